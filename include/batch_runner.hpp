@@ -0,0 +1,175 @@
+#pragma once
+
+#include "types.hpp"
+#include "config.hpp"
+#include "renderer.hpp"
+#include "render_pool.hpp"
+#include "output_sink.hpp"
+#include "depth_mesh.hpp"
+#include "sequence_mesh.hpp"
+#include "bounded_queue.hpp"
+#include "mapped_io.hpp"
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rgbd {
+namespace app {
+
+/**
+ * One RGB-D frame of a dataset
+ */
+struct FrameSpec {
+    std::string name;            // Output file prefix
+    std::string rgbPath;
+    std::string depthPath;
+    std::string cameraInfoPath;  // Empty: use the intrinsics from Config
+};
+
+/**
+ * Read a frame manifest
+ *
+ * One frame per line: "RGB DEPTH [CAMERA_INFO]", separated by whitespace.
+ * Relative paths are resolved against the manifest's directory; empty
+ * lines and lines starting with '#' are skipped. The frame name is the
+ * RGB file name without extension and "_rgb" suffix.
+ * @param path Manifest file
+ * @param frames Output frames, in manifest order
+ * @return true on success
+ */
+bool loadManifest(const std::string& path, std::vector<FrameSpec>& frames);
+
+/**
+ * Collect the frames of a dataset directory
+ *
+ * Matches RGB files against a file name pattern ('*' wildcards, default
+ * "*_rgb.*") and pairs each "<stem>_rgb.<ext>" with "<stem>_depth.png"
+ * (or .npy / .exr) and, if present, "<stem>_depth_camera_info.json".
+ * @param pattern Directory, or directory plus file name pattern ("data/*_rgb.png")
+ * @param frames Output frames, sorted by name
+ * @return true if at least one frame was found
+ */
+bool scanFrames(const std::string& pattern, std::vector<FrameSpec>& frames);
+
+/**
+ * Target intrinsics of one focal scale: focal length scaled, resolution
+ * from Config::outputWidth / outputHeight (principal point scaled along)
+ */
+Intrinsics focalScaleTarget(const Intrinsics& sourceK, const Config& config, float scale);
+
+/**
+ * Render every focal scale of one uploaded frame and queue the outputs
+ *
+ * Uses the layered batch path with Config::batch, otherwise keeps up to
+ * Config::pipelineDepth renders in flight. Files are named
+ * "<prefix>scale_<scale>"; with a frame EXR bundle the scales are queued
+ * together as "<prefix>scales.exr" (OutputSink::submitFrame()).
+ * @param renderer Renderer with the frame's geometry and texture uploaded
+ * @param sourceK Source camera intrinsics
+ * @param config Focal scales, output size and render settings
+ * @param sink Output writer
+ * @param prefix File name prefix (e.g. "<frame>_", may be empty)
+ * @return true if every scale rendered
+ */
+bool renderFocalScales(render::Renderer& renderer, const Intrinsics& sourceK,
+                       const Config& config, OutputSink& sink, const std::string& prefix);
+
+/**
+ * Render every focal scale of one uploaded frame into a callback
+ * @param consume Receives the index into Config::focalScales and the output,
+ *                in scale order, on the calling thread
+ * @return true if every scale rendered
+ */
+bool renderFocalScales(render::Renderer& renderer, const Intrinsics& sourceK, const Config& config,
+                       const std::function<void(size_t, RenderOutput&&)>& consume);
+
+/**
+ * Render every focal scale of one frame with the contexts of a pool device
+ *
+ * The frame is uploaded once and its scales are spread over the device's
+ * contexts (RenderPool::renderViews). Files are named as above.
+ * @param pool Initialized context pool
+ * @param upload Uploads the frame's geometry and texture to a renderer
+ * @return true if every scale rendered
+ */
+bool renderFocalScales(render::RenderPool& pool, const render::RenderPool::Upload& upload,
+                       const Intrinsics& sourceK, const Config& config,
+                       OutputSink& sink, const std::string& prefix);
+
+/**
+ * Multi-frame driver that keeps one renderer alive for a whole dataset
+ *
+ * Frames flow through three stages connected by bounded queues:
+ * a loader thread (RGB, depth, camera info), a meshing thread
+ * (DepthMesh::build, itself multithreaded; skipped in grid mode) and the
+ * calling thread, which owns the GL context and uploads / renders each
+ * frame. Saving runs on the OutputSink encoder threads. While frame N is
+ * rendered, frame N+1 is meshed and frame N+2 is loaded. Failed frames are
+ * reported and skipped. With a RenderPool the render stage hands each
+ * frame to the least-loaded context instead, so several frames render at
+ * once.
+ */
+class BatchRunner {
+public:
+    /**
+     * @param config Rendering, thresholds, fallback intrinsics and queue size
+     */
+    explicit BatchRunner(const Config& config);
+
+    // Non-copyable
+    BatchRunner(const BatchRunner&) = delete;
+    BatchRunner& operator=(const BatchRunner&) = delete;
+
+    /**
+     * Process all frames
+     * @param renderer Initialized renderer (used from the calling thread only)
+     * @param frames Frames to process
+     * @param sink Output writer
+     * @return true if every frame succeeded
+     */
+    bool run(render::Renderer& renderer, const std::vector<FrameSpec>& frames, OutputSink& sink);
+
+    /**
+     * Process all frames on a context pool
+     * @param pool Initialized pool; up to its size plus Config::frameQueue
+     *             frames are in flight
+     * @param frames Frames to process
+     * @param sink Output writer
+     * @return true if every frame succeeded
+     */
+    bool run(render::RenderPool& pool, const std::vector<FrameSpec>& frames, OutputSink& sink);
+
+    size_t getProcessedCount() const { return processed_; }
+    size_t getFailedCount() const { return failed_; }
+
+private:
+    struct LoadedFrame {
+        FrameSpec spec;
+        cv::Mat rgb;
+        cv::Mat depth;
+        std::shared_ptr<io::MappedFile> depthSource;  // Keeps a mapped depth file alive
+        Intrinsics K;
+    };
+
+    struct MeshedFrame {
+        LoadedFrame frame;
+        std::unique_ptr<mesh::DepthMesh> mesh;  // Null in grid and sequence mode
+        std::shared_ptr<const Mesh> sequenceMesh;  // Sequence mode snapshot
+        MeshUpdate update;                         // Changes since the previous snapshot
+    };
+
+    void loadStage(const std::vector<FrameSpec>& frames, BoundedQueue<LoadedFrame>& loaded);
+    void meshStage(BoundedQueue<LoadedFrame>& loaded, BoundedQueue<MeshedFrame>& meshed);
+    bool renderFrame(render::Renderer& renderer, MeshedFrame& frame, OutputSink& sink);
+
+    const Config& config_;
+    std::atomic<size_t> processed_{0};
+    std::atomic<size_t> failed_{0};
+    uint64_t uploadedVersion_ = 0;  // Sequence mesh version on the renderer
+};
+
+} // namespace app
+} // namespace rgbd
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "types.hpp"
+#include <string>
+
+namespace rgbd {
+namespace io {
+
+/**
+ * Load intrinsics from a ROS sensor_msgs/CameraInfo JSON dump
+ *
+ * Reads the row-major 3x3 "K" array (fx, cx, fy, cy), the "width" /
+ * "height" fields and the lens distortion ("distortion_model" and "D"), as
+ * written next to each frame in sample_data/ (*_depth_camera_info.json).
+ * plumb_bob is supported, and rational_polynomial whose k4..k6 are zero;
+ * other models are rejected unless all their coefficients are zero. The
+ * 3x4 "P" array gives the intrinsics of the rectified (undistorted) image.
+ * "R" and the remaining fields are ignored.
+ * @param path Path to the JSON file
+ * @param K Output intrinsics (width / height left unchanged if absent)
+ * @param rectified Optional output: intrinsics from P, without distortion
+ *                  (left unchanged if P is absent)
+ * @return true if a valid K array and a supported distortion were found
+ */
+bool loadCameraInfo(const std::string& path, Intrinsics& K, Intrinsics* rectified = nullptr);
+
+} // namespace io
+} // namespace rgbd
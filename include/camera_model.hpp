@@ -0,0 +1,83 @@
+#pragma once
+
+#include "types.hpp"
+#include <memory>
+#include <vector>
+
+namespace rgbd {
+namespace mesh {
+
+/**
+ * Invert the plumb_bob distortion of normalized image coordinates
+ *
+ * Fixed-point iteration x = (x_d - tangential(x)) / radial(x), as
+ * cv::undistortPoints does; converges for points inside the calibrated
+ * field of view.
+ * @param distortion Lens distortion
+ * @param xd Distorted x
+ * @param yd Distorted y
+ * @param x Undistorted x (the last iterate if not converged)
+ * @param y Undistorted y
+ * @return false if the iteration did not converge
+ */
+bool undistortPoint(const Distortion& distortion, float xd, float yd, float& x, float& y);
+
+/**
+ * Viewing rays of every pixel center of a camera
+ *
+ * Holds the undistorted normalized image coordinates (x, y) of pixel
+ * center (u + 0.5, v + 0.5), so the camera-space point at depth z is
+ * (x z, y z, z) and back-projection is one multiply by z per coordinate.
+ * Pinhole cameras fill the table in closed form, (u + 0.5 - cx) / fx;
+ * distorted ones run undistortPoint() once per pixel.
+ *
+ * Tables are shared through get(), which keeps the most recently used
+ * cameras, so a stream of frames from a fixed camera computes its table
+ * once. Tables are immutable and safe to read from any thread.
+ */
+class RayTable {
+public:
+    // Tables kept by get()
+    static constexpr size_t kCacheSize = 4;
+
+    /**
+     * Get the table of a camera, building it on first use
+     * @param K Camera intrinsics and distortion
+     * @param width Table width in pixels (the depth map's, may differ from K.width)
+     * @param height Table height in pixels
+     */
+    static std::shared_ptr<const RayTable> get(const Intrinsics& K, int width, int height);
+
+    /**
+     * Number of tables built since the process started (for tests)
+     */
+    static size_t buildCount();
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    const Intrinsics& intrinsics() const { return K_; }
+
+    /**
+     * Ray x / y of the pixels of row v
+     */
+    const float* rowX(int v) const { return x_.data() + static_cast<size_t>(v) * width_; }
+    const float* rowY(int v) const { return y_.data() + static_cast<size_t>(v) * width_; }
+
+    /**
+     * Pixels whose undistortion did not converge (rays are approximate)
+     */
+    size_t unconvergedCount() const { return unconverged_; }
+
+    RayTable(const Intrinsics& K, int width, int height);
+
+private:
+    Intrinsics K_;
+    int width_;
+    int height_;
+    std::vector<float> x_;
+    std::vector<float> y_;
+    size_t unconverged_ = 0;
+};
+
+} // namespace mesh
+} // namespace rgbd
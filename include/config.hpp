@@ -1,12 +1,24 @@
 #pragma once
 
 #include "types.hpp"
+#include "mesh_generator.hpp"
+#include "sequence_mesh.hpp"
+#include "depth_io.hpp"
 #include <string>
 #include <vector>
 
 namespace rgbd {
 namespace app {
 
+/**
+ * Grouping of the rendered outputs into EXR files
+ */
+enum class ExrBundle {
+    None,   // Depth EXR per scale, RGB and mask as PNG
+    Scale,  // One EXR per scale with the channels R, G, B, Z and mask
+    Frame   // One multi-part EXR per frame, a part per scale
+};
+
 /**
  * Application configuration
  */
@@ -16,11 +28,26 @@ struct Config {
     std::string depthPath;
     std::string outputDir = "./output";
     
+    // Multi-frame input (replaces rgbPath / depthPath when set)
+    std::string manifestPath;  // Lines of "RGB DEPTH [CAMERA_INFO]"
+    std::string inputDir;      // Directory or glob of *_rgb.* files
+    
+    // Frames buffered between the load, mesh and render stages
+    int frameQueue = 2;
+    
+    // Serve render requests on this Unix domain socket instead of rendering inputs
+    std::string serveSocket;
+    
     // Source intrinsics
     float fx = 525.0f;
     float fy = 525.0f;
     float cx = -1.0f;  // -1 means use image center
     float cy = -1.0f;
+    std::vector<float> distortion;  // plumb_bob k1,k2,p1,p2[,k3], empty means pinhole
+    std::string cameraInfoPath;     // Single-frame camera info, replaces the values above
+    
+    // Lens distortion of the targets: "source" (same lens) or "none" (pinhole)
+    std::string targetDistortion = "source";
     
     // Depth scale (to convert to meters)
     float depthScale = 1.0f;  // e.g., 0.001 if depth is in mm
@@ -41,11 +68,74 @@ struct Config {
     float farPlane = 100.0f;
     int gpuDevice = -1;
     
+    // GL context pool: contexts per EGL device and the devices to use
+    // ("all" or comma-separated indices, empty = gpuDevice only)
+    int glContexts = 1;
+    std::string gpuList;
+    
+    // Linked shader program cache of the gl backend (empty = compile every run)
+    std::string shaderCacheDir;
+    
+    // Rendering backend: "gl" (OpenGL via EGL), "cpu" (software rasterizer)
+    // or "resample" (inverse-mapping resampler of the depth grid)
+    std::string backend = "gl";
+    
+    // Geometry source: "mesh" (CPU mesh upload) or "grid" (depth texture only)
+    std::string renderMode = "mesh";
+    
+    // Mesh vertex layout: "float32", "depth_pixel" or "quantized16"
+    std::string vertexLayout = "float32";
+    
+    // Mesh index mode: "triangles", "strips" or "meshlets"
+    std::string indexMode = "triangles";
+    
+    // Adaptive meshing bounds (reprojection error in target pixels, 0 = full grid)
+    float adaptiveError = 0.0f;
+    float adaptiveDepthError = 0.01f;
+    
+    // Incremental meshing of consecutive frames (multi-frame input)
+    bool sequence = false;
+    float sequenceTolerance = 0.0f;   // Depth change (meters) ignored between frames
+    float sequenceRebuild = 0.5f;     // Changed tile fraction above which the mesh is rebuilt
+    
+    // Renders kept in flight while earlier results are read back
+    int pipelineDepth = 2;
+    
+    // Render all focal scales in one layered pass (needs equal output sizes)
+    bool batch = false;
+    
+    // CPU threads for mesh generation and the cpu backend (0 = all hardware threads)
+    int numThreads = 0;
+    
+    // Output encoder threads (0 = all hardware threads)
+    int encodeThreads = 0;
+    
+    // Rendered outputs (comma-separated rgb, depth, mask) and their formats
+    std::string outputs = "rgb,depth,mask";
+    std::string depthFormat = "float32";  // "float32", "float16" or "mm16" (R16UI millimeters)
+    bool maskFromDepth = false;           // Mask from depth > 0 on the CPU, no mask target
+    
     // Output formats
     bool saveExr = true;
     bool saveNpy = false;
     bool savePng = true;
     
+    // EXR writer: compression ("none", "zip", "zips", "piz", "dwaa"), HALF
+    // depth, OpenEXR threads per file (0 = all hardware threads) and bundling
+    // ("none", "scale" or "frame", see ExrBundle)
+    std::string exrCompression = "zip";
+    bool exrHalf = false;
+    int exrThreads = 0;
+    std::string exrBundle = "none";
+    
+    // Tar shard output: shard size limit in MiB (0 = separate files) and
+    // per-shard .idx sidecars (see io::TarShardWriter)
+    int tarShardMB = 0;
+    bool tarIndex = false;
+    
+    // Chrome trace-event JSON of every pipeline stage (empty = no tracing)
+    std::string tracePath;
+    
     /**
      * Get depth thresholds struct
      */
@@ -53,6 +143,82 @@ struct Config {
         return DepthThresholds(tauRel, tauAbs);
     }
     
+    /**
+     * Get the mesh vertex layout (Float32 if the name is unknown)
+     */
+    VertexLayout getVertexLayout() const;
+    
+    /**
+     * Get the mesh index mode (Triangles if the name is unknown)
+     */
+    IndexMode getIndexMode() const;
+    
+    /**
+     * Get the selected outputs (all, float32 depth if a name is unknown)
+     */
+    OutputSelection getOutputSelection() const;
+    
+    /**
+     * Get the adaptive meshing options, bounded for the largest focal scale
+     */
+    mesh::AdaptiveOptions getAdaptiveOptions() const;
+    
+    /**
+     * Get the EXR writer options (ZIP if the compression is unknown)
+     */
+    io::ExrOptions getExrOptions() const;
+    
+    /**
+     * Get the EXR bundling (None if the name is unknown)
+     */
+    ExrBundle getExrBundle() const;
+    
+    /**
+     * Get the sequence meshing options
+     */
+    mesh::SequenceOptions getSequenceOptions() const;
+    
+    /**
+     * Source intrinsics of a frame from fx / fy / cx / cy and the distortion
+     * (cx / cy default to the image center)
+     * @param width Image width
+     * @param height Image height
+     */
+    Intrinsics getSourceIntrinsics(int width, int height) const;
+    
+    /**
+     * Check if frames are uploaded as depth grids (uploadDepth) instead of meshes
+     */
+    bool usesDepthGrid() const {
+        return renderMode == "grid" || backend == "resample";
+    }
+    
+    /**
+     * Check if rendering goes through a pool of GL contexts
+     */
+    bool usesRenderPool() const {
+        return glContexts > 1 || !gpuList.empty();
+    }
+    
+    /**
+     * EGL devices of the context pool (empty = every device)
+     */
+    std::vector<int> getPoolDevices() const;
+    
+    /**
+     * Check if a dataset (manifest or directory) is processed
+     */
+    bool isMultiFrame() const {
+        return !manifestPath.empty() || !inputDir.empty();
+    }
+    
+    /**
+     * Check if requests are served on a socket
+     */
+    bool isServer() const {
+        return !serveSocket.empty();
+    }
+    
     /**
      * Validate configuration
      * @return Error message (empty if valid)
@@ -74,6 +240,15 @@ struct Config {
  */
 bool parseArgs(int argc, char** argv, Config& config);
 
+/**
+ * Parse an output list (any of "rgb,depth,mask") and a depth format name
+ * ("float32", "float16", "mm16")
+ * @param outputs Output selection (maskFromDepth is left unchanged)
+ * @return false for an unknown name or an empty list
+ */
+bool parseOutputSelection(const std::string& list, const std::string& depthFormat,
+                          OutputSelection& outputs);
+
 /**
  * Print usage information
  */
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "renderer.hpp"
+#include "simd.hpp"
+
+namespace rgbd {
+namespace render {
+
+/**
+ * Tiled multithreaded software rasterizer
+ *
+ * Renders the same mesh / texture / intrinsics as GLRenderer without any
+ * GL context, for machines without a GPU. The frame is split into square
+ * tiles; triangles are set up and binned to the tiles they touch in
+ * parallel chunks, then tiles are rasterized in parallel, each by one
+ * thread, walking the chunks in submission order so depth ties resolve
+ * like GL_LESS in draw order.
+ *
+ * Rasterization follows the GL pipeline: the same projection matrix,
+ * near/far clipping, 8-bit subpixel vertex snapping, pixel-center sampling
+ * with a top-left fill rule, perspective-correct interpolation of UV and
+ * metric depth, a strict less-than depth test on 1/w and bilinear,
+ * clamp-to-edge texture sampling. Target lens distortion moves the
+ * vertices before clipping, as GLRenderer's vertex shader does. Edge
+ * functions are evaluated 8 pixels at a time with AVX2 where available.
+ *
+ * Tolerance against GLRenderer (checked in test_rerender): coverage may
+ * differ on a few silhouette pixels (< 0.5% of the frame) where the GL
+ * driver's fixed-point rules and 24-bit depth buffer differ; metric depth
+ * of pixels covered by both agrees within 1e-3 relative; RGB within 2
+ * levels except where a different triangle won the depth test.
+ */
+class CpuRenderer : public Renderer {
+public:
+    // Tile edge length in pixels
+    static constexpr int kTileSize = 64;
+
+    CpuRenderer();
+    ~CpuRenderer() override;
+
+    // Non-copyable
+    CpuRenderer(const CpuRenderer&) = delete;
+    CpuRenderer& operator=(const CpuRenderer&) = delete;
+
+    bool initialize(int gpuDevice = -1) override;
+    bool uploadMesh(const Mesh& mesh) override;
+    bool uploadTexture(const cv::Mat& texture) override;
+    bool render(const Intrinsics& sourceK, const Intrinsics& targetK,
+                float nearPlane, float farPlane, RenderOutput& output) override;
+    bool isInitialized() const override { return initialized_; }
+    std::string getInfo() const override;
+    void cleanup() override;
+
+    /**
+     * Set the number of rasterizer threads
+     * @param numThreads Thread count (0 = all hardware threads)
+     */
+    void setNumThreads(int numThreads) { numThreads_ = numThreads; }
+
+    /**
+     * Select the instruction set of the edge function kernel
+     * @param level Requested level (clamped to what the CPU supports)
+     */
+    void setSimdLevel(SimdLevel level) { simdLevel_ = level; }
+
+private:
+    Mesh mesh_;
+    cv::Mat texture_;  // CV_8UC3, RGB order
+    int numThreads_ = 0;
+    SimdLevel simdLevel_ = activeSimdLevel();
+    bool initialized_ = false;
+};
+
+} // namespace render
+} // namespace rgbd
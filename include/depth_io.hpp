@@ -1,5 +1,6 @@
 #pragma once
 
+#include "types.hpp"
 #include <string>
 #include <vector>
 #include <opencv2/core.hpp>
@@ -7,9 +8,58 @@
 namespace rgbd {
 namespace io {
 
+/**
+ * EXR compression methods (lossless except DWAA on HALF channels)
+ */
+enum class ExrCompression {
+    None,
+    ZIP,   // zlib, 16 scanlines per block
+    ZIPS,  // zlib, one scanline per block
+    PIZ,   // Wavelet + Huffman, best ratio on noisy images
+    DWAA   // Lossy DCT for HALF channels (FLOAT channels stay lossless)
+};
+
+/**
+ * Parse a compression name ("none", "zip", "zips", "piz", "dwaa")
+ * @return false if the name is unknown
+ */
+bool parseExrCompression(const std::string& name, ExrCompression& compression);
+
+/**
+ * Name of a compression method
+ */
+const char* exrCompressionName(ExrCompression compression);
+
+/**
+ * EXR writer settings
+ */
+struct ExrOptions {
+    ExrCompression compression = ExrCompression::ZIP;
+    bool halfDepth = false;  // Store depth as HALF (about 3 significant digits, up to 65504 m)
+};
+
+/**
+ * One image of a bundled EXR file
+ */
+struct ExrPart {
+    std::string name;                        // Part name of multi-part files
+    const RenderOutput* output = nullptr;    // Empty buffers are left out
+};
+
+/**
+ * Check if EXR files are written with OpenEXR (otherwise depth falls back to TIFF)
+ */
+bool exrAvailable();
+
+/**
+ * Set the OpenEXR worker threads that compress the line blocks of a file
+ * @param numThreads Thread count (0 = all hardware threads)
+ */
+void setExrThreadCount(int numThreads);
+
 /**
  * Load a depth map from file
- * Supports: PNG (16-bit), EXR (float32), NPY
+ * Supports: PNG (16-bit), EXR (channel "Z", "depth" or "Y" of the first part), NPY
  * @param path Path to depth file
  * @param scale Scale factor to convert to meters (e.g., 0.001 for mm to m)
  * @return Depth map as float32, values in meters
@@ -25,7 +75,7 @@ cv::Mat loadDepth(const std::string& path, float scale = 1.0f);
  * @return true on success
  */
 bool saveDepthEXR(const std::string& path, const std::vector<float>& depth,
-                  int width, int height);
+                  int width, int height, const ExrOptions& options = ExrOptions());
 
 /**
  * Save depth map to EXR format (float32)
@@ -35,6 +85,37 @@ bool saveDepthEXR(const std::string& path, const std::vector<float>& depth,
  */
 bool saveDepthEXR(const std::string& path, const cv::Mat& depth);
 
+/**
+ * Save render outputs as channels of one EXR file
+ *
+ * Each output becomes the channels R, G, B (HALF, 0-1), Z (meters, FLOAT
+ * or HALF) and mask (HALF, 0/1) of its buffers that are not empty. A single
+ * part is written as a plain scanline file, several as a multi-part file
+ * with one named part per output.
+ * @param path Output path (should end with .exr)
+ * @param parts Outputs to bundle (at least one)
+ * @param options Compression and depth precision
+ * @return true on success (false without OpenEXR)
+ */
+bool saveOutputsEXR(const std::string& path, const std::vector<ExrPart>& parts,
+                    const ExrOptions& options = ExrOptions());
+
+/**
+ * Encoders behind the save functions: the same file, into memory
+ * @param bytes Output: encoded file
+ * @return true on success
+ */
+bool encodeDepthEXR(const std::vector<float>& depth, int width, int height,
+                    const ExrOptions& options, std::vector<uint8_t>& bytes);  // TIFF without OpenEXR
+bool encodeOutputsEXR(const std::vector<ExrPart>& parts, const ExrOptions& options,
+                      std::vector<uint8_t>& bytes);
+bool encodeDepthPNG(const std::vector<float>& depth, int width, int height, float scale,
+                    std::vector<uint8_t>& bytes);
+bool encodeDepthNPY(const std::vector<float>& depth, int width, int height,
+                    std::vector<uint8_t>& bytes);
+bool encodeMask(const std::vector<uint8_t>& mask, int width, int height,
+                std::vector<uint8_t>& bytes);
+
 /**
  * Save depth map to PNG format (16-bit)
  * @param path Output path
@@ -59,7 +140,7 @@ bool saveDepthNPY(const std::string& path, const std::vector<float>& depth,
                   int width, int height);
 
 /**
- * Load depth from NPY format
+ * Load depth from NPY format (see mapNPY for the accepted dtypes / layouts)
  * @param path Path to NPY file
  * @return Depth as cv::Mat (CV_32F)
  */
@@ -28,6 +28,35 @@ public:
                const Intrinsics& intrinsics,
                const DepthThresholds& thresholds = DepthThresholds());
     
+    /**
+     * Set the number of threads used for mesh generation
+     * @param numThreads Thread count (0 = all hardware threads, 1 = serial)
+     */
+    void setNumThreads(int numThreads) { numThreads_ = numThreads; }
+    
+    /**
+     * Set the vertex layout of the generated mesh
+     * @param layout VertexLayout::Float32 (default), DepthPixel or Quantized16
+     */
+    void setVertexLayout(VertexLayout layout) { layout_ = layout; }
+    
+    /**
+     * Set the index mode of the generated mesh
+     * @param mode IndexMode::Triangles (default), Strips or Meshlets
+     */
+    void setIndexMode(IndexMode mode) { indexMode_ = mode; }
+    
+    /**
+     * Enable adaptive quadtree meshing
+     * @param options Error bounds (maxErrorPx = 0 keeps the full grid)
+     */
+    void setAdaptive(const AdaptiveOptions& options) { adaptive_ = options; }
+    
+    /**
+     * Statistics of the last adaptive build()
+     */
+    const AdaptiveReport& getAdaptiveReport() const { return adaptiveReport_; }
+    
     /**
      * Get the generated mesh
      */
@@ -65,6 +94,11 @@ private:
     Intrinsics intrinsics_;
     float minDepth_ = 0.0f;
     float maxDepth_ = 0.0f;
+    int numThreads_ = 0;
+    VertexLayout layout_ = VertexLayout::Float32;
+    IndexMode indexMode_ = IndexMode::Triangles;
+    AdaptiveOptions adaptive_;
+    AdaptiveReport adaptiveReport_;
 };
 
 } // namespace mesh
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "types.hpp"
+#include "simd.hpp"
+#include <opencv2/core.hpp>
+
+namespace rgbd {
+namespace mesh {
+
+/**
+ * Per-pixel edge mask bits
+ *
+ * A set bit means the grid edge leaving pixel (u, v) in that direction is
+ * unbroken: both endpoints have valid depth and DepthThresholds does not
+ * report a discontinuity between them.
+ */
+constexpr uint8_t kEdgeRight = 1 << 0;  // (u, v) - (u+1, v)
+constexpr uint8_t kEdgeDown = 1 << 1;   // (u, v) - (u, v+1)
+constexpr uint8_t kEdgeDiag = 1 << 2;   // (u, v) - (u+1, v+1)
+
+/**
+ * Compute the edge mask of one depth row
+ *
+ * Evaluates exactly DepthThresholds::isDiscontinuity for the horizontal,
+ * vertical and diagonal edge of every pixel, several pixels at a time.
+ * @param row0 Depth row v (width floats)
+ * @param row1 Depth row v+1, or nullptr for the last row
+ * @param width Row width in pixels
+ * @param thresholds Depth discontinuity thresholds
+ * @param out Output mask row (width bytes)
+ * @param level Instruction set to use (clamped to what the CPU supports)
+ */
+void computeEdgeMaskRow(const float* row0, const float* row1, int width,
+                        const DepthThresholds& thresholds, uint8_t* out,
+                        SimdLevel level = activeSimdLevel());
+
+/**
+ * Compute the edge mask of a whole depth map
+ * @param depth Depth map (CV_32F, meters)
+ * @param thresholds Depth discontinuity thresholds
+ * @param level Instruction set to use
+ * @param numThreads Thread count (0 = all hardware threads)
+ * @return Edge mask (CV_8U, kEdge* bits per pixel)
+ */
+cv::Mat computeEdgeMask(const cv::Mat& depth, const DepthThresholds& thresholds,
+                        SimdLevel level = activeSimdLevel(), int numThreads = 0);
+
+/**
+ * Check the upper triangle (v00, v10, v11) of quad (u, v) from its mask rows
+ */
+inline bool upperTriangleUnbroken(const uint8_t* edgeRow0, int u) {
+    return (edgeRow0[u] & (kEdgeRight | kEdgeDiag)) == (kEdgeRight | kEdgeDiag) &&
+           (edgeRow0[u + 1] & kEdgeDown) != 0;
+}
+
+/**
+ * Check the lower triangle (v00, v11, v01) of quad (u, v) from its mask rows
+ */
+inline bool lowerTriangleUnbroken(const uint8_t* edgeRow0, const uint8_t* edgeRow1, int u) {
+    return (edgeRow0[u] & (kEdgeDown | kEdgeDiag)) == (kEdgeDown | kEdgeDiag) &&
+           (edgeRow1[u] & kEdgeRight) != 0;
+}
+
+} // namespace mesh
+} // namespace rgbd
@@ -11,6 +11,10 @@ namespace render {
  * 
  * This class creates an EGL context without requiring a display,
  * enabling GPU-accelerated rendering on servers and in CLI pipelines.
+ * Contexts created with a share context on the same device form a share
+ * group: buffers, textures and programs of one are usable by all of them
+ * (VAOs and framebuffers are not shared). Each context is current on at
+ * most one thread at a time.
  */
 class GLContext {
 public:
@@ -26,11 +30,30 @@ public:
     GLContext& operator=(GLContext&& other) noexcept;
     
     /**
-     * Initialize EGL context
+     * Initialize EGL context and make it current on the calling thread
      * @param deviceIndex GPU device index (-1 for default)
+     * @param shareWith Initialized context whose objects this one shares
+     *                  (its device is used, deviceIndex is ignored)
      * @return true on success
      */
-    bool initialize(int deviceIndex = -1);
+    bool initialize(int deviceIndex = -1, const GLContext* shareWith = nullptr);
+    
+    /**
+     * Number of EGL devices (0 if device enumeration is unsupported)
+     */
+    static int queryDeviceCount();
+    
+    /**
+     * Device index the context was created on (-1 for the default display)
+     */
+    int getDevice() const { return device_; }
+    
+    /**
+     * Check if both contexts belong to the same share group
+     */
+    bool sharesObjectsWith(const GLContext& other) const {
+        return initialized_ && other.initialized_ && shareGroup_ == other.shareGroup_;
+    }
     
     /**
      * Make this context current
@@ -65,8 +88,11 @@ public:
     
 private:
     void* display_ = nullptr;
+    void* config_ = nullptr;
     void* context_ = nullptr;
     void* surface_ = nullptr;
+    void* shareGroup_ = nullptr;  // Context that started the share group
+    int device_ = -1;
     bool initialized_ = false;
 };
 
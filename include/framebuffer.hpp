@@ -1,5 +1,6 @@
 #pragma once
 
+#include "types.hpp"
 #include <cstdint>
 #include <vector>
 
@@ -11,9 +12,20 @@ namespace render {
  * 
  * Attachments:
  * - Color0: RGB output (RGBA8)
- * - Color1: Metric depth (R32F) 
+ * - Color1: Metric depth (R32F, R16F or R16UI millimeters)
  * - Color2: Validity mask (R8)
  * - Depth: Z-buffer for depth testing
+ * 
+ * Only the color attachments of the OutputSelection are created, drawn
+ * (the others are GL_NONE draw buffers) and read back; reduced-precision
+ * depth is widened to float meters on readback.
+ * 
+ * A layered framebuffer uses 2D texture arrays for every attachment, so a
+ * geometry shader can route each primitive to a layer with gl_Layer.
+ * 
+ * Besides the blocking read* calls, all color attachments can be read back
+ * asynchronously into pixel-pack buffers guarded by a fence, so the GPU can
+ * keep rendering into other framebuffers while the transfer completes.
  */
 class Framebuffer {
 public:
@@ -32,9 +44,21 @@ public:
      * Create framebuffer with specified size
      * @param width Framebuffer width
      * @param height Framebuffer height
+     * @param outputs Render targets to create (default: all, float32 depth)
+     * @return true on success
+     */
+    bool create(int width, int height, const OutputSelection& outputs = OutputSelection());
+    
+    /**
+     * Create layered framebuffer (texture array attachments)
+     * @param width Framebuffer width
+     * @param height Framebuffer height
+     * @param layers Number of layers
+     * @param outputs Render targets to create (default: all, float32 depth)
      * @return true on success
      */
-    bool create(int width, int height);
+    bool createLayered(int width, int height, int layers,
+                       const OutputSelection& outputs = OutputSelection());
     
     /**
      * Bind this framebuffer for rendering
@@ -47,40 +71,84 @@ public:
     static void unbind();
     
     /**
-     * Clear all attachments
+     * Bind and clear all attachments (every layer when layered)
+     * Integer targets cannot be cleared with glClear, so each attachment
+     * is cleared with the glClearBuffer call of its type.
      * @param clearDepthValue Value for metric depth buffer (default: 0)
      */
     void clear(float clearDepthValue = 0.0f) const;
     
     /**
-     * Read RGB data from framebuffer
-     * @param data Output buffer (must be preallocated: width * height * 3)
+     * Read RGB data from framebuffer (layer 0 when layered)
+     * Without an RGB attachment data is left empty (likewise for depth / mask).
+     * @param data Output buffer (resized to width * height * 3)
      */
     void readRGB(std::vector<uint8_t>& data) const;
     
     /**
      * Read metric depth from framebuffer
-     * @param data Output buffer (must be preallocated: width * height)
+     * @param data Output buffer (resized to width * height)
      */
     void readDepth(std::vector<float>& data) const;
     
     /**
      * Read mask from framebuffer
-     * @param data Output buffer (must be preallocated: width * height)
+     * @param data Output buffer (resized to width * height)
      */
     void readMask(std::vector<uint8_t>& data) const;
     
+    /**
+     * Start an asynchronous readback of all color attachments
+     * Returns immediately; a fence marks the end of the transfer.
+     */
+    void beginReadback();
+    
+    /**
+     * Check whether an asynchronous readback is in flight
+     */
+    bool isReadbackPending() const { return fence_ != nullptr; }
+    
+    /**
+     * Check without blocking whether the pending readback has completed
+     */
+    bool isReadbackComplete() const;
+    
+    /**
+     * Wait for the pending readback and copy it out
+     * @param output Selected outputs (OutputSelection::select applied)
+     * @return true on success
+     */
+    bool finishReadback(RenderOutput& output);
+    
+    /**
+     * Wait for the pending readback of a layered framebuffer
+     * @param outputs One output per layer (resized to getLayerCount())
+     * @return true on success
+     */
+    bool finishReadback(std::vector<RenderOutput>& outputs);
+    
     /**
      * Get framebuffer dimensions
      */
     int getWidth() const { return width_; }
     int getHeight() const { return height_; }
     
+    /**
+     * Number of layers (1 for a plain framebuffer)
+     */
+    int getLayerCount() const { return layers_ > 0 ? layers_ : 1; }
+    bool isLayered() const { return layers_ > 0; }
+    
     /**
      * Check if framebuffer is valid
      */
     bool isValid() const { return fboId_ != 0; }
     
+    /**
+     * Render targets the framebuffer was created with
+     */
+    const OutputSelection& getOutputs() const { return outputs_; }
+    
     /**
      * Get texture IDs
      */
@@ -97,8 +165,23 @@ private:
     uint32_t fboId_ = 0;
     uint32_t colorTextures_[3] = {0, 0, 0};  // RGB, Depth, Mask
     uint32_t depthRbo_ = 0;  // Renderbuffer for z-test
+    uint32_t depthArrayTexture_ = 0;  // Layered z-test buffer
+    uint32_t packBuffers_[3] = {0, 0, 0};  // PBOs for RGB, Depth, Mask (0 when not created)
+    OutputSelection outputs_;
+    void* fence_ = nullptr;  // GLsync of the pending readback
     int width_ = 0;
     int height_ = 0;
+    int layers_ = 0;  // 0 = plain 2D attachments
+    
+    /**
+     * Create attachments (2D when layers == 0, texture arrays otherwise)
+     */
+    bool createAttachments(int width, int height, int layers, const OutputSelection& outputs);
+    
+    /**
+     * Wait for the pending readback and copy every layer into outputs
+     */
+    bool finishReadbackInto(RenderOutput* outputs);
     
     /**
      * Check framebuffer completeness
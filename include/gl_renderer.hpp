@@ -1,30 +1,67 @@
 #pragma once
 
 #include "types.hpp"
+#include "renderer.hpp"
 #include "depth_mesh.hpp"
 #include "egl_context.hpp"
 #include "shader.hpp"
 #include "framebuffer.hpp"
+#include "gpu_timer.hpp"
 #include <opencv2/core.hpp>
+#include <array>
+#include <map>
 #include <memory>
+#include <string>
+#include <deque>
+#include <vector>
 
 namespace rgbd {
 namespace render {
 
+/**
+ * Geometry source used by GLRenderer::render
+ */
+enum class RenderMode {
+    Mesh,          // CPU-generated mesh uploaded with uploadMesh()
+    ImplicitGrid   // Depth texture uploaded with uploadDepth(), quads built in the vertex shader
+};
+
 /**
  * OpenGL renderer for RGBD re-rendering
  * 
  * This class handles:
- * - Uploading mesh data to GPU (VBO/EBO)
+ * - Uploading mesh data to GPU (VBO/EBO) in any VertexLayout and IndexMode
+ *   (triangle lists, restart-separated strips or base-vertex meshlets), or
+ *   only the depth map for the implicit grid mode where the vertex shader
+ *   rebuilds every quad from gl_VertexID/gl_InstanceID and discards
+ *   triangles across discontinuities
  * - Uploading RGB texture
  * - Setting up projection matrix from intrinsics
- * - Rendering to FBO with MRT (RGB, depth, mask)
- * - Reading back results
+ * - Culling meshlet tiles outside the target views on the CPU and drawing
+ *   the visible ones with one indirect multi-draw, so zoomed-in views only
+ *   process the vertices of the part they show
+ * - Rendering to FBO with MRT (RGB, depth, mask), restricted to the outputs
+ *   of setOutputs(): each render target combination and depth format has
+ *   its own fragment shader variant, built on first use
+ * - Reading back results, either blocking (render) or pipelined through a
+ *   ring of framebuffers with fenced PBO readback (submit / retrieve)
+ * - Batch rendering of many views in one instanced pass into texture array
+ *   layers (renderBatch)
+ * - Optionally caching linked shader programs on disk (setShaderCacheDir),
+ *   which skips GLSL compilation when a later process starts
+ * - Sharing uploaded geometry between renderers whose contexts form one
+ *   EGL share group (initializeShared / shareGeometry), so several threads
+ *   can draw a mesh and texture uploaded once
+ * - Timing uploads, draws and readbacks with GL timer queries while
+ *   tracing (GpuTimer), one trace track per context
  */
-class GLRenderer {
+class GLRenderer : public Renderer {
 public:
+    // Views per layered pass (size of the projection uniform array)
+    static constexpr int kMaxBatchLayers = 16;
+    
     GLRenderer();
-    ~GLRenderer();
+    ~GLRenderer() override;
     
     // Non-copyable
     GLRenderer(const GLRenderer&) = delete;
@@ -35,21 +72,102 @@ public:
      * @param gpuDevice GPU device index (-1 for default)
      * @return true on success
      */
-    bool initialize(int gpuDevice = -1);
+    bool initialize(int gpuDevice = -1) override;
+    
+    /**
+     * Initialize with a context in the share group of another renderer
+     * The owner may be current on another thread; this renderer becomes
+     * current on the calling thread.
+     * @param owner Initialized renderer on the device to use
+     * @return true on success
+     */
+    bool initializeShared(const GLRenderer& owner);
+    
+    /**
+     * Draw the geometry and texture uploaded by another renderer
+     * 
+     * Buffers and textures are referenced, not copied; only this renderer's
+     * vertex array is set up. The owner's uploads must be complete
+     * (finishUploads() on its thread) and it must not upload again while
+     * this renderer draws. A later upload on this renderer replaces the
+     * shared objects with its own.
+     * @param owner Renderer of the same share group
+     * @return true on success
+     */
+    bool shareGeometry(const GLRenderer& owner);
+    
+    /**
+     * Wait until uploads are complete, making them visible to the share group
+     */
+    void finishUploads();
+    
+    /**
+     * EGL device of the context (-1 for the default display)
+     */
+    int getDevice() const { return eglContext_.getDevice(); }
+    
+    /**
+     * Set the program binary cache directory
+     * Must be called before initialize().
+     * @param directory Cache directory (empty disables the cache)
+     */
+    void setShaderCacheDir(const std::string& directory) { shaderCacheDir_ = directory; }
     
     /**
      * Upload mesh data to GPU
+     * Compact layouts are uploaded as is and decoded in the vertex shader;
+     * DepthPixel meshes take X, Y and UV from the sourceK passed to render().
      * @param mesh Mesh with vertices and triangles
      * @return true on success
      */
-    bool uploadMesh(const Mesh& mesh);
+    bool uploadMesh(const Mesh& mesh) override;
+    
+    /**
+     * Rewrite the changed ranges of the uploaded mesh with glBufferSubData
+     * Falls back to a full upload for a full update, a mesh of another
+     * size, layout or index mode, or geometry shared from another renderer.
+     * @param mesh Mesh after the update
+     * @param update Changed vertex and index ranges
+     * @return true on success
+     */
+    bool updateMesh(const Mesh& mesh, const MeshUpdate& update) override;
+    
+    /**
+     * Upload depth map for the implicit grid render mode
+     * @param depth Depth map (meters, converted to CV_32F if needed)
+     * @param thresholds Depth discontinuity thresholds evaluated on the GPU
+     * @return true on success
+     */
+    bool uploadDepth(const cv::Mat& depth, const DepthThresholds& thresholds) override;
+    
+    /**
+     * Select the geometry source used by render()
+     * @param mode RenderMode::Mesh (default) or RenderMode::ImplicitGrid
+     */
+    void setRenderMode(RenderMode mode) { mode_ = mode; }
+    
+    /**
+     * Get the current render mode
+     */
+    RenderMode getRenderMode() const { return mode_; }
+    
+    /**
+     * Enable or disable meshlet culling (enabled by default)
+     * Only affects meshes in IndexMode::Meshlets; disabled, every meshlet is drawn.
+     */
+    void setMeshletCulling(bool enabled) { meshletCulling_ = enabled; }
+    
+    /**
+     * Triangles submitted by the last draw (per view), after meshlet culling
+     */
+    size_t getDrawnTriangles() const { return drawnTriangles_; }
     
     /**
      * Upload RGB texture to GPU
      * @param texture RGB image (CV_8UC3)
      * @return true on success
      */
-    bool uploadTexture(const cv::Mat& texture);
+    bool uploadTexture(const cv::Mat& texture) override;
     
     /**
      * Render with target intrinsics
@@ -61,27 +179,144 @@ public:
      * @return true on success
      */
     bool render(const Intrinsics& sourceK, const Intrinsics& targetK,
-                float nearPlane, float farPlane, RenderOutput& output);
+                float nearPlane, float farPlane, RenderOutput& output) override;
+    
+    /**
+     * Render several target views in one submission
+     * 
+     * Each view is drawn into its own layer of a texture array framebuffer:
+     * the geometry is instanced once per view, the projection comes from a
+     * per-layer uniform buffer and a geometry shader sets gl_Layer. All
+     * layers are read back together. Views beyond kMaxBatchLayers are
+     * rendered in further passes.
+     * @param sourceK Source camera intrinsics
+     * @param targetKs Target intrinsics (all with the same width and height)
+     * @param nearPlane Near clipping plane (meters)
+     * @param farPlane Far clipping plane (meters)
+     * @param outputs One output per target, in order
+     * @return true on success
+     */
+    bool renderBatch(const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs,
+                     float nearPlane, float farPlane, std::vector<RenderOutput>& outputs) override;
+    
+    /**
+     * Queue a render and start its readback without waiting for it
+     * 
+     * Each submission renders into its own framebuffer of the readback ring,
+     * so the next one can be drawn while earlier transfers are in flight.
+     * Fails when getPipelineDepth() renders are already pending.
+     * @param sourceK Source camera intrinsics
+     * @param targetK Target camera intrinsics
+     * @param nearPlane Near clipping plane (meters)
+     * @param farPlane Far clipping plane (meters)
+     * @return true on success
+     */
+    bool submit(const Intrinsics& sourceK, const Intrinsics& targetK,
+                float nearPlane, float farPlane) override;
+    
+    /**
+     * Wait for the oldest pending render and read it back
+     * @param output Output render targets
+     * @return true on success
+     */
+    bool retrieve(RenderOutput& output) override;
+    
+    /**
+     * Number of submitted renders not retrieved yet
+     */
+    size_t pendingCount() const override { return pending_.size(); }
+    
+    /**
+     * Set the number of framebuffers in the readback ring
+     * Only allowed while no render is pending.
+     * @param depth Maximum number of renders in flight (>= 1)
+     */
+    void setPipelineDepth(int depth) override;
+    
+    /**
+     * Get the number of framebuffers in the readback ring
+     */
+    int getPipelineDepth() const override { return pipelineDepth_; }
     
     /**
      * Check if renderer is initialized
      */
-    bool isInitialized() const { return initialized_; }
+    bool isInitialized() const override { return initialized_; }
     
     /**
      * Get OpenGL info
      */
     std::string getGLInfo() const;
+    std::string getInfo() const override { return getGLInfo(); }
     
     /**
      * Cleanup all resources
      */
-    void cleanup();
+    void cleanup() override;
     
 private:
+    static constexpr int kNumVertexLayouts = 3;
+    
+    /**
+     * Uniform handles of one program, resolved once it is loaded
+     */
+    struct ProgramUniforms {
+        Uniform projection;
+        Uniform rgbTexture;
+        Uniform depthTexture;
+        Uniform sourceK;
+        Uniform sourceSize;
+        Uniform gridSize;
+        Uniform tauRel;
+        Uniform tauAbs;
+        Uniform positionOffset;
+        Uniform positionScale;
+        Uniform distort;
+        Uniform distortion;
+        Uniform distortionK3;
+        
+        void resolve(const Shader& shader);
+    };
+    
+    /**
+     * Programs of one fragment shader variant (OutputSelection::key())
+     */
+    struct ProgramSet {
+        Shader meshShaders[kNumVertexLayouts];         // Indexed by VertexLayout
+        Shader layeredMeshShaders[kNumVertexLayouts];
+        Shader gridShader;
+        Shader layeredGridShader;
+        ProgramUniforms meshUniforms[kNumVertexLayouts];
+        ProgramUniforms layeredMeshUniforms[kNumVertexLayouts];
+        ProgramUniforms gridUniforms;
+        ProgramUniforms layeredGridUniforms;
+        
+        /**
+         * Plain or layered program of the current geometry source
+         */
+        const Shader& shader(bool grid, bool layered, VertexLayout layout) const;
+        const ProgramUniforms& uniforms(bool grid, bool layered, VertexLayout layout) const;
+        
+        void destroy();
+    };
+    
     GLContext eglContext_;
-    Shader shader_;
-    Framebuffer framebuffer_;
+    std::map<int, std::unique_ptr<ProgramSet>> programSets_;
+    std::string shaderCacheDir_;
+    
+    // Readback ring: slots are used round-robin, pending_ holds the slots
+    // of submitted renders in submission order
+    std::vector<Framebuffer> ring_;
+    std::deque<int> pending_;
+    int nextSlot_ = 0;
+    int pipelineDepth_ = 2;
+    
+    // GPU spans of this context (--trace)
+    GpuTimer gpuTimer_;
+    
+    // Batch rendering
+    Framebuffer layeredFramebuffer_;
+    uint32_t layerUbo_ = 0;
     
     // OpenGL resources
     uint32_t vao_ = 0;
@@ -89,9 +324,42 @@ private:
     uint32_t ebo_ = 0;
     uint32_t rgbTexture_ = 0;
     size_t numIndices_ = 0;
+    size_t numTriangles_ = 0;
+    size_t vertexBufferBytes_ = 0;  // Sizes of the uploaded streams (updateMesh)
+    size_t indexBufferBytes_ = 0;
+    
+    // False while vbo_, ebo_ and the textures belong to another renderer (shareGeometry)
+    bool ownsGeometry_ = true;
+    
+    // Index mode of the uploaded mesh, its meshlets and the indirect draw
+    // commands of the visible ones (rewritten by every draw)
+    IndexMode indexMode_ = IndexMode::Triangles;
+    std::vector<Meshlet> meshlets_;
+    uint32_t indirectBuffer_ = 0;
+    bool meshletCulling_ = true;
+    size_t drawnTriangles_ = 0;
+    
+    // Vertex layout of the uploaded mesh and its Quantized16 dequantization
+    VertexLayout meshLayout_ = VertexLayout::Float32;
+    std::array<float, 3> positionOffset_ = {{0.0f, 0.0f, 0.0f}};
+    std::array<float, 3> positionScale_ = {{1.0f, 1.0f, 1.0f}};
+    
+    // Implicit grid resources
+    uint32_t gridVao_ = 0;
+    uint32_t depthTexture_ = 0;
+    int gridWidth_ = 0;
+    int gridHeight_ = 0;
+    DepthThresholds gridThresholds_;
+    RenderMode mode_ = RenderMode::Mesh;
     
     bool initialized_ = false;
     
+    /**
+     * Upload the vertex and index streams of a mesh
+     * @param usage Buffer usage hint (GL_STATIC_DRAW, GL_DYNAMIC_DRAW)
+     */
+    bool uploadMeshBuffers(const Mesh& mesh, uint32_t usage);
+    
     /**
      * Create OpenGL projection matrix from intrinsics
      * @param K Camera intrinsics
@@ -104,10 +372,69 @@ private:
                                 float* matrix) const;
     
     /**
-     * Initialize shaders
+     * Check that geometry and texture are uploaded and can be drawn for sourceK
+     */
+    bool checkReady(const Intrinsics& sourceK) const;
+    
+    /**
+     * Draw the current geometry into a framebuffer
+     */
+    void draw(const ProgramSet& programs, const Intrinsics& sourceK, const Intrinsics& targetK,
+              float nearPlane, float farPlane, Framebuffer& framebuffer);
+    
+    /**
+     * Bind and clear a framebuffer and set the fixed-function state
+     */
+    void beginPass(const Framebuffer& framebuffer);
+    
+    /**
+     * Bind textures and issue the draw call of the current geometry
+     * @param shader Program in use
+     * @param uniforms Uniform handles of the program
+     * @param sourceK Source camera intrinsics (implicit grid back-projection)
+     * @param targetKs Target of each layered view (one for a plain framebuffer),
+     *                 meshlets outside all of them are culled
+     */
+    void drawGeometry(const Shader& shader, const ProgramUniforms& uniforms,
+                      const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs);
+    
+    /**
+     * Draw the meshlets visible in any target view with glMultiDrawElementsIndirect
+     * @param views Instances per meshlet (layered views)
+     */
+    void drawMeshlets(const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs, int views);
+    
+    /**
+     * Create the context (optionally in a share group), shaders and buffers
+     */
+    bool initializeContext(int gpuDevice, const GLContext* shareWith);
+    
+    /**
+     * Describe the vertex attributes of a layout for the bound VAO and VBO
+     */
+    void setVertexAttributes(VertexLayout layout);
+    
+    /**
+     * Replace shared geometry objects with fresh ones before an upload
+     */
+    void ownGeometry();
+    
+    /**
+     * Initialize the shaders of the current output selection
      */
     bool initShaders();
     
+    /**
+     * Programs of the current output selection, built on first use
+     * @return nullptr if a program failed to build
+     */
+    const ProgramSet* getPrograms();
+    
+    /**
+     * Compile (or load from the cache) every program of one selection
+     */
+    bool buildPrograms(const OutputSelection& outputs, ProgramSet& programs) const;
+    
     /**
      * Create VAO/VBO/EBO
      */
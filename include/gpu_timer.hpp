@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace rgbd {
+namespace render {
+
+/**
+ * GPU spans of one GL context for the trace (see trace.hpp)
+ *
+ * begin() / end() bracket GL commands with a GL_TIME_ELAPSED query. The
+ * results are collected later without stalling: each begin() and poll()
+ * only reads queries whose result is already available. The measured GPU
+ * time is placed on the context's track starting at the CPU submission
+ * time, or right after the previous span when the GPU was still busy, so
+ * queueing shows up as spans drifting behind their submission.
+ *
+ * Timer queries cannot nest; a begin() while a query is open is ignored.
+ * All calls need the GL context current, and do nothing while tracing is
+ * off.
+ */
+class GpuTimer {
+public:
+    GpuTimer() = default;
+    ~GpuTimer() = default;
+
+    // Non-copyable (owns GL query objects)
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    /**
+     * Name of the track the spans go to (registered on the first span)
+     */
+    void setTrackName(const std::string& name) { trackName_ = name; }
+
+    /**
+     * Start timing the following GL commands
+     * @param name Span name, must outlive the trace (string literal)
+     */
+    void begin(const char* name);
+
+    /**
+     * Stop timing (no-op without a matching begin())
+     */
+    void end();
+
+    /**
+     * Record the spans whose results are available, without waiting
+     */
+    void poll();
+
+    /**
+     * Wait for every query, record it and delete the query objects
+     */
+    void destroy();
+
+private:
+    struct Query {
+        uint32_t id;
+        const char* name;
+        int64_t submitted;   // CPU time of begin()
+    };
+
+    std::string trackName_ = "GPU";
+    uint32_t track_ = 0;             // 0: not registered yet
+    std::vector<uint32_t> free_;     // Query objects ready for reuse
+    std::deque<Query> inFlight_;     // Ended queries in submission order
+    Query active_ = { 0, nullptr, 0 };
+    bool open_ = false;
+    int64_t gpuEnd_ = 0;             // End of the last span on the track
+
+    void collect(bool wait);
+};
+
+} // namespace render
+} // namespace rgbd
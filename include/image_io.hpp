@@ -25,6 +25,26 @@ cv::Mat loadRGB(const std::string& path);
 bool saveRGB(const std::string& path, const std::vector<uint8_t>& image, 
              int width, int height);
 
+/**
+ * Encode an RGB image into memory (what saveRGB writes)
+ * @param ext Format as a file extension (e.g. ".png")
+ * @param image RGB image data (HxWx3 uint8)
+ * @param width Image width
+ * @param height Image height
+ * @param bytes Output: encoded file
+ * @return true on success
+ */
+bool encodeRGB(const std::string& ext, const std::vector<uint8_t>& image,
+               int width, int height, std::vector<uint8_t>& bytes);
+
+/**
+ * Write an encoded file
+ * @param path Output path
+ * @param bytes File contents
+ * @return true on success
+ */
+bool writeFile(const std::string& path, const std::vector<uint8_t>& bytes);
+
 /**
  * Save an RGB image to file
  * @param path Output path
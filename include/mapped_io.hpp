@@ -0,0 +1,95 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace rgbd {
+namespace io {
+
+/**
+ * Read-only view of a whole file through mmap
+ *
+ * The mapping is private copy-on-write, so a cv::Mat wrapping it may be
+ * written to without touching the file. On platforms without mmap the
+ * file is read into memory instead.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    // Non-copyable
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Map a file
+     * @param path File to map
+     * @return Mapping, nullptr if the file cannot be opened or is empty
+     */
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+
+    const uint8_t* data() const { return data_; }
+    uint8_t* data() { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;  // false: data_ is a heap copy
+};
+
+/**
+ * Image loaded by one of the map* functions
+ *
+ * When source is set, mat points straight into the mapped file and stays
+ * valid as long as this object (or a copy of source) is alive. Otherwise
+ * mat owns its data like any cv::Mat.
+ */
+struct MappedMat {
+    cv::Mat mat;
+    std::shared_ptr<MappedFile> source;
+
+    bool empty() const { return mat.empty(); }
+    bool isZeroCopy() const { return source != nullptr; }
+};
+
+/**
+ * Map a 2D NumPy array (.npy, format versions 1-3) as CV_32F
+ *
+ * Little-endian float32 in C order is wrapped without a copy. float16,
+ * float64, uint16 and int32 are converted to float32 (AVX2 / F16C where
+ * available); Fortran-order arrays are transposed to row-major.
+ * Shapes (H, W) and (H, W, 1) are accepted.
+ * @param path Path to the .npy file
+ * @return Depth map, empty on error
+ */
+MappedMat mapNPY(const std::string& path);
+
+/**
+ * Map a binary PGM (P5) or PPM (P6) image
+ *
+ * 8-bit images are wrapped without a copy: CV_8UC1 for PGM, CV_8UC3 in the
+ * file's RGB channel order for PPM. 16-bit images are stored big-endian
+ * and are byte-swapped into an owned CV_16UC1 / CV_16UC3.
+ * @param path Path to the .pgm / .ppm file
+ * @return Image, empty on error
+ */
+MappedMat mapPNM(const std::string& path);
+
+/**
+ * Load a depth map in meters, mapping it when the format allows
+ *
+ * float32 .npy files with scale 1 are zero-copy; other .npy dtypes and
+ * 16-bit .pgm files are converted through the mapping; every other format
+ * goes through loadDepth().
+ * @param path Path to depth file
+ * @param scale Scale factor to convert to meters
+ * @return Depth map as CV_32F, empty on error
+ */
+MappedMat mapDepth(const std::string& path, float scale = 1.0f);
+
+} // namespace io
+} // namespace rgbd
@@ -1,11 +1,47 @@
 #pragma once
 
 #include "types.hpp"
+#include "camera_model.hpp"
 #include <opencv2/core.hpp>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace rgbd {
 namespace mesh {
 
+/**
+ * Adaptive (quadtree) meshing settings
+ *
+ * Errors are those of rendering a block with its coarse triangles instead of
+ * the full-resolution grid, measured at every pixel of the block:
+ * - reprojection error: distance between where the pixel's texel lands in
+ *   the target view and where it should land (target pixels)
+ * - depth error: relative difference of the rendered and the true depth
+ */
+struct AdaptiveOptions {
+    float maxErrorPx = 0.0f;       // Reprojection error bound, 0 disables adaptive meshing
+    float maxDepthError = 0.01f;   // Relative depth error bound
+    float maxFocalScale = 1.0f;    // Largest target / source focal length ratio rendered
+    int maxBlockSize = 64;         // Quads per side of the largest block (power of two)
+};
+
+/**
+ * Statistics of the last adaptive generation
+ * Errors are measured on the emitted triangles over every covered pixel.
+ */
+struct AdaptiveReport {
+    size_t blocks = 0;          // Quadtree leaves
+    size_t mergedBlocks = 0;    // Leaves larger than one quad
+    size_t gridTriangles = 0;   // Triangles of the full-resolution grid
+    size_t triangles = 0;       // Emitted triangles
+    float maxErrorPx = 0.0f;
+    float meanErrorPx = 0.0f;
+    float maxDepthError = 0.0f;
+    float meanDepthError = 0.0f;
+};
+
 /**
  * Generate a 2.5D mesh from a depth map
  * 
@@ -14,6 +50,30 @@ namespace mesh {
  * 2. Creating vertices with texture coordinates
  * 3. Building triangles from adjacent pixels
  * 4. Breaking edges at depth discontinuities to avoid rubber-sheet artifacts
+ *    (evaluated per row with the vectorized kernel in edge_mask.hpp)
+ *
+ * Generation runs over horizontal row bands in parallel. Each band first
+ * counts its valid vertices and triangles, an exclusive prefix sum over the
+ * rows gives every row its output offsets, and the bands then fill the
+ * exactly-sized vertex and index arrays in place. The result is identical
+ * for any thread count.
+ *
+ * The vertex stream is written in the layout chosen with setVertexLayout():
+ * full float vertices, depth plus pixel coordinate (X, Y and UV are rebuilt
+ * from the source intrinsics when rendering) or 16-bit positions normalized
+ * to the mesh bounds.
+ *
+ * Indices are written in the mode chosen with setIndexMode(): a triangle
+ * list, row-wise triangle strips that are restarted wherever a triangle is
+ * dropped, or square meshlet tiles with 16-bit indices relative to a
+ * per-meshlet base vertex and source pixel bounds for view culling. All
+ * modes describe the same triangles.
+ *
+ * With setAdaptive() the grid is instead tessellated by a quadtree: blocks
+ * free of DepthThresholds breaks whose coarse triangles stay within the
+ * error bounds are merged, and every merged block is fanned over all leaf
+ * corners on its border so neighbouring levels share edges without
+ * T-junctions. Adaptive meshes are always triangle lists.
  */
 class MeshGenerator {
 public:
@@ -26,6 +86,35 @@ public:
      */
     void setThresholds(const DepthThresholds& thresholds);
     
+    /**
+     * Set the number of worker threads used by generate()
+     * @param numThreads Thread count (0 = all hardware threads, 1 = serial)
+     */
+    void setNumThreads(int numThreads);
+    
+    /**
+     * Set the vertex layout written by generate()
+     * @param layout VertexLayout::Float32 (default), DepthPixel or Quantized16
+     */
+    void setVertexLayout(VertexLayout layout);
+    
+    /**
+     * Set the index mode written by generate()
+     * @param mode IndexMode::Triangles (default), Strips or Meshlets
+     */
+    void setIndexMode(IndexMode mode);
+    
+    /**
+     * Enable adaptive quadtree meshing
+     * @param options Error bounds (maxErrorPx = 0 restores the full grid)
+     */
+    void setAdaptive(const AdaptiveOptions& options);
+    
+    /**
+     * Statistics of the last adaptive generate()
+     */
+    const AdaptiveReport& getAdaptiveReport() const { return report_; }
+    
     /**
      * Generate mesh from depth map
      * @param depth Depth map (float32, meters)
@@ -44,29 +133,141 @@ public:
     Mesh generate(const cv::Mat& depth, const Intrinsics& intrinsics,
                   const cv::Mat& validMask);
     
+    /**
+     * Allocate a tiled mesh for a depth map size
+     * 
+     * A tiled mesh has one meshlet per kMeshletTileSize tile of quads, and
+     * every tile owns a fixed range of kTileVertexSlots vertices (one per
+     * pixel of the tile including its right and bottom border, in row
+     * order) and kTileIndexSlots indices. Tiles are regenerated in place
+     * with generateTiles(), which never moves another tile. Border pixels
+     * have a vertex in each tile they belong to.
+     * @param mesh Output mesh (Meshlets, empty tiles)
+     * @param width Depth map width
+     * @param height Depth map height
+     * @return false for the Quantized16 layout (its range spans the whole
+     *         mesh) or an unsupported size
+     */
+    bool initTiledMesh(Mesh& mesh, int width, int height) const;
+    
+    /**
+     * Regenerate tiles of a mesh from initTiledMesh()
+     * 
+     * Tiles emit the same triangles as generate() does for their quads.
+     * Slots of invalid pixels hold a vertex at depth 0 that no triangle uses.
+     * @param depth Depth map (CV_32F, meters)
+     * @param intrinsics Camera intrinsics
+     * @param tiles Indices into mesh.meshlets
+     * @param mesh Tiled mesh of the depth map's size
+     */
+    void generateTiles(const cv::Mat& depth, const Intrinsics& intrinsics,
+                       const std::vector<uint32_t>& tiles, Mesh& mesh);
+    
 private:
     DepthThresholds thresholds_;
+    int numThreads_ = 0;
+    VertexLayout layout_ = VertexLayout::Float32;
+    IndexMode indexMode_ = IndexMode::Triangles;
+    AdaptiveOptions adaptive_;
+    AdaptiveReport report_;
+    std::shared_ptr<const RayTable> rays_;  // Rays of the camera being meshed
+    
+    /**
+     * Quadtree tessellation used when adaptive meshing is enabled
+     * @param depth Depth map (CV_32F)
+     * @param intrinsics Camera intrinsics
+     * @param validMask Optional validity mask
+     * @return Triangle-list mesh
+     */
+    Mesh generateAdaptive(const cv::Mat& depth, const Intrinsics& intrinsics,
+                          const cv::Mat& validMask);
     
     /**
-     * Back-project a pixel to 3D camera space
+     * Back-project a pixel center to 3D camera space along its rays_ entry
      * @param u Pixel x coordinate
      * @param v Pixel y coordinate
      * @param z Depth value (meters)
-     * @param K Camera intrinsics
+     * @param K Camera intrinsics (texture coordinates)
      * @return 3D point in camera space
      */
-    Vertex backproject(float u, float v, float z, const Intrinsics& K);
+    Vertex backproject(int u, int v, float z, const Intrinsics& K) const;
     
     /**
-     * Check if an edge between two depth values should be broken
+     * Set the Quantized16 dequantization range of a mesh
+     * @param bounds Position bounds (min xyz, max xyz)
+     * @return Reciprocal of the stored scale
      */
-    bool shouldBreakEdge(float z1, float z2) const;
+    static std::array<float, 3> setQuantizationRange(Mesh& mesh, const std::array<float, 6>& bounds);
     
     /**
-     * Check if a triangle should be created (all edges valid)
+     * Write the vertex of pixel (u, v) in the mesh's layout
+     * @param index Position in the (already sized) vertex stream
+     * @param invScale Reciprocal quantization scale (Quantized16 only)
      */
-    bool isValidTriangle(float z0, float z1, float z2) const;
+    void storeVertex(Mesh& mesh, size_t index, int u, int v, float z,
+                     const Intrinsics& K, const std::array<float, 3>& invScale);
 };
 
+/**
+ * Parse a vertex layout name ("float32", "depth_pixel", "quantized16")
+ * @param name Layout name
+ * @param layout Output layout
+ * @return false if the name is unknown
+ */
+bool parseVertexLayout(const std::string& name, VertexLayout& layout);
+
+/**
+ * Name of a vertex layout, as accepted by parseVertexLayout()
+ */
+const char* vertexLayoutName(VertexLayout layout);
+
+/**
+ * Parse an index mode name ("triangles", "strips", "meshlets")
+ * @param name Mode name
+ * @param mode Output mode
+ * @return false if the name is unknown
+ */
+bool parseIndexMode(const std::string& name, IndexMode& mode);
+
+/**
+ * Name of an index mode, as accepted by parseIndexMode()
+ */
+const char* indexModeName(IndexMode mode);
+
+// Quads per side of a meshlet tile
+static constexpr int kMeshletTileSize = 32;
+
+// Vertex and index slots of one tile of a tiled mesh (MeshGenerator::initTiledMesh)
+static constexpr uint32_t kTileVertexSlots = (kMeshletTileSize + 1) * (kMeshletTileSize + 1);
+static constexpr uint32_t kTileIndexSlots = kMeshletTileSize * kMeshletTileSize * 6;
+
+/**
+ * Quad rows per meshlet for a depth map width
+ * @return kMeshletTileSize, or fewer rows so that a row band's vertices fit
+ *         16-bit local indices (< 1 if the width is too large)
+ */
+int meshletRows(int width);
+
+/**
+ * Whether a meshlet may cover pixels of a target view
+ * 
+ * Source and target share the viewpoint, so a source pixel lands at the
+ * same target pixel for every depth: the tile bounds map to the target
+ * image by the ratio of the intrinsics, no depth range is needed.
+ * Always true if either camera has lens distortion.
+ * @param meshlet Meshlet with source pixel bounds
+ * @param sourceK Intrinsics the mesh was generated with
+ * @param targetK Target intrinsics
+ * @return false if the meshlet is entirely outside the target image
+ */
+bool meshletVisible(const Meshlet& meshlet, const Intrinsics& sourceK, const Intrinsics& targetK);
+
+/**
+ * Triangle list of a mesh in any index mode
+ * @param mesh Mesh with strips, meshlets or triangles
+ * @return Triangles with global vertex indices
+ */
+std::vector<Triangle> expandTriangles(const Mesh& mesh);
+
 } // namespace mesh
 } // namespace rgbd
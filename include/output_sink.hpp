@@ -0,0 +1,220 @@
+#pragma once
+
+#include "types.hpp"
+#include "config.hpp"
+#include "bounded_queue.hpp"
+#include "tar_writer.hpp"
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rgbd {
+namespace app {
+
+/**
+ * Asynchronous writer for rendered outputs
+ *
+ * submit() takes ownership of a RenderOutput and returns as soon as its
+ * files are queued; a pool of encoder threads writes them (RGB PNG, depth
+ * EXR/PNG/NPY as configured, mask PNG; empty buffers are skipped). Every file is a separate job, so
+ * the files of one scale are encoded in parallel as well. The queue is
+ * bounded: when encoding falls behind, submit() blocks instead of letting
+ * pending buffers pile up.
+ *
+ * With Config::exrBundle the RGB, depth and mask of a scale go into one
+ * multi-channel EXR instead (depth PNG/NPY are still written as
+ * configured); in frame mode submitFrame() bundles every scale of a frame
+ * as the parts of one multi-part EXR.
+ *
+ * With Config::tarShardMB the files are not written one by one but
+ * streamed into rolling tar shards (io::TarShardWriter) in the output
+ * directory, encoded by the same functions. Each submission is one
+ * WebDataset sample: its files become the members "<key>.<suffix>"
+ * (e.g. "frame_scale_1_00.rgb.png", the key being the file name prefix
+ * with dots replaced), kept together and appended in submission order
+ * whichever encoder thread finishes first.
+ */
+class OutputSink {
+public:
+    /**
+     * Start the encoder threads
+     * @param config Output directory and formats (outputDir, save*)
+     * @param numThreads Encoder threads (0 = all hardware threads)
+     */
+    OutputSink(const Config& config, int numThreads = 0);
+
+    /**
+     * Flushes pending files (see finish())
+     */
+    ~OutputSink();
+
+    // Non-copyable
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    /**
+     * Queue all files of one rendered output
+     * @param baseName File name prefix inside the output directory (e.g. "scale_1.00")
+     * @param output Render result, moved into the sink
+     * @return false if the sink was already finished
+     */
+    bool submit(const std::string& baseName, RenderOutput&& output);
+
+    /**
+     * Queue all files of one rendered output under an explicit path prefix
+     * @param prefix Path prefix (e.g. "/data/out/frame_scale_1.00")
+     * @param output Render result, moved into the sink
+     * @param onWritten Called once from an encoder thread when the last file
+     *                  is done, with true if every file was written (may be empty)
+     * @param paths Receives the paths of the queued files (optional)
+     * @return false if the sink was already finished
+     */
+    bool submitTo(const std::string& prefix, RenderOutput&& output,
+                  std::function<void(bool)> onWritten, std::vector<std::string>* paths = nullptr);
+
+    /**
+     * Queue the outputs of every scale of one frame as one multi-part EXR
+     * ("<prefix>scales.exr", see bundlesFrames()); their depth PNG/NPY are
+     * named "<prefix><part name>_depth.*"
+     * @param prefix File name prefix inside the output directory (may be empty)
+     * @param partNames Part name of each output (e.g. "scale_1.00")
+     * @param outputs Render results, moved into the sink
+     * @return false if the sink was already finished or the part names
+     *         do not match the outputs
+     */
+    bool submitFrame(const std::string& prefix, const std::vector<std::string>& partNames,
+                     std::vector<RenderOutput>&& outputs);
+
+    /**
+     * Check if the scales of a frame are bundled into one file (submitFrame());
+     * outputs submitted one by one are then bundled per scale
+     */
+    bool bundlesFrames() const { return exrBundle_ == ExrBundle::Frame; }
+
+    /**
+     * Check if files go into tar shards
+     */
+    bool writesTar() const { return tar_ != nullptr; }
+
+    /**
+     * Wait until every queued file is written, stop the threads and print a
+     * summary of written and failed files. Further calls do nothing.
+     * @return true if every file was written
+     */
+    bool finish();
+
+    /**
+     * Number of encoder threads
+     */
+    int getThreadCount() const { return static_cast<int>(workers_.size()); }
+
+    /**
+     * Files written / failed so far
+     */
+    size_t getWrittenCount() const { return written_; }
+    size_t getFailedCount() const;
+
+private:
+    enum class FileKind { RGB, DepthEXR, DepthPNG, DepthNPY, Mask, BundleEXR };
+
+    // Files of one output still to be written, and its callback
+    struct Completion {
+        std::atomic<int> remaining{0};
+        std::atomic<bool> ok{true};
+        std::function<void(bool)> onWritten;
+    };
+
+    struct Job {
+        std::shared_ptr<const RenderOutput> output;  // Shared by the files of one output
+        std::string path;
+        FileKind kind = FileKind::RGB;
+        std::shared_ptr<Completion> completion;      // Null without a callback
+        // BundleEXR: one part per output
+        std::vector<std::pair<std::string, std::shared_ptr<const RenderOutput>>> parts;
+    };
+
+    // Files encoded by one worker: a single file, or a whole sample in tar mode
+    struct Task {
+        std::vector<Job> jobs;
+        uint64_t sample = 0;  // Submission order (tar mode)
+    };
+
+    // Encoded sample waiting for its predecessors (tar mode)
+    struct EncodedSample {
+        std::vector<Job> jobs;
+        std::vector<std::vector<uint8_t>> files;
+        std::vector<std::string> errors;  // Per job, empty if encoded
+    };
+
+    std::string outputDir_;
+    bool saveExr_;
+    bool savePng_;
+    bool saveNpy_;
+    io::ExrOptions exrOptions_;
+    ExrBundle exrBundle_;
+
+    BoundedQueue<Task> queue_;
+    std::vector<std::thread> workers_;
+    bool finished_ = false;
+
+    std::unique_ptr<io::TarShardWriter> tar_;   // Null: separate files
+    std::mutex tarMutex_;
+    std::atomic<uint64_t> submittedSamples_{0};
+    uint64_t nextSample_ = 0;                   // Next sample to append
+    std::map<uint64_t, EncodedSample> pendingSamples_;
+
+    std::atomic<size_t> written_{0};
+    mutable std::mutex errorMutex_;
+    std::vector<std::string> errors_;
+
+    /**
+     * Path of a file of one output, or its tar member name
+     * @param suffix File suffix including the separator ("_rgb.png", ".exr")
+     */
+    std::string fileName(const std::string& prefix, const std::string& suffix) const;
+
+    /**
+     * Add the jobs of the separate files of one output
+     * @param bundled RGB, depth and mask go into a bundled EXR (no RGB / mask
+     *                PNG, no depth EXR)
+     */
+    void addJobs(const std::string& prefix, const std::shared_ptr<const RenderOutput>& output,
+                 bool bundled, std::vector<Job>& jobs) const;
+
+    /**
+     * Attach the completion callback and queue the jobs of one submission
+     */
+    bool queueJobs(std::vector<Job>& jobs, std::function<void(bool)> onWritten,
+                   std::vector<std::string>* paths);
+
+    /**
+     * Encoder thread: write files until the queue is closed and drained
+     */
+    void workerLoop();
+
+    /**
+     * Encode one file
+     * @return true on success
+     */
+    bool encode(const Job& job, std::vector<uint8_t>& bytes) const;
+
+    /**
+     * Append the samples that are next in submission order to the shards
+     * (all pending ones with flush); called with tarMutex_ held
+     */
+    void appendSamples(bool flush);
+
+    /**
+     * Count a finished file and run its output's callback after the last one
+     * @param error Empty if the file was written
+     */
+    void report(Job& job, const std::string& error);
+};
+
+} // namespace app
+} // namespace rgbd
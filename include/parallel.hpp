@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace rgbd {
+
+/**
+ * Resolve a user-facing thread count
+ * @param requested Requested number of threads (<= 0 means all hardware threads)
+ * @return Number of threads to use (always >= 1)
+ */
+inline int resolveThreadCount(int requested) {
+    if (requested > 0) return requested;
+    unsigned int hw = std::thread::hardware_concurrency();
+    return hw > 0 ? static_cast<int>(hw) : 1;
+}
+
+/**
+ * Run fn(i) for every i in [0, count) on up to numThreads threads
+ *
+ * The calling thread takes part in the work, so numThreads == 1 runs
+ * everything inline without spawning. Tasks are handed out dynamically,
+ * fn must be safe to call concurrently for different indices.
+ * @param count Number of tasks
+ * @param numThreads Maximum number of threads (<= 0 means all hardware threads)
+ * @param fn Callable taking the task index
+ */
+template <typename Fn>
+void parallelFor(int count, int numThreads, Fn&& fn) {
+    if (count <= 0) return;
+
+    int threads = std::min(resolveThreadCount(numThreads), count);
+    if (threads == 1) {
+        for (int i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        for (int i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (int t = 0; t < threads - 1; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& th : pool) {
+        th.join();
+    }
+}
+
+} // namespace rgbd
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "types.hpp"
+#include "simd.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace rgbd {
+namespace kernels {
+
+/**
+ * Per-pixel conversions of readback and output encoding
+ *
+ * Row kernels convert one row of tightly packed pixels with the requested
+ * instruction set (clamped to what the CPU supports); every level produces
+ * bit-identical results. The image functions run them over whole images,
+ * optionally reading the source rows bottom-up (OpenGL readback) and
+ * splitting the rows over threads. Small images always stay on the calling
+ * thread, so numThreads is only an upper bound.
+ */
+
+/**
+ * IEEE half-precision to float (scalar reference of the half kernels)
+ */
+float halfToFloat(uint16_t half);
+
+// Row kernels
+
+/**
+ * RGBA to RGB, or to BGR with swapRedBlue (alpha dropped)
+ */
+void rgbaToRgbRow(const uint8_t* rgba, uint8_t* out, int width, bool swapRedBlue,
+                  SimdLevel level = activeSimdLevel());
+
+/**
+ * Swap the first and third channel of 3-channel pixels (RGB <-> BGR)
+ * out may equal in.
+ */
+void swapRedBlueRow(const uint8_t* in, uint8_t* out, int width,
+                    SimdLevel level = activeSimdLevel());
+
+/**
+ * Half-precision floats to float
+ */
+void halfToFloatRow(const uint16_t* in, float* out, int width,
+                    SimdLevel level = activeSimdLevel());
+
+/**
+ * Unsigned 16-bit integers times scale (e.g. millimeters to meters)
+ */
+void u16ToFloatRow(const uint16_t* in, float* out, int width, float scale,
+                   SimdLevel level = activeSimdLevel());
+
+/**
+ * Metric depth to 16-bit: depth * scale truncated and clamped to 65535,
+ * 0 where the depth is not finite and positive
+ */
+void depthToU16Row(const float* in, uint16_t* out, int width, float scale,
+                   SimdLevel level = activeSimdLevel());
+
+/**
+ * Mask values to 0 / 255 (any non-zero value becomes 255)
+ */
+void maskToU8Row(const uint8_t* in, uint8_t* out, int width,
+                 SimdLevel level = activeSimdLevel());
+
+// Image functions (flip: the source rows are stored bottom-up)
+
+/**
+ * RGBA image to RGB (or BGR with swapRedBlue)
+ */
+void rgbaToRgb(const uint8_t* rgba, uint8_t* out, int width, int height, bool flip,
+               bool swapRedBlue, int numThreads = 1, SimdLevel level = activeSimdLevel());
+
+/**
+ * RGB image to BGR or back (out may equal in when not flipping)
+ */
+void swapRedBlue(const uint8_t* in, uint8_t* out, int width, int height, bool flip,
+                 int numThreads = 1, SimdLevel level = activeSimdLevel());
+
+/**
+ * Depth target of any DepthFormat to float meters
+ */
+void depthToFloat(const void* in, DepthFormat format, float* out, int width, int height,
+                  bool flip, int numThreads = 1, SimdLevel level = activeSimdLevel());
+
+/**
+ * Metric depth image to 16-bit (see depthToU16Row)
+ */
+void depthToU16(const float* in, uint16_t* out, int width, int height, float scale,
+                bool flip, int numThreads = 1, SimdLevel level = activeSimdLevel());
+
+/**
+ * Mask image to 0 / 255
+ */
+void maskToU8(const uint8_t* in, uint8_t* out, int width, int height, bool flip,
+              int numThreads = 1, SimdLevel level = activeSimdLevel());
+
+/**
+ * Copy rows of rowBytes bytes, optionally flipped
+ */
+void copyRows(const void* in, void* out, size_t rowBytes, int height, bool flip,
+              int numThreads = 1);
+
+} // namespace kernels
+} // namespace rgbd
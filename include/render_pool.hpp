@@ -0,0 +1,162 @@
+#pragma once
+
+#include "types.hpp"
+#include "gl_renderer.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rgbd {
+namespace render {
+
+/**
+ * Contexts created by RenderPool
+ */
+struct RenderPoolOptions {
+    std::vector<int> devices;      // EGL device indices (empty = every device)
+    int contextsPerDevice = 1;     // Contexts of each device, sharing objects
+    int pipelineDepth = 2;         // Readback ring of each renderer
+    std::string shaderCacheDir;    // Program binary cache (see GLRenderer)
+    OutputSelection outputs;       // Outputs of every context (see Renderer::setOutputs)
+};
+
+/**
+ * GL renderers spread over EGL devices, each driven by its own thread
+ *
+ * Every context has a worker thread that owns it (a context is current on
+ * one thread) and a task queue. The contexts of one device form a share
+ * group: the first one uploads, the others draw the same buffers and
+ * textures. Work is dispatched to the least-loaded context, counting
+ * queued and running tasks:
+ * - submit(): one task (e.g. a whole frame) on any context
+ * - renderViews(): one frame, uploaded once on the least-loaded device,
+ *   its views drawn by all contexts of that device
+ * With Mesa's surfaceless / llvmpipe device the pool also runs without a GPU.
+ */
+class RenderPool {
+public:
+    using Task = std::function<bool(GLRenderer&)>;
+    using Upload = std::function<bool(GLRenderer&)>;
+    using Consume = std::function<void(size_t, RenderOutput&&)>;
+
+    RenderPool();
+
+    /**
+     * Stops the workers (see shutdown())
+     */
+    ~RenderPool();
+
+    // Non-copyable
+    RenderPool(const RenderPool&) = delete;
+    RenderPool& operator=(const RenderPool&) = delete;
+
+    /**
+     * Create the contexts and start their threads
+     * @return true if at least one context per requested device was created
+     */
+    bool initialize(const RenderPoolOptions& options);
+
+    /**
+     * Number of contexts / devices
+     */
+    size_t size() const { return workers_.size(); }
+    int getDeviceCount() const { return static_cast<int>(devices_.size()); }
+
+    /**
+     * Run a task on the least-loaded context
+     * @param task Receives the context's renderer, on its thread
+     * @return Result of the task (false if the pool is shut down)
+     */
+    std::future<bool> submit(Task task);
+
+    /**
+     * Render the views of one frame with every context of one device
+     *
+     * upload runs on the first context of the least-loaded device; the
+     * views are then dispatched to the least-loaded contexts of that
+     * device, which draw the shared geometry. Blocks until every view is
+     * consumed. Calls for different frames may run concurrently from
+     * several threads (they then use different devices when available).
+     * Tasks of submit() must not upload on a device during renderViews().
+     * @param upload Uploads geometry and texture (e.g. uploadMesh + uploadTexture)
+     * @param sourceK Source camera intrinsics
+     * @param targetKs Target intrinsics, one per view
+     * @param nearPlane Near clipping plane (meters)
+     * @param farPlane Far clipping plane (meters)
+     * @param consume Receives the view index and output, serialized but in
+     *                completion order, on a worker thread
+     * @return true if every view rendered
+     */
+    bool renderViews(const Upload& upload, const Intrinsics& sourceK,
+                     const std::vector<Intrinsics>& targetKs, float nearPlane, float farPlane,
+                     const Consume& consume);
+
+    /**
+     * Tasks completed by each context, in context order
+     */
+    std::vector<size_t> getCompletedCounts() const;
+
+    /**
+     * Finish queued tasks, stop the threads and destroy the contexts
+     */
+    void shutdown();
+
+    /**
+     * Description of the devices and contexts
+     */
+    std::string getInfo() const;
+
+private:
+    struct Job {
+        Task task;
+        std::promise<bool> result;      // Set after the counters are updated
+    };
+
+    struct Worker {
+        int device = 0;                 // Index into devices_
+        GLRenderer renderer;
+        std::thread thread;
+        std::deque<Job> tasks;
+        size_t load = 0;                // Queued and running tasks (guarded by mutex_)
+        size_t completed = 0;
+        std::string info;               // GL version / renderer, queried on the worker thread
+    };
+
+    struct Device {
+        int eglDevice = -1;
+        std::vector<size_t> workers;    // First one uploads for renderViews
+        std::unique_ptr<std::mutex> frameMutex;  // One renderViews frame at a time
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<Device> devices_;
+    mutable std::mutex mutex_;
+    std::condition_variable taskReady_;
+    bool stopping_ = false;
+
+    /**
+     * Worker thread: create the context, then run tasks until stopped
+     * @param shareWith Renderer of the device's first context (null for the first)
+     */
+    void workerLoop(Worker& worker, int eglDevice, const RenderPoolOptions& options,
+                    const GLRenderer* shareWith, std::promise<bool> ready);
+
+    /**
+     * Queue a task on a given context
+     */
+    std::future<bool> enqueue(size_t index, Task task);
+
+    /**
+     * Least-loaded context among candidates (guarded by mutex_)
+     */
+    size_t leastLoaded(const std::vector<size_t>& candidates) const;
+};
+
+} // namespace render
+} // namespace rgbd
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "types.hpp"
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rgbd {
+namespace app {
+
+/**
+ * Wire format of the render server
+ *
+ * Every message is a frame of
+ *   uint32 magic ('RGBR'), uint32 header bytes, uint64 payload bytes,
+ *   header, payload
+ * in host byte order (the socket is local). The header is text, one
+ * "key value" field per line; the payload holds the binary blobs announced
+ * by the header, in the order of their fields. Clients may send several
+ * requests without waiting; responses carry the request id and may arrive
+ * in another order.
+ *
+ * Request fields:
+ *   id N                 Request id echoed in the response
+ *   rgb PATH             RGB image file, or
+ *   rgb_data W H         Inline BGR8 image (W*H*3 bytes)
+ *   depth PATH           Depth file (scaled by depth_scale), or
+ *   depth_data W H       Inline float32 depth in meters (W*H*4 bytes)
+ *   fx, fy, cx, cy       Source intrinsics (cx / cy default to the image center)
+ *   distortion A,B,...   Source lens distortion k1,k2,p1,p2[,k3] (plumb_bob)
+ *   depth_scale S        Scale of depth files to meters
+ *   tau_rel, tau_abs     Depth discontinuity thresholds
+ *   near, far            Clipping planes
+ *   scales A,B,...       Focal scales to render
+ *   output_size W H      Output resolution (default: source resolution)
+ *   outputs A,B,...      Outputs to render (rgb, depth, mask)
+ *   depth_format F       Depth render target (float32, float16, mm16)
+ *   mask_from_depth 0|1  Derive the mask from depth instead of rendering it
+ *   output_dir DIR       Server writes files to DIR, otherwise outputs are inline
+ *   name PREFIX          File name prefix (default "request_<id>")
+ * Omitted fields take the server's configuration.
+ *
+ * Response fields:
+ *   id N
+ *   status ok|error
+ *   error MESSAGE
+ *   file PATH            One per written file (output_dir requests)
+ *   view SCALE W H [OUTPUTS]
+ *                        One per scale of inline requests, followed in the
+ *                        payload by RGB8 (W*H*3), float32 depth (W*H*4)
+ *                        and mask (W*H) bytes; OUTPUTS lists the buffers
+ *                        present (e.g. "depth,mask", default all three)
+ */
+struct RenderRequest {
+    uint64_t id = 0;
+    std::string rgbPath;
+    std::string depthPath;
+    cv::Mat rgb;     // Inline image (CV_8UC3, BGR)
+    cv::Mat depth;   // Inline depth (CV_32F, meters)
+
+    // Unset values (negative) take the server's configuration
+    float fx = -1.0f;
+    float fy = -1.0f;
+    float cx = -1.0f;
+    float cy = -1.0f;
+    std::vector<float> distortion;  // Empty: server's configuration
+    float depthScale = -1.0f;
+    float tauRel = -1.0f;
+    float tauAbs = -1.0f;
+    float nearPlane = -1.0f;
+    float farPlane = -1.0f;
+    std::vector<float> focalScales;
+    int outputWidth = 0;
+    int outputHeight = 0;
+    std::string outputs;      // Empty: server's selection
+    std::string depthFormat;
+    int maskFromDepth = -1;
+
+    std::string outputDir;  // Empty: return the outputs inline
+    std::string name;
+};
+
+struct RenderResponse {
+    uint64_t id = 0;
+    bool ok = false;
+    std::string error;
+    std::vector<std::string> files;
+    std::vector<float> scales;          // Scale of each inline output
+    std::vector<RenderOutput> outputs;  // Inline outputs
+};
+
+/**
+ * Create a listening Unix domain socket (a stale socket file is replaced)
+ * @param path Socket path
+ * @param backlog Pending connection limit
+ * @return File descriptor, -1 on failure
+ */
+int listenUnixSocket(const std::string& path, int backlog = 64);
+
+/**
+ * Connect to a Unix domain socket
+ * @param path Socket path
+ * @return File descriptor, -1 on failure
+ */
+int connectUnixSocket(const std::string& path);
+
+/**
+ * Send a request
+ * @return false if the connection failed
+ */
+bool sendRequest(int fd, const RenderRequest& request);
+
+/**
+ * Receive a request, blocking until it is complete
+ * @param error Set when the frame was read but is not a valid request
+ * @return false at end of stream, on a connection error or on an invalid request
+ */
+bool receiveRequest(int fd, RenderRequest& request, std::string& error);
+
+/**
+ * Send a response
+ * @return false if the connection failed
+ */
+bool sendResponse(int fd, const RenderResponse& response);
+
+/**
+ * Receive a response, blocking until it is complete
+ * @return false at end of stream or on an error
+ */
+bool receiveResponse(int fd, RenderResponse& response);
+
+} // namespace app
+} // namespace rgbd
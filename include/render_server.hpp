@@ -0,0 +1,144 @@
+#pragma once
+
+#include "types.hpp"
+#include "config.hpp"
+#include "renderer.hpp"
+#include "output_sink.hpp"
+#include "depth_mesh.hpp"
+#include "bounded_queue.hpp"
+#include "mapped_io.hpp"
+#include "render_protocol.hpp"
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rgbd {
+namespace app {
+
+/**
+ * Long-running render service on a Unix domain socket
+ *
+ * One initialized renderer serves every request, so clients pay for the
+ * context, glad loading and shader compilation once per server instead of
+ * once per frame. Requests (see render_protocol.hpp) flow through stages
+ * like BatchRunner: a reader thread per connection receives requests,
+ * loads their inputs and builds the mesh; a bounded queue of
+ * Config::frameQueue requests feeds the calling thread, which owns the GL
+ * context and renders; output files are written by an OutputSink and a
+ * request is answered once its last file is written. Inline outputs are
+ * answered right after rendering. Clients may pipeline requests on one
+ * connection, responses carry the request id.
+ *
+ * stop() or requestStop() (safe in a signal handler) stops accepting
+ * connections and requests; requests already received are rendered and
+ * answered before run() returns.
+ */
+class RenderServer {
+public:
+    /**
+     * @param config Defaults for request fields, meshing, rendering, output
+     *               formats and the queue size
+     */
+    explicit RenderServer(const Config& config);
+    ~RenderServer();
+
+    // Non-copyable
+    RenderServer(const RenderServer&) = delete;
+    RenderServer& operator=(const RenderServer&) = delete;
+
+    /**
+     * Serve requests until stopped
+     * @param renderer Initialized renderer (used from the calling thread only)
+     * @param socketPath Socket to listen on (removed when the server ends)
+     * @return false if the socket could not be created
+     */
+    bool run(render::Renderer& renderer, const std::string& socketPath);
+
+    /**
+     * Stop this server (thread-safe)
+     */
+    void stop() { stop_ = true; }
+
+    /**
+     * Stop every server of the process (async-signal-safe, e.g. for SIGTERM)
+     */
+    static void requestStop() { signalled_ = true; }
+
+    size_t getProcessedCount() const { return processed_; }
+    size_t getFailedCount() const { return failed_; }
+
+private:
+    /**
+     * Client connection, shared by its reader and its pending responses
+     */
+    struct Connection {
+        int fd = -1;
+        std::mutex writeMutex;  // Responses come from the render and encoder threads
+
+        explicit Connection(int socket) : fd(socket) {}
+        ~Connection();
+        bool send(const RenderResponse& response);
+    };
+
+    /**
+     * Request with its inputs loaded and meshed
+     */
+    struct Job {
+        std::shared_ptr<Connection> connection;
+        uint64_t id = 0;
+        Config config;                                // Server config with the request's fields
+        cv::Mat rgb;
+        cv::Mat depth;
+        std::shared_ptr<io::MappedFile> depthSource;  // Keeps a mapped depth file alive
+        Intrinsics K;
+        std::unique_ptr<mesh::DepthMesh> mesh;        // Null in grid mode
+        std::string outputPrefix;                     // Empty for inline outputs
+    };
+
+    struct Reader {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+
+    const Config& config_;
+    BoundedQueue<Job> queue_;
+    OutputSink sink_;
+    std::vector<Reader> readers_;
+
+    std::atomic<bool> stop_{false};
+    static std::atomic<bool> signalled_;
+
+    std::atomic<size_t> processed_{0};
+    std::atomic<size_t> failed_{0};
+
+    bool stopping() const { return stop_ || signalled_; }
+
+    /**
+     * Accept connections until stopped, then wait for the readers and close the queue
+     */
+    void acceptLoop(int listenFd);
+
+    /**
+     * Receive and prepare the requests of one connection
+     */
+    void readerLoop(std::shared_ptr<Connection> connection, std::shared_ptr<std::atomic<bool>> done);
+
+    /**
+     * Merge a request into the server config, load its inputs and build the mesh
+     * @param error Reason of a failure
+     * @return true on success
+     */
+    bool prepare(RenderRequest& request, Job& job, std::string& error) const;
+
+    /**
+     * Upload, render and answer (or hand the files to the sink) one job
+     */
+    void renderJob(render::Renderer& renderer, Job& job);
+};
+
+} // namespace app
+} // namespace rgbd
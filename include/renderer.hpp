@@ -0,0 +1,167 @@
+#pragma once
+
+#include "types.hpp"
+#include <opencv2/core.hpp>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rgbd {
+namespace render {
+
+/**
+ * Common interface of the rendering backends
+ *
+ * A backend takes the camera-space mesh and its texture once, then renders
+ * it for any number of target intrinsics into RenderOutput (RGB, metric
+ * depth, mask). Backends:
+ * - GLRenderer: OpenGL through EGL (GPU or driver software rasterizer)
+ * - CpuRenderer: tiled multithreaded software rasterizer, no GL required
+ * - ResampleRenderer: inverse-mapping resampler of depth grids, no GL or
+ *   mesh required (targets differ from the source in intrinsics only)
+ *
+ * submit/retrieve and renderBatch have synchronous default implementations
+ * so callers can use the pipelined API with every backend.
+ *
+ * setOutputs() selects the outputs of later renders; the buffers of the
+ * others stay empty in RenderOutput. GLRenderer draws and reads back only
+ * the selected targets in the selected depth format; CpuRenderer skips
+ * texturing without RGB and always computes float32 depth.
+ */
+class Renderer {
+public:
+    virtual ~Renderer() = default;
+
+    /**
+     * Initialize the backend
+     * @param gpuDevice GPU device index (-1 for default, ignored by CPU backends)
+     * @return true on success
+     */
+    virtual bool initialize(int gpuDevice = -1) = 0;
+
+    /**
+     * Upload mesh data
+     * @param mesh Mesh with vertices and triangles
+     * @return true on success
+     */
+    virtual bool uploadMesh(const Mesh& mesh) = 0;
+
+    /**
+     * Update the uploaded mesh to a later version of itself
+     * (default: uploads the whole mesh)
+     * @param mesh Mesh after the update
+     * @param update Changed vertex and index ranges (full: everything)
+     * @return true on success
+     */
+    virtual bool updateMesh(const Mesh& mesh, const MeshUpdate& update);
+
+    /**
+     * Upload RGB texture
+     * @param texture Texture image (CV_8UC3 BGR as loaded by OpenCV)
+     * @return true on success
+     */
+    virtual bool uploadTexture(const cv::Mat& texture) = 0;
+
+    /**
+     * Upload a depth map to render as an implicit grid instead of a mesh
+     * (default: unsupported, prints an error)
+     * @param depth Depth map (meters, converted to CV_32F if needed)
+     * @param thresholds Depth discontinuity thresholds
+     * @return true on success
+     */
+    virtual bool uploadDepth(const cv::Mat& depth, const DepthThresholds& thresholds);
+
+    /**
+     * Render with target intrinsics
+     * 
+     * Target lens distortion is applied per vertex, so straight mesh edges
+     * stay straight between vertices (exact for the per-pixel grid up to
+     * the curvature within one source pixel).
+     * @param sourceK Source camera intrinsics (used for mesh creation)
+     * @param targetK Target camera intrinsics (for rendering)
+     * @param nearPlane Near clipping plane (meters)
+     * @param farPlane Far clipping plane (meters)
+     * @param output Output render targets
+     * @return true on success
+     */
+    virtual bool render(const Intrinsics& sourceK, const Intrinsics& targetK,
+                        float nearPlane, float farPlane, RenderOutput& output) = 0;
+
+    /**
+     * Render several target views (default: one render() per view)
+     * @param outputs One output per target, in order
+     * @return true on success
+     */
+    virtual bool renderBatch(const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs,
+                             float nearPlane, float farPlane, std::vector<RenderOutput>& outputs);
+
+    /**
+     * Queue a render (default: renders synchronously and keeps the result)
+     * @return true on success
+     */
+    virtual bool submit(const Intrinsics& sourceK, const Intrinsics& targetK,
+                        float nearPlane, float farPlane);
+
+    /**
+     * Take the oldest submitted result
+     * @param output Output render targets
+     * @return true on success
+     */
+    virtual bool retrieve(RenderOutput& output);
+
+    /**
+     * Number of submitted renders not retrieved yet
+     */
+    virtual size_t pendingCount() const { return completed_.size(); }
+
+    /**
+     * Select the outputs of later renders (submitted renders keep theirs)
+     * @param outputs Outputs and depth format (default: all, float32 depth)
+     */
+    virtual void setOutputs(const OutputSelection& outputs) { outputs_ = outputs; }
+    const OutputSelection& getOutputs() const { return outputs_; }
+
+    /**
+     * Maximum number of renders in flight (1 for synchronous backends)
+     */
+    virtual void setPipelineDepth(int depth) { (void)depth; }
+    virtual int getPipelineDepth() const { return 1; }
+
+    /**
+     * Check if renderer is initialized
+     */
+    virtual bool isInitialized() const = 0;
+
+    /**
+     * Human-readable backend description
+     */
+    virtual std::string getInfo() const = 0;
+
+    /**
+     * Release all resources
+     */
+    virtual void cleanup() = 0;
+
+protected:
+    OutputSelection outputs_;
+
+    /**
+     * Print the share of rendered pixels (from the mask, else from depth)
+     */
+    static void reportValidPixels(const RenderOutput& output);
+
+private:
+    std::deque<RenderOutput> completed_;  // Results of the default submit()
+};
+
+/**
+ * Create a rendering backend
+ * @param backend "gl", "cpu" or "resample"
+ * @param numThreads CPU threads for software backends (0 = all hardware threads)
+ * @return Backend instance, nullptr for an unknown name
+ */
+std::unique_ptr<Renderer> createRenderer(const std::string& backend, int numThreads = 0);
+
+} // namespace render
+} // namespace rgbd
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "renderer.hpp"
+#include "simd.hpp"
+
+namespace rgbd {
+namespace render {
+
+/**
+ * Analytic resampler for targets that only change the intrinsics
+ *
+ * Source and target share the camera centre and orientation, so the depth
+ * grid projects into the target through an axis-aligned affine map of the
+ * source image plane and occlusion never changes. Instead of meshing and
+ * rasterizing, every target pixel centre is mapped back into the source
+ * image (separably: one table per column and per row), lands in one grid
+ * quad and one of its two triangles, and is shaded from that triangle
+ * alone: metric depth and texture coordinates are interpolated
+ * perspective-correctly from the three vertices and RGB is a bilinear
+ * sample of the four quad texels, exactly what GL computes for the
+ * implicit grid. Pixels whose triangle fails the DepthThresholds test
+ * (see edge_mask.hpp), that fall outside the grid or whose depth is
+ * outside [near, far] are invalid (RGB 0, depth 0, mask 0).
+ *
+ * Input comes from uploadDepth() and uploadTexture() like the gl backend's
+ * grid mode; uploadMesh() is rejected, as are cameras with lens distortion. Rows are shaded in parallel, 8
+ * pixels at a time with AVX2 gathers where available.
+ *
+ * Pixel centres exactly on a grid line go to the triangle the GL fill rule
+ * picks. Tolerance against GLRenderer (checked in test_rerender against
+ * CpuRenderer's mesh path): the same as CpuRenderer's; there is no vertex
+ * snapping, so depth is usually closer to the exact value than either.
+ */
+class ResampleRenderer : public Renderer {
+public:
+    ResampleRenderer();
+    ~ResampleRenderer() override;
+
+    // Non-copyable
+    ResampleRenderer(const ResampleRenderer&) = delete;
+    ResampleRenderer& operator=(const ResampleRenderer&) = delete;
+
+    bool initialize(int gpuDevice = -1) override;
+    bool uploadMesh(const Mesh& mesh) override;
+    bool uploadDepth(const cv::Mat& depth, const DepthThresholds& thresholds) override;
+    bool uploadTexture(const cv::Mat& texture) override;
+    bool render(const Intrinsics& sourceK, const Intrinsics& targetK,
+                float nearPlane, float farPlane, RenderOutput& output) override;
+    bool isInitialized() const override { return initialized_; }
+    std::string getInfo() const override;
+    void cleanup() override;
+
+    /**
+     * Set the number of worker threads
+     * @param numThreads Thread count (0 = all hardware threads)
+     */
+    void setNumThreads(int numThreads) { numThreads_ = numThreads; }
+
+    /**
+     * Select the instruction set of the shading kernel
+     * @param level Requested level (clamped to what the CPU supports)
+     */
+    void setSimdLevel(SimdLevel level) { simdLevel_ = level; }
+
+private:
+    int gridWidth_ = 0;
+    int gridHeight_ = 0;
+    std::vector<float> invDepth_;     // 1 / Z per grid vertex, 0 where invalid
+    std::vector<uint8_t> quadBits_;   // Bit 0: upper triangle, bit 1: lower triangle unbroken
+    std::vector<uint32_t> texels_;    // RGBX8 per pixel, same channel mapping as CpuRenderer
+    int textureWidth_ = 0;
+    int textureHeight_ = 0;
+    int numThreads_ = 0;
+    SimdLevel simdLevel_ = activeSimdLevel();
+    bool initialized_ = false;
+};
+
+} // namespace render
+} // namespace rgbd
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "types.hpp"
+#include "mesh_generator.hpp"
+#include <opencv2/core.hpp>
+#include <memory>
+#include <vector>
+
+namespace rgbd {
+namespace mesh {
+
+/**
+ * Incremental meshing settings of a depth sequence
+ */
+struct SequenceOptions {
+    float depthTolerance = 0.0f;      // Depth change (meters) still treated as unchanged
+    float maxChangedFraction = 0.5f;  // Share of changed tiles above which every tile is rebuilt
+};
+
+/**
+ * Statistics of the last SequenceMesh::update()
+ */
+struct SequenceReport {
+    size_t tiles = 0;
+    size_t changedTiles = 0;  // Tiles regenerated (all of them when rebuilt)
+    bool rebuilt = false;     // First frame, new size or intrinsics, or above maxChangedFraction
+};
+
+/**
+ * Mesh of a depth video, updated in place from frame to frame
+ *
+ * The mesh is a tiled mesh (MeshGenerator::initTiledMesh) whose topology
+ * stays fixed while the size and intrinsics do. update() compares each
+ * frame with the depth the mesh was built from, regenerates only the tiles
+ * containing a changed pixel and reports their vertex and index slots in a
+ * MeshUpdate, so a renderer rewrites just those parts of its buffers
+ * (Renderer::updateMesh). Pixels that changed by no more than the tolerance
+ * keep their previous depth in both the mesh and the reference, so the
+ * tiles on either side of a border always agree and small changes never
+ * accumulate unnoticed.
+ *
+ * getMesh() hands out a shared snapshot. A snapshot still held elsewhere
+ * (e.g. by a render stage behind a queue) is copied before the next
+ * update() writes to the mesh.
+ */
+class SequenceMesh {
+public:
+    SequenceMesh();
+
+    /**
+     * Depth discontinuity thresholds, vertex layout (Float32 or DepthPixel)
+     * and thread count of the generator; changing them rebuilds on the next
+     * update()
+     */
+    void setThresholds(const DepthThresholds& thresholds);
+    void setVertexLayout(VertexLayout layout);
+    void setNumThreads(int numThreads);
+
+    /**
+     * Set the change detection settings
+     */
+    void setOptions(const SequenceOptions& options) { options_ = options; }
+
+    /**
+     * Mesh the next frame of the sequence
+     * @param depth Depth map (meters, converted to CV_32F if needed)
+     * @param intrinsics Source camera intrinsics
+     * @param update Output: what changed since the previous frame's mesh
+     * @return false if the depth map cannot be meshed
+     */
+    bool update(const cv::Mat& depth, const Intrinsics& intrinsics, MeshUpdate& update);
+
+    /**
+     * Mesh of the last update() (null before the first one)
+     */
+    std::shared_ptr<const Mesh> getMesh() const { return mesh_; }
+
+    /**
+     * Statistics of the last update()
+     */
+    const SequenceReport& getReport() const { return report_; }
+
+    /**
+     * Forget the previous frame, the next update() rebuilds every tile
+     */
+    void reset();
+
+private:
+    MeshGenerator generator_;
+    SequenceOptions options_;
+    int numThreads_ = 0;
+    std::shared_ptr<Mesh> mesh_;
+    cv::Mat reference_;      // Depth the mesh was built from (CV_32F)
+    Intrinsics intrinsics_;
+    uint64_t version_ = 0;
+    SequenceReport report_;
+};
+
+} // namespace mesh
+} // namespace rgbd
@@ -1,13 +1,32 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <cstdint>
 
 namespace rgbd {
 namespace render {
 
+/**
+ * Uniform location resolved once with Shader::uniform()
+ * Setting an invalid handle (unknown or optimized-out name) does nothing.
+ */
+struct Uniform {
+    int location = -1;
+    
+    bool isValid() const { return location >= 0; }
+};
+
 /**
  * OpenGL shader program wrapper
+ * 
+ * Uniform locations are queried once after linking and looked up by name
+ * afterwards; hot paths resolve a Uniform handle instead. With a binary
+ * cache directory set, linked programs are stored with glGetProgramBinary,
+ * keyed by the GL vendor, renderer and version and a hash of the sources,
+ * and later loads use glProgramBinary, compiling from source whenever the
+ * cached binary is missing or rejected by the driver.
  */
 class Shader {
 public:
@@ -31,6 +50,37 @@ public:
     bool loadFromSource(const std::string& vertexSource,
                         const std::string& fragmentSource);
     
+    /**
+     * Load and compile shaders with a geometry stage from source strings
+     * @param vertexSource Vertex shader GLSL source
+     * @param geometrySource Geometry shader GLSL source
+     * @param fragmentSource Fragment shader GLSL source
+     * @return true on success
+     */
+    bool loadFromSource(const std::string& vertexSource,
+                        const std::string& geometrySource,
+                        const std::string& fragmentSource);
+    
+    /**
+     * Insert #define lines right after the #version directive of a source
+     * @param source GLSL source starting with a #version line
+     * @param defines Macro definitions, e.g. "LAYERED" or "MAX_LAYERS 16"
+     * @return Source of the shader variant
+     */
+    static std::string injectDefines(const std::string& source,
+                                     const std::vector<std::string>& defines);
+    
+    /**
+     * Set the program binary cache directory used by loadFromSource
+     * @param directory Cache directory, created on demand (empty disables the cache)
+     */
+    void setBinaryCacheDir(const std::string& directory) { cacheDir_ = directory; }
+    
+    /**
+     * Check if the last load used a cached program binary
+     */
+    bool isFromCache() const { return fromCache_; }
+    
     /**
      * Load and compile shaders from files
      * @param vertexPath Path to vertex shader file
@@ -46,22 +96,49 @@ public:
     void use() const;
     
     /**
-     * Get uniform location
+     * Get uniform location from the cache filled at link time
      * @param name Uniform variable name
      * @return Location (-1 if not found)
      */
     int getUniformLocation(const std::string& name) const;
     
+    /**
+     * Get a uniform handle for repeated updates
+     * @param name Uniform variable name
+     * @return Handle (invalid if not found)
+     */
+    Uniform uniform(const std::string& name) const { return Uniform{ getUniformLocation(name) }; }
+    
     /**
      * Set uniform values
      */
     void setUniform(const std::string& name, int value) const;
     void setUniform(const std::string& name, float value) const;
+    void setUniform(const std::string& name, int x, int y) const;
     void setUniform(const std::string& name, float x, float y) const;
     void setUniform(const std::string& name, float x, float y, float z) const;
     void setUniform(const std::string& name, float x, float y, float z, float w) const;
     void setUniformMatrix4(const std::string& name, const float* matrix) const;
     
+    /**
+     * Set uniform values through cached handles
+     */
+    void setUniform(Uniform uniform, int value) const;
+    void setUniform(Uniform uniform, float value) const;
+    void setUniform(Uniform uniform, int x, int y) const;
+    void setUniform(Uniform uniform, float x, float y) const;
+    void setUniform(Uniform uniform, float x, float y, float z) const;
+    void setUniform(Uniform uniform, float x, float y, float z, float w) const;
+    void setUniformMatrix4(Uniform uniform, const float* matrix) const;
+    
+    /**
+     * Bind a uniform block to a uniform buffer binding point
+     * @param name Uniform block name
+     * @param binding Binding point used with glBindBufferBase
+     * @return true if the block exists in the program
+     */
+    bool bindUniformBlock(const std::string& name, uint32_t binding) const;
+    
     /**
      * Get program ID
      */
@@ -85,11 +162,38 @@ public:
 private:
     uint32_t programId_ = 0;
     std::string errorMsg_;
+    std::unordered_map<std::string, int> uniformLocations_;
+    std::string cacheDir_;
+    bool fromCache_ = false;
+    
+    /**
+     * Query the locations of all active uniforms of the linked program
+     */
+    void cacheUniformLocations();
+    
+    /**
+     * Path of the cache file of a program
+     * @param sources Stage sources (empty for absent stages)
+     * @param key Output full cache key stored in the file
+     * @return Cache file path (empty if the cache is disabled)
+     */
+    std::string binaryCachePath(const std::vector<std::string>& sources, std::string& key) const;
+    
+    /**
+     * Create the program from a cached binary
+     * @return true if the binary was found and accepted by the driver
+     */
+    bool loadBinary(const std::string& path, const std::string& key);
+    
+    /**
+     * Store the linked program binary (best effort)
+     */
+    void saveBinary(const std::string& path, const std::string& key) const;
     
     /**
      * Compile a shader stage
      * @param source GLSL source code
-     * @param type GL_VERTEX_SHADER or GL_FRAGMENT_SHADER
+     * @param type GL_VERTEX_SHADER, GL_GEOMETRY_SHADER or GL_FRAGMENT_SHADER
      * @return Shader ID (0 on failure)
      */
     uint32_t compileShader(const std::string& source, uint32_t type);
@@ -97,10 +201,11 @@ private:
     /**
      * Link shader program
      * @param vertexShader Compiled vertex shader ID
+     * @param geometryShader Compiled geometry shader ID (0 for none)
      * @param fragmentShader Compiled fragment shader ID
      * @return true on success
      */
-    bool linkProgram(uint32_t vertexShader, uint32_t fragmentShader);
+    bool linkProgram(uint32_t vertexShader, uint32_t geometryShader, uint32_t fragmentShader);
 };
 
 } // namespace render
@@ -0,0 +1,71 @@
+#pragma once
+
+/**
+ * Runtime CPU feature dispatch for hand-vectorized kernels
+ *
+ * Kernels are compiled for several instruction sets with per-function
+ * target attributes and the best one supported by the running CPU is
+ * picked at call time, so the binary itself stays at the baseline ISA.
+ */
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define RGBD_X86_SIMD 1
+#define RGBD_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define RGBD_TARGET_AVX2 __attribute__((target("avx2")))
+#define RGBD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512vl")))
+#else
+#define RGBD_X86_SIMD 0
+#define RGBD_TARGET_SSE41
+#define RGBD_TARGET_AVX2
+#define RGBD_TARGET_AVX512
+#endif
+
+namespace rgbd {
+
+/**
+ * Instruction set levels, ordered from least to most capable
+ */
+enum class SimdLevel {
+    Scalar = 0,
+    SSE41 = 1,
+    AVX2 = 2,
+    AVX512 = 3   // AVX-512 F + BW + VL; kernels without a 512-bit form use AVX2
+};
+
+/**
+ * Detect the best instruction set supported by this CPU
+ */
+inline SimdLevel detectSimdLevel() {
+#if RGBD_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+/**
+ * Instruction set used by default (detected once per process)
+ */
+inline SimdLevel activeSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+/**
+ * Human-readable name of an instruction set level
+ */
+inline const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2: return "AVX2";
+        case SimdLevel::SSE41: return "SSE4.1";
+        default: return "Scalar";
+    }
+}
+
+} // namespace rgbd
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace rgbd {
+namespace io {
+
+/**
+ * One file of a tar shard
+ */
+struct TarMember {
+    std::string name;            // Member name (no directories)
+    std::vector<uint8_t> data;
+};
+
+/**
+ * Writer of rolling tar shards ("<dir>/<name>-000000.tar", ...)
+ *
+ * Members are appended as POSIX ustar entries (pax records for names
+ * longer than 100 characters) with fixed mode, owner and mtime, so the
+ * same members give byte-identical shards. The members of one append()
+ * call stay together in one shard (a WebDataset sample); a new shard is
+ * started before a sample that would grow the current one past the size
+ * limit. Writes go through a large stream buffer, the disk only sees
+ * long sequential writes.
+ *
+ * With an index, every shard gets a "<shard>.idx" sidecar listing each
+ * member as "name<TAB>offset<TAB>size" (offset of the data in the tar), for
+ * random access without scanning the archive.
+ *
+ * Not thread-safe: calls must be serialized by the caller.
+ */
+class TarShardWriter {
+public:
+    /**
+     * @param directory Output directory (must exist)
+     * @param name Shard name prefix
+     * @param shardBytes Size limit of a shard (a single larger sample gets a shard of its own)
+     * @param writeIndex Write a .idx sidecar per shard
+     */
+    TarShardWriter(const std::string& directory, const std::string& name, size_t shardBytes,
+                   bool writeIndex);
+
+    /**
+     * Closes the current shard (see close())
+     */
+    ~TarShardWriter();
+
+    // Non-copyable
+    TarShardWriter(const TarShardWriter&) = delete;
+    TarShardWriter& operator=(const TarShardWriter&) = delete;
+
+    /**
+     * Append the members of one sample
+     * @return false if the shard cannot be written
+     */
+    bool append(const std::vector<TarMember>& members);
+
+    /**
+     * Finish the current shard (end-of-archive blocks, index). The next
+     * append() starts a new shard. Further calls do nothing.
+     * @return false if the shard or its index could not be written
+     */
+    bool close();
+
+    /**
+     * Shards started so far
+     */
+    size_t getShardCount() const { return shardCount_; }
+
+    /**
+     * Path of shard i
+     */
+    std::string shardPath(size_t index) const;
+
+private:
+    struct IndexEntry {
+        std::string name;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::string directory_;
+    std::string name_;
+    size_t shardBytes_;
+    bool writeIndex_;
+
+    std::vector<char> buffer_;    // Stream buffer of the open shard
+    std::ofstream file_;
+    uint64_t shardSize_ = 0;      // Bytes written to the open shard
+    size_t shardCount_ = 0;
+    std::vector<IndexEntry> index_;
+
+    bool openShard();
+    bool writeMember(const TarMember& member);
+    bool writeHeader(const std::string& name, uint64_t size, char type);
+    void writePadding(uint64_t size);
+};
+
+} // namespace io
+} // namespace rgbd
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace rgbd {
+namespace trace {
+
+/**
+ * Pipeline tracing (--trace out.json)
+ *
+ * Scopes record CPU spans per thread into thread-local logs; GPU spans
+ * (render::GpuTimer) go to a track of their own per renderer. writeJson()
+ * dumps everything in the Chrome trace-event format, which chrome://tracing
+ * and ui.perfetto.dev open directly.
+ *
+ * Instrumentation is compiled in when RGBD_TRACE_ENABLED is defined (CMake
+ * option RGBD_TRACE, on by default). While recording is off a scope costs
+ * one relaxed atomic load; without RGBD_TRACE_ENABLED enabled() is a
+ * constant false and the scopes compile to nothing.
+ */
+
+namespace detail {
+extern std::atomic<bool> recording;
+}
+
+/**
+ * Check whether the instrumentation is compiled in
+ */
+constexpr bool compiledIn() {
+#ifdef RGBD_TRACE_ENABLED
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Check whether spans are being recorded
+ */
+inline bool enabled() {
+#ifdef RGBD_TRACE_ENABLED
+    return detail::recording.load(std::memory_order_relaxed);
+#else
+    return false;
+#endif
+}
+
+/**
+ * Drop previously recorded spans and start recording
+ * @return false if the instrumentation is compiled out
+ */
+bool start();
+
+/**
+ * Stop recording (recorded spans are kept for writeJson())
+ */
+void stop();
+
+/**
+ * Nanoseconds on the steady clock since the first use of the trace module
+ * (fixed for the process, so timestamps of every start() share one origin)
+ */
+int64_t now();
+
+/**
+ * Name the calling thread in the trace
+ */
+void setThreadName(const std::string& name);
+
+/**
+ * Register a track that is not a thread (e.g. the GPU timeline of a context)
+ * @return Track id for record()
+ */
+uint32_t addTrack(const std::string& name);
+
+/**
+ * Record a span of the calling thread
+ * @param name Span name, must outlive the trace (string literal)
+ * @param start Start time (now())
+ * @param duration Duration in nanoseconds
+ */
+void record(const char* name, int64_t start, int64_t duration);
+
+/**
+ * Record a span on a track of addTrack()
+ */
+void record(uint32_t track, const char* name, int64_t start, int64_t duration);
+
+/**
+ * Number of spans recorded since start()
+ */
+size_t eventCount();
+
+/**
+ * Number of thread and track logs held (for tests; exited threads' empty
+ * logs are reused, so this does not grow with short-lived threads)
+ */
+size_t logCount();
+
+/**
+ * Write the recorded spans as Chrome trace-event JSON
+ * @return false if the file cannot be written
+ */
+bool writeJson(const std::string& path);
+
+/**
+ * Records the span from construction to destruction on the calling thread
+ */
+class Scope {
+public:
+    explicit Scope(const char* name) : name_(name) {
+        if (enabled()) {
+            start_ = now();
+        }
+    }
+
+    ~Scope() {
+        if (start_ >= 0) {
+            record(name_, start_, now() - start_);
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_ = -1;  // Negative: not recording
+};
+
+} // namespace trace
+} // namespace rgbd
+
+#define RGBD_TRACE_CONCAT_(a, b) a##b
+#define RGBD_TRACE_CONCAT(a, b) RGBD_TRACE_CONCAT_(a, b)
+
+#ifdef RGBD_TRACE_ENABLED
+// Trace the rest of the enclosing block as a span named name (a string literal)
+#define RGBD_TRACE_SCOPE(name) ::rgbd::trace::Scope RGBD_TRACE_CONCAT(rgbdTraceScope, __LINE__)(name)
+#else
+#define RGBD_TRACE_SCOPE(name) ((void)0)
+#endif
@@ -8,6 +8,38 @@
 
 namespace rgbd {
 
+// Lens distortion of the ROS / OpenCV plumb_bob model, applied to
+// normalized image coordinates (x, y) = (X / Z, Y / Z):
+//   r2 = x^2 + y^2, radial = 1 + k1 r2 + k2 r2^2 + k3 r2^3
+//   x_d = x radial + 2 p1 x y + p2 (r2 + 2 x^2)
+//   y_d = y radial + p1 (r2 + 2 y^2) + 2 p2 x y
+// All zero coefficients describe a pinhole camera.
+struct Distortion {
+    float k1 = 0.0f, k2 = 0.0f;  // Radial
+    float p1 = 0.0f, p2 = 0.0f;  // Tangential
+    float k3 = 0.0f;             // Radial, sixth order
+    
+    bool isZero() const {
+        return k1 == 0.0f && k2 == 0.0f && p1 == 0.0f && p2 == 0.0f && k3 == 0.0f;
+    }
+    
+    bool operator==(const Distortion& other) const {
+        return k1 == other.k1 && k2 == other.k2 && p1 == other.p1 && p2 == other.p2 &&
+               k3 == other.k3;
+    }
+    bool operator!=(const Distortion& other) const { return !(*this == other); }
+    
+    // Distort normalized image coordinates in place
+    void apply(float& x, float& y) const {
+        float r2 = x * x + y * y;
+        float radial = 1.0f + r2 * (k1 + r2 * (k2 + r2 * k3));
+        float xd = x * radial + 2.0f * p1 * x * y + p2 * (r2 + 2.0f * x * x);
+        float yd = y * radial + p1 * (r2 + 2.0f * y * y) + 2.0f * p2 * x * y;
+        x = xd;
+        y = yd;
+    }
+};
+
 // Camera intrinsics
 struct Intrinsics {
     float fx = 525.0f;  // Focal length x
@@ -16,22 +48,29 @@ struct Intrinsics {
     float cy = 240.0f;  // Principal point y
     int width = 640;    // Image width
     int height = 480;   // Image height
+    Distortion distortion;  // Lens distortion (none: pinhole)
     
     Intrinsics() = default;
     Intrinsics(float fx_, float fy_, float cx_, float cy_, int w, int h)
         : fx(fx_), fy(fy_), cx(cx_), cy(cy_), width(w), height(h) {}
     
-    // Create scaled intrinsics (for zoom)
+    // Check for a pinhole camera (no lens distortion)
+    bool isPinhole() const { return distortion.isZero(); }
+    
+    // Create scaled intrinsics (for zoom), keeping the lens distortion
     Intrinsics scaled(float scale) const {
-        return Intrinsics(fx * scale, fy * scale, cx, cy, width, height);
+        Intrinsics K(fx * scale, fy * scale, cx, cy, width, height);
+        K.distortion = distortion;
+        return K;
     }
     
-    // Create with different resolution
+    // Create with different resolution (distortion is resolution independent)
     Intrinsics withResolution(int w, int h) const {
         float scale_x = static_cast<float>(w) / width;
         float scale_y = static_cast<float>(h) / height;
-        return Intrinsics(fx * scale_x, fy * scale_y, 
-                         cx * scale_x, cy * scale_y, w, h);
+        Intrinsics K(fx * scale_x, fy * scale_y, cx * scale_x, cy * scale_y, w, h);
+        K.distortion = distortion;
+        return K;
     }
 };
 
@@ -45,6 +84,33 @@ struct Vertex {
         : x(x_), y(y_), z(z_), u(u_), v(v_) {}
 };
 
+// Vertex stream layouts of a Mesh, selected when the mesh is generated
+enum class VertexLayout {
+    Float32,     // Vertex: X, Y, Z, u, v as floats (20 bytes)
+    DepthPixel,  // DepthPixelVertex: Z plus pixel coordinate (8 bytes)
+    Quantized16  // QuantizedVertex: 16-bit normalized position and UV (12 bytes)
+};
+
+// Depth-only vertex: X, Y and u, v are rebuilt from the pixel center and
+// the source intrinsics exactly like MeshGenerator's back-projection
+// (pinhole sources only)
+struct DepthPixelVertex {
+    float z;           // Metric depth
+    uint16_t px, py;   // Source pixel, packed into one 32-bit word
+    
+    DepthPixelVertex() : z(0), px(0), py(0) {}
+    DepthPixelVertex(float z_, uint16_t px_, uint16_t py_) : z(z_), px(px_), py(py_) {}
+};
+
+// Quantized vertex: position normalized to the mesh bounds, UV to [0, 1]
+struct QuantizedVertex {
+    uint16_t x, y, z;  // (position - offset) / scale * 65535
+    uint16_t pad;      // Keeps the UV attribute 4-byte aligned
+    uint16_t u, v;     // Texture coordinates * 65535
+    
+    QuantizedVertex() : x(0), y(0), z(0), pad(0), u(0), v(0) {}
+};
+
 // Triangle indices
 struct Triangle {
     uint32_t v0, v1, v2;
@@ -53,25 +119,189 @@ struct Triangle {
     Triangle(uint32_t a, uint32_t b, uint32_t c) : v0(a), v1(b), v2(c) {}
 };
 
+// Index streams of a Mesh, selected when the mesh is generated
+enum class IndexMode {
+    Triangles,  // Triangle list, 3 x uint32 per triangle
+    Strips,     // Row-wise uint32 triangle strips separated by kStripRestart
+    Meshlets    // Row-band meshlets: uint16 triangle lists plus a base vertex each
+};
+
+// Primitive restart index separating triangle strips
+static constexpr uint32_t kStripRestart = 0xFFFFFFFFu;
+
+// Meshlet of IndexMode::Meshlets
+// A tile of quads inside a row band; the vertices of a band are one
+// contiguous range, shared by the base vertex of all its tiles
+struct Meshlet {
+    uint32_t indexOffset;  // First entry in Mesh::meshletIndices
+    uint32_t indexCount;   // Number of uint16 indices (3 per triangle)
+    uint32_t baseVertex;   // Added to every local index
+    uint16_t minU, minV;   // Source pixels of the tile's vertices (inclusive)
+    uint16_t maxU, maxV;
+    
+    Meshlet() : indexOffset(0), indexCount(0), baseVertex(0), minU(0), minV(0), maxU(0), maxV(0) {}
+    Meshlet(uint32_t offset, uint32_t count, uint32_t base)
+        : indexOffset(offset), indexCount(count), baseVertex(base), minU(0), minV(0), maxU(0), maxV(0) {}
+};
+
 // Mesh data structure
+// Only the vertex stream of the current layout and the index stream of the
+// current index mode are filled
 struct Mesh {
-    std::vector<Vertex> vertices;
-    std::vector<Triangle> triangles;
+    VertexLayout layout = VertexLayout::Float32;
+    std::vector<Vertex> vertices;                  // Float32
+    std::vector<DepthPixelVertex> depthVertices;   // DepthPixel
+    std::vector<QuantizedVertex> quantizedVertices;  // Quantized16
+    
+    IndexMode indexMode = IndexMode::Triangles;
+    std::vector<Triangle> triangles;               // Triangles
+    std::vector<uint32_t> stripIndices;            // Strips
+    std::vector<uint16_t> meshletIndices;          // Meshlets
+    std::vector<Meshlet> meshlets;                 // Meshlets
+    size_t stripTriangles = 0;                     // Triangles encoded in stripIndices
+    
+    // Quantized16 dequantization: position = offset + q / 65535 * scale
+    std::array<float, 3> positionOffset = {{0.0f, 0.0f, 0.0f}};
+    std::array<float, 3> positionScale = {{1.0f, 1.0f, 1.0f}};
     
     void clear() {
         vertices.clear();
+        depthVertices.clear();
+        quantizedVertices.clear();
         triangles.clear();
+        stripIndices.clear();
+        meshletIndices.clear();
+        meshlets.clear();
+        stripTriangles = 0;
     }
     
     bool empty() const {
-        return vertices.empty() || triangles.empty();
+        return numVertices() == 0 || numTriangles() == 0;
+    }
+    
+    size_t numVertices() const {
+        switch (layout) {
+            case VertexLayout::DepthPixel: return depthVertices.size();
+            case VertexLayout::Quantized16: return quantizedVertices.size();
+            default: return vertices.size();
+        }
     }
+    size_t numTriangles() const {
+        switch (indexMode) {
+            case IndexMode::Strips: return stripTriangles;
+            case IndexMode::Meshlets: {
+                // Tiled meshes reserve more index slots than their meshlets use
+                size_t count = 0;
+                for (const Meshlet& m : meshlets) {
+                    count += m.indexCount / 3;
+                }
+                return count;
+            }
+            default: return triangles.size();
+        }
+    }
+    
+    // Bytes of the index stream
+    size_t indexBytes() const {
+        switch (indexMode) {
+            case IndexMode::Strips: return stripIndices.size() * sizeof(uint32_t);
+            case IndexMode::Meshlets: return meshletIndices.size() * sizeof(uint16_t);
+            default: return triangles.size() * sizeof(Triangle);
+        }
+    }
+    
+    // Bytes of the vertex stream per vertex
+    size_t vertexStride() const {
+        switch (layout) {
+            case VertexLayout::DepthPixel: return sizeof(DepthPixelVertex);
+            case VertexLayout::Quantized16: return sizeof(QuantizedVertex);
+            default: return sizeof(Vertex);
+        }
+    }
+    
+    // Decode vertex i of any layout
+    // sourceK is only used by DepthPixel, which needs the source camera
+    Vertex vertex(size_t i, const Intrinsics& sourceK) const {
+        switch (layout) {
+            case VertexLayout::DepthPixel: {
+                const DepthPixelVertex& d = depthVertices[i];
+                float uc = d.px + 0.5f;
+                float vc = d.py + 0.5f;
+                return Vertex((uc - sourceK.cx) / sourceK.fx * d.z,
+                              (vc - sourceK.cy) / sourceK.fy * d.z,
+                              d.z,
+                              uc / static_cast<float>(sourceK.width),
+                              vc / static_cast<float>(sourceK.height));
+            }
+            case VertexLayout::Quantized16: {
+                const QuantizedVertex& q = quantizedVertices[i];
+                const float k = 1.0f / 65535.0f;
+                return Vertex(positionOffset[0] + q.x * k * positionScale[0],
+                              positionOffset[1] + q.y * k * positionScale[1],
+                              positionOffset[2] + q.z * k * positionScale[2],
+                              q.u * k, q.v * k);
+            }
+            default:
+                return vertices[i];
+        }
+    }
+};
+
+// Element range [offset, offset + count) of a vertex or index stream
+struct BufferRange {
+    size_t offset = 0;
+    size_t count = 0;
     
-    size_t numVertices() const { return vertices.size(); }
-    size_t numTriangles() const { return triangles.size(); }
+    BufferRange() = default;
+    BufferRange(size_t offset_, size_t count_) : offset(offset_), count(count_) {}
+};
+
+// Parts of a Mesh rewritten since its previous version (mesh::SequenceMesh)
+// Ranges count elements of the mesh's current vertex and index streams;
+// the meshlet table is small and always taken as a whole
+struct MeshUpdate {
+    uint64_t version = 0;                   // Mesh version after this update
+    bool full = true;                       // Everything changed, upload the whole mesh
+    std::vector<BufferRange> vertexRanges;
+    std::vector<BufferRange> indexRanges;
+};
+
+// Render target format of the metric depth output
+enum class DepthFormat {
+    Float32,      // R32F meters
+    Float16,      // R16F meters (11-bit mantissa)
+    Millimeters   // R16UI integer millimeters, up to 65.535 m
+};
+
+// Outputs a render produces; the others are neither drawn nor read back
+struct OutputSelection {
+    bool rgb = true;
+    bool depth = true;
+    bool mask = true;
+    DepthFormat depthFormat = DepthFormat::Float32;
+    bool maskFromDepth = false;  // Mask is depth > 0, computed on the CPU instead of an R8 target
+    
+    // Depth target needed (for the depth output or a derived mask)
+    bool rendersDepth() const { return depth || (mask && maskFromDepth); }
+    bool rendersMask() const { return mask && !maskFromDepth; }
+    
+    bool empty() const { return !rgb && !depth && !mask; }
+    
+    bool operator==(const OutputSelection& other) const {
+        return rgb == other.rgb && depth == other.depth && mask == other.mask &&
+               depthFormat == other.depthFormat && maskFromDepth == other.maskFromDepth;
+    }
+    bool operator!=(const OutputSelection& other) const { return !(*this == other); }
+    
+    // Distinct value per render target combination (shader variant key)
+    int key() const {
+        return (rgb ? 1 : 0) | (rendersDepth() ? 2 : 0) | (rendersMask() ? 4 : 0) |
+               (static_cast<int>(depthFormat) << 3);
+    }
 };
 
 // Rendering output
+// Buffers of outputs left out of the OutputSelection are empty.
 struct RenderOutput {
     std::vector<uint8_t> rgb;      // HxWx3 RGB
     std::vector<float> depth;      // HxW metric depth (meters)
@@ -87,6 +317,28 @@ struct RenderOutput {
         mask.resize(w * h, 0);
     }
     
+    // Allocate the buffers of the selection's render targets only
+    void allocate(int w, int h, const OutputSelection& outputs) {
+        width = w;
+        height = h;
+        rgb.assign(outputs.rgb ? w * h * 3 : 0, 0);
+        depth.assign(outputs.rendersDepth() ? w * h : 0, 0.0f);
+        mask.assign(outputs.rendersMask() ? w * h : 0, 0);
+    }
+    
+    // Derive a depth-based mask and drop the buffers not selected
+    void select(const OutputSelection& outputs) {
+        if (outputs.mask && outputs.maskFromDepth) {
+            mask.resize(depth.size());
+            for (size_t i = 0; i < depth.size(); ++i) {
+                mask[i] = depth[i] > 0.0f ? 255 : 0;
+            }
+        }
+        if (!outputs.rgb) std::vector<uint8_t>().swap(rgb);
+        if (!outputs.depth) std::vector<float>().swap(depth);
+        if (!outputs.mask) std::vector<uint8_t>().swap(mask);
+    }
+    
     void clear() {
         std::fill(rgb.begin(), rgb.end(), 0);
         std::fill(depth.begin(), depth.end(), 0.0f);
@@ -0,0 +1,114 @@
+#version 330 core
+
+// Implicit grid: no vertex attributes. Each instance is one quad row of the
+// depth map and every six vertices form one quad (two triangles).
+
+// Uniforms: projection, depth texture and source camera
+uniform mat4 uProjection;
+uniform sampler2D uDepthTexture;  // R32F metric depth
+uniform vec4 uSourceK;            // Source fx, fy, cx, cy
+uniform ivec2 uGridSize;          // Depth map width, height
+uniform float uTauRel;            // Relative discontinuity threshold
+uniform float uTauAbs;            // Absolute discontinuity threshold (meters)
+
+// Target lens distortion (plumb_bob), applied to the normalized
+// coordinates of each vertex before the projection
+uniform bool uDistort;
+uniform vec4 uDistortion;    // k1, k2, p1, p2
+uniform float uDistortionK3;
+
+vec3 distortTarget(vec3 p) {
+    if (!uDistort || p.z <= 0.0) return p;
+    vec2 n = p.xy / p.z;
+    float r2 = dot(n, n);
+    float radial = 1.0 + r2 * (uDistortion.x + r2 * (uDistortion.y + r2 * uDistortionK3));
+    vec2 d = n * radial +
+             vec2(2.0 * uDistortion.z * n.x * n.y + uDistortion.w * (r2 + 2.0 * n.x * n.x),
+                  uDistortion.z * (r2 + 2.0 * n.y * n.y) + 2.0 * uDistortion.w * n.x * n.y);
+    return vec3(d * p.z, p.z);
+}
+
+// Layered batch variant (compiled with LAYERED and MAX_LAYERS defined):
+// instances are grouped per view, the projection comes from a uniform buffer
+// and outputs go through layer.geom, which sets gl_Layer
+#ifdef LAYERED
+layout(std140) uniform LayerProjections {
+    mat4 uLayerProjections[MAX_LAYERS];
+};
+flat out int gLayer;
+#define vTexCoord gTexCoord
+#define vDepth gDepth
+#endif
+
+// Output to fragment shader
+out vec2 vTexCoord;
+out float vDepth;
+
+// Triangle 1: v00, v10, v11 / Triangle 2: v00, v11, v01
+const ivec2 kCorners[6] = ivec2[6](
+    ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+    ivec2(0, 0), ivec2(1, 1), ivec2(0, 1)
+);
+
+// Same rule as DepthThresholds::isDiscontinuity
+bool isDiscontinuity(float z1, float z2) {
+    if (isnan(z1) || isinf(z1) || isnan(z2) || isinf(z2)) return true;
+    if (z1 <= 0.0 || z2 <= 0.0) return true;
+    
+    float diff = abs(z1 - z2);
+    float min_z = min(z1, z2);
+    float max_z = max(z1, z2);
+    
+    if (diff / min_z > uTauRel) return true;
+    
+    float adaptive_abs = uTauAbs * max(1.0, max_z / 2.0);
+    return diff > adaptive_abs;
+}
+
+bool isValidTriangle(float z0, float z1, float z2) {
+    return !isDiscontinuity(z0, z1) && !isDiscontinuity(z1, z2) && !isDiscontinuity(z2, z0);
+}
+
+void main() {
+    int corner = gl_VertexID % 6;
+#ifdef LAYERED
+    int rows = uGridSize.y - 1;
+    int layer = gl_InstanceID / rows;
+    int row = gl_InstanceID - layer * rows;
+    gLayer = layer;
+    mat4 projection = uLayerProjections[layer];
+#else
+    int row = gl_InstanceID;
+    mat4 projection = uProjection;
+#endif
+    ivec2 quad = ivec2(gl_VertexID / 6, row);
+    
+    // Depth of the four quad corners
+    float z00 = texelFetch(uDepthTexture, quad, 0).r;
+    float z10 = texelFetch(uDepthTexture, quad + ivec2(1, 0), 0).r;
+    float z01 = texelFetch(uDepthTexture, quad + ivec2(0, 1), 0).r;
+    float z11 = texelFetch(uDepthTexture, quad + ivec2(1, 1), 0).r;
+    
+    // Broken triangles are moved outside the clip volume
+    bool valid = (corner < 3) ? isValidTriangle(z00, z10, z11)
+                              : isValidTriangle(z00, z11, z01);
+    if (!valid) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        vTexCoord = vec2(0.0);
+        vDepth = 0.0;
+        return;
+    }
+    
+    // Back-project the pixel center to camera space
+    ivec2 pixel = quad + kCorners[corner];
+    float z = texelFetch(uDepthTexture, pixel, 0).r;
+    vec2 center = vec2(pixel) + 0.5;
+    vec3 position = vec3((center.x - uSourceK.z) / uSourceK.x * z,
+                         (center.y - uSourceK.w) / uSourceK.y * z,
+                         z);
+    
+    // Transform to clip space, pass texture coordinates and metric depth
+    gl_Position = projection * vec4(distortTarget(position), 1.0);
+    vTexCoord = center / vec2(uGridSize);
+    vDepth = z;
+}
@@ -7,13 +7,48 @@ layout(location = 1) in vec2 aTexCoord;  // UV texture coordinates
 // Uniform: Projection matrix
 uniform mat4 uProjection;
 
+// Target lens distortion (plumb_bob), applied to the normalized
+// coordinates of each vertex before the projection
+uniform bool uDistort;
+uniform vec4 uDistortion;    // k1, k2, p1, p2
+uniform float uDistortionK3;
+
+vec3 distortTarget(vec3 p) {
+    if (!uDistort || p.z <= 0.0) return p;
+    vec2 n = p.xy / p.z;
+    float r2 = dot(n, n);
+    float radial = 1.0 + r2 * (uDistortion.x + r2 * (uDistortion.y + r2 * uDistortionK3));
+    vec2 d = n * radial +
+             vec2(2.0 * uDistortion.z * n.x * n.y + uDistortion.w * (r2 + 2.0 * n.x * n.x),
+                  uDistortion.z * (r2 + 2.0 * n.y * n.y) + 2.0 * uDistortion.w * n.x * n.y);
+    return vec3(d * p.z, p.z);
+}
+
+// Layered batch variant (compiled with LAYERED and MAX_LAYERS defined):
+// one instance per view, the projection comes from a uniform buffer and
+// outputs go through layer.geom, which sets gl_Layer
+#ifdef LAYERED
+layout(std140) uniform LayerProjections {
+    mat4 uLayerProjections[MAX_LAYERS];
+};
+flat out int gLayer;
+#define vTexCoord gTexCoord
+#define vDepth gDepth
+#endif
+
 // Output to fragment shader
 out vec2 vTexCoord;
 out float vDepth;
 
 void main() {
     // Transform vertex from camera space to clip space
-    gl_Position = uProjection * vec4(aPosition, 1.0);
+    vec3 projected = distortTarget(aPosition);
+#ifdef LAYERED
+    gLayer = gl_InstanceID;
+    gl_Position = uLayerProjections[gl_InstanceID] * vec4(projected, 1.0);
+#else
+    gl_Position = uProjection * vec4(projected, 1.0);
+#endif
     
     // Pass texture coordinates
     vTexCoord = aTexCoord;
@@ -0,0 +1,545 @@
+#include "batch_runner.hpp"
+#include "image_io.hpp"
+#include "depth_io.hpp"
+#include "camera_info.hpp"
+#include "gl_renderer.hpp"
+#include "trace.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace rgbd {
+namespace app {
+
+namespace {
+
+/**
+ * Match a file name against a pattern where '*' matches any run of characters
+ */
+bool matchWildcard(const char* pattern, const char* name) {
+    if (*pattern == '\0') return *name == '\0';
+    if (*pattern == '*') {
+        for (const char* p = name; ; ++p) {
+            if (matchWildcard(pattern + 1, p)) return true;
+            if (*p == '\0') return false;
+        }
+    }
+    return *pattern == *name && matchWildcard(pattern + 1, name + 1);
+}
+
+/**
+ * Frame name from an RGB path: "dir/123_rgb.png" -> "123"
+ */
+std::string frameName(const fs::path& rgbPath) {
+    std::string stem = rgbPath.stem().string();
+    const std::string suffix = "_rgb";
+    if (stem.size() > suffix.size() &&
+        stem.compare(stem.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        stem.resize(stem.size() - suffix.size());
+    }
+    return stem;
+}
+
+/**
+ * Name of a focal scale's files ("scale_1.00")
+ */
+std::string scaleName(float scale) {
+    std::ostringstream name;
+    name << std::fixed << std::setprecision(2) << "scale_" << scale;
+    return name.str();
+}
+
+/**
+ * Collects the scales of one frame for OutputSink::submitFrame()
+ */
+struct FrameBundle {
+    std::vector<RenderOutput> outputs;
+    std::vector<bool> rendered;
+
+    explicit FrameBundle(size_t numScales) : outputs(numScales), rendered(numScales, false) {}
+
+    void add(size_t index, RenderOutput&& output) {
+        outputs[index] = std::move(output);
+        rendered[index] = true;
+    }
+
+    // Queue the rendered scales in scale order
+    void submit(const Config& config, OutputSink& sink, const std::string& prefix) {
+        std::vector<std::string> names;
+        std::vector<RenderOutput> parts;
+        for (size_t i = 0; i < outputs.size(); ++i) {
+            if (rendered[i]) {
+                names.push_back(scaleName(config.focalScales[i]));
+                parts.push_back(std::move(outputs[i]));
+            }
+        }
+        if (!parts.empty()) {
+            sink.submitFrame(prefix, names, std::move(parts));
+        }
+    }
+};
+
+} // namespace
+
+bool loadManifest(const std::string& path, std::vector<FrameSpec>& frames) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open manifest: " << path << std::endl;
+        return false;
+    }
+
+    fs::path base = fs::path(path).parent_path();
+    auto resolve = [&](const std::string& p) {
+        fs::path fp(p);
+        return (fp.is_absolute() ? fp : base / fp).string();
+    };
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream ss(line);
+        std::string rgb, depth, info;
+        if (!(ss >> rgb) || rgb[0] == '#') {
+            continue;
+        }
+        if (!(ss >> depth)) {
+            std::cerr << "Error: Manifest line " << lineNumber << " needs RGB and depth paths" << std::endl;
+            return false;
+        }
+        ss >> info;
+
+        FrameSpec frame;
+        frame.name = frameName(rgb);
+        frame.rgbPath = resolve(rgb);
+        frame.depthPath = resolve(depth);
+        frame.cameraInfoPath = info.empty() ? "" : resolve(info);
+        frames.push_back(frame);
+    }
+    return true;
+}
+
+bool scanFrames(const std::string& pattern, std::vector<FrameSpec>& frames) {
+    fs::path dir(pattern);
+    std::string namePattern = "*_rgb.*";
+    if (pattern.find('*') != std::string::npos) {
+        namePattern = dir.filename().string();
+        dir = dir.parent_path();
+    }
+    if (dir.empty()) {
+        dir = ".";
+    }
+
+    std::error_code ec;
+    if (!fs::is_directory(dir, ec)) {
+        std::cerr << "Error: Not a directory: " << dir.string() << std::endl;
+        return false;
+    }
+
+    std::vector<FrameSpec> found;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        std::string fileName = entry.path().filename().string();
+        if (!entry.is_regular_file() || !matchWildcard(namePattern.c_str(), fileName.c_str())) {
+            continue;
+        }
+
+        FrameSpec frame;
+        frame.name = frameName(entry.path());
+        frame.rgbPath = entry.path().string();
+        for (const char* ext : { ".png", ".npy", ".exr" }) {
+            fs::path depth = dir / (frame.name + "_depth" + ext);
+            if (fs::exists(depth)) {
+                frame.depthPath = depth.string();
+                break;
+            }
+        }
+        if (frame.depthPath.empty()) {
+            std::cerr << "Warning: No depth map for " << fileName << ", skipping" << std::endl;
+            continue;
+        }
+        fs::path info = dir / (frame.name + "_depth_camera_info.json");
+        if (fs::exists(info)) {
+            frame.cameraInfoPath = info.string();
+        }
+        found.push_back(frame);
+    }
+
+    std::sort(found.begin(), found.end(),
+              [](const FrameSpec& a, const FrameSpec& b) { return a.name < b.name; });
+    frames.insert(frames.end(), found.begin(), found.end());
+
+    if (found.empty()) {
+        std::cerr << "Error: No frames matching " << namePattern << " in " << dir.string() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool renderFocalScales(render::Renderer& renderer, const Intrinsics& sourceK,
+                       const Config& config, OutputSink& sink, const std::string& prefix) {
+    if (sink.bundlesFrames()) {
+        // One file for every scale, queued once the last one is read back
+        FrameBundle bundle(config.focalScales.size());
+        bool ok = renderFocalScales(renderer, sourceK, config, [&](size_t index, RenderOutput&& output) {
+            bundle.add(index, std::move(output));
+        });
+        bundle.submit(config, sink, prefix);
+        return ok;
+    }
+    return renderFocalScales(renderer, sourceK, config, [&](size_t index, RenderOutput&& output) {
+        sink.submit(prefix + scaleName(config.focalScales[index]), std::move(output));
+    });
+}
+
+Intrinsics focalScaleTarget(const Intrinsics& sourceK, const Config& config, float scale) {
+    int outputW = (config.outputWidth > 0) ? config.outputWidth : sourceK.width;
+    int outputH = (config.outputHeight > 0) ? config.outputHeight : sourceK.height;
+
+    Intrinsics targetK = sourceK;
+    targetK.fx = sourceK.fx * scale;
+    targetK.fy = sourceK.fy * scale;
+    targetK.width = outputW;
+    targetK.height = outputH;
+    if (config.targetDistortion == "none") {
+        targetK.distortion = Distortion();
+    }
+
+    // Adjust principal point for resolution change
+    if (outputW != sourceK.width || outputH != sourceK.height) {
+        targetK.cx = sourceK.cx * outputW / sourceK.width;
+        targetK.cy = sourceK.cy * outputH / sourceK.height;
+    }
+    return targetK;
+}
+
+bool renderFocalScales(render::Renderer& renderer, const Intrinsics& sourceK, const Config& config,
+                       const std::function<void(size_t, RenderOutput&&)>& consume) {
+    int outputW = (config.outputWidth > 0) ? config.outputWidth : sourceK.width;
+    int outputH = (config.outputHeight > 0) ? config.outputHeight : sourceK.height;
+
+    const size_t numScales = config.focalScales.size();
+    bool ok = true;
+
+    if (config.batch) {
+        // Every scale in one layered submission with a single readback
+        std::vector<Intrinsics> targetKs;
+        for (float scale : config.focalScales) {
+            targetKs.push_back(focalScaleTarget(sourceK, config, scale));
+        }
+
+        std::cout << "\n  Rendering " << numScales << " scales in one batch, size="
+                  << outputW << "x" << outputH << std::endl;
+
+        std::vector<RenderOutput> outputs;
+        if (!renderer.renderBatch(sourceK, targetKs, config.nearPlane, config.farPlane, outputs)) {
+            std::cerr << "Error: Batch rendering failed" << std::endl;
+            return false;
+        }
+
+        for (size_t i = 0; i < numScales; ++i) {
+            std::cout << "  Queued scale " << config.focalScales[i] << " (" << (i + 1)
+                      << "/" << numScales << ")" << std::endl;
+            consume(i, std::move(outputs[i]));
+        }
+        return true;
+    }
+
+    // Keep up to pipeline_depth renders in flight: the next scale is drawn
+    // while earlier ones are still being read back, results are saved in order
+    renderer.setPipelineDepth(config.pipelineDepth);
+    std::deque<size_t> inFlight;
+    size_t nextScale = 0;
+
+    while (nextScale < numScales || !inFlight.empty()) {
+        if (nextScale < numScales &&
+            renderer.pendingCount() < static_cast<size_t>(renderer.getPipelineDepth())) {
+            size_t i = nextScale++;
+            float scale = config.focalScales[i];
+
+            std::cout << "\n  Processing scale " << scale << " (" << (i + 1)
+                      << "/" << numScales << ")..." << std::endl;
+
+            Intrinsics targetK = focalScaleTarget(sourceK, config, scale);
+            std::cout << "    Target: fx=" << targetK.fx << ", fy=" << targetK.fy
+                      << ", size=" << targetK.width << "x" << targetK.height << std::endl;
+
+            // Render (readback continues in the background)
+            if (!renderer.submit(sourceK, targetK, config.nearPlane, config.farPlane)) {
+                std::cerr << "    Error: Rendering failed" << std::endl;
+                ok = false;
+                continue;
+            }
+            inFlight.push_back(i);
+            continue;
+        }
+
+        // Ring full or nothing left to submit: wait for the oldest result
+        size_t index = inFlight.front();
+        float scale = config.focalScales[index];
+        inFlight.pop_front();
+
+        std::cout << "\n  Reading back scale " << scale << "..." << std::endl;
+        RenderOutput output;
+        if (!renderer.retrieve(output)) {
+            std::cerr << "    Error: Readback failed" << std::endl;
+            ok = false;
+            continue;
+        }
+        consume(index, std::move(output));
+    }
+    return ok;
+}
+
+bool renderFocalScales(render::RenderPool& pool, const render::RenderPool::Upload& upload,
+                       const Intrinsics& sourceK, const Config& config,
+                       OutputSink& sink, const std::string& prefix) {
+    std::vector<Intrinsics> targetKs;
+    for (float scale : config.focalScales) {
+        targetKs.push_back(focalScaleTarget(sourceK, config, scale));
+    }
+
+    std::cout << "\n  Rendering " << targetKs.size() << " scales on " << pool.size()
+              << " contexts" << std::endl;
+    if (sink.bundlesFrames()) {
+        FrameBundle bundle(targetKs.size());
+        bool ok = pool.renderViews(upload, sourceK, targetKs, config.nearPlane, config.farPlane,
+            [&](size_t index, RenderOutput&& output) {
+                bundle.add(index, std::move(output));
+            });
+        bundle.submit(config, sink, prefix);
+        return ok;
+    }
+    return pool.renderViews(upload, sourceK, targetKs, config.nearPlane, config.farPlane,
+        [&](size_t index, RenderOutput&& output) {
+            std::cout << "  Queued scale " << config.focalScales[index] << std::endl;
+            sink.submit(prefix + scaleName(config.focalScales[index]), std::move(output));
+        });
+}
+
+BatchRunner::BatchRunner(const Config& config) : config_(config) {}
+
+bool BatchRunner::run(render::Renderer& renderer, const std::vector<FrameSpec>& frames,
+                      OutputSink& sink) {
+    processed_ = 0;
+    failed_ = 0;
+    uploadedVersion_ = 0;
+
+    BoundedQueue<LoadedFrame> loaded(static_cast<size_t>(config_.frameQueue));
+    BoundedQueue<MeshedFrame> meshed(static_cast<size_t>(config_.frameQueue));
+    std::thread loader(&BatchRunner::loadStage, this, std::cref(frames), std::ref(loaded));
+    std::thread mesher(&BatchRunner::meshStage, this, std::ref(loaded), std::ref(meshed));
+
+    MeshedFrame frame;
+    size_t index = 0;
+    while (meshed.pop(frame)) {
+        index++;
+        std::cout << "\n=== Frame " << frame.frame.spec.name << " (" << index << "/"
+                  << frames.size() << ") ===" << std::endl;
+        if (renderFrame(renderer, frame, sink)) {
+            processed_++;
+        } else {
+            std::cerr << "Error: Frame " << frame.frame.spec.name << " failed" << std::endl;
+            failed_++;
+        }
+        // Release the frame's images and mesh before waiting for the next one
+        frame = MeshedFrame();
+    }
+
+    loader.join();
+    mesher.join();
+    return failed_ == 0;
+}
+
+bool BatchRunner::run(render::RenderPool& pool, const std::vector<FrameSpec>& frames,
+                      OutputSink& sink) {
+    processed_ = 0;
+    failed_ = 0;
+
+    BoundedQueue<LoadedFrame> loaded(static_cast<size_t>(config_.frameQueue));
+    BoundedQueue<MeshedFrame> meshed(static_cast<size_t>(config_.frameQueue));
+    std::thread loader(&BatchRunner::loadStage, this, std::cref(frames), std::ref(loaded));
+    std::thread mesher(&BatchRunner::meshStage, this, std::ref(loaded), std::ref(meshed));
+
+    // Frames on the pool, oldest first; waiting on the oldest bounds memory
+    std::deque<std::pair<std::string, std::future<bool>>> inFlight;
+    const size_t maxInFlight = pool.size() + static_cast<size_t>(config_.frameQueue);
+    auto collect = [&]() {
+        auto& oldest = inFlight.front();
+        if (oldest.second.get()) {
+            processed_++;
+        } else {
+            std::cerr << "Error: Frame " << oldest.first << " failed" << std::endl;
+            failed_++;
+        }
+        inFlight.pop_front();
+    };
+
+    MeshedFrame frame;
+    size_t index = 0;
+    while (meshed.pop(frame)) {
+        index++;
+        std::cout << "\n=== Frame " << frame.frame.spec.name << " (" << index << "/"
+                  << frames.size() << ") ===" << std::endl;
+        std::string name = frame.frame.spec.name;
+        auto shared = std::make_shared<MeshedFrame>(std::move(frame));
+        frame = MeshedFrame();
+        inFlight.emplace_back(name, pool.submit([this, shared, &sink](render::GLRenderer& renderer) {
+            return renderFrame(renderer, *shared, sink);
+        }));
+        while (inFlight.size() >= maxInFlight) {
+            collect();
+        }
+    }
+    while (!inFlight.empty()) {
+        collect();
+    }
+
+    loader.join();
+    mesher.join();
+    return failed_ == 0;
+}
+
+void BatchRunner::loadStage(const std::vector<FrameSpec>& frames, BoundedQueue<LoadedFrame>& loaded) {
+    trace::setThreadName("load");
+    for (const FrameSpec& spec : frames) {
+        LoadedFrame frame;
+        frame.spec = spec;
+        frame.rgb = io::loadRGB(spec.rgbPath);
+        // .npy depth is mapped instead of read; the frame keeps the mapping alive
+        io::MappedMat depth = io::mapDepth(spec.depthPath, config_.depthScale);
+        frame.depth = depth.mat;
+        frame.depthSource = depth.source;
+        if (frame.rgb.empty() || frame.depth.empty()) {
+            std::cerr << "Error: Failed to load frame " << spec.name << std::endl;
+            failed_++;
+            continue;
+        }
+        if (frame.rgb.cols != frame.depth.cols || frame.rgb.rows != frame.depth.rows) {
+            std::cerr << "Error: RGB and depth dimensions mismatch in frame " << spec.name << std::endl;
+            failed_++;
+            continue;
+        }
+
+        // Intrinsics from the frame's camera info, otherwise from the command line
+        Intrinsics K = config_.getSourceIntrinsics(frame.rgb.cols, frame.rgb.rows);
+        if (!spec.cameraInfoPath.empty()) {
+            if (!io::loadCameraInfo(spec.cameraInfoPath, K)) {
+                failed_++;
+                continue;
+            }
+            // Camera info may describe another resolution than the stored images
+            if (K.width != frame.rgb.cols || K.height != frame.rgb.rows) {
+                K = K.withResolution(frame.rgb.cols, frame.rgb.rows);
+            }
+        }
+        frame.K = K;
+
+        if (!loaded.push(std::move(frame))) {
+            break;
+        }
+    }
+    loaded.close();
+}
+
+void BatchRunner::meshStage(BoundedQueue<LoadedFrame>& loaded, BoundedQueue<MeshedFrame>& meshed) {
+    trace::setThreadName("mesh");
+    const bool gridMode = config_.usesDepthGrid();
+    // Sequence mode meshes every frame into the previous frame's mesh
+    mesh::SequenceMesh sequence;
+    if (config_.sequence) {
+        sequence.setThresholds(config_.getThresholds());
+        sequence.setVertexLayout(config_.getVertexLayout());
+        sequence.setNumThreads(config_.numThreads);
+        sequence.setOptions(config_.getSequenceOptions());
+    }
+    LoadedFrame frame;
+    while (loaded.pop(frame)) {
+        MeshedFrame result;
+        if (config_.sequence) {
+            if (!sequence.update(frame.depth, frame.K, result.update)) {
+                std::cerr << "Error: Failed to update mesh for frame " << frame.spec.name << std::endl;
+                failed_++;
+                continue;
+            }
+            const mesh::SequenceReport& report = sequence.getReport();
+            std::cout << "  Sequence mesh " << frame.spec.name << ": "
+                      << (report.rebuilt ? "rebuilt " : "updated ") << report.changedTiles
+                      << "/" << report.tiles << " tiles" << std::endl;
+            result.sequenceMesh = sequence.getMesh();
+            // The texture is uploaded as is: 3 channels like DepthMesh::getTexture()
+            if (frame.rgb.channels() == 4) {
+                cv::cvtColor(frame.rgb, frame.rgb, cv::COLOR_BGRA2BGR);
+            } else if (frame.rgb.channels() == 1) {
+                cv::cvtColor(frame.rgb, frame.rgb, cv::COLOR_GRAY2BGR);
+            }
+        } else if (!gridMode) {
+            result.mesh.reset(new mesh::DepthMesh());
+            result.mesh->setNumThreads(config_.numThreads);
+            result.mesh->setVertexLayout(config_.getVertexLayout());
+            result.mesh->setIndexMode(config_.getIndexMode());
+            result.mesh->setAdaptive(config_.getAdaptiveOptions());
+            if (!result.mesh->build(frame.rgb, frame.depth, frame.K, config_.getThresholds())) {
+                std::cerr << "Error: Failed to build mesh for frame " << frame.spec.name << std::endl;
+                failed_++;
+                continue;
+            }
+        }
+        result.frame = std::move(frame);
+        frame = LoadedFrame();
+
+        if (!meshed.push(std::move(result))) {
+            break;
+        }
+    }
+    meshed.close();
+}
+
+bool BatchRunner::renderFrame(render::Renderer& renderer, MeshedFrame& frame, OutputSink& sink) {
+    RGBD_TRACE_SCOPE("renderFrame");
+    const LoadedFrame& f = frame.frame;
+    std::cout << "  Intrinsics: fx=" << f.K.fx << ", fy=" << f.K.fy
+              << ", cx=" << f.K.cx << ", cy=" << f.K.cy << std::endl;
+
+    if (frame.sequenceMesh) {
+        // A frame that failed in between leaves the renderer behind: upload it all
+        if (frame.update.version != uploadedVersion_ + 1) {
+            frame.update.full = true;
+        }
+        if (!renderer.updateMesh(*frame.sequenceMesh, frame.update)) {
+            uploadedVersion_ = 0;
+            return false;
+        }
+        uploadedVersion_ = frame.update.version;
+        if (!renderer.uploadTexture(f.rgb)) {
+            return false;
+        }
+    } else if (frame.mesh) {
+        if (!renderer.uploadMesh(frame.mesh->getMesh()) ||
+            !renderer.uploadTexture(frame.mesh->getTexture())) {
+            return false;
+        }
+    } else {
+        // Depth grid: grid mode of the gl backend or the resample backend
+        if (auto* glRenderer = dynamic_cast<render::GLRenderer*>(&renderer)) {
+            glRenderer->setRenderMode(render::RenderMode::ImplicitGrid);
+        }
+        if (!renderer.uploadDepth(f.depth, config_.getThresholds()) ||
+            !renderer.uploadTexture(f.rgb)) {
+            return false;
+        }
+    }
+
+    return renderFocalScales(renderer, f.K, config_, sink, f.spec.name + "_");
+}
+
+} // namespace app
+} // namespace rgbd
@@ -1,4 +1,6 @@
 #include "config.hpp"
+#include "mesh_generator.hpp"
+#include "trace.hpp"
 #include <iostream>
 #include <sstream>
 #include <cstring>
@@ -7,16 +9,49 @@
 namespace rgbd {
 namespace app {
 
+bool parseOutputSelection(const std::string& list, const std::string& format,
+                          OutputSelection& outputs) {
+    outputs.rgb = outputs.depth = outputs.mask = false;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (item == "rgb") outputs.rgb = true;
+        else if (item == "depth") outputs.depth = true;
+        else if (item == "mask") outputs.mask = true;
+        else return false;
+    }
+    
+    if (format == "float32") outputs.depthFormat = DepthFormat::Float32;
+    else if (format == "float16") outputs.depthFormat = DepthFormat::Float16;
+    else if (format == "mm16") outputs.depthFormat = DepthFormat::Millimeters;
+    else return false;
+    return !outputs.empty();
+}
+
 std::string Config::validate() const {
-    if (rgbPath.empty()) {
-        return "RGB image path is required";
+    if (isServer() && (isMultiFrame() || !rgbPath.empty())) {
+        return "Serve mode takes its inputs from requests (no --rgb / --manifest / --input_dir)";
     }
-    if (depthPath.empty()) {
-        return "Depth map path is required";
+    if (!isMultiFrame() && !isServer()) {
+        if (rgbPath.empty()) {
+            return "RGB image path is required";
+        }
+        if (depthPath.empty()) {
+            return "Depth map path is required";
+        }
     }
     if (fx <= 0 || fy <= 0) {
         return "Focal length (fx, fy) must be positive";
     }
+    if (!distortion.empty() && distortion.size() != 4 && distortion.size() != 5) {
+        return "Distortion must be 4 or 5 plumb_bob coefficients (k1,k2,p1,p2[,k3])";
+    }
+    if (!cameraInfoPath.empty() && (isMultiFrame() || isServer())) {
+        return "--camera_info is for single-frame input (manifests list camera info per frame)";
+    }
+    if (targetDistortion != "source" && targetDistortion != "none") {
+        return "Target distortion must be 'source' or 'none'";
+    }
     if (focalScales.empty()) {
         return "At least one focal scale is required";
     }
@@ -26,16 +61,227 @@ std::string Config::validate() const {
     if (nearPlane <= 0 || farPlane <= 0 || nearPlane >= farPlane) {
         return "Invalid near/far planes";
     }
+    if (backend != "gl" && backend != "cpu" && backend != "resample") {
+        return "Backend must be 'gl', 'cpu' or 'resample'";
+    }
+    if (renderMode != "mesh" && renderMode != "grid") {
+        return "Render mode must be 'mesh' or 'grid'";
+    }
+    if (backend == "cpu" && renderMode == "grid") {
+        return "Grid render mode requires the gl backend";
+    }
+    if (backend == "resample" && (adaptiveError > 0 || sequence)) {
+        return "The resample backend renders depth grids (no adaptive or sequence meshing)";
+    }
+    // Distorted sources are meshed along MeshGenerator's ray table; the
+    // implicit grid, DepthPixel and adaptive meshing assume a pinhole camera
+    bool distorted = false;
+    for (float c : distortion) {
+        distorted = distorted || c != 0.0f;
+    }
+    if (distorted && (usesDepthGrid() || vertexLayout == "depth_pixel" || adaptiveError > 0)) {
+        return "Lens distortion requires render mode 'mesh' without the depth_pixel layout "
+               "or adaptive meshing";
+    }
+    VertexLayout layout;
+    if (!mesh::parseVertexLayout(vertexLayout, layout)) {
+        return "Vertex layout must be 'float32', 'depth_pixel' or 'quantized16'";
+    }
+    IndexMode mode;
+    if (!mesh::parseIndexMode(indexMode, mode)) {
+        return "Index mode must be 'triangles', 'strips' or 'meshlets'";
+    }
+    if (adaptiveError < 0 || adaptiveDepthError <= 0) {
+        return "Adaptive error bounds must be non-negative (depth error positive)";
+    }
+    if (adaptiveError > 0 && (usesDepthGrid() || indexMode != "triangles")) {
+        return "Adaptive meshing requires render mode 'mesh' and index mode 'triangles'";
+    }
+    if (sequence) {
+        if (!isMultiFrame()) {
+            return "Sequence mode requires multi-frame input (--manifest / --input_dir)";
+        }
+        if (usesDepthGrid() || adaptiveError > 0) {
+            return "Sequence mode requires render mode 'mesh' without adaptive meshing";
+        }
+        if (vertexLayout == "quantized16" || (indexMode != "triangles" && indexMode != "meshlets")) {
+            return "Sequence mode requires vertex layout 'float32' or 'depth_pixel' and "
+                   "index mode 'triangles' or 'meshlets'";
+        }
+        if (usesRenderPool()) {
+            return "Sequence mode renders on a single context (no --gl_contexts / --gpus)";
+        }
+        if (sequenceTolerance < 0 || sequenceRebuild < 0 || sequenceRebuild > 1) {
+            return "Sequence tolerance must be non-negative and the rebuild fraction in [0, 1]";
+        }
+    }
+    OutputSelection selection;
+    if (!parseOutputSelection(outputs, depthFormat, selection)) {
+        return "Outputs must be a non-empty list of rgb, depth, mask and the depth format "
+               "'float32', 'float16' or 'mm16'";
+    }
+    if (glContexts < 1) {
+        return "GL context count must be at least 1";
+    }
+    if (usesRenderPool()) {
+        if (backend != "gl") {
+            return "GL context pools (--gl_contexts, --gpus) require the gl backend";
+        }
+        if (isServer()) {
+            return "Serve mode renders on a single context (no --gl_contexts / --gpus)";
+        }
+        if (gpuList != "all" && !gpuList.empty() &&
+            gpuList.find_first_not_of("0123456789,") != std::string::npos) {
+            return "GPU list must be 'all' or comma-separated device indices";
+        }
+    }
+    if (pipelineDepth < 1) {
+        return "Pipeline depth must be at least 1";
+    }
+    if (frameQueue < 1) {
+        return "Frame queue size must be at least 1";
+    }
+    io::ExrCompression compression;
+    if (!io::parseExrCompression(exrCompression, compression)) {
+        return "EXR compression must be 'none', 'zip', 'zips', 'piz' or 'dwaa'";
+    }
+    if (exrBundle != "none" && exrBundle != "scale" && exrBundle != "frame") {
+        return "EXR bundle must be 'none', 'scale' or 'frame'";
+    }
+    if (exrBundle != "none" && !io::exrAvailable()) {
+        return "EXR bundles require OpenEXR";
+    }
+    if (exrBundle == "frame" && isServer()) {
+        return "Serve mode answers per scale (no --exr_bundle frame)";
+    }
+    if (tarShardMB < 0) {
+        return "Tar shard size must be non-negative";
+    }
+    if (tarShardMB > 0 && isServer()) {
+        return "Serve mode answers per request (no --tar_shard_mb)";
+    }
+    if (!tracePath.empty() && !trace::compiledIn()) {
+        return "Built without tracing (RGBD_TRACE=OFF), --trace is unavailable";
+    }
+    if (numThreads < 0 || encodeThreads < 0 || exrThreads < 0) {
+        return "Thread count must be non-negative";
+    }
     return "";
 }
 
+VertexLayout Config::getVertexLayout() const {
+    VertexLayout layout = VertexLayout::Float32;
+    mesh::parseVertexLayout(vertexLayout, layout);
+    return layout;
+}
+
+Intrinsics Config::getSourceIntrinsics(int width, int height) const {
+    Intrinsics K;
+    K.fx = fx;
+    K.fy = fy;
+    K.cx = (cx >= 0) ? cx : static_cast<float>(width) / 2.0f;
+    K.cy = (cy >= 0) ? cy : static_cast<float>(height) / 2.0f;
+    K.width = width;
+    K.height = height;
+    const float* d = distortion.data();
+    const size_t n = distortion.size();
+    K.distortion.k1 = n > 0 ? d[0] : 0.0f;
+    K.distortion.k2 = n > 1 ? d[1] : 0.0f;
+    K.distortion.p1 = n > 2 ? d[2] : 0.0f;
+    K.distortion.p2 = n > 3 ? d[3] : 0.0f;
+    K.distortion.k3 = n > 4 ? d[4] : 0.0f;
+    return K;
+}
+
+IndexMode Config::getIndexMode() const {
+    IndexMode mode = IndexMode::Triangles;
+    mesh::parseIndexMode(indexMode, mode);
+    return mode;
+}
+
+OutputSelection Config::getOutputSelection() const {
+    OutputSelection selection;
+    if (!parseOutputSelection(outputs, depthFormat, selection)) {
+        return OutputSelection();
+    }
+    selection.maskFromDepth = maskFromDepth;
+    return selection;
+}
+
+mesh::AdaptiveOptions Config::getAdaptiveOptions() const {
+    mesh::AdaptiveOptions options;
+    options.maxErrorPx = adaptiveError;
+    options.maxDepthError = adaptiveDepthError;
+    options.maxFocalScale = focalScales.empty() ? 1.0f :
+        *std::max_element(focalScales.begin(), focalScales.end());
+    return options;
+}
+
+io::ExrOptions Config::getExrOptions() const {
+    io::ExrOptions options;
+    io::parseExrCompression(exrCompression, options.compression);
+    options.halfDepth = exrHalf;
+    return options;
+}
+
+ExrBundle Config::getExrBundle() const {
+    if (exrBundle == "scale") return ExrBundle::Scale;
+    if (exrBundle == "frame") return ExrBundle::Frame;
+    return ExrBundle::None;
+}
+
+mesh::SequenceOptions Config::getSequenceOptions() const {
+    mesh::SequenceOptions options;
+    options.depthTolerance = sequenceTolerance;
+    options.maxChangedFraction = sequenceRebuild;
+    return options;
+}
+
+std::vector<int> Config::getPoolDevices() const {
+    std::vector<int> devices;
+    if (gpuList == "all") {
+        return devices;
+    }
+    if (gpuList.empty()) {
+        devices.push_back(gpuDevice);
+        return devices;
+    }
+    std::stringstream ss(gpuList);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) {
+            devices.push_back(std::stoi(item));
+        }
+    }
+    return devices;
+}
+
 void Config::print() const {
     std::cout << "\n=== Configuration ===" << std::endl;
-    std::cout << "RGB: " << rgbPath << std::endl;
-    std::cout << "Depth: " << depthPath << std::endl;
+    if (isServer()) {
+        std::cout << "Serve socket: " << serveSocket << std::endl;
+        std::cout << "Request queue: " << frameQueue << std::endl;
+    } else if (isMultiFrame()) {
+        if (!manifestPath.empty()) std::cout << "Manifest: " << manifestPath << std::endl;
+        if (!inputDir.empty()) std::cout << "Input: " << inputDir << std::endl;
+        std::cout << "Frame queue: " << frameQueue << std::endl;
+    } else {
+        std::cout << "RGB: " << rgbPath << std::endl;
+        std::cout << "Depth: " << depthPath << std::endl;
+    }
     std::cout << "Output: " << outputDir << std::endl;
     std::cout << "Intrinsics: fx=" << fx << ", fy=" << fy 
               << ", cx=" << cx << ", cy=" << cy << std::endl;
+    if (!distortion.empty()) {
+        std::cout << "Distortion: [";
+        for (size_t i = 0; i < distortion.size(); ++i) {
+            std::cout << distortion[i] << (i + 1 < distortion.size() ? ", " : "");
+        }
+        std::cout << "], targets " << targetDistortion << std::endl;
+    }
+    if (!cameraInfoPath.empty()) {
+        std::cout << "Camera info: " << cameraInfoPath << std::endl;
+    }
     std::cout << "Depth scale: " << depthScale << std::endl;
     std::cout << "Focal scales: [";
     for (size_t i = 0; i < focalScales.size(); ++i) {
@@ -46,6 +292,40 @@ void Config::print() const {
     std::cout << "Thresholds: tau_rel=" << tauRel << ", tau_abs=" << tauAbs << std::endl;
     std::cout << "Planes: near=" << nearPlane << ", far=" << farPlane << std::endl;
     std::cout << "GPU device: " << gpuDevice << std::endl;
+    if (usesRenderPool()) {
+        std::cout << "Context pool: " << glContexts << " per device on "
+                  << (gpuList.empty() ? std::to_string(gpuDevice) : gpuList) << std::endl;
+    }
+    std::cout << "Backend: " << backend << std::endl;
+    if (!tracePath.empty()) {
+        std::cout << "Trace: " << tracePath << std::endl;
+    }
+    if (!shaderCacheDir.empty()) {
+        std::cout << "Shader cache: " << shaderCacheDir << std::endl;
+    }
+    std::cout << "Render mode: " << renderMode << std::endl;
+    std::cout << "Vertex layout: " << vertexLayout << std::endl;
+    std::cout << "Index mode: " << indexMode << std::endl;
+    if (adaptiveError > 0) {
+        std::cout << "Adaptive mesh: " << adaptiveError << " px, "
+                  << adaptiveDepthError * 100.0f << "% depth" << std::endl;
+    }
+    if (sequence) {
+        std::cout << "Sequence mode: tolerance " << sequenceTolerance << " m, rebuild above "
+                  << sequenceRebuild * 100.0f << "% changed tiles" << std::endl;
+    }
+    std::cout << "Pipeline depth: " << pipelineDepth << std::endl;
+    std::cout << "Batch rendering: " << (batch ? "yes" : "no") << std::endl;
+    std::cout << "Outputs: " << outputs << " (depth " << depthFormat
+              << (maskFromDepth ? ", mask from depth" : "") << ")" << std::endl;
+    std::cout << "Threads: " << numThreads << (numThreads == 0 ? " (auto)" : "") << std::endl;
+    std::cout << "Encode threads: " << encodeThreads << (encodeThreads == 0 ? " (auto)" : "") << std::endl;
+    std::cout << "EXR: " << exrCompression << (exrHalf ? ", half depth" : "") << ", bundle "
+              << exrBundle << ", " << exrThreads << (exrThreads == 0 ? " (auto)" : "")
+              << " threads" << std::endl;
+    if (tarShardMB > 0) {
+        std::cout << "Tar shards: " << tarShardMB << " MiB" << (tarIndex ? ", with index" : "") << std::endl;
+    }
     std::cout << "=====================\n" << std::endl;
 }
 
@@ -57,9 +337,23 @@ void printUsage(const char* programName) {
     std::cout << "  --depth PATH        Path to depth map (meters or scaled)\n";
     std::cout << "  --fx VALUE          Focal length X (pixels)\n";
     std::cout << "  --fy VALUE          Focal length Y (pixels)\n\n";
+    std::cout << "Multi-frame input (instead of --rgb / --depth):\n";
+    std::cout << "  --manifest PATH     Frame list, one \"RGB DEPTH [CAMERA_INFO]\" per line\n";
+    std::cout << "  --input_dir PATH    Directory (or DIR/*_rgb.png glob) of *_rgb / *_depth pairs\n";
+    std::cout << "  --frame_queue N     Frames buffered between load / mesh / render (default: 2)\n";
+    std::cout << "  --sequence          Update the mesh of consecutive frames in changed tiles only\n";
+    std::cout << "  --sequence_tolerance M  Depth change in meters treated as unchanged (default: 0)\n";
+    std::cout << "  --sequence_rebuild F    Changed tile fraction forcing a full rebuild (default: 0.5)\n\n";
+    std::cout << "Server mode (inputs come from rgbd_client requests):\n";
+    std::cout << "  --serve PATH        Serve render requests on a Unix domain socket\n";
+    std::cout << "                      (options below are request defaults, SIGTERM drains and exits)\n\n";
     std::cout << "Optional options:\n";
     std::cout << "  --cx VALUE          Principal point X (default: image center)\n";
     std::cout << "  --cy VALUE          Principal point Y (default: image center)\n";
+    std::cout << "  --distortion LIST   Source lens distortion k1,k2,p1,p2[,k3] (plumb_bob)\n";
+    std::cout << "  --camera_info FILE  Source intrinsics and distortion from a CameraInfo JSON\n";
+    std::cout << "  --target_distortion MODE  source (same lens) or none (pinhole targets)\n";
+    std::cout << "                      (default: source)\n";
     std::cout << "  --out_dir PATH      Output directory (default: ./output)\n";
     std::cout << "  --depth_scale VALUE Scale to convert depth to meters (default: 1.0)\n";
     std::cout << "  --focal_list VALUES Comma-separated focal scales (default: 0.5,0.75,1.0,1.5,2.0)\n";
@@ -68,11 +362,39 @@ void printUsage(const char* programName) {
     std::cout << "  --near VALUE        Near clipping plane (default: 0.1)\n";
     std::cout << "  --far VALUE         Far clipping plane (default: 100.0)\n";
     std::cout << "  --gpu VALUE         GPU device index (default: -1 for auto)\n";
+    std::cout << "  --gl_contexts N     GL contexts per device, each on its own thread (default: 1)\n";
+    std::cout << "  --gpus LIST         Devices of the context pool: all or e.g. 0,1 (default: --gpu)\n";
+    std::cout << "  --backend NAME      gl (OpenGL), cpu (software rasterizer) or resample\n";
+    std::cout << "                      (CPU inverse mapping of the depth grid) (default: gl)\n";
+    std::cout << "  --shader_cache DIR  Cache linked shader programs in DIR (gl backend)\n";
+    std::cout << "  --render_mode MODE  mesh (CPU mesh) or grid (GPU implicit grid) (default: mesh)\n";
+    std::cout << "  --vertex_layout L   float32, depth_pixel or quantized16 (default: float32)\n";
+    std::cout << "  --index_mode MODE   triangles, strips or meshlets (default: triangles)\n";
+    std::cout << "  --adaptive_error PX Quadtree meshing error bound in target pixels (default: 0 = off)\n";
+    std::cout << "  --adaptive_depth_error VALUE  Relative depth error bound (default: 0.01)\n";
+    std::cout << "  --pipeline_depth N  Renders in flight during readback (default: 2)\n";
+    std::cout << "  --batch             Render all scales in one layered pass\n";
     std::cout << "  --W_out VALUE       Output width (default: same as input)\n";
     std::cout << "  --H_out VALUE       Output height (default: same as input)\n";
+    std::cout << "  --threads VALUE     CPU threads for meshing / cpu and resample backends (default: 0 for auto)\n";
+    std::cout << "  --encode_threads N  Threads writing output files (default: 0 for auto)\n";
+    std::cout << "  --outputs LIST      Outputs to render: any of rgb,depth,mask (default: all)\n";
+    std::cout << "  --depth_format F    Depth target: float32, float16 or mm16 (16-bit millimeters)\n";
+    std::cout << "                      (default: float32, gl backend)\n";
+    std::cout << "  --mask_from_depth   Derive the mask from depth > 0 instead of rendering it\n";
     std::cout << "  --save_exr          Save depth as EXR (default: true)\n";
     std::cout << "  --save_npy          Save depth as NPY (default: false)\n";
     std::cout << "  --save_png          Save depth as PNG (default: true)\n";
+    std::cout << "  --exr_compression C none, zip, zips, piz or dwaa (default: zip)\n";
+    std::cout << "  --exr_half          Store EXR depth as HALF instead of FLOAT\n";
+    std::cout << "  --exr_threads N     OpenEXR threads compressing each file (default: 0 for auto)\n";
+    std::cout << "  --exr_bundle MODE   none, scale (R,G,B,Z,mask EXR per scale) or frame\n";
+    std::cout << "                      (multi-part EXR per frame, a part per scale) (default: none)\n";
+    std::cout << "  --tar_shard_mb N    Stream outputs into N MiB tar shards (WebDataset) instead\n";
+    std::cout << "                      of separate files (default: 0 for separate files)\n";
+    std::cout << "  --tar_index         Write a .idx (name, offset, size) sidecar per tar shard\n";
+    std::cout << "  --trace FILE        Write a Chrome / Perfetto trace of every stage (CPU threads and\n";
+    std::cout << "                      GL timer queries) to FILE\n";
     std::cout << "  -h, --help          Show this help message\n";
 }
 
@@ -143,6 +465,21 @@ bool parseArgs(int argc, char** argv, Config& config) {
             if (!val) return false;
             config.cy = std::stof(val);
         }
+        else if (arg == "--distortion") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.distortion = parseFloatList(val);
+        }
+        else if (arg == "--camera_info") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.cameraInfoPath = val;
+        }
+        else if (arg == "--target_distortion") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.targetDistortion = val;
+        }
         else if (arg == "--depth_scale") {
             const char* val = getValue();
             if (!val) return false;
@@ -178,6 +515,89 @@ bool parseArgs(int argc, char** argv, Config& config) {
             if (!val) return false;
             config.gpuDevice = std::stoi(val);
         }
+        else if (arg == "--gl_contexts") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.glContexts = std::stoi(val);
+        }
+        else if (arg == "--gpus") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.gpuList = val;
+        }
+        else if (arg == "--manifest") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.manifestPath = val;
+        }
+        else if (arg == "--input_dir") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.inputDir = val;
+        }
+        else if (arg == "--serve") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.serveSocket = val;
+        }
+        else if (arg == "--frame_queue") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.frameQueue = std::stoi(val);
+        }
+        else if (arg == "--backend") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.backend = val;
+        }
+        else if (arg == "--shader_cache") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.shaderCacheDir = val;
+        }
+        else if (arg == "--render_mode") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.renderMode = val;
+        }
+        else if (arg == "--vertex_layout") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.vertexLayout = val;
+        }
+        else if (arg == "--index_mode") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.indexMode = val;
+        }
+        else if (arg == "--adaptive_error") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.adaptiveError = std::stof(val);
+        }
+        else if (arg == "--adaptive_depth_error") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.adaptiveDepthError = std::stof(val);
+        }
+        else if (arg == "--sequence") {
+            config.sequence = true;
+        }
+        else if (arg == "--sequence_tolerance") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.sequenceTolerance = std::stof(val);
+        }
+        else if (arg == "--sequence_rebuild") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.sequenceRebuild = std::stof(val);
+        }
+        else if (arg == "--pipeline_depth") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.pipelineDepth = std::stoi(val);
+        }
         else if (arg == "--W_out") {
             const char* val = getValue();
             if (!val) return false;
@@ -188,6 +608,32 @@ bool parseArgs(int argc, char** argv, Config& config) {
             if (!val) return false;
             config.outputHeight = std::stoi(val);
         }
+        else if (arg == "--threads") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.numThreads = std::stoi(val);
+        }
+        else if (arg == "--encode_threads") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.encodeThreads = std::stoi(val);
+        }
+        else if (arg == "--outputs") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.outputs = val;
+        }
+        else if (arg == "--depth_format") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.depthFormat = val;
+        }
+        else if (arg == "--mask_from_depth") {
+            config.maskFromDepth = true;
+        }
+        else if (arg == "--batch") {
+            config.batch = true;
+        }
         else if (arg == "--save_exr") {
             config.saveExr = true;
         }
@@ -197,6 +643,37 @@ bool parseArgs(int argc, char** argv, Config& config) {
         else if (arg == "--save_png") {
             config.savePng = true;
         }
+        else if (arg == "--exr_compression") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.exrCompression = val;
+        }
+        else if (arg == "--exr_half") {
+            config.exrHalf = true;
+        }
+        else if (arg == "--exr_threads") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.exrThreads = std::stoi(val);
+        }
+        else if (arg == "--exr_bundle") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.exrBundle = val;
+        }
+        else if (arg == "--tar_shard_mb") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.tarShardMB = std::stoi(val);
+        }
+        else if (arg == "--tar_index") {
+            config.tarIndex = true;
+        }
+        else if (arg == "--trace") {
+            const char* val = getValue();
+            if (!val) return false;
+            config.tracePath = val;
+        }
         else {
             std::cerr << "Warning: Unknown argument: " << arg << std::endl;
         }
@@ -0,0 +1,308 @@
+#include "output_sink.hpp"
+#include "image_io.hpp"
+#include "depth_io.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+namespace rgbd {
+namespace app {
+
+OutputSink::OutputSink(const Config& config, int numThreads)
+    : outputDir_(config.outputDir)
+    , saveExr_(config.saveExr)
+    , savePng_(config.savePng)
+    , saveNpy_(config.saveNpy)
+    , exrOptions_(config.getExrOptions())
+    , exrBundle_(config.getExrBundle())
+    , queue_(4 * static_cast<size_t>(resolveThreadCount(numThreads))) {
+    io::setExrThreadCount(config.exrThreads);
+    if (config.tarShardMB > 0) {
+        tar_.reset(new io::TarShardWriter(outputDir_, "shard",
+                                          static_cast<size_t>(config.tarShardMB) << 20, config.tarIndex));
+    }
+    int threads = resolveThreadCount(numThreads);
+    workers_.reserve(threads);
+    for (int i = 0; i < threads; ++i) {
+        workers_.emplace_back([this, i]() {
+            trace::setThreadName("encoder " + std::to_string(i));
+            workerLoop();
+        });
+    }
+}
+
+OutputSink::~OutputSink() {
+    finish();
+}
+
+bool OutputSink::submit(const std::string& baseName, RenderOutput&& output) {
+    return submitTo(outputDir_ + "/" + baseName, std::move(output), nullptr);
+}
+
+bool OutputSink::submitTo(const std::string& prefix, RenderOutput&& output,
+                          std::function<void(bool)> onWritten, std::vector<std::string>* paths) {
+    if (finished_) {
+        std::cerr << "Error: Output sink already finished" << std::endl;
+        return false;
+    }
+
+    auto shared = std::make_shared<const RenderOutput>(std::move(output));
+
+    std::vector<Job> jobs;
+    const bool bundled = (exrBundle_ != ExrBundle::None);
+    if (bundled && (!shared->rgb.empty() || !shared->depth.empty() || !shared->mask.empty())) {
+        Job bundle{nullptr, fileName(prefix, ".exr"), FileKind::BundleEXR, nullptr};
+        bundle.parts.emplace_back("", shared);
+        jobs.push_back(std::move(bundle));
+    }
+    addJobs(prefix, shared, bundled, jobs);
+    return queueJobs(jobs, std::move(onWritten), paths);
+}
+
+bool OutputSink::submitFrame(const std::string& prefix, const std::vector<std::string>& partNames,
+                             std::vector<RenderOutput>&& outputs) {
+    if (finished_) {
+        std::cerr << "Error: Output sink already finished" << std::endl;
+        return false;
+    }
+    if (partNames.size() != outputs.size()) {
+        std::cerr << "Error: " << partNames.size() << " part names for " << outputs.size()
+                  << " outputs" << std::endl;
+        return false;
+    }
+
+    std::vector<Job> jobs;
+    Job bundle{nullptr, fileName(outputDir_ + "/" + prefix + "scales", ".exr"), FileKind::BundleEXR, nullptr};
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        auto shared = std::make_shared<const RenderOutput>(std::move(outputs[i]));
+        if (!shared->rgb.empty() || !shared->depth.empty() || !shared->mask.empty()) {
+            bundle.parts.emplace_back(partNames[i], shared);
+        }
+        addJobs(outputDir_ + "/" + prefix + partNames[i], shared, true, jobs);
+    }
+    outputs.clear();
+    if (!bundle.parts.empty()) {
+        jobs.insert(jobs.begin(), std::move(bundle));
+    }
+    return queueJobs(jobs, nullptr, nullptr);
+}
+
+std::string OutputSink::fileName(const std::string& prefix, const std::string& suffix) const {
+    if (!tar_) {
+        return prefix + suffix;
+    }
+    // WebDataset splits member names at the first dot: keep dots out of the key
+    std::string key = std::filesystem::path(prefix).filename().string();
+    std::replace(key.begin(), key.end(), '.', '_');
+    return key + "." + suffix.substr(1);
+}
+
+void OutputSink::addJobs(const std::string& prefix, const std::shared_ptr<const RenderOutput>& output,
+                         bool bundled, std::vector<Job>& jobs) const {
+    // Outputs left out of the render's OutputSelection are empty
+    if (!output->rgb.empty() && !bundled) {
+        jobs.push_back({output, fileName(prefix, "_rgb.png"), FileKind::RGB, nullptr});
+    }
+    if (!output->depth.empty()) {
+        // Without OpenEXR the depth "EXR" is a 32-bit TIFF
+        const char* exr = io::exrAvailable() ? "_depth.exr" : "_depth.tiff";
+        if (saveExr_ && !bundled) jobs.push_back({output, fileName(prefix, exr), FileKind::DepthEXR, nullptr});
+        if (savePng_) jobs.push_back({output, fileName(prefix, "_depth.png"), FileKind::DepthPNG, nullptr});
+        if (saveNpy_) jobs.push_back({output, fileName(prefix, "_depth.npy"), FileKind::DepthNPY, nullptr});
+    }
+    if (!output->mask.empty() && !bundled) {
+        jobs.push_back({output, fileName(prefix, "_mask.png"), FileKind::Mask, nullptr});
+    }
+}
+
+bool OutputSink::queueJobs(std::vector<Job>& jobs, std::function<void(bool)> onWritten,
+                           std::vector<std::string>* paths) {
+    if (jobs.empty()) {
+        if (onWritten) {
+            onWritten(true);
+        }
+        return true;
+    }
+
+    if (onWritten) {
+        auto completion = std::make_shared<Completion>();
+        completion->remaining = static_cast<int>(jobs.size());
+        completion->onWritten = std::move(onWritten);
+        for (Job& job : jobs) {
+            job.completion = completion;
+        }
+    }
+    if (paths) {
+        for (const Job& job : jobs) {
+            paths->push_back(job.path);
+        }
+    }
+
+    if (tar_) {
+        // One sample, numbered in submission order
+        Task task;
+        task.jobs = std::move(jobs);
+        task.sample = submittedSamples_++;
+        return queue_.push(std::move(task));
+    }
+    for (Job& job : jobs) {
+        Task task;
+        task.jobs.push_back(std::move(job));
+        if (!queue_.push(std::move(task))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool OutputSink::finish() {
+    if (finished_) {
+        return getFailedCount() == 0;
+    }
+    finished_ = true;
+
+    queue_.close();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+
+    if (tar_) {
+        std::lock_guard<std::mutex> tarLock(tarMutex_);
+        appendSamples(true);
+        if (!tar_->close()) {
+            std::lock_guard<std::mutex> lock(errorMutex_);
+            errors_.push_back(tar_->shardPath(tar_->getShardCount() - 1));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    std::cout << "  Output: " << written_ << " files written";
+    if (tar_) {
+        std::cout << " to " << tar_->getShardCount() << " tar shards";
+    }
+    if (!errors_.empty()) {
+        std::cout << ", " << errors_.size() << " failed";
+    }
+    std::cout << std::endl;
+    for (const auto& error : errors_) {
+        std::cerr << "    Failed: " << error << std::endl;
+    }
+    return errors_.empty();
+}
+
+size_t OutputSink::getFailedCount() const {
+    std::lock_guard<std::mutex> lock(errorMutex_);
+    return errors_.size();
+}
+
+void OutputSink::workerLoop() {
+    Task task;
+    while (queue_.pop(task)) {
+        EncodedSample sample;
+        sample.files.resize(task.jobs.size());
+        sample.errors.resize(task.jobs.size());
+        for (size_t i = 0; i < task.jobs.size(); ++i) {
+            Job& job = task.jobs[i];
+            // An exception must not take down the encoder thread (and the process)
+            std::string& error = sample.errors[i];
+            try {
+                if (!encode(job, sample.files[i]) || (!tar_ && !io::writeFile(job.path, sample.files[i]))) {
+                    error = job.path;
+                }
+            } catch (const std::exception& e) {
+                error = job.path + " (" + e.what() + ")";
+            }
+            // Drop our reference so the buffers go away with the last file
+            job.output.reset();
+            job.parts.clear();
+            if (!tar_) {
+                sample.files[i].clear();
+                report(job, error);
+            }
+        }
+
+        if (tar_) {
+            sample.jobs = std::move(task.jobs);
+            std::lock_guard<std::mutex> lock(tarMutex_);
+            pendingSamples_.emplace(task.sample, std::move(sample));
+            appendSamples(false);
+        }
+        task = Task();
+    }
+}
+
+void OutputSink::appendSamples(bool flush) {
+    while (!pendingSamples_.empty()) {
+        auto next = pendingSamples_.begin();
+        if (next->first != nextSample_ && !flush) {
+            break;
+        }
+        EncodedSample& sample = next->second;
+        std::vector<io::TarMember> members;
+        for (size_t i = 0; i < sample.jobs.size(); ++i) {
+            if (sample.errors[i].empty()) {
+                members.push_back({sample.jobs[i].path, std::move(sample.files[i])});
+            }
+        }
+        bool appended = tar_->append(members);
+        for (size_t i = 0; i < sample.jobs.size(); ++i) {
+            std::string error = sample.errors[i];
+            if (error.empty() && !appended) {
+                error = sample.jobs[i].path + " (" + tar_->shardPath(tar_->getShardCount() - 1) + ")";
+            }
+            report(sample.jobs[i], error);
+        }
+        nextSample_ = next->first + 1;
+        pendingSamples_.erase(next);
+    }
+}
+
+void OutputSink::report(Job& job, const std::string& error) {
+    if (error.empty()) {
+        written_++;
+    } else {
+        std::lock_guard<std::mutex> lock(errorMutex_);
+        errors_.push_back(error);
+    }
+
+    if (job.completion) {
+        if (!error.empty()) {
+            job.completion->ok = false;
+        }
+        if (--job.completion->remaining == 0) {
+            job.completion->onWritten(job.completion->ok);
+        }
+        job.completion.reset();
+    }
+}
+
+bool OutputSink::encode(const Job& job, std::vector<uint8_t>& bytes) const {
+    if (job.kind == FileKind::BundleEXR) {
+        std::vector<io::ExrPart> parts;
+        for (const auto& part : job.parts) {
+            parts.push_back({part.first, part.second.get()});
+        }
+        return io::encodeOutputsEXR(parts, exrOptions_, bytes);
+    }
+    const RenderOutput& out = *job.output;
+    switch (job.kind) {
+        case FileKind::RGB:
+            return io::encodeRGB(".png", out.rgb, out.width, out.height, bytes);
+        case FileKind::DepthEXR:
+            return io::encodeDepthEXR(out.depth, out.width, out.height, exrOptions_, bytes);
+        case FileKind::DepthPNG:
+            return io::encodeDepthPNG(out.depth, out.width, out.height, 1000.0f, bytes);
+        case FileKind::DepthNPY:
+            return io::encodeDepthNPY(out.depth, out.width, out.height, bytes);
+        case FileKind::Mask:
+            return io::encodeMask(out.mask, out.width, out.height, bytes);
+        case FileKind::BundleEXR:
+            break;
+    }
+    return false;
+}
+
+} // namespace app
+} // namespace rgbd
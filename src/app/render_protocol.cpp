@@ -0,0 +1,458 @@
+#include "render_protocol.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace rgbd {
+namespace app {
+
+static const uint32_t kMagic = 0x52424752;  // "RGBR"
+
+// Frames beyond these sizes are rejected as corrupt
+static constexpr uint32_t kMaxHeaderBytes = 1u << 20;
+static constexpr uint64_t kMaxPayloadBytes = 4ull << 30;
+
+struct Blob {
+    const void* data;
+    size_t size;
+};
+
+static bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        // MSG_NOSIGNAL: a closed peer must not raise SIGPIPE
+        ssize_t n = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool readAll(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::recv(fd, bytes, size, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (n == 0) {
+            return false;  // End of stream
+        }
+        bytes += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static bool writeFrame(int fd, const std::string& header, const std::vector<Blob>& blobs) {
+    uint64_t payloadBytes = 0;
+    for (const Blob& blob : blobs) {
+        payloadBytes += blob.size;
+    }
+    uint32_t headerBytes = static_cast<uint32_t>(header.size());
+
+    char prefix[16];
+    std::memcpy(prefix, &kMagic, 4);
+    std::memcpy(prefix + 4, &headerBytes, 4);
+    std::memcpy(prefix + 8, &payloadBytes, 8);
+    if (!writeAll(fd, prefix, sizeof(prefix)) || !writeAll(fd, header.data(), header.size())) {
+        return false;
+    }
+    for (const Blob& blob : blobs) {
+        if (!writeAll(fd, blob.data, blob.size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool readFrame(int fd, std::string& header, std::vector<uint8_t>& payload) {
+    char prefix[16];
+    if (!readAll(fd, prefix, sizeof(prefix))) {
+        return false;
+    }
+    uint32_t magic, headerBytes;
+    uint64_t payloadBytes;
+    std::memcpy(&magic, prefix, 4);
+    std::memcpy(&headerBytes, prefix + 4, 4);
+    std::memcpy(&payloadBytes, prefix + 8, 8);
+    if (magic != kMagic || headerBytes > kMaxHeaderBytes || payloadBytes > kMaxPayloadBytes) {
+        std::cerr << "Error: Invalid message frame" << std::endl;
+        return false;
+    }
+
+    header.resize(headerBytes);
+    payload.resize(payloadBytes);
+    return readAll(fd, &header[0], headerBytes) && readAll(fd, payload.data(), payload.size());
+}
+
+/**
+ * Split a header into (key, value) fields, the value is the rest of the line
+ */
+static std::vector<std::pair<std::string, std::string>> parseHeader(const std::string& header) {
+    std::vector<std::pair<std::string, std::string>> fields;
+    std::istringstream stream(header);
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty()) continue;
+        size_t space = line.find(' ');
+        if (space == std::string::npos) {
+            fields.emplace_back(line, std::string());
+        } else {
+            fields.emplace_back(line.substr(0, space), line.substr(space + 1));
+        }
+    }
+    return fields;
+}
+
+/**
+ * Copy the next blob of a payload
+ * @return false if the payload is too short
+ */
+static bool takeBlob(const std::vector<uint8_t>& payload, size_t& offset, void* out, size_t size) {
+    if (offset > payload.size() || size > payload.size() - offset) {
+        return false;
+    }
+    if (size > 0) {
+        std::memcpy(out, payload.data() + offset, size);
+    }
+    offset += size;
+    return true;
+}
+
+int listenUnixSocket(const std::string& path, int backlog) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << path << std::endl;
+        return -1;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // Replace a socket left behind by a previous server, never a regular file
+    struct stat info;
+    if (::stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        ::unlink(path.c_str());
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Error: Failed to create socket: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(fd, backlog) != 0) {
+        std::cerr << "Error: Failed to listen on " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connectUnixSocket(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Error: Socket path too long: " << path << std::endl;
+        return -1;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Error: Failed to create socket: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Error: Failed to connect to " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool sendRequest(int fd, const RenderRequest& request) {
+    std::ostringstream header;
+    header << std::setprecision(9);
+    header << "id " << request.id << "\n";
+
+    std::vector<Blob> blobs;
+    cv::Mat rgb, depth;
+    if (!request.rgb.empty()) {
+        if (request.rgb.type() != CV_8UC3) {
+            std::cerr << "Error: Inline RGB must be CV_8UC3" << std::endl;
+            return false;
+        }
+        rgb = request.rgb.isContinuous() ? request.rgb : request.rgb.clone();
+        header << "rgb_data " << rgb.cols << " " << rgb.rows << "\n";
+        blobs.push_back({ rgb.data, rgb.total() * rgb.elemSize() });
+    } else {
+        header << "rgb " << request.rgbPath << "\n";
+    }
+    if (!request.depth.empty()) {
+        if (request.depth.type() != CV_32F) {
+            std::cerr << "Error: Inline depth must be CV_32F" << std::endl;
+            return false;
+        }
+        depth = request.depth.isContinuous() ? request.depth : request.depth.clone();
+        header << "depth_data " << depth.cols << " " << depth.rows << "\n";
+        blobs.push_back({ depth.data, depth.total() * depth.elemSize() });
+    } else {
+        header << "depth " << request.depthPath << "\n";
+    }
+
+    auto optional = [&](const char* key, float value) {
+        if (value >= 0.0f) header << key << " " << value << "\n";
+    };
+    optional("fx", request.fx);
+    optional("fy", request.fy);
+    optional("cx", request.cx);
+    optional("cy", request.cy);
+    if (!request.distortion.empty()) {
+        header << "distortion ";
+        for (size_t i = 0; i < request.distortion.size(); ++i) {
+            header << (i > 0 ? "," : "") << request.distortion[i];
+        }
+        header << "\n";
+    }
+    optional("depth_scale", request.depthScale);
+    optional("tau_rel", request.tauRel);
+    optional("tau_abs", request.tauAbs);
+    optional("near", request.nearPlane);
+    optional("far", request.farPlane);
+    if (!request.focalScales.empty()) {
+        header << "scales ";
+        for (size_t i = 0; i < request.focalScales.size(); ++i) {
+            header << (i > 0 ? "," : "") << request.focalScales[i];
+        }
+        header << "\n";
+    }
+    if (request.outputWidth > 0 && request.outputHeight > 0) {
+        header << "output_size " << request.outputWidth << " " << request.outputHeight << "\n";
+    }
+    if (!request.outputs.empty()) {
+        header << "outputs " << request.outputs << "\n";
+    }
+    if (!request.depthFormat.empty()) {
+        header << "depth_format " << request.depthFormat << "\n";
+    }
+    if (request.maskFromDepth >= 0) {
+        header << "mask_from_depth " << request.maskFromDepth << "\n";
+    }
+    if (!request.outputDir.empty()) {
+        header << "output_dir " << request.outputDir << "\n";
+    }
+    if (!request.name.empty()) {
+        header << "name " << request.name << "\n";
+    }
+    return writeFrame(fd, header.str(), blobs);
+}
+
+bool receiveRequest(int fd, RenderRequest& request, std::string& error) {
+    std::string header;
+    std::vector<uint8_t> payload;
+    error.clear();
+    if (!readFrame(fd, header, payload)) {
+        return false;
+    }
+
+    request = RenderRequest();
+    size_t offset = 0;
+    try {
+        for (const auto& field : parseHeader(header)) {
+            const std::string& key = field.first;
+            const std::string& value = field.second;
+            std::istringstream values(value);
+
+            if (key == "id") {
+                request.id = std::stoull(value);
+            } else if (key == "rgb") {
+                request.rgbPath = value;
+            } else if (key == "depth") {
+                request.depthPath = value;
+            } else if (key == "rgb_data" || key == "depth_data") {
+                int width = 0, height = 0;
+                values >> width >> height;
+                if (!values || width <= 0 || height <= 0) {
+                    error = "Invalid size of " + key;
+                    return false;
+                }
+                // Checked against the payload before allocating anything
+                const size_t elemSize = (key == "rgb_data") ? 3 : sizeof(float);
+                const size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+                if (pixels / static_cast<size_t>(width) != static_cast<size_t>(height) ||
+                    pixels > std::numeric_limits<size_t>::max() / elemSize ||
+                    pixels * elemSize > payload.size() - offset) {
+                    error = "Payload too short for " + key;
+                    return false;
+                }
+                cv::Mat& mat = (key == "rgb_data") ? request.rgb : request.depth;
+                mat.create(height, width, key == "rgb_data" ? CV_8UC3 : CV_32F);
+                takeBlob(payload, offset, mat.data, pixels * elemSize);
+            } else if (key == "fx") {
+                request.fx = std::stof(value);
+            } else if (key == "fy") {
+                request.fy = std::stof(value);
+            } else if (key == "cx") {
+                request.cx = std::stof(value);
+            } else if (key == "cy") {
+                request.cy = std::stof(value);
+            } else if (key == "distortion") {
+                std::string item;
+                std::istringstream list(value);
+                while (std::getline(list, item, ',')) {
+                    request.distortion.push_back(std::stof(item));
+                }
+            } else if (key == "depth_scale") {
+                request.depthScale = std::stof(value);
+            } else if (key == "tau_rel") {
+                request.tauRel = std::stof(value);
+            } else if (key == "tau_abs") {
+                request.tauAbs = std::stof(value);
+            } else if (key == "near") {
+                request.nearPlane = std::stof(value);
+            } else if (key == "far") {
+                request.farPlane = std::stof(value);
+            } else if (key == "scales") {
+                std::string item;
+                std::istringstream list(value);
+                while (std::getline(list, item, ',')) {
+                    request.focalScales.push_back(std::stof(item));
+                }
+            } else if (key == "output_size") {
+                values >> request.outputWidth >> request.outputHeight;
+            } else if (key == "outputs") {
+                request.outputs = value;
+            } else if (key == "depth_format") {
+                request.depthFormat = value;
+            } else if (key == "mask_from_depth") {
+                request.maskFromDepth = std::stoi(value);
+            } else if (key == "output_dir") {
+                request.outputDir = value;
+            } else if (key == "name") {
+                request.name = value;
+            } else {
+                error = "Unknown request field: " + key;
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        error = "Invalid request field value";
+        return false;
+    }
+
+    if (offset != payload.size()) {
+        error = "Unexpected payload bytes";
+        return false;
+    }
+    if ((request.rgb.empty() && request.rgbPath.empty()) ||
+        (request.depth.empty() && request.depthPath.empty())) {
+        error = "Request needs rgb and depth";
+        return false;
+    }
+    return true;
+}
+
+bool sendResponse(int fd, const RenderResponse& response) {
+    std::ostringstream header;
+    header << std::setprecision(9);
+    header << "id " << response.id << "\n";
+    header << "status " << (response.ok ? "ok" : "error") << "\n";
+    if (!response.error.empty()) {
+        // One line only
+        std::string error = response.error;
+        std::replace(error.begin(), error.end(), '\n', ' ');
+        header << "error " << error << "\n";
+    }
+    for (const std::string& file : response.files) {
+        header << "file " << file << "\n";
+    }
+
+    std::vector<Blob> blobs;
+    for (size_t i = 0; i < response.outputs.size(); ++i) {
+        const RenderOutput& out = response.outputs[i];
+        float scale = i < response.scales.size() ? response.scales[i] : 0.0f;
+        // Buffers of unselected outputs are empty and not sent
+        std::string present;
+        if (!out.rgb.empty()) present += ",rgb";
+        if (!out.depth.empty()) present += ",depth";
+        if (!out.mask.empty()) present += ",mask";
+        header << "view " << scale << " " << out.width << " " << out.height << " "
+               << (present.empty() ? "none" : present.substr(1)) << "\n";
+        blobs.push_back({ out.rgb.data(), out.rgb.size() });
+        blobs.push_back({ out.depth.data(), out.depth.size() * sizeof(float) });
+        blobs.push_back({ out.mask.data(), out.mask.size() });
+    }
+    return writeFrame(fd, header.str(), blobs);
+}
+
+bool receiveResponse(int fd, RenderResponse& response) {
+    std::string header;
+    std::vector<uint8_t> payload;
+    if (!readFrame(fd, header, payload)) {
+        return false;
+    }
+
+    response = RenderResponse();
+    size_t offset = 0;
+    try {
+        for (const auto& field : parseHeader(header)) {
+            const std::string& key = field.first;
+            const std::string& value = field.second;
+            if (key == "id") {
+                response.id = std::stoull(value);
+            } else if (key == "status") {
+                response.ok = (value == "ok");
+            } else if (key == "error") {
+                response.error = value;
+            } else if (key == "file") {
+                response.files.push_back(value);
+            } else if (key == "view") {
+                std::istringstream values(value);
+                float scale = 0.0f;
+                int width = 0, height = 0;
+                std::string present = "rgb,depth,mask";
+                values >> scale >> width >> height;
+                if (!values || width <= 0 || height <= 0) {
+                    std::cerr << "Error: Invalid view in response" << std::endl;
+                    return false;
+                }
+                values >> present;
+                OutputSelection outputs;
+                outputs.rgb = present.find("rgb") != std::string::npos;
+                outputs.depth = present.find("depth") != std::string::npos;
+                outputs.mask = present.find("mask") != std::string::npos;
+                RenderOutput out;
+                out.allocate(width, height, outputs);
+                if (!takeBlob(payload, offset, out.rgb.data(), out.rgb.size()) ||
+                    !takeBlob(payload, offset, out.depth.data(), out.depth.size() * sizeof(float)) ||
+                    !takeBlob(payload, offset, out.mask.data(), out.mask.size())) {
+                    std::cerr << "Error: Response payload too short" << std::endl;
+                    return false;
+                }
+                response.scales.push_back(scale);
+                response.outputs.push_back(std::move(out));
+            }
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Error: Invalid response field value" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace app
+} // namespace rgbd
@@ -0,0 +1,358 @@
+#include "render_server.hpp"
+#include "batch_runner.hpp"
+#include "image_io.hpp"
+#include "mapped_io.hpp"
+#include "gl_renderer.hpp"
+#include "trace.hpp"
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace rgbd {
+namespace app {
+
+namespace {
+
+// Poll interval of the acceptor and readers: bounds how long a stop request waits
+constexpr int kPollMs = 200;
+
+/**
+ * Wait until fd is readable
+ * @return 1 if readable (or closed), 0 on timeout or signal, -1 on error
+ */
+int waitReadable(int fd) {
+    pollfd p{fd, POLLIN, 0};
+    int r = ::poll(&p, 1, kPollMs);
+    if (r < 0) {
+        return (errno == EINTR) ? 0 : -1;
+    }
+    return r;
+}
+
+} // namespace
+
+std::atomic<bool> RenderServer::signalled_{false};
+
+RenderServer::Connection::~Connection() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool RenderServer::Connection::send(const RenderResponse& response) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return sendResponse(fd, response);
+}
+
+RenderServer::RenderServer(const Config& config)
+    : config_(config)
+    , queue_(static_cast<size_t>(config.frameQueue))
+    , sink_(config, config.encodeThreads) {}
+
+RenderServer::~RenderServer() {
+    sink_.finish();
+}
+
+bool RenderServer::run(render::Renderer& renderer, const std::string& socketPath) {
+    int listenFd = listenUnixSocket(socketPath);
+    if (listenFd < 0) {
+        return false;
+    }
+    std::cout << "Serving on " << socketPath << std::endl;
+
+    std::thread acceptor(&RenderServer::acceptLoop, this, listenFd);
+
+    // The calling thread owns the GL context and renders every request
+    Job job;
+    while (queue_.pop(job)) {
+        renderJob(renderer, job);
+        // Release the request's images and mesh before waiting for the next one
+        job = Job();
+    }
+
+    acceptor.join();
+    ::close(listenFd);
+
+    // Answer the requests still waiting for their files
+    sink_.finish();
+    ::unlink(socketPath.c_str());
+
+    std::cout << "Server stopped: " << processed_ << " requests rendered";
+    if (failed_ > 0) {
+        std::cout << ", " << failed_ << " failed";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+void RenderServer::acceptLoop(int listenFd) {
+    trace::setThreadName("accept");
+    while (!stopping()) {
+        // Join the readers of closed connections
+        for (size_t i = 0; i < readers_.size();) {
+            if (*readers_[i].done) {
+                readers_[i].thread.join();
+                readers_[i] = std::move(readers_.back());
+                readers_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+
+        int ready = waitReadable(listenFd);
+        if (ready < 0) {
+            std::cerr << "Error: poll on server socket failed" << std::endl;
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+
+        auto connection = std::make_shared<Connection>(fd);
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        readers_.push_back({std::thread(&RenderServer::readerLoop, this, connection, done), done});
+    }
+
+    // No new requests: let the render loop drain what was received
+    for (Reader& reader : readers_) {
+        reader.thread.join();
+    }
+    readers_.clear();
+    queue_.close();
+}
+
+void RenderServer::readerLoop(std::shared_ptr<Connection> connection,
+                              std::shared_ptr<std::atomic<bool>> done) {
+    trace::setThreadName("connection " + std::to_string(connection->fd));
+    while (!stopping()) {
+        int ready = waitReadable(connection->fd);
+        if (ready < 0) {
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+
+        RenderRequest request;
+        std::string error;
+        if (!receiveRequest(connection->fd, request, error)) {
+            if (error.empty()) {
+                break;  // Closed or broken connection
+            }
+            // The invalid frame was consumed, the connection stays usable
+            RenderResponse response;
+            response.id = request.id;
+            response.error = error;
+            std::cerr << "Error: Request " << request.id << ": " << error << std::endl;
+            failed_++;
+            connection->send(response);
+            continue;
+        }
+
+        Job job;
+        if (!prepare(request, job, error)) {
+            RenderResponse response;
+            response.id = request.id;
+            response.error = error;
+            std::cerr << "Error: Request " << request.id << ": " << error << std::endl;
+            failed_++;
+            connection->send(response);
+            continue;
+        }
+        job.connection = connection;
+
+        if (!queue_.push(std::move(job))) {
+            break;
+        }
+    }
+    *done = true;
+}
+
+bool RenderServer::prepare(RenderRequest& request, Job& job, std::string& error) const {
+    job.id = request.id;
+
+    // Request fields override the server configuration
+    Config& config = job.config;
+    config = config_;
+    if (request.fx > 0) config.fx = request.fx;
+    if (request.fy > 0) config.fy = request.fy;
+    if (request.cx >= 0) config.cx = request.cx;
+    if (request.cy >= 0) config.cy = request.cy;
+    if (!request.distortion.empty()) config.distortion = request.distortion;
+    if (request.depthScale > 0) config.depthScale = request.depthScale;
+    if (request.tauRel > 0) config.tauRel = request.tauRel;
+    if (request.tauAbs > 0) config.tauAbs = request.tauAbs;
+    if (request.nearPlane > 0) config.nearPlane = request.nearPlane;
+    if (request.farPlane > 0) config.farPlane = request.farPlane;
+    if (!request.focalScales.empty()) config.focalScales = request.focalScales;
+    if (request.outputWidth > 0 && request.outputHeight > 0) {
+        config.outputWidth = request.outputWidth;
+        config.outputHeight = request.outputHeight;
+    }
+    if (!request.outputs.empty()) config.outputs = request.outputs;
+    if (!request.depthFormat.empty()) config.depthFormat = request.depthFormat;
+    if (request.maskFromDepth >= 0) config.maskFromDepth = (request.maskFromDepth != 0);
+    error = config.validate();
+    if (!error.empty()) {
+        return false;
+    }
+
+    // Inputs: inline buffers or files readable by the server
+    if (!request.rgb.empty()) {
+        job.rgb = request.rgb;
+    } else if (!request.rgbPath.empty()) {
+        job.rgb = io::loadRGB(request.rgbPath);
+    }
+    if (!request.depth.empty()) {
+        job.depth = request.depth;
+    } else if (!request.depthPath.empty()) {
+        io::MappedMat depth = io::mapDepth(request.depthPath, config.depthScale);
+        job.depth = depth.mat;
+        job.depthSource = depth.source;
+    }
+    if (job.rgb.empty() || job.depth.empty()) {
+        error = "Failed to load RGB and depth inputs";
+        return false;
+    }
+    if (job.rgb.cols != job.depth.cols || job.rgb.rows != job.depth.rows) {
+        error = "RGB and depth dimensions mismatch";
+        return false;
+    }
+
+    job.K = config.getSourceIntrinsics(job.rgb.cols, job.rgb.rows);
+
+    if (!config.usesDepthGrid()) {
+        job.mesh.reset(new mesh::DepthMesh());
+        job.mesh->setNumThreads(config.numThreads);
+        job.mesh->setVertexLayout(config.getVertexLayout());
+        job.mesh->setIndexMode(config.getIndexMode());
+        job.mesh->setAdaptive(config.getAdaptiveOptions());
+        if (!job.mesh->build(job.rgb, job.depth, job.K, config.getThresholds())) {
+            error = "Failed to build mesh";
+            return false;
+        }
+    }
+
+    if (!request.outputDir.empty()) {
+        std::error_code ec;
+        fs::create_directories(request.outputDir, ec);
+        if (!fs::is_directory(request.outputDir, ec)) {
+            error = "Cannot create output directory " + request.outputDir;
+            return false;
+        }
+        std::string name = request.name.empty() ? "request_" + std::to_string(request.id) : request.name;
+        job.outputPrefix = (fs::path(request.outputDir) / name).string() + "_";
+    }
+    return true;
+}
+
+void RenderServer::renderJob(render::Renderer& renderer, Job& job) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::cout << "\n=== Request " << job.id << " (" << job.rgb.cols << "x" << job.rgb.rows
+              << ", " << job.config.focalScales.size() << " scales) ===" << std::endl;
+
+    // Outputs may differ per request; each selection builds its shaders once
+    renderer.setOutputs(job.config.getOutputSelection());
+
+    bool uploaded;
+    if (job.mesh) {
+        uploaded = renderer.uploadMesh(job.mesh->getMesh()) &&
+                   renderer.uploadTexture(job.mesh->getTexture());
+    } else {
+        // Depth grid: grid mode of the gl backend or the resample backend
+        if (auto* glRenderer = dynamic_cast<render::GLRenderer*>(&renderer)) {
+            glRenderer->setRenderMode(render::RenderMode::ImplicitGrid);
+        }
+        uploaded = renderer.uploadDepth(job.depth, job.config.getThresholds()) &&
+                   renderer.uploadTexture(job.rgb);
+    }
+
+    if (job.outputPrefix.empty()) {
+        // Inline: the outputs travel back in the response
+        RenderResponse response;
+        response.id = job.id;
+        response.ok = uploaded && renderFocalScales(renderer, job.K, job.config,
+            [&](size_t index, RenderOutput&& output) {
+                response.scales.push_back(job.config.focalScales[index]);
+                response.outputs.push_back(std::move(output));
+            });
+        if (!response.ok) {
+            response.error = uploaded ? "Rendering failed" : "Upload failed";
+            response.scales.clear();
+            response.outputs.clear();
+        }
+        (response.ok ? processed_ : failed_)++;
+        job.connection->send(response);
+    } else {
+        // Files: answer when the last one is written (on an encoder thread)
+        struct Pending {
+            std::mutex mutex;
+            RenderResponse response;
+            size_t remaining = 0;  // Outputs still being written
+            bool rendered = false;
+        };
+        auto pending = std::make_shared<Pending>();
+        pending->response.id = job.id;
+        pending->response.ok = true;
+        std::shared_ptr<Connection> connection = job.connection;
+
+        auto reply = [pending, connection]() {
+            connection->send(pending->response);
+        };
+
+        bool rendered = uploaded && renderFocalScales(renderer, job.K, job.config,
+            [&](size_t index, RenderOutput&& output) {
+                std::ostringstream prefix;
+                prefix << job.outputPrefix << std::fixed << std::setprecision(2)
+                       << "scale_" << job.config.focalScales[index];
+                std::vector<std::string> paths;
+                {
+                    std::lock_guard<std::mutex> lock(pending->mutex);
+                    pending->remaining++;
+                }
+                sink_.submitTo(prefix.str(), std::move(output), [pending, reply](bool written) {
+                    std::lock_guard<std::mutex> lock(pending->mutex);
+                    if (!written) {
+                        pending->response.ok = false;
+                        pending->response.error = "Failed to write output files";
+                    }
+                    if (--pending->remaining == 0 && pending->rendered) {
+                        reply();
+                    }
+                }, &paths);
+                std::lock_guard<std::mutex> lock(pending->mutex);
+                pending->response.files.insert(pending->response.files.end(), paths.begin(), paths.end());
+            });
+
+        std::lock_guard<std::mutex> lock(pending->mutex);
+        if (!rendered) {
+            pending->response.ok = false;
+            pending->response.error = uploaded ? "Rendering failed" : "Upload failed";
+        }
+        (rendered ? processed_ : failed_)++;
+        pending->rendered = true;
+        if (pending->remaining == 0) {
+            reply();
+        }
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::cout << "  Request " << job.id << " rendered in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count()
+              << " ms" << std::endl;
+}
+
+} // namespace app
+} // namespace rgbd
@@ -0,0 +1,233 @@
+/**
+ * RGBD Rerendering - Render Server Client
+ *
+ * Sends frames to a running "rgbd_rerender --serve SOCKET" and waits for
+ * the results. All requests are sent up front (pipelined); the server
+ * renders them in order while the client collects the responses.
+ */
+
+#include "config.hpp"
+#include "render_protocol.hpp"
+#include "batch_runner.hpp"
+#include "output_sink.hpp"
+#include "image_io.hpp"
+#include "depth_io.hpp"
+#include "camera_info.hpp"
+
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+static void printClientUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " --socket PATH (--rgb PATH --depth PATH | --manifest PATH) [options]\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --socket PATH       Socket of the render server\n";
+    std::cout << "  --rgb PATH          RGB image\n";
+    std::cout << "  --depth PATH        Depth map\n";
+    std::cout << "  --manifest PATH     Frame list, one \"RGB DEPTH [CAMERA_INFO]\" per line\n";
+    std::cout << "  --fx, --fy, --cx, --cy VALUE  Source intrinsics (default: server's)\n";
+    std::cout << "  --depth_scale VALUE Scale to convert depth to meters (default: server's)\n";
+    std::cout << "  --focal_list VALUES Comma-separated focal scales (default: server's)\n";
+    std::cout << "  --W_out VALUE       Output width (with --H_out)\n";
+    std::cout << "  --H_out VALUE       Output height (with --W_out)\n";
+    std::cout << "  --outputs LIST      Outputs to render: any of rgb,depth,mask (default: server's)\n";
+    std::cout << "  --depth_format F    Depth target: float32, float16 or mm16 (default: server's)\n";
+    std::cout << "  --mask_from_depth   Derive the mask from depth instead of rendering it\n";
+    std::cout << "  --out_dir PATH      Output directory (default: ./output)\n";
+    std::cout << "  --inline            Receive the outputs and write them here, not on the server\n";
+    std::cout << "  --send_data         Send the decoded images instead of their paths\n";
+    std::cout << "  -h, --help          Show this help message\n";
+}
+
+int main(int argc, char** argv) {
+    std::string socketPath;
+    std::string manifestPath;
+    bool inlineOutputs = false;
+    bool sendData = false;
+
+    // Request fields shared by every frame
+    rgbd::app::RenderRequest base;
+    rgbd::app::FrameSpec single;
+    rgbd::app::Config config;  // Output directory and formats of --inline
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            printClientUsage(argv[0]);
+            return 0;
+        }
+        if (arg == "--inline") {
+            inlineOutputs = true;
+            continue;
+        }
+        if (arg == "--send_data") {
+            sendData = true;
+            continue;
+        }
+        if (arg == "--mask_from_depth") {
+            base.maskFromDepth = 1;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << arg << std::endl;
+            return 1;
+        }
+        std::string val = argv[++i];
+
+        if (arg == "--socket") socketPath = val;
+        else if (arg == "--rgb") single.rgbPath = val;
+        else if (arg == "--depth") single.depthPath = val;
+        else if (arg == "--manifest") manifestPath = val;
+        else if (arg == "--fx") base.fx = std::stof(val);
+        else if (arg == "--fy") base.fy = std::stof(val);
+        else if (arg == "--cx") base.cx = std::stof(val);
+        else if (arg == "--cy") base.cy = std::stof(val);
+        else if (arg == "--depth_scale") base.depthScale = std::stof(val);
+        else if (arg == "--W_out") base.outputWidth = std::stoi(val);
+        else if (arg == "--H_out") base.outputHeight = std::stoi(val);
+        else if (arg == "--outputs") base.outputs = val;
+        else if (arg == "--depth_format") base.depthFormat = val;
+        else if (arg == "--out_dir") config.outputDir = val;
+        else if (arg == "--focal_list") {
+            std::stringstream ss(val);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                base.focalScales.push_back(std::stof(item));
+            }
+        }
+        else {
+            std::cerr << "Warning: Unknown argument: " << arg << std::endl;
+        }
+    }
+
+    std::vector<rgbd::app::FrameSpec> frames;
+    if (!manifestPath.empty()) {
+        if (!rgbd::app::loadManifest(manifestPath, frames)) {
+            return 1;
+        }
+    } else if (!single.rgbPath.empty() && !single.depthPath.empty()) {
+        single.name = fs::path(single.rgbPath).stem().string();
+        frames.push_back(single);
+    }
+    if (socketPath.empty() || frames.empty()) {
+        printClientUsage(argv[0]);
+        return 1;
+    }
+
+    int fd = rgbd::app::connectUnixSocket(socketPath);
+    if (fd < 0) {
+        return 1;
+    }
+
+    // The server resolves paths in its own working directory
+    std::error_code ec;
+    fs::create_directories(config.outputDir, ec);
+    std::string outputDir = fs::absolute(config.outputDir).string();
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Send every request first; responses are collected on this thread meanwhile
+    size_t sent = 0;
+    bool sendFailed = false;
+    std::thread sender([&]() {
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const rgbd::app::FrameSpec& frame = frames[i];
+            rgbd::app::RenderRequest request = base;
+            request.id = i + 1;
+            request.name = frame.name;
+            if (!inlineOutputs) {
+                request.outputDir = outputDir;
+            }
+
+            if (!frame.cameraInfoPath.empty()) {
+                rgbd::Intrinsics K;
+                if (rgbd::io::loadCameraInfo(frame.cameraInfoPath, K)) {
+                    request.fx = K.fx;
+                    request.fy = K.fy;
+                    request.cx = K.cx;
+                    request.cy = K.cy;
+                    if (!K.isPinhole()) {
+                        const rgbd::Distortion& d = K.distortion;
+                        request.distortion = { d.k1, d.k2, d.p1, d.p2, d.k3 };
+                    }
+                }
+            }
+
+            if (sendData) {
+                float scale = (base.depthScale > 0) ? base.depthScale : 1.0f;
+                request.rgb = rgbd::io::loadRGB(frame.rgbPath);
+                request.depth = rgbd::io::loadDepth(frame.depthPath, scale);
+                if (request.rgb.empty() || request.depth.empty()) {
+                    std::cerr << "Error: Failed to load frame " << frame.name << std::endl;
+                    // Still send it so that every id gets a response
+                    request.rgb = cv::Mat();
+                    request.depth = cv::Mat();
+                }
+                request.depthScale = 1.0f;
+            } else {
+                request.rgbPath = fs::absolute(frame.rgbPath).string();
+                request.depthPath = fs::absolute(frame.depthPath).string();
+            }
+
+            if (!rgbd::app::sendRequest(fd, request)) {
+                std::cerr << "Error: Connection to server lost" << std::endl;
+                sendFailed = true;
+                break;
+            }
+            sent++;
+        }
+        // Tell the server no more requests follow
+        ::shutdown(fd, SHUT_WR);
+    });
+
+    std::unique_ptr<rgbd::app::OutputSink> sink;
+    if (inlineOutputs) {
+        sink.reset(new rgbd::app::OutputSink(config, config.encodeThreads));
+    }
+
+    size_t received = 0;
+    size_t failed = 0;
+    rgbd::app::RenderResponse response;
+    while (received < frames.size() && rgbd::app::receiveResponse(fd, response)) {
+        received++;
+        const std::string& name = (response.id >= 1 && response.id <= frames.size())
+            ? frames[response.id - 1].name : std::to_string(response.id);
+        if (!response.ok) {
+            std::cerr << "  " << name << ": " << response.error << std::endl;
+            failed++;
+            continue;
+        }
+        for (size_t i = 0; i < response.outputs.size(); ++i) {
+            std::ostringstream fileName;
+            fileName << name << "_" << std::fixed << std::setprecision(2) << "scale_" << response.scales[i];
+            sink->submit(fileName.str(), std::move(response.outputs[i]));
+        }
+        std::cout << "  " << name << ": "
+                  << (inlineOutputs ? response.outputs.size() : response.files.size())
+                  << (inlineOutputs ? " views" : " files") << std::endl;
+    }
+
+    sender.join();
+    ::close(fd);
+    if (sink) {
+        sink->finish();
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count() / 1000.0;
+
+    size_t missing = sent - std::min(sent, received);
+    std::cout << "Done: " << received - failed << "/" << frames.size() << " frames in " << seconds << " s";
+    if (failed > 0) std::cout << ", " << failed << " failed";
+    if (missing > 0) std::cout << ", " << missing << " unanswered";
+    std::cout << std::endl;
+
+    return (failed == 0 && missing == 0 && !sendFailed && received == frames.size()) ? 0 : 1;
+}
@@ -0,0 +1,187 @@
+#include "camera_info.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+namespace rgbd {
+namespace io {
+
+namespace {
+
+/**
+ * Find the value of a top-level key of a JSON object
+ *
+ * Nested objects (e.g. "roi", which has its own width / height) and string
+ * contents are skipped, so only keys of the outermost object match.
+ * @return Offset of the first character of the value, npos if absent
+ */
+size_t findTopLevelValue(const std::string& json, const std::string& key) {
+    int nesting = 0;
+    for (size_t i = 0; i < json.size(); ++i) {
+        char c = json[i];
+        if (c == '{' || c == '[') {
+            nesting++;
+        } else if (c == '}' || c == ']') {
+            nesting--;
+        } else if (c == '"') {
+            size_t end = i + 1;
+            while (end < json.size() && json[end] != '"') {
+                end += (json[end] == '\\') ? 2 : 1;
+            }
+            if (end >= json.size()) {
+                return std::string::npos;
+            }
+
+            bool match = nesting == 1 && json.compare(i + 1, end - i - 1, key) == 0;
+            i = end;
+            if (!match) {
+                continue;
+            }
+
+            size_t colon = json.find_first_not_of(" \t\r\n", end + 1);
+            if (colon == std::string::npos || json[colon] != ':') {
+                continue;
+            }
+            return json.find_first_not_of(" \t\r\n", colon + 1);
+        }
+    }
+    return std::string::npos;
+}
+
+/**
+ * Parse a JSON array of numbers starting at pos ('[')
+ */
+bool parseNumberArray(const std::string& json, size_t pos, std::vector<double>& values) {
+    if (pos == std::string::npos || json[pos] != '[') {
+        return false;
+    }
+
+    const char* p = json.c_str() + pos + 1;
+    while (true) {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ',') ++p;
+        if (*p == ']') return true;
+
+        char* end = nullptr;
+        double v = std::strtod(p, &end);
+        if (end == p) return false;
+        values.push_back(v);
+        p = end;
+    }
+}
+
+/**
+ * Parse a JSON string starting at pos ('"'), without escape handling
+ */
+bool parseString(const std::string& json, size_t pos, std::string& value) {
+    if (pos == std::string::npos || json[pos] != '"') {
+        return false;
+    }
+    size_t end = json.find('"', pos + 1);
+    if (end == std::string::npos) {
+        return false;
+    }
+    value = json.substr(pos + 1, end - pos - 1);
+    return true;
+}
+
+/**
+ * Map the "distortion_model" / "D" pair to plumb_bob coefficients
+ *
+ * rational_polynomial is accepted when its k4..k6 are zero, any model when
+ * all coefficients are zero.
+ */
+bool parseDistortion(const std::string& model, const std::vector<double>& d,
+                     Distortion& distortion) {
+    bool zero = true;
+    for (double c : d) {
+        zero = zero && c == 0.0;
+    }
+    if (zero) {
+        distortion = Distortion();
+        return true;
+    }
+
+    bool supported = model.empty() || model == "plumb_bob";
+    if (model == "rational_polynomial") {
+        supported = true;
+        for (size_t i = 5; i < d.size(); ++i) {
+            supported = supported && d[i] == 0.0;
+        }
+    }
+    if (!supported || d.size() < 4) {
+        return false;
+    }
+    distortion.k1 = static_cast<float>(d[0]);
+    distortion.k2 = static_cast<float>(d[1]);
+    distortion.p1 = static_cast<float>(d[2]);
+    distortion.p2 = static_cast<float>(d[3]);
+    distortion.k3 = d.size() > 4 ? static_cast<float>(d[4]) : 0.0f;
+    return true;
+}
+
+} // namespace
+
+bool loadCameraInfo(const std::string& path, Intrinsics& K, Intrinsics* rectified) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open camera info: " << path << std::endl;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string json = buffer.str();
+
+    // Row-major [fx 0 cx; 0 fy cy; 0 0 1]
+    std::vector<double> k;
+    if (!parseNumberArray(json, findTopLevelValue(json, "K"), k) || k.size() != 9 ||
+        k[0] <= 0 || k[4] <= 0) {
+        std::cerr << "Error: No valid K array in camera info: " << path << std::endl;
+        return false;
+    }
+
+    // Lens distortion, absent in older dumps
+    std::string model;
+    parseString(json, findTopLevelValue(json, "distortion_model"), model);
+    std::vector<double> d;
+    size_t pos = findTopLevelValue(json, "D");
+    if (pos != std::string::npos && !parseNumberArray(json, pos, d)) {
+        std::cerr << "Error: Invalid D array in camera info: " << path << std::endl;
+        return false;
+    }
+    Distortion distortion;
+    if (!parseDistortion(model, d, distortion)) {
+        std::cerr << "Error: Unsupported distortion model \"" << model << "\" with "
+                  << d.size() << " coefficients in camera info: " << path << std::endl;
+        return false;
+    }
+
+    K.fx = static_cast<float>(k[0]);
+    K.cx = static_cast<float>(k[2]);
+    K.fy = static_cast<float>(k[4]);
+    K.cy = static_cast<float>(k[5]);
+    K.distortion = distortion;
+
+    pos = findTopLevelValue(json, "width");
+    if (pos != std::string::npos) {
+        K.width = std::atoi(json.c_str() + pos);
+    }
+    pos = findTopLevelValue(json, "height");
+    if (pos != std::string::npos) {
+        K.height = std::atoi(json.c_str() + pos);
+    }
+
+    // Row-major [fx' 0 cx' Tx; 0 fy' cy' Ty; 0 0 1 0] of the rectified image
+    std::vector<double> p;
+    if (rectified && parseNumberArray(json, findTopLevelValue(json, "P"), p) && p.size() == 12 &&
+        p[0] > 0 && p[5] > 0) {
+        *rectified = Intrinsics(static_cast<float>(p[0]), static_cast<float>(p[5]),
+                                static_cast<float>(p[2]), static_cast<float>(p[6]),
+                                K.width, K.height);
+    }
+    return true;
+}
+
+} // namespace io
+} // namespace rgbd
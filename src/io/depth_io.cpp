@@ -1,4 +1,9 @@
 #include "depth_io.hpp"
+#include "image_io.hpp"
+#include "mapped_io.hpp"
+#include "pixel_kernels.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
 #include <opencv2/imgcodecs.hpp>
 #include <iostream>
 #include <fstream>
@@ -11,12 +16,154 @@
 #include <OpenEXR/ImfChannelList.h>
 #include <OpenEXR/ImfFrameBuffer.h>
 #include <OpenEXR/ImfHeader.h>
+#include <OpenEXR/ImfCompression.h>
+#include <OpenEXR/ImfMultiPartOutputFile.h>
+#include <OpenEXR/ImfOutputPart.h>
+#include <OpenEXR/ImfPartType.h>
+#include <OpenEXR/ImfThreading.h>
+#include <OpenEXR/ImfIO.h>
+#include <OpenEXR/OpenEXRConfig.h>
+#if OPENEXR_VERSION_MAJOR < 3
+#include <OpenEXR/ImfInt64.h>
+#endif
 #endif
 
 namespace rgbd {
 namespace io {
 
+#ifdef HAS_OPENEXR
+namespace {
+
+Imf::Compression toImfCompression(ExrCompression compression) {
+    switch (compression) {
+        case ExrCompression::None: return Imf::NO_COMPRESSION;
+        case ExrCompression::ZIPS: return Imf::ZIPS_COMPRESSION;
+        case ExrCompression::PIZ:  return Imf::PIZ_COMPRESSION;
+        case ExrCompression::DWAA: return Imf::DWAA_COMPRESSION;
+        default:                   return Imf::ZIP_COMPRESSION;
+    }
+}
+
+#if OPENEXR_VERSION_MAJOR >= 3
+using ExrOffset = uint64_t;
+#else
+using ExrOffset = Imf::Int64;
+#endif
+
+/**
+ * OpenEXR output stream into a byte vector
+ */
+class MemoryOStream : public Imf::OStream {
+public:
+    explicit MemoryOStream(std::vector<uint8_t>& bytes) : Imf::OStream("memory"), bytes_(bytes) {}
+
+    void write(const char c[], int n) override {
+        size_t end = position_ + static_cast<size_t>(n);
+        if (end > bytes_.size()) {
+            bytes_.resize(end);
+        }
+        std::memcpy(bytes_.data() + position_, c, static_cast<size_t>(n));
+        position_ = end;
+    }
+
+    ExrOffset tellp() override { return position_; }
+    void seekp(ExrOffset pos) override { position_ = static_cast<size_t>(pos); }
+
+private:
+    std::vector<uint8_t>& bytes_;
+    size_t position_ = 0;
+};
+
+/**
+ * Channel planes of one bundled output; the frame buffer points into them
+ */
+struct ExrChannels {
+    std::vector<float> r, g, b, mask;
+    Imf::FrameBuffer frameBuffer;
+};
+
+/**
+ * Declare the channels of an output in its header and fill its frame buffer
+ */
+void addOutputChannels(const RenderOutput& out, const ExrOptions& options,
+                       Imf::Header& header, ExrChannels& channels) {
+    const size_t pixels = static_cast<size_t>(out.width) * out.height;
+    const size_t xStride = sizeof(float);
+    const size_t yStride = sizeof(float) * out.width;
+    auto insert = [&](const char* name, Imf::PixelType type, const float* plane) {
+        // The writer converts the float slices to the channel type
+        header.channels().insert(name, Imf::Channel(type));
+        channels.frameBuffer.insert(name,
+            Imf::Slice(Imf::FLOAT, (char*)plane, xStride, yStride));
+    };
+
+    if (!out.rgb.empty()) {
+        channels.r.resize(pixels);
+        channels.g.resize(pixels);
+        channels.b.resize(pixels);
+        for (size_t i = 0; i < pixels; ++i) {
+            channels.r[i] = out.rgb[i * 3 + 0] / 255.0f;
+            channels.g[i] = out.rgb[i * 3 + 1] / 255.0f;
+            channels.b[i] = out.rgb[i * 3 + 2] / 255.0f;
+        }
+        insert("R", Imf::HALF, channels.r.data());
+        insert("G", Imf::HALF, channels.g.data());
+        insert("B", Imf::HALF, channels.b.data());
+    }
+    if (!out.depth.empty()) {
+        insert("Z", options.halfDepth ? Imf::HALF : Imf::FLOAT, out.depth.data());
+    }
+    if (!out.mask.empty()) {
+        channels.mask.resize(pixels);
+        for (size_t i = 0; i < pixels; ++i) {
+            channels.mask[i] = out.mask[i] ? 1.0f : 0.0f;
+        }
+        insert("mask", Imf::HALF, channels.mask.data());
+    }
+}
+
+} // namespace
+#endif
+
+bool parseExrCompression(const std::string& name, ExrCompression& compression) {
+    if (name == "none") compression = ExrCompression::None;
+    else if (name == "zip") compression = ExrCompression::ZIP;
+    else if (name == "zips") compression = ExrCompression::ZIPS;
+    else if (name == "piz") compression = ExrCompression::PIZ;
+    else if (name == "dwaa") compression = ExrCompression::DWAA;
+    else return false;
+    return true;
+}
+
+const char* exrCompressionName(ExrCompression compression) {
+    switch (compression) {
+        case ExrCompression::None: return "none";
+        case ExrCompression::ZIP:  return "zip";
+        case ExrCompression::ZIPS: return "zips";
+        case ExrCompression::PIZ:  return "piz";
+        case ExrCompression::DWAA: return "dwaa";
+    }
+    return "unknown";
+}
+
+bool exrAvailable() {
+#ifdef HAS_OPENEXR
+    return true;
+#else
+    return false;
+#endif
+}
+
+void setExrThreadCount(int numThreads) {
+#ifdef HAS_OPENEXR
+    Imf::setGlobalThreadCount(resolveThreadCount(numThreads));
+#else
+    (void)numThreads;
+#endif
+}
+
 cv::Mat loadDepth(const std::string& path, float scale) {
+    RGBD_TRACE_SCOPE("loadDepth");
     // Check file extension
     size_t dotPos = path.rfind('.');
     std::string ext = (dotPos != std::string::npos) ? path.substr(dotPos) : "";
@@ -37,10 +184,33 @@ cv::Mat loadDepth(const std::string& path, float scale) {
             int width = dw.max.x - dw.min.x + 1;
             int height = dw.max.y - dw.min.y + 1;
             
+            // Depth channel by name, or the only channel of the file
+            const Imf::ChannelList& channels = file.header().channels();
+            const char* channel = nullptr;
+            for (const char* name : { "Z", "depth", "Y" }) {
+                if (channels.findChannel(name)) {
+                    channel = name;
+                    break;
+                }
+            }
+            if (!channel) {
+                Imf::ChannelList::ConstIterator it = channels.begin();
+                if (it != channels.end()) {
+                    channel = it.name();
+                    if (++it != channels.end()) {
+                        channel = nullptr;
+                    }
+                }
+            }
+            if (!channel) {
+                std::cerr << "Error: No depth channel (Z, depth or Y) in " << path << std::endl;
+                return cv::Mat();
+            }
+            
             depth.create(height, width, CV_32F);
             
             Imf::FrameBuffer frameBuffer;
-            frameBuffer.insert("Y",
+            frameBuffer.insert(channel,
                 Imf::Slice(Imf::FLOAT,
                     (char*)(depth.ptr<float>() - dw.min.x - dw.min.y * width),
                     sizeof(float),
@@ -83,14 +253,18 @@ cv::Mat loadDepth(const std::string& path, float scale) {
     return depth;
 }
 
-bool saveDepthEXR(const std::string& path, const std::vector<float>& depth,
-                  int width, int height) {
+bool encodeDepthEXR(const std::vector<float>& depth, int width, int height,
+                    const ExrOptions& options, std::vector<uint8_t>& bytes) {
+    RGBD_TRACE_SCOPE("encodeDepthEXR");
 #ifdef HAS_OPENEXR
     try {
         Imf::Header header(width, height);
-        header.channels().insert("Y", Imf::Channel(Imf::FLOAT));
+        header.compression() = toImfCompression(options.compression);
+        header.channels().insert("Y", Imf::Channel(options.halfDepth ? Imf::HALF : Imf::FLOAT));
         
-        Imf::OutputFile file(path.c_str(), header);
+        bytes.clear();
+        MemoryOStream stream(bytes);
+        Imf::OutputFile file(stream, header);
         Imf::FrameBuffer frameBuffer;
         
         frameBuffer.insert("Y",
@@ -107,14 +281,28 @@ bool saveDepthEXR(const std::string& path, const std::vector<float>& depth,
         return false;
     }
 #else
-    // Fallback: save as 32-bit TIFF
+    // Fallback: 32-bit TIFF
+    (void)options;
     cv::Mat depthMat(height, width, CV_32F, const_cast<float*>(depth.data()));
+    return cv::imencode(".tiff", depthMat, bytes);
+#endif
+}
+
+bool saveDepthEXR(const std::string& path, const std::vector<float>& depth,
+                  int width, int height, const ExrOptions& options) {
+    std::vector<uint8_t> bytes;
+    if (!encodeDepthEXR(depth, width, height, options, bytes)) {
+        return false;
+    }
+#ifdef HAS_OPENEXR
+    return writeFile(path, bytes);
+#else
     std::string tiffPath = path;
     size_t dotPos = tiffPath.rfind('.');
     if (dotPos != std::string::npos) {
         tiffPath = tiffPath.substr(0, dotPos) + ".tiff";
     }
-    return cv::imwrite(tiffPath, depthMat);
+    return writeFile(tiffPath, bytes);
 #endif
 }
 
@@ -130,42 +318,83 @@ bool saveDepthEXR(const std::string& path, const cv::Mat& depth) {
     return saveDepthEXR(path, data, depth.cols, depth.rows);
 }
 
-bool saveDepthPNG(const std::string& path, const std::vector<float>& depth,
-                  int width, int height, float scale) {
-    cv::Mat depth16(height, width, CV_16UC1);
-    
-    for (int i = 0; i < height * width; ++i) {
-        float z = depth[i];
-        if (std::isfinite(z) && z > 0) {
-            float scaled = z * scale;
-            depth16.at<uint16_t>(i / width, i % width) = 
-                static_cast<uint16_t>(std::min(scaled, 65535.0f));
-        } else {
-            depth16.at<uint16_t>(i / width, i % width) = 0;
+bool encodeOutputsEXR(const std::vector<ExrPart>& parts, const ExrOptions& options,
+                      std::vector<uint8_t>& bytes) {
+    RGBD_TRACE_SCOPE("encodeOutputsEXR");
+    if (parts.empty()) {
+        std::cerr << "Error: No outputs for EXR" << std::endl;
+        return false;
+    }
+#ifdef HAS_OPENEXR
+    try {
+        std::vector<Imf::Header> headers;
+        headers.reserve(parts.size());
+        std::vector<ExrChannels> channels(parts.size());
+        for (size_t i = 0; i < parts.size(); ++i) {
+            const RenderOutput& out = *parts[i].output;
+            headers.emplace_back(out.width, out.height);
+            Imf::Header& header = headers.back();
+            header.compression() = toImfCompression(options.compression);
+            addOutputChannels(out, options, header, channels[i]);
+        }
+        
+        bytes.clear();
+        MemoryOStream stream(bytes);
+        if (parts.size() == 1) {
+            Imf::OutputFile file(stream, headers[0]);
+            file.setFrameBuffer(channels[0].frameBuffer);
+            file.writePixels(parts[0].output->height);
+            return true;
+        }
+        
+        for (size_t i = 0; i < parts.size(); ++i) {
+            headers[i].setName(parts[i].name);
+            headers[i].setType(Imf::SCANLINEIMAGE);
+        }
+        Imf::MultiPartOutputFile file(stream, headers.data(), static_cast<int>(headers.size()), true);
+        for (size_t i = 0; i < parts.size(); ++i) {
+            Imf::OutputPart part(file, static_cast<int>(i));
+            part.setFrameBuffer(channels[i].frameBuffer);
+            part.writePixels(parts[i].output->height);
         }
+        return true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error saving EXR: " << e.what() << std::endl;
+        return false;
     }
+#else
+    (void)options;
+    (void)bytes;
+    std::cerr << "Error: Multi-channel EXR requires OpenEXR" << std::endl;
+    return false;
+#endif
+}
+
+bool saveOutputsEXR(const std::string& path, const std::vector<ExrPart>& parts,
+                    const ExrOptions& options) {
+    std::vector<uint8_t> bytes;
+    return encodeOutputsEXR(parts, options, bytes) && writeFile(path, bytes);
+}
+
+bool encodeDepthPNG(const std::vector<float>& depth, int width, int height, float scale,
+                    std::vector<uint8_t>& bytes) {
+    RGBD_TRACE_SCOPE("encodeDepthPNG");
+    cv::Mat depth16(height, width, CV_16UC1);
+    kernels::depthToU16(depth.data(), depth16.ptr<uint16_t>(), width, height, scale, false);
     
-    return cv::imwrite(path, depth16);
+    return cv::imencode(".png", depth16, bytes);
 }
 
-bool saveDepthNPY(const std::string& path, const std::vector<float>& depth,
-                  int width, int height) {
+bool saveDepthPNG(const std::string& path, const std::vector<float>& depth,
+                  int width, int height, float scale) {
+    std::vector<uint8_t> bytes;
+    return encodeDepthPNG(depth, width, height, scale, bytes) && writeFile(path, bytes);
+}
+
+bool encodeDepthNPY(const std::vector<float>& depth, int width, int height,
+                    std::vector<uint8_t>& bytes) {
+    RGBD_TRACE_SCOPE("encodeDepthNPY");
     // Simple NPY format writer
-    std::ofstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Error: Cannot open file for writing: " << path << std::endl;
-        return false;
-    }
-    
-    // NPY magic number and version
-    const char magic[] = "\x93NUMPY";
-    file.write(magic, 6);
-    
-    // Version 1.0
-    uint8_t version[] = {1, 0};
-    file.write(reinterpret_cast<char*>(version), 2);
-    
-    // Header
     std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (";
     header += std::to_string(height) + ", " + std::to_string(width) + "), }";
     
@@ -175,104 +404,50 @@ bool saveDepthNPY(const std::string& path, const std::vector<float>& depth,
     header.resize(paddedLen - 1, ' ');
     header += '\n';
     
-    // Header length (little-endian 16-bit)
+    // NPY magic number, version 1.0, header length (little-endian 16-bit)
+    const char magic[] = "\x93NUMPY";
     uint16_t hlen = static_cast<uint16_t>(header.size());
-    file.write(reinterpret_cast<char*>(&hlen), 2);
-    file.write(header.c_str(), header.size());
+    size_t dataBytes = depth.size() * sizeof(float);
+    bytes.resize(10 + header.size() + dataBytes);
+    uint8_t* out = bytes.data();
+    std::memcpy(out, magic, 6);
+    out[6] = 1;
+    out[7] = 0;
+    out[8] = static_cast<uint8_t>(hlen & 0xFF);
+    out[9] = static_cast<uint8_t>(hlen >> 8);
+    std::memcpy(out + 10, header.data(), header.size());
     
     // Data
-    file.write(reinterpret_cast<const char*>(depth.data()), 
-               depth.size() * sizeof(float));
-    
+    std::memcpy(out + 10 + header.size(), depth.data(), dataBytes);
     return true;
 }
 
+bool saveDepthNPY(const std::string& path, const std::vector<float>& depth,
+                  int width, int height) {
+    std::vector<uint8_t> bytes;
+    return encodeDepthNPY(depth, width, height, bytes) && writeFile(path, bytes);
+}
+
 cv::Mat loadDepthNPY(const std::string& path) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file.is_open()) {
-        std::cerr << "Error: Cannot open NPY file: " << path << std::endl;
-        return cv::Mat();
-    }
-    
-    // Read magic number
-    char magic[6];
-    file.read(magic, 6);
-    if (std::strncmp(magic, "\x93NUMPY", 6) != 0) {
-        std::cerr << "Error: Invalid NPY magic number" << std::endl;
-        return cv::Mat();
-    }
-    
-    // Read version
-    uint8_t version[2];
-    file.read(reinterpret_cast<char*>(version), 2);
-    
-    // Read header length
-    uint16_t headerLen;
-    if (version[0] == 1) {
-        file.read(reinterpret_cast<char*>(&headerLen), 2);
-    } else {
-        uint32_t hlen32;
-        file.read(reinterpret_cast<char*>(&hlen32), 4);
-        headerLen = static_cast<uint16_t>(hlen32);
-    }
-    
-    // Read header
-    std::string header(headerLen, '\0');
-    file.read(&header[0], headerLen);
-    
-    // Parse shape from header
-    size_t shapePos = header.find("'shape':");
-    if (shapePos == std::string::npos) {
-        std::cerr << "Error: Cannot find shape in NPY header" << std::endl;
-        return cv::Mat();
-    }
-    
-    size_t startParen = header.find('(', shapePos);
-    size_t endParen = header.find(')', startParen);
-    std::string shapeStr = header.substr(startParen + 1, endParen - startParen - 1);
-    
-    // Parse dimensions
-    int height = 0, width = 0;
-    size_t commaPos = shapeStr.find(',');
-    if (commaPos != std::string::npos) {
-        height = std::stoi(shapeStr.substr(0, commaPos));
-        std::string widthStr = shapeStr.substr(commaPos + 1);
-        // Remove trailing comma if present
-        size_t comma2 = widthStr.find(',');
-        if (comma2 != std::string::npos) {
-            widthStr = widthStr.substr(0, comma2);
-        }
-        // Trim whitespace
-        widthStr.erase(0, widthStr.find_first_not_of(" \t"));
-        widthStr.erase(widthStr.find_last_not_of(" \t") + 1);
-        if (!widthStr.empty()) {
-            width = std::stoi(widthStr);
-        }
-    }
-    
-    if (height <= 0 || width <= 0) {
-        std::cerr << "Error: Invalid shape in NPY file" << std::endl;
-        return cv::Mat();
-    }
-    
-    // Read data
-    cv::Mat depth(height, width, CV_32F);
-    file.read(reinterpret_cast<char*>(depth.ptr<float>()), 
-              height * width * sizeof(float));
+    // The caller owns the result, so a zero-copy mapping is copied out once
+    MappedMat mapped = mapNPY(path);
+    return mapped.isZeroCopy() ? mapped.mat.clone() : mapped.mat;
+}
+
+bool encodeMask(const std::vector<uint8_t>& mask, int width, int height,
+                std::vector<uint8_t>& bytes) {
+    RGBD_TRACE_SCOPE("encodeMask");
+    cv::Mat maskMat(height, width, CV_8UC1);
+    // Convert 0/1 to 0/255 for visibility
+    kernels::maskToU8(mask.data(), maskMat.ptr<uint8_t>(), width, height, false);
     
-    return depth;
+    return cv::imencode(".png", maskMat, bytes);
 }
 
 bool saveMask(const std::string& path, const std::vector<uint8_t>& mask,
               int width, int height) {
-    cv::Mat maskMat(height, width, CV_8UC1);
-    
-    for (int i = 0; i < height * width; ++i) {
-        // Convert 0/1 to 0/255 for visibility
-        maskMat.at<uint8_t>(i / width, i % width) = mask[i] ? 255 : 0;
-    }
-    
-    return cv::imwrite(path, maskMat);
+    std::vector<uint8_t> bytes;
+    return encodeMask(mask, width, height, bytes) && writeFile(path, bytes);
 }
 
 } // namespace io
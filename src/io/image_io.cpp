@@ -1,4 +1,6 @@
 #include "image_io.hpp"
+#include "pixel_kernels.hpp"
+#include "trace.hpp"
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
 #include <iostream>
@@ -8,6 +10,7 @@ namespace rgbd {
 namespace io {
 
 cv::Mat loadRGB(const std::string& path) {
+    RGBD_TRACE_SCOPE("loadRGB");
     cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
     if (image.empty()) {
         std::cerr << "Error: Failed to load image: " << path << std::endl;
@@ -18,19 +21,41 @@ cv::Mat loadRGB(const std::string& path) {
 
 bool saveRGB(const std::string& path, const std::vector<uint8_t>& image,
              int width, int height) {
+    size_t dotPos = path.rfind('.');
+    std::string ext = (dotPos != std::string::npos) ? path.substr(dotPos) : "";
+    std::vector<uint8_t> bytes;
+    return encodeRGB(ext, image, width, height, bytes) && writeFile(path, bytes);
+}
+
+bool encodeRGB(const std::string& ext, const std::vector<uint8_t>& image,
+               int width, int height, std::vector<uint8_t>& bytes) {
+    RGBD_TRACE_SCOPE("encodeRGB");
     if (image.size() != static_cast<size_t>(width * height * 3)) {
         std::cerr << "Error: Image size mismatch" << std::endl;
         return false;
     }
     
-    // Create Mat from data (RGB format)
-    cv::Mat rgb(height, width, CV_8UC3, const_cast<uint8_t*>(image.data()));
-    
     // Convert RGB to BGR for OpenCV
-    cv::Mat bgr;
-    cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
+    cv::Mat bgr(height, width, CV_8UC3);
+    kernels::swapRedBlue(image.data(), bgr.data, width, height, false);
     
-    return cv::imwrite(path, bgr);
+    return cv::imencode(ext, bgr, bytes);
+}
+
+bool writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    RGBD_TRACE_SCOPE("writeFile");
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open file for writing: " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    file.close();
+    if (file.fail()) {
+        std::cerr << "Error: Failed to write file: " << path << std::endl;
+        return false;
+    }
+    return true;
 }
 
 bool saveRGB(const std::string& path, const cv::Mat& image) {
@@ -41,16 +66,30 @@ bool saveRGB(const std::string& path, const cv::Mat& image) {
     return cv::imwrite(path, image);
 }
 
+namespace {
+
+/**
+ * Swap R and B of a 3-channel image (other layouts go through OpenCV)
+ */
+cv::Mat swapChannels(const cv::Mat& image, int code) {
+    cv::Mat swapped;
+    if (image.type() != CV_8UC3 || !image.isContinuous()) {
+        cv::cvtColor(image, swapped, code);
+        return swapped;
+    }
+    swapped.create(image.rows, image.cols, CV_8UC3);
+    kernels::swapRedBlue(image.data, swapped.data, image.cols, image.rows, false);
+    return swapped;
+}
+
+} // namespace
+
 cv::Mat bgrToRgb(const cv::Mat& bgr) {
-    cv::Mat rgb;
-    cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
-    return rgb;
+    return swapChannels(bgr, cv::COLOR_BGR2RGB);
 }
 
 cv::Mat rgbToBgr(const cv::Mat& rgb) {
-    cv::Mat bgr;
-    cv::cvtColor(rgb, bgr, cv::COLOR_RGB2BGR);
-    return bgr;
+    return swapChannels(rgb, cv::COLOR_RGB2BGR);
 }
 
 } // namespace io
@@ -0,0 +1,482 @@
+#include "mapped_io.hpp"
+#include "depth_io.hpp"
+#include "pixel_kernels.hpp"
+#include "simd.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RGBD_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define RGBD_HAS_MMAP 0
+#endif
+
+#if RGBD_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rgbd {
+namespace io {
+
+MappedFile::~MappedFile() {
+    if (!data_) return;
+#if RGBD_HAS_MMAP
+    if (mapped_) {
+        munmap(data_, size_);
+        return;
+    }
+#endif
+    delete[] data_;
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    auto file = std::make_shared<MappedFile>();
+#if RGBD_HAS_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    // Private writable mapping: writes go to copy-on-write pages, never the file
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    madvise(data, static_cast<size_t>(st.st_size), MADV_WILLNEED);
+
+    file->data_ = static_cast<uint8_t*>(data);
+    file->size_ = static_cast<size_t>(st.st_size);
+    file->mapped_ = true;
+#else
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open() || in.tellg() <= 0) {
+        return nullptr;
+    }
+    file->size_ = static_cast<size_t>(in.tellg());
+    file->data_ = new uint8_t[file->size_];
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(file->data_), file->size_);
+#endif
+    return file;
+}
+
+namespace {
+
+/**
+ * Parsed .npy header
+ */
+struct NpyHeader {
+    char byteOrder = '<';  // '<', '>', '=' or '|'
+    char kind = 'f';       // 'f', 'u', 'i'
+    int itemSize = 4;
+    bool fortranOrder = false;
+    std::vector<long> shape;
+    size_t dataOffset = 0;
+};
+
+/**
+ * Value of a key in the header dict, up to the next ',' or '}' outside parentheses
+ */
+std::string npyField(const std::string& header, const std::string& key) {
+    size_t pos = header.find("'" + key + "'");
+    if (pos == std::string::npos) return "";
+    pos = header.find(':', pos);
+    if (pos == std::string::npos) return "";
+
+    size_t end = pos + 1;
+    int parens = 0;
+    while (end < header.size()) {
+        char c = header[end];
+        if (c == '(') parens++;
+        if (c == ')') parens--;
+        if (parens == 0 && (c == ',' || c == '}')) break;
+        end++;
+    }
+    std::string value = header.substr(pos + 1, end - pos - 1);
+    value.erase(0, value.find_first_not_of(" \t"));
+    value.erase(value.find_last_not_of(" \t") + 1);
+    return value;
+}
+
+bool parseNpyHeader(const uint8_t* data, size_t size, NpyHeader& h) {
+    if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0) {
+        std::cerr << "Error: Invalid NPY magic number" << std::endl;
+        return false;
+    }
+
+    // v1: uint16 header length; v2 / v3: uint32 (v3 only differs in utf-8 keys)
+    size_t headerLen = 0;
+    size_t headerStart = 0;
+    uint8_t major = data[6];
+    if (major == 1) {
+        headerLen = data[8] | (data[9] << 8);
+        headerStart = 10;
+    } else if ((major == 2 || major == 3) && size >= 12) {
+        headerLen = static_cast<size_t>(data[8]) | (static_cast<size_t>(data[9]) << 8) |
+                    (static_cast<size_t>(data[10]) << 16) | (static_cast<size_t>(data[11]) << 24);
+        headerStart = 12;
+    } else {
+        std::cerr << "Error: Unsupported NPY version " << int(major) << std::endl;
+        return false;
+    }
+    if (headerStart + headerLen > size) {
+        std::cerr << "Error: Truncated NPY header" << std::endl;
+        return false;
+    }
+    std::string header(reinterpret_cast<const char*>(data + headerStart), headerLen);
+    h.dataOffset = headerStart + headerLen;
+
+    std::string descr = npyField(header, "descr");
+    if (descr.size() < 5 || (descr.front() != '\'' && descr.front() != '"')) {
+        std::cerr << "Error: Cannot find dtype in NPY header" << std::endl;
+        return false;
+    }
+    descr = descr.substr(1, descr.size() - 2);
+    h.byteOrder = descr[0];
+    h.kind = descr[1];
+    h.itemSize = std::atoi(descr.c_str() + 2);
+
+    h.fortranOrder = npyField(header, "fortran_order") == "True";
+
+    std::string shape = npyField(header, "shape");
+    size_t open = shape.find('(');
+    size_t close = shape.find(')');
+    if (open == std::string::npos || close == std::string::npos) {
+        std::cerr << "Error: Cannot find shape in NPY header" << std::endl;
+        return false;
+    }
+    std::string dims = shape.substr(open + 1, close - open - 1);
+    size_t pos = 0;
+    while (pos < dims.size()) {
+        size_t comma = dims.find(',', pos);
+        std::string dim = dims.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        if (dim.find_first_not_of(" \t") != std::string::npos) {
+            h.shape.push_back(std::atol(dim.c_str()));
+        }
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// dtype -> float32 conversion kernels (unaligned sources)
+// ---------------------------------------------------------------------------
+
+template <typename T>
+void convertScalar(const uint8_t* src, float* dst, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; ++i) {
+        T v;
+        std::memcpy(&v, src + i * sizeof(T), sizeof(T));
+        dst[i] = static_cast<float>(v);
+    }
+}
+
+void convertHalfScalar(const uint8_t* src, float* dst, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; ++i) {
+        uint16_t v;
+        std::memcpy(&v, src + i * 2, 2);
+        dst[i] = kernels::halfToFloat(v);
+    }
+}
+
+#if RGBD_X86_SIMD
+
+RGBD_TARGET_AVX2
+size_t convertU16AVX2(const uint8_t* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v)));
+    }
+    return i;
+}
+
+RGBD_TARGET_AVX2
+size_t convertI32AVX2(const uint8_t* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        _mm256_storeu_ps(dst + i, _mm256_cvtepi32_ps(v));
+    }
+    return i;
+}
+
+RGBD_TARGET_AVX2
+size_t convertF64AVX2(const uint8_t* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(reinterpret_cast<const double*>(src + i * 8)));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(reinterpret_cast<const double*>(src + i * 8 + 32)));
+        _mm_storeu_ps(dst + i, lo);
+        _mm_storeu_ps(dst + i + 4, hi);
+    }
+    return i;
+}
+
+__attribute__((target("avx2,f16c")))
+size_t convertF16F16C(const uint8_t* src, float* dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(v));
+    }
+    return i;
+}
+
+bool hasF16C() {
+    static const bool supported = __builtin_cpu_supports("f16c");
+    return supported;
+}
+
+#endif // RGBD_X86_SIMD
+
+/**
+ * Convert count little-endian elements of a supported dtype to float32
+ * @return false for unsupported dtypes
+ */
+bool convertToFloat(const NpyHeader& h, const uint8_t* src, float* dst, size_t count) {
+    size_t done = 0;
+#if RGBD_X86_SIMD
+    bool avx2 = activeSimdLevel() >= SimdLevel::AVX2;
+#endif
+
+    if (h.kind == 'f' && h.itemSize == 4) {
+        std::memcpy(dst, src, count * sizeof(float));
+    } else if (h.kind == 'f' && h.itemSize == 2) {
+#if RGBD_X86_SIMD
+        if (avx2 && hasF16C()) done = convertF16F16C(src, dst, count);
+#endif
+        convertHalfScalar(src, dst, done, count);
+    } else if (h.kind == 'f' && h.itemSize == 8) {
+#if RGBD_X86_SIMD
+        if (avx2) done = convertF64AVX2(src, dst, count);
+#endif
+        convertScalar<double>(src, dst, done, count);
+    } else if (h.kind == 'u' && h.itemSize == 2) {
+#if RGBD_X86_SIMD
+        if (avx2) done = convertU16AVX2(src, dst, count);
+#endif
+        convertScalar<uint16_t>(src, dst, done, count);
+    } else if (h.kind == 'i' && h.itemSize == 4) {
+#if RGBD_X86_SIMD
+        if (avx2) done = convertI32AVX2(src, dst, count);
+#endif
+        convertScalar<int32_t>(src, dst, done, count);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Transpose a rows x cols float matrix into dst (cols x rows), in cache blocks
+ */
+void transposeBlocked(const float* src, int rows, int cols, float* dst) {
+    const int block = 32;
+    for (int r0 = 0; r0 < rows; r0 += block) {
+        for (int c0 = 0; c0 < cols; c0 += block) {
+            int r1 = std::min(r0 + block, rows);
+            int c1 = std::min(c0 + block, cols);
+            for (int r = r0; r < r1; ++r) {
+                for (int c = c0; c < c1; ++c) {
+                    dst[static_cast<size_t>(c) * rows + r] = src[static_cast<size_t>(r) * cols + c];
+                }
+            }
+        }
+    }
+}
+
+bool isLittleEndianOrder(char byteOrder) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return byteOrder == '<';
+#else
+    return byteOrder == '<' || byteOrder == '=';
+#endif
+}
+
+/**
+ * Next whitespace-separated header token of a PNM file, skipping comments
+ */
+bool pnmToken(const uint8_t* data, size_t size, size_t& pos, long& value) {
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') pos++;
+        } else if (std::isspace(data[pos])) {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    if (pos >= size || !std::isdigit(data[pos])) {
+        return false;
+    }
+    value = 0;
+    while (pos < size && std::isdigit(data[pos])) {
+        value = value * 10 + (data[pos] - '0');
+        pos++;
+    }
+    return true;
+}
+
+} // namespace
+
+MappedMat mapNPY(const std::string& path) {
+    MappedMat result;
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file) {
+        std::cerr << "Error: Cannot open NPY file: " << path << std::endl;
+        return result;
+    }
+
+    NpyHeader h;
+    if (!parseNpyHeader(file->data(), file->size(), h)) {
+        return result;
+    }
+    if (h.byteOrder != '|' && !isLittleEndianOrder(h.byteOrder)) {
+        std::cerr << "Error: Big-endian NPY data is not supported: " << path << std::endl;
+        return result;
+    }
+
+    bool trailingOne = h.shape.size() == 3 && h.shape[2] == 1;
+    if ((h.shape.size() != 2 && !trailingOne) || h.shape[0] <= 0 || h.shape[1] <= 0) {
+        std::cerr << "Error: Invalid shape in NPY file (expected H x W)" << std::endl;
+        return result;
+    }
+    int height = static_cast<int>(h.shape[0]);
+    int width = static_cast<int>(h.shape[1]);
+    size_t count = static_cast<size_t>(height) * width;
+
+    if (h.dataOffset + count * h.itemSize > file->size()) {
+        std::cerr << "Error: Truncated NPY data: " << path << std::endl;
+        return result;
+    }
+    uint8_t* src = file->data() + h.dataOffset;
+
+    // Native float32 rows: wrap the mapping as is
+    bool aligned = reinterpret_cast<uintptr_t>(src) % alignof(float) == 0;
+    if (h.kind == 'f' && h.itemSize == 4 && !h.fortranOrder && aligned) {
+        result.mat = cv::Mat(height, width, CV_32F, src);
+        result.source = file;
+        return result;
+    }
+
+    cv::Mat depth(height, width, CV_32F);
+    std::vector<float> columnMajor;
+    float* dst = depth.ptr<float>();
+    if (h.fortranOrder) {
+        columnMajor.resize(count);
+        dst = columnMajor.data();
+    }
+
+    if (!convertToFloat(h, src, dst, count)) {
+        std::cerr << "Error: Unsupported NPY dtype " << h.byteOrder << h.kind << h.itemSize
+                  << " (expected f2, f4, f8, u2 or i4)" << std::endl;
+        return result;
+    }
+
+    // Fortran order stores the W x H transpose row by row
+    if (h.fortranOrder) {
+        transposeBlocked(columnMajor.data(), width, height, depth.ptr<float>());
+    }
+    result.mat = depth;
+    return result;
+}
+
+MappedMat mapPNM(const std::string& path) {
+    MappedMat result;
+    std::shared_ptr<MappedFile> file = MappedFile::open(path);
+    if (!file) {
+        std::cerr << "Error: Cannot open PNM file: " << path << std::endl;
+        return result;
+    }
+
+    const uint8_t* data = file->data();
+    size_t size = file->size();
+    if (size < 2 || data[0] != 'P' || (data[1] != '5' && data[1] != '6')) {
+        std::cerr << "Error: Not a binary PGM/PPM file: " << path << std::endl;
+        return result;
+    }
+    int channels = (data[1] == '5') ? 1 : 3;
+
+    size_t pos = 2;
+    long width = 0, height = 0, maxval = 0;
+    if (!pnmToken(data, size, pos, width) || !pnmToken(data, size, pos, height) ||
+        !pnmToken(data, size, pos, maxval) || width <= 0 || height <= 0 ||
+        maxval <= 0 || maxval > 65535) {
+        std::cerr << "Error: Invalid PNM header: " << path << std::endl;
+        return result;
+    }
+    pos++;  // Single whitespace byte before the raster
+
+    int bytesPerSample = (maxval < 256) ? 1 : 2;
+    size_t count = static_cast<size_t>(width) * height * channels;
+    if (pos + count * bytesPerSample > size) {
+        std::cerr << "Error: Truncated PNM data: " << path << std::endl;
+        return result;
+    }
+    uint8_t* raster = file->data() + pos;
+
+    if (bytesPerSample == 1) {
+        result.mat = cv::Mat(static_cast<int>(height), static_cast<int>(width), CV_MAKETYPE(CV_8U, channels), raster);
+        result.source = file;
+        return result;
+    }
+
+    // 16-bit samples are big-endian
+    cv::Mat image(static_cast<int>(height), static_cast<int>(width), CV_MAKETYPE(CV_16U, channels));
+    uint16_t* dst = image.ptr<uint16_t>();
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = static_cast<uint16_t>((raster[2 * i] << 8) | raster[2 * i + 1]);
+    }
+    result.mat = image;
+    return result;
+}
+
+MappedMat mapDepth(const std::string& path, float scale) {
+    RGBD_TRACE_SCOPE("mapDepth");
+    size_t dotPos = path.rfind('.');
+    std::string ext = (dotPos != std::string::npos) ? path.substr(dotPos) : "";
+    for (char& c : ext) c = std::tolower(c);
+
+    MappedMat result;
+    if (ext == ".npy") {
+        result = mapNPY(path);
+    } else if (ext == ".pgm") {
+        MappedMat raw = mapPNM(path);
+        if (raw.empty() || raw.mat.channels() != 1) {
+            if (!raw.empty()) std::cerr << "Error: Depth PGM must have one channel" << std::endl;
+            return MappedMat();
+        }
+        raw.mat.convertTo(result.mat, CV_32F);
+    } else {
+        result.mat = loadDepth(path, scale);
+        return result;
+    }
+
+    // In place is fine for a mapping too: its pages are copy-on-write
+    if (scale != 1.0f && !result.empty()) {
+        result.mat *= scale;
+    }
+    return result;
+}
+
+} // namespace io
+} // namespace rgbd
@@ -0,0 +1,544 @@
+#include "pixel_kernels.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if RGBD_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rgbd {
+namespace kernels {
+
+namespace {
+
+// Images smaller than this per thread are converted on fewer threads
+static constexpr size_t kMinPixelsPerThread = 1 << 16;
+static constexpr int kBandsPerThread = 4;
+
+/**
+ * Never run code the CPU cannot execute, whatever the caller asked for
+ */
+SimdLevel clampLevel(SimdLevel level) {
+    return std::min(level, activeSimdLevel());
+}
+
+// Scalar reference kernels; they also finish the tail of the vector ones
+
+void rgbaToRgbScalar(const uint8_t* rgba, uint8_t* out, int begin, int width, bool swap) {
+    const int r = swap ? 2 : 0;
+    const int b = swap ? 0 : 2;
+    for (int x = begin; x < width; ++x) {
+        out[x * 3 + 0] = rgba[x * 4 + r];
+        out[x * 3 + 1] = rgba[x * 4 + 1];
+        out[x * 3 + 2] = rgba[x * 4 + b];
+    }
+}
+
+void swapRedBlueScalar(const uint8_t* in, uint8_t* out, int begin, int width) {
+    for (int x = begin; x < width; ++x) {
+        uint8_t r = in[x * 3 + 0];
+        uint8_t g = in[x * 3 + 1];
+        uint8_t b = in[x * 3 + 2];
+        out[x * 3 + 0] = b;
+        out[x * 3 + 1] = g;
+        out[x * 3 + 2] = r;
+    }
+}
+
+void halfToFloatScalar(const uint16_t* in, float* out, int begin, int width) {
+    for (int x = begin; x < width; ++x) {
+        out[x] = halfToFloat(in[x]);
+    }
+}
+
+void u16ToFloatScalar(const uint16_t* in, float* out, int begin, int width, float scale) {
+    for (int x = begin; x < width; ++x) {
+        out[x] = in[x] * scale;
+    }
+}
+
+void depthToU16Scalar(const float* in, uint16_t* out, int begin, int width, float scale) {
+    for (int x = begin; x < width; ++x) {
+        float z = in[x];
+        out[x] = (std::isfinite(z) && z > 0.0f)
+            ? static_cast<uint16_t>(std::min(z * scale, 65535.0f)) : 0;
+    }
+}
+
+void maskToU8Scalar(const uint8_t* in, uint8_t* out, int begin, int width) {
+    for (int x = begin; x < width; ++x) {
+        out[x] = in[x] ? 255 : 0;
+    }
+}
+
+#if RGBD_X86_SIMD
+
+// The vector kernels return the number of pixels they converted
+
+// pshufb masks gathering RGB (or BGR) from 4 RGBA pixels into 12 bytes
+inline __m128i rgbaShuffle(bool swap) {
+    return swap ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1)
+                : _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+}
+
+// Swaps R and B of the first 5 pixels of 16 bytes, byte 15 passes through
+RGBD_TARGET_SSE41
+inline __m128i swapShuffle() {
+    return _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+}
+
+RGBD_TARGET_SSE41
+int rgbaToRgbSSE41(const uint8_t* rgba, uint8_t* out, int width, bool swap) {
+    const __m128i shuffle = rgbaShuffle(swap);
+    int x = 0;
+    // Each 16-byte store writes 4 bytes past its pixels, overwritten by the next one
+    for (; x + 6 <= width; x += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + x * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 3), _mm_shuffle_epi8(v, shuffle));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX2
+int rgbaToRgbAVX2(const uint8_t* rgba, uint8_t* out, int width, bool swap) {
+    const __m256i shuffle = _mm256_broadcastsi128_si256(rgbaShuffle(swap));
+    // Moves the 12 bytes of the upper lane next to those of the lower one
+    const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    int x = 0;
+    for (; x + 11 <= width; x += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + x * 4));
+        __m256i rgb = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle), pack);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x * 3), rgb);
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX512
+int rgbaToRgbAVX512(const uint8_t* rgba, uint8_t* out, int width, bool swap) {
+    const __m512i shuffle = _mm512_broadcast_i32x4(rgbaShuffle(swap));
+    const __m512i pack = _mm512_setr_epi32(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 0, 0, 0, 0);
+    const __mmask64 store = (__mmask64(1) << 48) - 1;
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i v = _mm512_loadu_si512(rgba + x * 4);
+        __m512i rgb = _mm512_permutexvar_epi32(pack, _mm512_shuffle_epi8(v, shuffle));
+        _mm512_mask_storeu_epi8(out + x * 3, store, rgb);
+    }
+    return x;
+}
+
+RGBD_TARGET_SSE41
+int swapRedBlueSSE41(const uint8_t* in, uint8_t* out, int width) {
+    const __m128i shuffle = swapShuffle();
+    int x = 0;
+    // 5 pixels per 16 bytes; in place, byte 15 is stored unchanged before it is loaded again
+    for (; x + 6 <= width; x += 5) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 3), _mm_shuffle_epi8(v, shuffle));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX2
+int swapRedBlueAVX2(const uint8_t* in, uint8_t* out, int width) {
+    const __m256i shuffle = _mm256_broadcastsi128_si256(swapShuffle());
+    int x = 0;
+    // 10 pixels: each lane holds 5, loaded and stored 15 bytes apart
+    for (; x + 11 <= width; x += 10) {
+        const uint8_t* src = in + x * 3;
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 15)), 1);
+        v = _mm256_shuffle_epi8(v, shuffle);
+        uint8_t* dst = out + x * 3;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_castsi256_si128(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 15), _mm256_extracti128_si256(v, 1));
+    }
+    return x;
+}
+
+__attribute__((target("avx2,f16c")))
+int halfToFloatF16C(const uint16_t* in, float* out, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+        _mm256_storeu_ps(out + x, _mm256_cvtph_ps(v));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX512
+int halfToFloatAVX512(const uint16_t* in, float* out, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+        _mm512_storeu_ps(out + x, _mm512_cvtph_ps(v));
+    }
+    return x;
+}
+
+bool hasF16C() {
+    static const bool supported = __builtin_cpu_supports("f16c");
+    return supported;
+}
+
+RGBD_TARGET_SSE41
+int u16ToFloatSSE41(const uint16_t* in, float* out, int width, float scale) {
+    const __m128 s = _mm_set1_ps(scale);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+        __m128i lo = _mm_cvtepu16_epi32(v);
+        __m128i hi = _mm_cvtepu16_epi32(_mm_srli_si128(v, 8));
+        _mm_storeu_ps(out + x, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+        _mm_storeu_ps(out + x + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX2
+int u16ToFloatAVX2(const uint16_t* in, float* out, int width, float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+        _mm256_storeu_ps(out + x, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v)), s));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX512
+int u16ToFloatAVX512(const uint16_t* in, float* out, int width, float scale) {
+    const __m512 s = _mm512_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+        _mm512_storeu_ps(out + x, _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepu16_epi32(v)), s));
+    }
+    return x;
+}
+
+/**
+ * Four depths to int32: truncated min(z * scale, 65535), 0 unless 0 < z < inf
+ * (ordered compares, false for NaN)
+ */
+RGBD_TARGET_SSE41
+inline __m128i depthToInt4(__m128 z, __m128 scale) {
+    const __m128 valid = _mm_and_ps(_mm_cmpgt_ps(z, _mm_setzero_ps()),
+                                    _mm_cmplt_ps(z, _mm_set1_ps(std::numeric_limits<float>::infinity())));
+    __m128 scaled = _mm_min_ps(_mm_mul_ps(z, scale), _mm_set1_ps(65535.0f));
+    return _mm_cvttps_epi32(_mm_and_ps(scaled, valid));
+}
+
+RGBD_TARGET_AVX2
+inline __m256i depthToInt8(__m256 z, __m256 scale) {
+    const __m256 valid = _mm256_and_ps(
+        _mm256_cmp_ps(z, _mm256_setzero_ps(), _CMP_GT_OQ),
+        _mm256_cmp_ps(z, _mm256_set1_ps(std::numeric_limits<float>::infinity()), _CMP_LT_OQ));
+    __m256 scaled = _mm256_min_ps(_mm256_mul_ps(z, scale), _mm256_set1_ps(65535.0f));
+    return _mm256_cvttps_epi32(_mm256_and_ps(scaled, valid));
+}
+
+RGBD_TARGET_SSE41
+int depthToU16SSE41(const float* in, uint16_t* out, int width, float scale) {
+    const __m128 s = _mm_set1_ps(scale);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i lo = depthToInt4(_mm_loadu_ps(in + x), s);
+        __m128i hi = depthToInt4(_mm_loadu_ps(in + x + 4), s);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_packus_epi32(lo, hi));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX2
+int depthToU16AVX2(const float* in, uint16_t* out, int width, float scale) {
+    const __m256 s = _mm256_set1_ps(scale);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i lo = depthToInt8(_mm256_loadu_ps(in + x), s);
+        __m256i hi = depthToInt8(_mm256_loadu_ps(in + x + 8), s);
+        // packus interleaves the lanes, the permute restores pixel order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), packed);
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX512
+int depthToU16AVX512(const float* in, uint16_t* out, int width, float scale) {
+    const __m512 s = _mm512_set1_ps(scale);
+    const __m512 zero = _mm512_setzero_ps();
+    const __m512 inf = _mm512_set1_ps(std::numeric_limits<float>::infinity());
+    const __m512 maxValue = _mm512_set1_ps(65535.0f);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512 z = _mm512_loadu_ps(in + x);
+        __mmask16 valid = _mm512_cmp_ps_mask(z, zero, _CMP_GT_OQ) & _mm512_cmp_ps_mask(z, inf, _CMP_LT_OQ);
+        __m512 scaled = _mm512_maskz_min_ps(valid, _mm512_mul_ps(z, s), maxValue);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x),
+                            _mm512_cvtusepi32_epi16(_mm512_cvttps_epi32(scaled)));
+    }
+    return x;
+}
+
+RGBD_TARGET_SSE41
+int maskToU8SSE41(const uint8_t* in, uint8_t* out, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(-1);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_xor_si128(_mm_cmpeq_epi8(v, zero), ones));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX2
+int maskToU8AVX2(const uint8_t* in, uint8_t* out, int width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(-1);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x),
+                            _mm256_xor_si256(_mm256_cmpeq_epi8(v, zero), ones));
+    }
+    return x;
+}
+
+RGBD_TARGET_AVX512
+int maskToU8AVX512(const uint8_t* in, uint8_t* out, int width) {
+    int x = 0;
+    for (; x + 64 <= width; x += 64) {
+        __m512i v = _mm512_loadu_si512(in + x);
+        _mm512_storeu_si512(out + x, _mm512_movm_epi8(_mm512_test_epi8_mask(v, v)));
+    }
+    return x;
+}
+
+#endif // RGBD_X86_SIMD
+
+/**
+ * Run fn(y) for every row, in bands over up to numThreads threads
+ */
+template <typename Fn>
+void forEachRow(int height, size_t rowPixels, int numThreads, Fn&& fn) {
+    if (height <= 0) {
+        return;
+    }
+    size_t pixels = rowPixels * static_cast<size_t>(height);
+    int maxThreads = static_cast<int>(std::min<size_t>(height, std::max<size_t>(1, pixels / kMinPixelsPerThread)));
+    int threads = std::min(resolveThreadCount(numThreads), maxThreads);
+    if (threads <= 1) {
+        for (int y = 0; y < height; ++y) {
+            fn(y);
+        }
+        return;
+    }
+
+    int bands = std::min(height, threads * kBandsPerThread);
+    int rowsPerBand = (height + bands - 1) / bands;
+    bands = (height + rowsPerBand - 1) / rowsPerBand;
+    parallelFor(bands, threads, [&](int band) {
+        int end = std::min(height, (band + 1) * rowsPerBand);
+        for (int y = band * rowsPerBand; y < end; ++y) {
+            fn(y);
+        }
+    });
+}
+
+/**
+ * Source row of output row y
+ */
+inline size_t sourceRow(int y, int height, bool flip) {
+    return static_cast<size_t>(flip ? height - 1 - y : y);
+}
+
+} // namespace
+
+float halfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x3FFu;
+    uint32_t bits;
+    if (exponent == 0x1Fu) {
+        // Inf / NaN; NaNs come out quiet, as with F16C
+        bits = sign | 0x7F800000u | (mantissa << 13) | (mantissa != 0 ? 0x00400000u : 0u);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Subnormal: normalize the mantissa
+        exponent = 113;
+        while ((mantissa & 0x400u) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void rgbaToRgbRow(const uint8_t* rgba, uint8_t* out, int width, bool swapRedBlue, SimdLevel level) {
+    int done = 0;
+#if RGBD_X86_SIMD
+    switch (clampLevel(level)) {
+        case SimdLevel::AVX512: done = rgbaToRgbAVX512(rgba, out, width, swapRedBlue); break;
+        case SimdLevel::AVX2: done = rgbaToRgbAVX2(rgba, out, width, swapRedBlue); break;
+        case SimdLevel::SSE41: done = rgbaToRgbSSE41(rgba, out, width, swapRedBlue); break;
+        default: break;
+    }
+#else
+    (void)level;
+#endif
+    rgbaToRgbScalar(rgba, out, done, width, swapRedBlue);
+}
+
+void swapRedBlueRow(const uint8_t* in, uint8_t* out, int width, SimdLevel level) {
+    int done = 0;
+#if RGBD_X86_SIMD
+    // Pixels straddle 16-byte lanes, a 512-bit form gains nothing over AVX2
+    SimdLevel clamped = clampLevel(level);
+    if (clamped >= SimdLevel::AVX2) {
+        done = swapRedBlueAVX2(in, out, width);
+    } else if (clamped == SimdLevel::SSE41) {
+        done = swapRedBlueSSE41(in, out, width);
+    }
+#else
+    (void)level;
+#endif
+    swapRedBlueScalar(in, out, done, width);
+}
+
+void halfToFloatRow(const uint16_t* in, float* out, int width, SimdLevel level) {
+    int done = 0;
+#if RGBD_X86_SIMD
+    // Below AVX-512 the conversion instruction needs F16C
+    SimdLevel clamped = clampLevel(level);
+    if (clamped == SimdLevel::AVX512) {
+        done = halfToFloatAVX512(in, out, width);
+    } else if (clamped == SimdLevel::AVX2 && hasF16C()) {
+        done = halfToFloatF16C(in, out, width);
+    }
+#else
+    (void)level;
+#endif
+    halfToFloatScalar(in, out, done, width);
+}
+
+void u16ToFloatRow(const uint16_t* in, float* out, int width, float scale, SimdLevel level) {
+    int done = 0;
+#if RGBD_X86_SIMD
+    switch (clampLevel(level)) {
+        case SimdLevel::AVX512: done = u16ToFloatAVX512(in, out, width, scale); break;
+        case SimdLevel::AVX2: done = u16ToFloatAVX2(in, out, width, scale); break;
+        case SimdLevel::SSE41: done = u16ToFloatSSE41(in, out, width, scale); break;
+        default: break;
+    }
+#else
+    (void)level;
+#endif
+    u16ToFloatScalar(in, out, done, width, scale);
+}
+
+void depthToU16Row(const float* in, uint16_t* out, int width, float scale, SimdLevel level) {
+    int done = 0;
+#if RGBD_X86_SIMD
+    switch (clampLevel(level)) {
+        case SimdLevel::AVX512: done = depthToU16AVX512(in, out, width, scale); break;
+        case SimdLevel::AVX2: done = depthToU16AVX2(in, out, width, scale); break;
+        case SimdLevel::SSE41: done = depthToU16SSE41(in, out, width, scale); break;
+        default: break;
+    }
+#else
+    (void)level;
+#endif
+    depthToU16Scalar(in, out, done, width, scale);
+}
+
+void maskToU8Row(const uint8_t* in, uint8_t* out, int width, SimdLevel level) {
+    int done = 0;
+#if RGBD_X86_SIMD
+    switch (clampLevel(level)) {
+        case SimdLevel::AVX512: done = maskToU8AVX512(in, out, width); break;
+        case SimdLevel::AVX2: done = maskToU8AVX2(in, out, width); break;
+        case SimdLevel::SSE41: done = maskToU8SSE41(in, out, width); break;
+        default: break;
+    }
+#else
+    (void)level;
+#endif
+    maskToU8Scalar(in, out, done, width);
+}
+
+void rgbaToRgb(const uint8_t* rgba, uint8_t* out, int width, int height, bool flip,
+               bool swapRedBlue, int numThreads, SimdLevel level) {
+    forEachRow(height, width, numThreads, [&](int y) {
+        rgbaToRgbRow(rgba + sourceRow(y, height, flip) * width * 4,
+                     out + static_cast<size_t>(y) * width * 3, width, swapRedBlue, level);
+    });
+}
+
+void swapRedBlue(const uint8_t* in, uint8_t* out, int width, int height, bool flip,
+                 int numThreads, SimdLevel level) {
+    forEachRow(height, width, numThreads, [&](int y) {
+        swapRedBlueRow(in + sourceRow(y, height, flip) * width * 3,
+                       out + static_cast<size_t>(y) * width * 3, width, level);
+    });
+}
+
+void depthToFloat(const void* in, DepthFormat format, float* out, int width, int height,
+                  bool flip, int numThreads, SimdLevel level) {
+    if (format == DepthFormat::Float32) {
+        copyRows(in, out, static_cast<size_t>(width) * sizeof(float), height, flip, numThreads);
+        return;
+    }
+    const uint16_t* values = static_cast<const uint16_t*>(in);
+    forEachRow(height, width, numThreads, [&](int y) {
+        const uint16_t* row = values + sourceRow(y, height, flip) * width;
+        float* dst = out + static_cast<size_t>(y) * width;
+        if (format == DepthFormat::Float16) {
+            halfToFloatRow(row, dst, width, level);
+        } else {
+            u16ToFloatRow(row, dst, width, 0.001f, level);
+        }
+    });
+}
+
+void depthToU16(const float* in, uint16_t* out, int width, int height, float scale,
+                bool flip, int numThreads, SimdLevel level) {
+    forEachRow(height, width, numThreads, [&](int y) {
+        depthToU16Row(in + sourceRow(y, height, flip) * width,
+                      out + static_cast<size_t>(y) * width, width, scale, level);
+    });
+}
+
+void maskToU8(const uint8_t* in, uint8_t* out, int width, int height, bool flip,
+              int numThreads, SimdLevel level) {
+    forEachRow(height, width, numThreads, [&](int y) {
+        maskToU8Row(in + sourceRow(y, height, flip) * width,
+                    out + static_cast<size_t>(y) * width, width, level);
+    });
+}
+
+void copyRows(const void* in, void* out, size_t rowBytes, int height, bool flip, int numThreads) {
+    const uint8_t* src = static_cast<const uint8_t*>(in);
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    if (!flip && numThreads == 1) {
+        std::memcpy(dst, src, rowBytes * static_cast<size_t>(height));
+        return;
+    }
+    forEachRow(height, rowBytes, numThreads, [&](int y) {
+        std::memcpy(dst + static_cast<size_t>(y) * rowBytes, src + sourceRow(y, height, flip) * rowBytes, rowBytes);
+    });
+}
+
+} // namespace kernels
+} // namespace rgbd
@@ -0,0 +1,182 @@
+#include "tar_writer.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace rgbd {
+namespace io {
+
+namespace {
+
+constexpr size_t kBlockSize = 512;
+constexpr size_t kStreamBuffer = 8 << 20;
+
+/**
+ * Write value as a zero-padded octal number of width - 1 digits plus NUL
+ */
+void writeOctal(char* field, size_t width, uint64_t value) {
+    std::snprintf(field, width, "%0*llo", static_cast<int>(width - 1),
+                  static_cast<unsigned long long>(value));
+}
+
+/**
+ * pax record "<length> <key>=<value>\n", the length counting itself
+ */
+std::string paxRecord(const std::string& key, const std::string& value) {
+    size_t body = key.size() + value.size() + 3;  // ' ', '=', '\n'
+    size_t length = body + 1;
+    while (std::to_string(length).size() + body > length) {
+        length++;
+    }
+    return std::to_string(length) + " " + key + "=" + value + "\n";
+}
+
+} // namespace
+
+TarShardWriter::TarShardWriter(const std::string& directory, const std::string& name,
+                               size_t shardBytes, bool writeIndex)
+    : directory_(directory)
+    , name_(name)
+    , shardBytes_(shardBytes)
+    , writeIndex_(writeIndex) {}
+
+TarShardWriter::~TarShardWriter() {
+    close();
+}
+
+std::string TarShardWriter::shardPath(size_t index) const {
+    char number[16];
+    std::snprintf(number, sizeof(number), "%06zu", index);
+    return directory_ + "/" + name_ + "-" + number + ".tar";
+}
+
+bool TarShardWriter::openShard() {
+    buffer_.resize(kStreamBuffer);
+    file_.rdbuf()->pubsetbuf(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    std::string path = shardPath(shardCount_);
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        std::cerr << "Error: Cannot open tar shard for writing: " << path << std::endl;
+        return false;
+    }
+    shardCount_++;
+    shardSize_ = 0;
+    index_.clear();
+    return true;
+}
+
+bool TarShardWriter::append(const std::vector<TarMember>& members) {
+    RGBD_TRACE_SCOPE("tarAppend");
+    uint64_t sampleBytes = 0;
+    for (const TarMember& member : members) {
+        sampleBytes += kBlockSize + (member.data.size() + kBlockSize - 1) / kBlockSize * kBlockSize;
+    }
+
+    // Samples never straddle shards
+    if (file_.is_open() && shardSize_ > 0 && shardSize_ + sampleBytes > shardBytes_) {
+        if (!close()) {
+            return false;
+        }
+    }
+    if (!file_.is_open() && !openShard()) {
+        return false;
+    }
+
+    for (const TarMember& member : members) {
+        if (!writeMember(member)) {
+            return false;
+        }
+    }
+    return static_cast<bool>(file_);
+}
+
+bool TarShardWriter::writeMember(const TarMember& member) {
+    const std::string& name = member.name;
+    if (name.size() > 100) {
+        // Long name in a pax extended header ahead of the member
+        std::string record = paxRecord("path", name);
+        if (!writeHeader("PaxHeaders/" + name.substr(0, 80), record.size(), 'x')) {
+            return false;
+        }
+        file_.write(record.data(), static_cast<std::streamsize>(record.size()));
+        writePadding(record.size());
+    }
+    if (!writeHeader(name.substr(0, 100), member.data.size(), '0')) {
+        return false;
+    }
+    index_.push_back({name, shardSize_, member.data.size()});
+    file_.write(reinterpret_cast<const char*>(member.data.data()),
+                static_cast<std::streamsize>(member.data.size()));
+    writePadding(member.data.size());
+    return static_cast<bool>(file_);
+}
+
+bool TarShardWriter::writeHeader(const std::string& name, uint64_t size, char type) {
+    char header[kBlockSize];
+    std::memset(header, 0, sizeof(header));
+    std::memcpy(header, name.data(), std::min<size_t>(name.size(), 100));
+    writeOctal(header + 100, 8, 0644);     // mode
+    writeOctal(header + 108, 8, 0);        // uid
+    writeOctal(header + 116, 8, 0);        // gid
+    writeOctal(header + 124, 12, size);    // size
+    writeOctal(header + 136, 12, 0);       // mtime, fixed for reproducible shards
+    header[156] = type;
+    std::memcpy(header + 257, "ustar", 6);
+    std::memcpy(header + 263, "00", 2);
+
+    // Checksum over the header with the checksum field read as spaces
+    std::memset(header + 148, ' ', 8);
+    unsigned int checksum = 0;
+    for (size_t i = 0; i < kBlockSize; ++i) {
+        checksum += static_cast<unsigned char>(header[i]);
+    }
+    std::snprintf(header + 148, 8, "%06o", checksum);
+    header[155] = ' ';
+
+    file_.write(header, kBlockSize);
+    shardSize_ += kBlockSize;
+    return static_cast<bool>(file_);
+}
+
+void TarShardWriter::writePadding(uint64_t size) {
+    static const char zeros[kBlockSize] = {};
+    size_t padding = (kBlockSize - size % kBlockSize) % kBlockSize;
+    file_.write(zeros, static_cast<std::streamsize>(padding));
+    shardSize_ += size + padding;
+}
+
+bool TarShardWriter::close() {
+    if (!file_.is_open()) {
+        return true;
+    }
+
+    // End of archive: two zero blocks
+    static const char zeros[2 * kBlockSize] = {};
+    file_.write(zeros, sizeof(zeros));
+    file_.close();
+    bool ok = !file_.fail();
+    file_.clear();
+    std::string path = shardPath(shardCount_ - 1);
+    if (!ok) {
+        std::cerr << "Error: Failed to write tar shard: " << path << std::endl;
+    }
+
+    if (writeIndex_) {
+        std::string indexPath = path.substr(0, path.size() - 4) + ".idx";
+        std::ofstream index(indexPath);
+        for (const IndexEntry& entry : index_) {
+            index << entry.name << '\t' << entry.offset << '\t' << entry.size << '\n';
+        }
+        if (!index) {
+            std::cerr << "Error: Failed to write tar index: " << indexPath << std::endl;
+            ok = false;
+        }
+    }
+    index_.clear();
+    return ok;
+}
+
+} // namespace io
+} // namespace rgbd
@@ -0,0 +1,292 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rgbd {
+namespace trace {
+
+namespace detail {
+std::atomic<bool> recording{false};
+}
+
+namespace {
+
+// Spans kept per thread / track, beyond that they are counted as dropped
+constexpr size_t kMaxEventsPerLog = 1 << 20;
+
+struct Event {
+    const char* name;
+    int64_t start;
+    int64_t duration;
+};
+
+/**
+ * Spans of one thread or track. Only its owner appends; the mutex is
+ * uncontended except while writeJson() reads it.
+ */
+struct Log {
+    uint32_t id;
+    std::string name;
+    bool gpu = false;
+    bool live = true;  // Owned by a running thread (or a GPU track)
+    std::mutex mutex;
+    std::vector<Event> events;
+    size_t dropped = 0;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Log>> logs;  // Never shrinks: thread_local pointers stay valid,
+                                             // logs of exited threads without spans are reused
+    const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+Log* newLog(const std::string& name, bool gpu) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.logs.emplace_back(new Log());
+    Log* log = reg.logs.back().get();
+    log->id = static_cast<uint32_t>(reg.logs.size());
+    log->name = name;
+    log->gpu = gpu;
+    return log;
+}
+
+/**
+ * Log and name of the calling thread. The log is taken on the first span
+ * only, so naming threads costs nothing while tracing is off.
+ */
+struct ThreadSlot {
+    Log* log = nullptr;
+    std::string name;
+
+    ~ThreadSlot() {
+        if (!log) {
+            return;
+        }
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        std::lock_guard<std::mutex> logLock(log->mutex);
+        log->live = false;
+    }
+};
+
+thread_local ThreadSlot threadSlot;
+
+Log* threadLog() {
+    ThreadSlot& slot = threadSlot;
+    if (slot.log) {
+        return slot.log;
+    }
+
+    // Reuse the log of an exited thread that has nothing to write
+    Registry& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (auto& log : reg.logs) {
+            std::lock_guard<std::mutex> logLock(log->mutex);
+            if (!log->live && log->events.empty() && log->dropped == 0) {
+                log->live = true;
+                log->name = slot.name;
+                slot.log = log.get();
+                return slot.log;
+            }
+        }
+    }
+    slot.log = newLog(slot.name, false);
+    return slot.log;
+}
+
+void append(Log& log, const char* name, int64_t start, int64_t duration) {
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (log.events.size() < kMaxEventsPerLog) {
+        log.events.push_back({name, start, duration});
+    } else {
+        log.dropped++;
+    }
+}
+
+void writeString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+/**
+ * Nanoseconds as the microseconds of the trace format
+ */
+void writeMicros(std::ostream& out, int64_t nanoseconds) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.3f", nanoseconds / 1000.0);
+    out << text;
+}
+
+} // namespace
+
+bool start() {
+    if (!compiledIn()) {
+        std::cerr << "Error: Tracing is compiled out (RGBD_TRACE=OFF)" << std::endl;
+        return false;
+    }
+    Registry& reg = registry();
+    {
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (auto& log : reg.logs) {
+            std::lock_guard<std::mutex> logLock(log->mutex);
+            log->events.clear();
+            log->dropped = 0;
+        }
+    }
+    detail::recording.store(true);
+    return true;
+}
+
+void stop() {
+    detail::recording.store(false);
+}
+
+int64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - registry().origin).count();
+}
+
+void setThreadName(const std::string& name) {
+    if (!compiledIn()) {
+        return;
+    }
+    ThreadSlot& slot = threadSlot;
+    slot.name = name;
+    if (slot.log) {
+        std::lock_guard<std::mutex> lock(slot.log->mutex);
+        slot.log->name = name;
+    }
+}
+
+uint32_t addTrack(const std::string& name) {
+    return newLog(name, true)->id;
+}
+
+void record(const char* name, int64_t start, int64_t duration) {
+    if (enabled()) {
+        append(*threadLog(), name, start, duration);
+    }
+}
+
+void record(uint32_t track, const char* name, int64_t start, int64_t duration) {
+    if (!enabled()) {
+        return;
+    }
+    Log* log = nullptr;
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        if (track == 0 || track > reg.logs.size()) {
+            return;
+        }
+        log = reg.logs[track - 1].get();
+    }
+    append(*log, name, start, duration);
+}
+
+size_t eventCount() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t count = 0;
+    for (auto& log : reg.logs) {
+        std::lock_guard<std::mutex> logLock(log->mutex);
+        count += log->events.size();
+    }
+    return count;
+}
+
+size_t logCount() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    return reg.logs.size();
+}
+
+bool writeJson(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Cannot open trace file for writing: " << path << std::endl;
+        return false;
+    }
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    size_t events = 0, dropped = 0;
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    for (auto& log : reg.logs) {
+        std::lock_guard<std::mutex> logLock(log->mutex);
+        if (log->events.empty()) {
+            continue;
+        }
+        std::string name = !log->name.empty() ? log->name : "thread " + std::to_string(log->id);
+        separator();
+        out << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << log->id << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+        writeString(out, name);
+        out << "}}";
+        // GPU tracks sort after the threads
+        separator();
+        out << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << log->id
+            << ",\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":"
+            << (log->gpu ? 1000 + log->id : log->id) << "}}";
+
+        const char* category = log->gpu ? "gpu" : "cpu";
+        for (const Event& event : log->events) {
+            separator();
+            out << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << log->id << ",\"cat\":\"" << category << "\",\"name\":";
+            writeString(out, event.name);
+            out << ",\"ts\":";
+            writeMicros(out, event.start);
+            out << ",\"dur\":";
+            writeMicros(out, std::max<int64_t>(0, event.duration));
+            out << "}";
+        }
+        events += log->events.size();
+        dropped += log->dropped;
+    }
+    out << "\n]}\n";
+    out.close();
+
+    if (!out) {
+        std::cerr << "Error: Failed to write trace file: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Trace: " << events << " spans written to " << path;
+    if (dropped > 0) {
+        std::cout << " (" << dropped << " dropped)";
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+} // namespace trace
+} // namespace rgbd
@@ -2,50 +2,160 @@
  * RGBD Rerendering - Main Application
  * 
  * Re-renders RGBD images with different focal lengths from the same viewpoint.
- * Uses GPU-accelerated mesh rasterization via OpenGL/EGL.
+ * Uses GPU-accelerated mesh rasterization via OpenGL/EGL, a multithreaded
+ * software rasterizer with --backend cpu, or inverse mapping of the depth
+ * grid with --backend resample.
  */
 
 #include "config.hpp"
+#include "camera_info.hpp"
 #include "image_io.hpp"
 #include "depth_io.hpp"
 #include "depth_mesh.hpp"
 #include "gl_renderer.hpp"
+#include "output_sink.hpp"
+#include "batch_runner.hpp"
+#include "render_server.hpp"
+#include "render_pool.hpp"
+#include "trace.hpp"
 
 #include <iostream>
-#include <iomanip>
-#include <sstream>
+#include <algorithm>
 #include <filesystem>
 #include <chrono>
+#include <csignal>
+#include <memory>
 
 namespace fs = std::filesystem;
 
-int main(int argc, char** argv) {
-    std::cout << "================================================" << std::endl;
-    std::cout << "  RGBD Rerendering with Variable Focal Lengths  " << std::endl;
-    std::cout << "================================================\n" << std::endl;
+/**
+ * Create and initialize the configured rendering backend
+ */
+static std::unique_ptr<rgbd::render::Renderer> createRenderer(const rgbd::app::Config& config) {
+    std::unique_ptr<rgbd::render::Renderer> renderer =
+        rgbd::render::createRenderer(config.backend, config.numThreads);
+    if (auto* glRenderer = dynamic_cast<rgbd::render::GLRenderer*>(renderer.get())) {
+        glRenderer->setShaderCacheDir(config.shaderCacheDir);
+    }
+    if (renderer) {
+        // Before initialize(), so only the needed shader variant is built
+        renderer->setOutputs(config.getOutputSelection());
+    }
+    if (!renderer || !renderer->initialize(config.gpuDevice)) {
+        std::cerr << "Error: Failed to initialize renderer" << std::endl;
+        return nullptr;
+    }
+    std::cout << renderer->getInfo() << std::endl;
+    return renderer;
+}
+
+/**
+ * Create the GL context pool of --gl_contexts / --gpus
+ */
+static std::unique_ptr<rgbd::render::RenderPool> createRenderPool(const rgbd::app::Config& config) {
+    rgbd::render::RenderPoolOptions options;
+    options.devices = config.getPoolDevices();
+    options.contextsPerDevice = config.glContexts;
+    options.pipelineDepth = config.pipelineDepth;
+    options.shaderCacheDir = config.shaderCacheDir;
+    options.outputs = config.getOutputSelection();
     
-    // Parse command line arguments
-    rgbd::app::Config config;
-    if (!rgbd::app::parseArgs(argc, argv, config)) {
-        return 1;
+    std::unique_ptr<rgbd::render::RenderPool> pool(new rgbd::render::RenderPool());
+    if (!pool->initialize(options)) {
+        std::cerr << "Error: Failed to initialize render pool" << std::endl;
+        return nullptr;
     }
+    std::cout << pool->getInfo() << std::endl;
+    return pool;
+}
+
+/**
+ * Process a manifest / directory of frames with one renderer (or context pool)
+ */
+static int runMultiFrame(const rgbd::app::Config& config) {
+    auto startTime = std::chrono::high_resolution_clock::now();
     
-    // Validate configuration
-    std::string error = config.validate();
-    if (!error.empty()) {
-        std::cerr << "Error: " << error << std::endl;
-        rgbd::app::printUsage(argv[0]);
+    std::vector<rgbd::app::FrameSpec> frames;
+    if (!config.manifestPath.empty() && !rgbd::app::loadManifest(config.manifestPath, frames)) {
         return 1;
     }
+    if (!config.inputDir.empty() && !rgbd::app::scanFrames(config.inputDir, frames)) {
+        return 1;
+    }
+    if (frames.empty()) {
+        std::cerr << "Error: No frames to process" << std::endl;
+        return 1;
+    }
+    std::cout << "Frames: " << frames.size() << std::endl;
     
-    config.print();
+    // Context, shaders and framebuffers are created once for all frames
+    rgbd::app::OutputSink sink(config, config.encodeThreads);
+    rgbd::app::BatchRunner runner(config);
+    if (config.usesRenderPool()) {
+        std::unique_ptr<rgbd::render::RenderPool> pool = createRenderPool(config);
+        if (!pool) {
+            return 1;
+        }
+        runner.run(*pool, frames, sink);
+        pool->shutdown();
+    } else {
+        std::unique_ptr<rgbd::render::Renderer> renderer = createRenderer(config);
+        if (!renderer) {
+            return 1;
+        }
+        runner.run(*renderer, frames, sink);
+        renderer->cleanup();
+    }
+    std::cout << "\nWaiting for output files..." << std::endl;
+    sink.finish();
     
-    // Create output directory
-    if (!fs::exists(config.outputDir)) {
-        fs::create_directories(config.outputDir);
-        std::cout << "Created output directory: " << config.outputDir << std::endl;
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count() / 1000.0;
+    
+    std::cout << "\n================================================" << std::endl;
+    std::cout << "  Done! Processed " << runner.getProcessedCount() << " frames";
+    if (runner.getFailedCount() > 0) {
+        std::cout << ", " << runner.getFailedCount() << " failed";
+    }
+    std::cout << std::endl;
+    std::cout << "  Total time: " << seconds << " seconds ("
+              << seconds / std::max<size_t>(1, runner.getProcessedCount()) << " s/frame)" << std::endl;
+    std::cout << "  Output: " << config.outputDir << std::endl;
+    std::cout << "================================================" << std::endl;
+    
+    return runner.getFailedCount() == 0 ? 0 : 1;
+}
+
+/**
+ * SIGTERM / SIGINT in server mode: finish the received requests, then exit
+ */
+static void handleStopSignal(int) {
+    rgbd::app::RenderServer::requestStop();
+}
+
+/**
+ * Serve render requests on a Unix domain socket until stopped
+ */
+static int runServer(const rgbd::app::Config& config) {
+    std::unique_ptr<rgbd::render::Renderer> renderer = createRenderer(config);
+    if (!renderer) {
+        return 1;
     }
     
+    std::signal(SIGTERM, handleStopSignal);
+    std::signal(SIGINT, handleStopSignal);
+    
+    rgbd::app::RenderServer server(config);
+    bool ok = server.run(*renderer, config.serveSocket);
+    
+    renderer->cleanup();
+    return ok ? 0 : 1;
+}
+
+/**
+ * Re-render one RGBD image at every focal scale
+ */
+static int runSingleFrame(const rgbd::app::Config& config) {
     auto startTime = std::chrono::high_resolution_clock::now();
     
     // Load RGB image
@@ -73,144 +183,108 @@ int main(int argc, char** argv) {
     }
     
     // Setup intrinsics
-    rgbd::Intrinsics sourceK;
-    sourceK.fx = config.fx;
-    sourceK.fy = config.fy;
-    sourceK.cx = (config.cx >= 0) ? config.cx : static_cast<float>(rgb.cols) / 2.0f;
-    sourceK.cy = (config.cy >= 0) ? config.cy : static_cast<float>(rgb.rows) / 2.0f;
-    sourceK.width = rgb.cols;
-    sourceK.height = rgb.rows;
+    rgbd::Intrinsics sourceK = config.getSourceIntrinsics(rgb.cols, rgb.rows);
+    if (!config.cameraInfoPath.empty()) {
+        if (!rgbd::io::loadCameraInfo(config.cameraInfoPath, sourceK)) {
+            return 1;
+        }
+        // Camera info may describe another resolution than the stored images
+        if (sourceK.width != rgb.cols || sourceK.height != rgb.rows) {
+            sourceK = sourceK.withResolution(rgb.cols, rgb.rows);
+        }
+    }
     
     std::cout << "  Intrinsics: fx=" << sourceK.fx << ", fy=" << sourceK.fy
               << ", cx=" << sourceK.cx << ", cy=" << sourceK.cy << std::endl;
+    if (!sourceK.isPinhole()) {
+        const rgbd::Distortion& d = sourceK.distortion;
+        std::cout << "  Distortion: k1=" << d.k1 << ", k2=" << d.k2 << ", p1=" << d.p1
+                  << ", p2=" << d.p2 << ", k3=" << d.k3 << std::endl;
+    }
     
-    // Build mesh
-    std::cout << "\n[3/5] Building mesh from depth..." << std::endl;
+    // Build mesh (grid mode and the resample backend work on the depth map instead)
+    bool gridMode = config.usesDepthGrid();
     rgbd::mesh::DepthMesh depthMesh;
-    if (!depthMesh.build(rgb, depth, sourceK, config.getThresholds())) {
-        std::cerr << "Error: Failed to build mesh" << std::endl;
-        return 1;
+    if (gridMode) {
+        std::cout << "\n[3/5] Skipping CPU mesh (depth grid)" << std::endl;
+    } else {
+        std::cout << "\n[3/5] Building mesh from depth..." << std::endl;
+        depthMesh.setNumThreads(config.numThreads);
+        depthMesh.setVertexLayout(config.getVertexLayout());
+        depthMesh.setIndexMode(config.getIndexMode());
+        depthMesh.setAdaptive(config.getAdaptiveOptions());
+        if (!depthMesh.build(rgb, depth, sourceK, config.getThresholds())) {
+            std::cerr << "Error: Failed to build mesh" << std::endl;
+            return 1;
+        }
+        
+        size_t numVerts, numTris;
+        float minZ, maxZ;
+        depthMesh.getStats(numVerts, numTris, minZ, maxZ);
+        std::cout << "  Vertices: " << numVerts << std::endl;
+        std::cout << "  Triangles: " << numTris << std::endl;
+        std::cout << "  Depth range: [" << minZ << ", " << maxZ << "] m" << std::endl;
     }
     
-    size_t numVerts, numTris;
-    float minZ, maxZ;
-    depthMesh.getStats(numVerts, numTris, minZ, maxZ);
-    std::cout << "  Vertices: " << numVerts << std::endl;
-    std::cout << "  Triangles: " << numTris << std::endl;
-    std::cout << "  Depth range: [" << minZ << ", " << maxZ << "] m" << std::endl;
+    // Upload geometry and texture
+    auto upload = [&](rgbd::render::Renderer& renderer) {
+        if (gridMode) {
+            if (auto* glRenderer = dynamic_cast<rgbd::render::GLRenderer*>(&renderer)) {
+                glRenderer->setRenderMode(rgbd::render::RenderMode::ImplicitGrid);
+            }
+            if (!renderer.uploadDepth(depth, config.getThresholds())) {
+                std::cerr << "Error: Failed to upload depth grid" << std::endl;
+                return false;
+            }
+        } else if (!renderer.uploadMesh(depthMesh.getMesh())) {
+            std::cerr << "Error: Failed to upload mesh" << std::endl;
+            return false;
+        }
+        
+        const cv::Mat& texture = gridMode ? rgb : depthMesh.getTexture();
+        if (!renderer.uploadTexture(texture)) {
+            std::cerr << "Error: Failed to upload texture" << std::endl;
+            return false;
+        }
+        return true;
+    };
     
     // Initialize renderer
     std::cout << "\n[4/5] Initializing renderer..." << std::endl;
-    rgbd::render::GLRenderer renderer;
-    if (!renderer.initialize(config.gpuDevice)) {
-        std::cerr << "Error: Failed to initialize renderer" << std::endl;
-        return 1;
-    }
-    std::cout << renderer.getGLInfo() << std::endl;
-    
-    // Upload mesh and texture
-    if (!renderer.uploadMesh(depthMesh.getMesh())) {
-        std::cerr << "Error: Failed to upload mesh" << std::endl;
-        return 1;
-    }
-    
-    if (!renderer.uploadTexture(depthMesh.getTexture())) {
-        std::cerr << "Error: Failed to upload texture" << std::endl;
-        return 1;
+    std::unique_ptr<rgbd::render::Renderer> renderer;
+    std::unique_ptr<rgbd::render::RenderPool> pool;
+    if (config.usesRenderPool()) {
+        pool = createRenderPool(config);
+        if (!pool) {
+            return 1;
+        }
+    } else {
+        renderer = createRenderer(config);
+        if (!renderer || !upload(*renderer)) {
+            return 1;
+        }
     }
     
     // Render with different focal lengths
     std::cout << "\n[5/5] Rendering with different focal lengths..." << std::endl;
     
-    int outputW = (config.outputWidth > 0) ? config.outputWidth : sourceK.width;
-    int outputH = (config.outputHeight > 0) ? config.outputHeight : sourceK.height;
+    // Files are encoded on background threads while rendering continues
+    rgbd::app::OutputSink sink(config, config.encodeThreads);
+    std::cout << "  Encoder threads: " << sink.getThreadCount() << std::endl;
     
-    for (size_t i = 0; i < config.focalScales.size(); ++i) {
-        float scale = config.focalScales[i];
-        
-        std::cout << "\n  Processing scale " << scale << " (" << (i + 1) 
-                  << "/" << config.focalScales.size() << ")..." << std::endl;
-        
-        // Create target intrinsics
-        rgbd::Intrinsics targetK = sourceK;
-        targetK.fx = sourceK.fx * scale;
-        targetK.fy = sourceK.fy * scale;
-        targetK.width = outputW;
-        targetK.height = outputH;
-        
-        // Adjust principal point for resolution change
-        if (outputW != sourceK.width || outputH != sourceK.height) {
-            targetK.cx = sourceK.cx * outputW / sourceK.width;
-            targetK.cy = sourceK.cy * outputH / sourceK.height;
-        }
-        
-        std::cout << "    Target: fx=" << targetK.fx << ", fy=" << targetK.fy
-                  << ", size=" << targetK.width << "x" << targetK.height << std::endl;
-        
-        // Render
-        rgbd::RenderOutput output;
-        if (!renderer.render(sourceK, targetK, config.nearPlane, config.farPlane, output)) {
-            std::cerr << "    Error: Rendering failed" << std::endl;
-            continue;
-        }
-        
-        // Generate output filenames
-        std::ostringstream prefix;
-        prefix << std::fixed << std::setprecision(2) << "scale_" << scale;
-        std::string baseName = prefix.str();
-        
-        // Save RGB
-        std::string rgbPath = config.outputDir + "/" + baseName + "_rgb.png";
-        if (!rgbd::io::saveRGB(rgbPath, output.rgb, output.width, output.height)) {
-            std::cerr << "    Warning: Failed to save RGB" << std::endl;
-        } else {
-            std::cout << "    Saved: " << rgbPath << std::endl;
-        }
-        
-        // Save depth (EXR)
-        if (config.saveExr) {
-            std::string depthPath = config.outputDir + "/" + baseName + "_depth.exr";
-            if (!rgbd::io::saveDepthEXR(depthPath, output.depth, output.width, output.height)) {
-                // Fallback to TIFF if EXR not available
-                std::string tiffPath = config.outputDir + "/" + baseName + "_depth.tiff";
-                std::cout << "    Warning: EXR not available, saving as TIFF" << std::endl;
-            } else {
-                std::cout << "    Saved: " << depthPath << std::endl;
-            }
-        }
-        
-        // Save depth (PNG - 16-bit)
-        if (config.savePng) {
-            std::string depthPngPath = config.outputDir + "/" + baseName + "_depth.png";
-            if (!rgbd::io::saveDepthPNG(depthPngPath, output.depth, 
-                                        output.width, output.height, 1000.0f)) {
-                std::cerr << "    Warning: Failed to save depth PNG" << std::endl;
-            } else {
-                std::cout << "    Saved: " << depthPngPath << std::endl;
-            }
-        }
-        
-        // Save depth (NPY)
-        if (config.saveNpy) {
-            std::string npyPath = config.outputDir + "/" + baseName + "_depth.npy";
-            if (!rgbd::io::saveDepthNPY(npyPath, output.depth, output.width, output.height)) {
-                std::cerr << "    Warning: Failed to save depth NPY" << std::endl;
-            } else {
-                std::cout << "    Saved: " << npyPath << std::endl;
-            }
-        }
-        
-        // Save mask
-        std::string maskPath = config.outputDir + "/" + baseName + "_mask.png";
-        if (!rgbd::io::saveMask(maskPath, output.mask, output.width, output.height)) {
-            std::cerr << "    Warning: Failed to save mask" << std::endl;
-        } else {
-            std::cout << "    Saved: " << maskPath << std::endl;
-        }
+    bool rendered;
+    if (pool) {
+        // Uploaded once, scales spread over the contexts of one device
+        rendered = rgbd::app::renderFocalScales(*pool, upload, sourceK, config, sink, "");
+        pool->shutdown();
+    } else {
+        rendered = rgbd::app::renderFocalScales(*renderer, sourceK, config, sink, "");
+        renderer->cleanup();
     }
     
-    // Cleanup
-    renderer.cleanup();
+    // Wait for the remaining files and report failures
+    std::cout << "\nWaiting for output files..." << std::endl;
+    sink.finish();
     
     auto endTime = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
@@ -221,5 +295,63 @@ int main(int argc, char** argv) {
     std::cout << "  Output: " << config.outputDir << std::endl;
     std::cout << "================================================" << std::endl;
     
-    return 0;
+    return rendered ? 0 : 1;
+}
+
+/**
+ * Run the configured mode
+ */
+static int run(const rgbd::app::Config& config) {
+    if (config.isServer()) {
+        return runServer(config);
+    }
+    
+    // Create output directory
+    if (!fs::exists(config.outputDir)) {
+        fs::create_directories(config.outputDir);
+        std::cout << "Created output directory: " << config.outputDir << std::endl;
+    }
+    
+    if (config.isMultiFrame()) {
+        return runMultiFrame(config);
+    }
+    return runSingleFrame(config);
+}
+
+int main(int argc, char** argv) {
+    std::cout << "================================================" << std::endl;
+    std::cout << "  RGBD Rerendering with Variable Focal Lengths  " << std::endl;
+    std::cout << "================================================\n" << std::endl;
+    
+    // Parse command line arguments
+    rgbd::app::Config config;
+    if (!rgbd::app::parseArgs(argc, argv, config)) {
+        return 1;
+    }
+    
+    // Validate configuration
+    std::string error = config.validate();
+    if (!error.empty()) {
+        std::cerr << "Error: " << error << std::endl;
+        rgbd::app::printUsage(argv[0]);
+        return 1;
+    }
+    
+    config.print();
+    
+    // Spans of every stage until the run ends
+    const bool tracing = !config.tracePath.empty() && rgbd::trace::start();
+    if (tracing) {
+        rgbd::trace::setThreadName("main");
+    }
+    
+    int status = run(config);
+    
+    if (tracing) {
+        rgbd::trace::stop();
+        if (!rgbd::trace::writeJson(config.tracePath)) {
+            status = 1;
+        }
+    }
+    return status;
 }
@@ -0,0 +1,363 @@
+#include "mesh_generator.hpp"
+#include "edge_mask.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace rgbd {
+namespace mesh {
+
+namespace {
+
+// Triangle bits of a single-quad leaf, same split as the full grid
+constexpr uint8_t kUpper = 1 << 0;  // v00, v10, v11
+constexpr uint8_t kLower = 1 << 1;  // v00, v11, v01
+
+/**
+ * Quadtree leaf: s x s quads with corner pixel (x, y)
+ * Leaves of one quad keep the triangles the full grid would emit.
+ */
+struct Leaf {
+    int x, y, s;
+    uint8_t tris;
+};
+
+/**
+ * Triangle corner in source pixel coordinates
+ */
+struct Corner {
+    int x, y;
+    float z;
+};
+
+/**
+ * Errors of pixel (qx, qy) with true depth z when covered by a triangle
+ *
+ * The triangle carries each corner's texel, so the texel of q is drawn at
+ * the triangle point with q's 2D barycentrics; projecting that point back
+ * to the source image gives sum(l_i z_i c_i) / sum(l_i z_i). Rays of the
+ * target camera are those of the source, so a source offset scales by the
+ * focal ratio in the target. The rendered depth on the ray of q follows
+ * from the affine inverse depth over the triangle.
+ * @return false if q lies outside the triangle (or it is degenerate)
+ */
+bool triangleError(const Corner& a, const Corner& b, const Corner& c,
+                   float qx, float qy, float z, float& errorPx, float& depthError) {
+    float det = static_cast<float>((b.y - c.y) * (a.x - c.x) + (c.x - b.x) * (a.y - c.y));
+    if (det == 0.0f) {
+        return false;
+    }
+    float l0 = ((b.y - c.y) * (qx - c.x) + (c.x - b.x) * (qy - c.y)) / det;
+    float l1 = ((c.y - a.y) * (qx - c.x) + (a.x - c.x) * (qy - c.y)) / det;
+    float l2 = 1.0f - l0 - l1;
+    const float eps = -1e-5f;
+    if (l0 < eps || l1 < eps || l2 < eps) {
+        return false;
+    }
+
+    float w0 = l0 * a.z, w1 = l1 * b.z, w2 = l2 * c.z;
+    float w = w0 + w1 + w2;
+    float dx = (w0 * (a.x - qx) + w1 * (b.x - qx) + w2 * (c.x - qx)) / w;
+    float dy = (w0 * (a.y - qy) + w1 * (b.y - qy) + w2 * (c.y - qy)) / w;
+    errorPx = std::sqrt(dx * dx + dy * dy);
+
+    float rendered = 1.0f / (l0 / a.z + l1 / b.z + l2 / c.z);
+    depthError = std::abs(rendered - z) / z;
+    return true;
+}
+
+} // namespace
+
+Mesh MeshGenerator::generateAdaptive(const cv::Mat& depth, const Intrinsics& intrinsics,
+                                     const cv::Mat& validMask) {
+    Mesh mesh;
+    mesh.layout = layout_;
+    report_ = AdaptiveReport();
+
+    const int H = depth.rows;
+    const int W = depth.cols;
+    const int numThreads = resolveThreadCount(numThreads_);
+    const float errorScale = std::max(adaptive_.maxFocalScale, 1e-6f);
+
+    int rootSize = 1;
+    while (rootSize * 2 <= std::max(1, adaptive_.maxBlockSize)) {
+        rootSize *= 2;
+    }
+
+    // Per-quad triangles with exactly the rules of the full grid, plus a
+    // summed-area table of fully valid quads for O(1) block checks
+    const int QW = W - 1;
+    const int QH = H - 1;
+    if (QW < 1 || QH < 1) {
+        return mesh;
+    }
+    cv::Mat edges = computeEdgeMask(depth, thresholds_, activeSimdLevel(), numThreads);
+    std::vector<uint8_t> quadTris(static_cast<size_t>(QW) * QH, 0);
+    std::vector<uint32_t> fullSum(static_cast<size_t>(QW + 1) * (QH + 1), 0);
+
+    parallelFor(QH, numThreads, [&](int v) {
+        const uint8_t* e0 = edges.ptr<uint8_t>(v);
+        const uint8_t* e1 = edges.ptr<uint8_t>(v + 1);
+        const uint8_t* m0 = validMask.empty() ? nullptr : validMask.ptr<uint8_t>(v);
+        const uint8_t* m1 = validMask.empty() ? nullptr : validMask.ptr<uint8_t>(v + 1);
+        uint8_t* out = &quadTris[static_cast<size_t>(v) * QW];
+        for (int u = 0; u < QW; ++u) {
+            uint8_t tri = 0;
+            if (upperTriangleUnbroken(e0, u)) tri |= kUpper;
+            if (lowerTriangleUnbroken(e0, e1, u)) tri |= kLower;
+            if (tri && m0) {
+                if (!(m0[u] > 0 && m1[u + 1] > 0)) tri = 0;
+                if (!(m0[u + 1] > 0)) tri &= ~kUpper;
+                if (!(m1[u] > 0)) tri &= ~kLower;
+            }
+            out[u] = tri;
+        }
+    });
+
+    for (int v = 0; v < QH; ++v) {
+        uint32_t rowSum = 0;
+        for (int u = 0; u < QW; ++u) {
+            const uint8_t tri = quadTris[static_cast<size_t>(v) * QW + u];
+            rowSum += (tri == (kUpper | kLower)) ? 1 : 0;
+            report_.gridTriangles += ((tri & kUpper) ? 1 : 0) + ((tri & kLower) ? 1 : 0);
+            fullSum[static_cast<size_t>(v + 1) * (QW + 1) + u + 1] =
+                fullSum[static_cast<size_t>(v) * (QW + 1) + u + 1] + rowSum;
+        }
+    }
+
+    auto z = [&](int x, int y) { return depth.ptr<float>(y)[x]; };
+
+    // A block may merge if it has no broken or missing triangle and its two
+    // coarse triangles keep every pixel within the error bounds
+    auto mergeable = [&](int x0, int y0, int s) {
+        int x1 = x0 + s;
+        int y1 = y0 + s;
+        if (x1 > QW || y1 > QH) {
+            return false;
+        }
+        auto sum = [&](int u, int v) { return fullSum[static_cast<size_t>(v) * (QW + 1) + u]; };
+        if (sum(x1, y1) - sum(x0, y1) - sum(x1, y0) + sum(x0, y0) != static_cast<uint32_t>(s * s)) {
+            return false;
+        }
+
+        const Corner c00 = { x0, y0, z(x0, y0) };
+        const Corner c10 = { x1, y0, z(x1, y0) };
+        const Corner c11 = { x1, y1, z(x1, y1) };
+        const Corner c01 = { x0, y1, z(x0, y1) };
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                float errorPx = 0.0f, depthError = 0.0f;
+                bool upper = (x - x0) >= (y - y0);
+                if (upper) {
+                    triangleError(c00, c10, c11, static_cast<float>(x), static_cast<float>(y),
+                                  z(x, y), errorPx, depthError);
+                } else {
+                    triangleError(c00, c11, c01, static_cast<float>(x), static_cast<float>(y),
+                                  z(x, y), errorPx, depthError);
+                }
+                if (errorPx * errorScale > adaptive_.maxErrorPx ||
+                    depthError > adaptive_.maxDepthError) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    // Pass 1: top-down subdivision of every root block
+    const int rootsX = (QW + rootSize - 1) / rootSize;
+    const int rootsY = (QH + rootSize - 1) / rootSize;
+    const int numRoots = rootsX * rootsY;
+    std::vector<std::vector<Leaf>> rootLeaves(numRoots);
+
+    parallelFor(numRoots, numThreads, [&](int r) {
+        std::vector<Leaf>& leaves = rootLeaves[r];
+        std::vector<Leaf> stack = { { (r % rootsX) * rootSize, (r / rootsX) * rootSize, rootSize, 0 } };
+        while (!stack.empty()) {
+            Leaf block = stack.back();
+            stack.pop_back();
+            if (block.x >= QW || block.y >= QH) {
+                continue;
+            }
+            if (block.s == 1) {
+                block.tris = quadTris[static_cast<size_t>(block.y) * QW + block.x];
+                if (block.tris) {
+                    leaves.push_back(block);
+                }
+                continue;
+            }
+            if (mergeable(block.x, block.y, block.s)) {
+                leaves.push_back(block);
+                continue;
+            }
+            // Children pushed in reverse so they are visited in row-major order
+            int h = block.s / 2;
+            stack.push_back({ block.x + h, block.y + h, h, 0 });
+            stack.push_back({ block.x, block.y + h, h, 0 });
+            stack.push_back({ block.x + h, block.y, h, 0 });
+            stack.push_back({ block.x, block.y, h, 0 });
+        }
+    });
+
+    // Pass 2: mark the pixels used as triangle corners, then number them in
+    // row-major order
+    std::vector<int32_t> vertexIndex(static_cast<size_t>(W) * H, -1);
+    auto mark = [&](int x, int y) { vertexIndex[static_cast<size_t>(y) * W + x] = 0; };
+    for (const std::vector<Leaf>& leaves : rootLeaves) {
+        for (const Leaf& leaf : leaves) {
+            int x1 = leaf.x + leaf.s;
+            int y1 = leaf.y + leaf.s;
+            bool upper = leaf.s > 1 || (leaf.tris & kUpper);
+            bool lower = leaf.s > 1 || (leaf.tris & kLower);
+            mark(leaf.x, leaf.y);
+            mark(x1, y1);
+            if (upper) mark(x1, leaf.y);
+            if (lower) mark(leaf.x, y1);
+
+            report_.blocks++;
+            report_.mergedBlocks += leaf.s > 1 ? 1 : 0;
+        }
+    }
+
+    size_t numVertices = 0;
+    std::array<float, 6> bounds = {{ std::numeric_limits<float>::infinity(),
+                                     std::numeric_limits<float>::infinity(),
+                                     std::numeric_limits<float>::infinity(),
+                                     -std::numeric_limits<float>::infinity(),
+                                     -std::numeric_limits<float>::infinity(),
+                                     -std::numeric_limits<float>::infinity() }};
+    for (int y = 0; y < H; ++y) {
+        for (int x = 0; x < W; ++x) {
+            int32_t& index = vertexIndex[static_cast<size_t>(y) * W + x];
+            if (index < 0) continue;
+            index = static_cast<int32_t>(numVertices++);
+            if (layout_ == VertexLayout::Quantized16) {
+                Vertex p = backproject(x, y, z(x, y), intrinsics);
+                bounds = {{ std::min(bounds[0], p.x), std::min(bounds[1], p.y), std::min(bounds[2], p.z),
+                            std::max(bounds[3], p.x), std::max(bounds[4], p.y), std::max(bounds[5], p.z) }};
+            }
+        }
+    }
+
+    switch (layout_) {
+        case VertexLayout::DepthPixel: mesh.depthVertices.resize(numVertices); break;
+        case VertexLayout::Quantized16: mesh.quantizedVertices.resize(numVertices); break;
+        default: mesh.vertices.resize(numVertices); break;
+    }
+    std::array<float, 3> invScale = {{ 0.0f, 0.0f, 0.0f }};
+    if (layout_ == VertexLayout::Quantized16 && numVertices > 0) {
+        invScale = setQuantizationRange(mesh, bounds);
+    }
+
+    parallelFor(H, numThreads, [&](int y) {
+        for (int x = 0; x < W; ++x) {
+            int32_t index = vertexIndex[static_cast<size_t>(y) * W + x];
+            if (index >= 0) {
+                storeVertex(mesh, static_cast<size_t>(index), x, y, z(x, y), intrinsics, invScale);
+            }
+        }
+    });
+
+    // Pass 3: triangulate every leaf and measure the error of what is emitted.
+    // Merged blocks are fanned from their top-left corner over all marked
+    // pixels on their border, walking top, right, bottom and left edges.
+    // Where a neighbour is finer, the fan triangles on the top and left edges
+    // are degenerate in the image but close the T-junction exactly.
+    struct RootOutput {
+        std::vector<Triangle> triangles;
+        double errorSum = 0.0, depthErrorSum = 0.0;
+        size_t samples = 0;
+        float maxErrorPx = 0.0f, maxDepthError = 0.0f;
+    };
+    std::vector<RootOutput> outputs(numRoots);
+
+    parallelFor(numRoots, numThreads, [&](int r) {
+        RootOutput& out = outputs[r];
+        std::vector<Corner> ring;
+
+        auto emit = [&](const Corner& a, const Corner& b, const Corner& c) {
+            out.triangles.emplace_back(vertexIndex[static_cast<size_t>(a.y) * W + a.x],
+                                       vertexIndex[static_cast<size_t>(b.y) * W + b.x],
+                                       vertexIndex[static_cast<size_t>(c.y) * W + c.x]);
+
+            // Pixels of the triangle (shared edges are counted on both sides)
+            int xMin = std::min({ a.x, b.x, c.x }), xMax = std::max({ a.x, b.x, c.x });
+            int yMin = std::min({ a.y, b.y, c.y }), yMax = std::max({ a.y, b.y, c.y });
+            for (int y = yMin; y <= yMax; ++y) {
+                for (int x = xMin; x <= xMax; ++x) {
+                    float errorPx = 0.0f, depthError = 0.0f;
+                    if (!triangleError(a, b, c, static_cast<float>(x), static_cast<float>(y),
+                                       z(x, y), errorPx, depthError)) {
+                        continue;
+                    }
+                    errorPx *= errorScale;
+                    out.maxErrorPx = std::max(out.maxErrorPx, errorPx);
+                    out.maxDepthError = std::max(out.maxDepthError, depthError);
+                    out.errorSum += errorPx;
+                    out.depthErrorSum += depthError;
+                    out.samples++;
+                }
+            }
+        };
+        auto corner = [&](int x, int y) { return Corner{ x, y, z(x, y) }; };
+        auto marked = [&](int x, int y) { return vertexIndex[static_cast<size_t>(y) * W + x] >= 0; };
+
+        for (const Leaf& leaf : rootLeaves[r]) {
+            int x0 = leaf.x, y0 = leaf.y;
+            int x1 = x0 + leaf.s, y1 = y0 + leaf.s;
+
+            if (leaf.s == 1) {
+                if (leaf.tris & kUpper) emit(corner(x0, y0), corner(x1, y0), corner(x1, y1));
+                if (leaf.tris & kLower) emit(corner(x0, y0), corner(x1, y1), corner(x0, y1));
+                continue;
+            }
+
+            ring.clear();
+            for (int x = x0; x < x1; ++x) if (marked(x, y0)) ring.push_back(corner(x, y0));
+            for (int y = y0; y < y1; ++y) if (marked(x1, y)) ring.push_back(corner(x1, y));
+            for (int x = x1; x > x0; --x) if (marked(x, y1)) ring.push_back(corner(x, y1));
+            for (int y = y1; y > y0; --y) if (marked(x0, y)) ring.push_back(corner(x0, y));
+
+            for (size_t k = 1; k + 1 < ring.size(); ++k) {
+                emit(ring[0], ring[k], ring[k + 1]);
+            }
+        }
+    });
+
+    size_t numTriangles = 0;
+    for (const RootOutput& out : outputs) {
+        numTriangles += out.triangles.size();
+    }
+    mesh.triangles.reserve(numTriangles);
+
+    double errorSum = 0.0, depthErrorSum = 0.0;
+    size_t samples = 0;
+    for (const RootOutput& out : outputs) {
+        mesh.triangles.insert(mesh.triangles.end(), out.triangles.begin(), out.triangles.end());
+        errorSum += out.errorSum;
+        depthErrorSum += out.depthErrorSum;
+        samples += out.samples;
+        report_.maxErrorPx = std::max(report_.maxErrorPx, out.maxErrorPx);
+        report_.maxDepthError = std::max(report_.maxDepthError, out.maxDepthError);
+    }
+    report_.triangles = numTriangles;
+    if (samples > 0) {
+        report_.meanErrorPx = static_cast<float>(errorSum / samples);
+        report_.meanDepthError = static_cast<float>(depthErrorSum / samples);
+    }
+
+    std::cout << "Generated adaptive mesh: " << mesh.numVertices() << " vertices, "
+              << report_.triangles << " triangles (grid: " << report_.gridTriangles << ", "
+              << report_.blocks << " blocks, " << report_.mergedBlocks << " merged)" << std::endl;
+    std::cout << "  Reprojection error: max " << report_.maxErrorPx << " px, mean "
+              << report_.meanErrorPx << " px; depth error: max " << report_.maxDepthError * 100.0f
+              << "%, mean " << report_.meanDepthError * 100.0f << "%" << std::endl;
+
+    return mesh;
+}
+
+} // namespace mesh
+} // namespace rgbd
@@ -0,0 +1,117 @@
+#include "camera_model.hpp"
+#include "trace.hpp"
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+
+namespace rgbd {
+namespace mesh {
+
+namespace {
+
+constexpr int kUndistortIterations = 20;
+constexpr double kUndistortTolerance = 1e-10;  // Squared normalized-coordinate step
+
+std::atomic<size_t> g_buildCount{0};
+
+bool sameCamera(const RayTable& table, const Intrinsics& K, int width, int height) {
+    const Intrinsics& T = table.intrinsics();
+    return table.width() == width && table.height() == height &&
+           T.fx == K.fx && T.fy == K.fy && T.cx == K.cx && T.cy == K.cy &&
+           T.distortion == K.distortion;
+}
+
+} // namespace
+
+bool undistortPoint(const Distortion& distortion, float xd, float yd, float& x, float& y) {
+    const double k1 = distortion.k1, k2 = distortion.k2, k3 = distortion.k3;
+    const double p1 = distortion.p1, p2 = distortion.p2;
+    double ux = xd, uy = yd;
+    bool converged = false;
+    for (int i = 0; i < kUndistortIterations && !converged; ++i) {
+        double r2 = ux * ux + uy * uy;
+        double radial = 1.0 + r2 * (k1 + r2 * (k2 + r2 * k3));
+        double dx = 2.0 * p1 * ux * uy + p2 * (r2 + 2.0 * ux * ux);
+        double dy = p1 * (r2 + 2.0 * uy * uy) + 2.0 * p2 * ux * uy;
+        if (!(radial > 0.0)) {
+            break;
+        }
+        double nx = (xd - dx) / radial;
+        double ny = (yd - dy) / radial;
+        converged = (nx - ux) * (nx - ux) + (ny - uy) * (ny - uy) < kUndistortTolerance;
+        ux = nx;
+        uy = ny;
+    }
+    x = static_cast<float>(ux);
+    y = static_cast<float>(uy);
+    return converged && std::isfinite(x) && std::isfinite(y);
+}
+
+RayTable::RayTable(const Intrinsics& K, int width, int height)
+    : K_(K)
+    , width_(width)
+    , height_(height)
+    , x_(static_cast<size_t>(width) * height)
+    , y_(static_cast<size_t>(width) * height) {
+    RGBD_TRACE_SCOPE("buildRayTable");
+    g_buildCount++;
+
+    // Same expression as the pinhole back-projection of the shaders and
+    // Mesh::vertex, so every path agrees bit for bit
+    std::vector<float> columnX(width), rowY(height);
+    for (int u = 0; u < width; ++u) {
+        columnX[u] = (u + 0.5f - K.cx) / K.fx;
+    }
+    for (int v = 0; v < height; ++v) {
+        rowY[v] = (v + 0.5f - K.cy) / K.fy;
+    }
+
+    for (int v = 0; v < height; ++v) {
+        float* xs = x_.data() + static_cast<size_t>(v) * width;
+        float* ys = y_.data() + static_cast<size_t>(v) * width;
+        for (int u = 0; u < width; ++u) {
+            if (K.isPinhole()) {
+                xs[u] = columnX[u];
+                ys[u] = rowY[v];
+            } else if (!undistortPoint(K.distortion, columnX[u], rowY[v], xs[u], ys[u])) {
+                unconverged_++;
+            }
+        }
+    }
+}
+
+std::shared_ptr<const RayTable> RayTable::get(const Intrinsics& K, int width, int height) {
+    // Most recently used first
+    static std::mutex mutex;
+    static std::vector<std::shared_ptr<const RayTable>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < cache.size(); ++i) {
+        if (sameCamera(*cache[i], K, width, height)) {
+            std::shared_ptr<const RayTable> table = cache[i];
+            cache.erase(cache.begin() + static_cast<std::ptrdiff_t>(i));
+            cache.insert(cache.begin(), table);
+            return table;
+        }
+    }
+
+    // Built under the lock: concurrent first frames of one camera share one table
+    auto table = std::make_shared<const RayTable>(K, width, height);
+    if (table->unconvergedCount() > 0) {
+        std::cerr << "Warning: Lens undistortion did not converge for "
+                  << table->unconvergedCount() << " pixels" << std::endl;
+    }
+    cache.insert(cache.begin(), table);
+    if (cache.size() > kCacheSize) {
+        cache.pop_back();
+    }
+    return table;
+}
+
+size_t RayTable::buildCount() {
+    return g_buildCount.load();
+}
+
+} // namespace mesh
+} // namespace rgbd
@@ -1,4 +1,5 @@
 #include "depth_mesh.hpp"
+#include "trace.hpp"
 #include <opencv2/imgproc.hpp>
 #include <iostream>
 #include <limits>
@@ -12,6 +13,7 @@ DepthMesh::DepthMesh() {}
 bool DepthMesh::build(const cv::Mat& rgb, const cv::Mat& depth,
                       const Intrinsics& intrinsics,
                       const DepthThresholds& thresholds) {
+    RGBD_TRACE_SCOPE("DepthMesh::build");
     clear();
     
     if (rgb.empty() || depth.empty()) {
@@ -44,7 +46,12 @@ bool DepthMesh::build(const cv::Mat& rgb, const cv::Mat& depth,
     // Generate mesh
     MeshGenerator generator;
     generator.setThresholds(thresholds);
+    generator.setNumThreads(numThreads_);
+    generator.setVertexLayout(layout_);
+    generator.setIndexMode(indexMode_);
+    generator.setAdaptive(adaptive_);
     mesh_ = generator.generate(depth, intrinsics_);
+    adaptiveReport_ = generator.getAdaptiveReport();
     
     if (mesh_.empty()) {
         std::cerr << "Error: Failed to generate mesh" << std::endl;
@@ -55,10 +62,11 @@ bool DepthMesh::build(const cv::Mat& rgb, const cv::Mat& depth,
     minDepth_ = std::numeric_limits<float>::max();
     maxDepth_ = 0.0f;
     
-    for (const auto& vertex : mesh_.vertices) {
-        if (vertex.z > 0) {
-            minDepth_ = std::min(minDepth_, vertex.z);
-            maxDepth_ = std::max(maxDepth_, vertex.z);
+    for (size_t i = 0; i < mesh_.numVertices(); ++i) {
+        float z = mesh_.vertex(i, intrinsics_).z;
+        if (z > 0) {
+            minDepth_ = std::min(minDepth_, z);
+            maxDepth_ = std::max(maxDepth_, z);
         }
     }
     
@@ -70,8 +78,8 @@ bool DepthMesh::build(const cv::Mat& rgb, const cv::Mat& depth,
 
 void DepthMesh::getStats(size_t& numVertices, size_t& numTriangles,
                          float& minDepth, float& maxDepth) const {
-    numVertices = mesh_.vertices.size();
-    numTriangles = mesh_.triangles.size();
+    numVertices = mesh_.numVertices();
+    numTriangles = mesh_.numTriangles();
     minDepth = minDepth_;
     maxDepth = maxDepth_;
 }
@@ -82,6 +90,7 @@ void DepthMesh::clear() {
     intrinsics_ = Intrinsics();
     minDepth_ = 0.0f;
     maxDepth_ = 0.0f;
+    adaptiveReport_ = AdaptiveReport();
 }
 
 } // namespace mesh
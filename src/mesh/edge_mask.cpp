@@ -0,0 +1,211 @@
+#include "edge_mask.hpp"
+#include "parallel.hpp"
+#include <cstring>
+
+#if RGBD_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rgbd {
+namespace mesh {
+
+namespace {
+
+/**
+ * Scalar reference: one isDiscontinuity call per edge
+ */
+inline uint8_t edgeBitsScalar(const float* row0, const float* row1, int u, int width,
+                              const DepthThresholds& t) {
+    uint8_t bits = 0;
+    bool hasRight = u + 1 < width;
+    if (hasRight && !t.isDiscontinuity(row0[u], row0[u + 1])) bits |= kEdgeRight;
+    if (row1) {
+        if (!t.isDiscontinuity(row0[u], row1[u])) bits |= kEdgeDown;
+        if (hasRight && !t.isDiscontinuity(row0[u], row1[u + 1])) bits |= kEdgeDiag;
+    }
+    return bits;
+}
+
+void edgeMaskRowScalar(const float* row0, const float* row1, int width,
+                       const DepthThresholds& t, uint8_t* out, int begin) {
+    for (int u = begin; u < width; ++u) {
+        out[u] = edgeBitsScalar(row0, row1, u, width, t);
+    }
+}
+
+#if RGBD_X86_SIMD
+
+// Spread the low 8 (or 4) bits of a movemask into one 0/1 byte per lane
+struct SpreadTables {
+    uint64_t spread8[256];
+    uint32_t spread4[16];
+
+    SpreadTables() {
+        for (int m = 0; m < 256; ++m) {
+            uint64_t v = 0;
+            for (int i = 0; i < 8; ++i) {
+                if (m & (1 << i)) v |= uint64_t(1) << (8 * i);
+            }
+            spread8[m] = v;
+            if (m < 16) spread4[m] = static_cast<uint32_t>(v);
+        }
+    }
+};
+
+const SpreadTables& spreadTables() {
+    static const SpreadTables tables;
+    return tables;
+}
+
+/**
+ * Vector form of DepthThresholds::isDiscontinuity, negated: lanes are all-ones
+ * where the edge a-b is unbroken. Valid depth (finite and > 0) is tested as
+ * 0 < z < inf with ordered compares, which is false for NaN.
+ */
+RGBD_TARGET_AVX2
+inline __m256 unbroken8(__m256 a, __m256 b, __m256 tauRel, __m256 tauAbs) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    __m256 valid = _mm256_and_ps(
+        _mm256_and_ps(_mm256_cmp_ps(a, zero, _CMP_GT_OQ), _mm256_cmp_ps(a, inf, _CMP_LT_OQ)),
+        _mm256_and_ps(_mm256_cmp_ps(b, zero, _CMP_GT_OQ), _mm256_cmp_ps(b, inf, _CMP_LT_OQ)));
+
+    __m256 diff = _mm256_and_ps(_mm256_sub_ps(a, b), absMask);
+    __m256 minZ = _mm256_min_ps(a, b);
+    __m256 maxZ = _mm256_max_ps(a, b);
+
+    // diff / min_z > tau_rel, and diff > tau_abs * max(1, max_z / 2)
+    __m256 relBreak = _mm256_cmp_ps(_mm256_div_ps(diff, minZ), tauRel, _CMP_GT_OQ);
+    __m256 adaptiveAbs = _mm256_mul_ps(tauAbs, _mm256_max_ps(one, _mm256_mul_ps(maxZ, half)));
+    __m256 absBreak = _mm256_cmp_ps(diff, adaptiveAbs, _CMP_GT_OQ);
+
+    return _mm256_andnot_ps(_mm256_or_ps(relBreak, absBreak), valid);
+}
+
+RGBD_TARGET_AVX2
+void edgeMaskRowAVX2(const float* row0, const float* row1, int width,
+                     const DepthThresholds& t, uint8_t* out) {
+    const SpreadTables& lut = spreadTables();
+    const __m256 tauRel = _mm256_set1_ps(t.tau_rel);
+    const __m256 tauAbs = _mm256_set1_ps(t.tau_abs);
+
+    // Every lane reads u and u+1, so stop while u+8 is still inside the row
+    int u = 0;
+    for (; u + 8 < width; u += 8) {
+        __m256 z00 = _mm256_loadu_ps(row0 + u);
+        __m256 z10 = _mm256_loadu_ps(row0 + u + 1);
+        uint64_t bits = lut.spread8[_mm256_movemask_ps(unbroken8(z00, z10, tauRel, tauAbs))];
+
+        if (row1) {
+            __m256 z01 = _mm256_loadu_ps(row1 + u);
+            __m256 z11 = _mm256_loadu_ps(row1 + u + 1);
+            bits |= lut.spread8[_mm256_movemask_ps(unbroken8(z00, z01, tauRel, tauAbs))] << 1;
+            bits |= lut.spread8[_mm256_movemask_ps(unbroken8(z00, z11, tauRel, tauAbs))] << 2;
+        }
+        std::memcpy(out + u, &bits, sizeof(bits));
+    }
+
+    edgeMaskRowScalar(row0, row1, width, t, out, u);
+}
+
+RGBD_TARGET_SSE41
+inline __m128 unbroken4(__m128 a, __m128 b, __m128 tauRel, __m128 tauAbs) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    __m128 valid = _mm_and_ps(
+        _mm_and_ps(_mm_cmpgt_ps(a, zero), _mm_cmplt_ps(a, inf)),
+        _mm_and_ps(_mm_cmpgt_ps(b, zero), _mm_cmplt_ps(b, inf)));
+
+    __m128 diff = _mm_and_ps(_mm_sub_ps(a, b), absMask);
+    __m128 minZ = _mm_min_ps(a, b);
+    __m128 maxZ = _mm_max_ps(a, b);
+
+    __m128 relBreak = _mm_cmpgt_ps(_mm_div_ps(diff, minZ), tauRel);
+    __m128 adaptiveAbs = _mm_mul_ps(tauAbs, _mm_max_ps(one, _mm_mul_ps(maxZ, half)));
+    __m128 absBreak = _mm_cmpgt_ps(diff, adaptiveAbs);
+
+    return _mm_andnot_ps(_mm_or_ps(relBreak, absBreak), valid);
+}
+
+RGBD_TARGET_SSE41
+void edgeMaskRowSSE41(const float* row0, const float* row1, int width,
+                      const DepthThresholds& t, uint8_t* out) {
+    const SpreadTables& lut = spreadTables();
+    const __m128 tauRel = _mm_set1_ps(t.tau_rel);
+    const __m128 tauAbs = _mm_set1_ps(t.tau_abs);
+
+    int u = 0;
+    for (; u + 4 < width; u += 4) {
+        __m128 z00 = _mm_loadu_ps(row0 + u);
+        __m128 z10 = _mm_loadu_ps(row0 + u + 1);
+        uint32_t bits = lut.spread4[_mm_movemask_ps(unbroken4(z00, z10, tauRel, tauAbs))];
+
+        if (row1) {
+            __m128 z01 = _mm_loadu_ps(row1 + u);
+            __m128 z11 = _mm_loadu_ps(row1 + u + 1);
+            bits |= lut.spread4[_mm_movemask_ps(unbroken4(z00, z01, tauRel, tauAbs))] << 1;
+            bits |= lut.spread4[_mm_movemask_ps(unbroken4(z00, z11, tauRel, tauAbs))] << 2;
+        }
+        std::memcpy(out + u, &bits, sizeof(bits));
+    }
+
+    edgeMaskRowScalar(row0, row1, width, t, out, u);
+}
+
+#endif // RGBD_X86_SIMD
+
+} // namespace
+
+void computeEdgeMaskRow(const float* row0, const float* row1, int width,
+                        const DepthThresholds& thresholds, uint8_t* out,
+                        SimdLevel level) {
+    // Never run code the CPU cannot execute, whatever the caller asked for
+    if (level > activeSimdLevel()) {
+        level = activeSimdLevel();
+    }
+
+#if RGBD_X86_SIMD
+    if (level >= SimdLevel::AVX2) {
+        edgeMaskRowAVX2(row0, row1, width, thresholds, out);
+        return;
+    }
+    if (level == SimdLevel::SSE41) {
+        edgeMaskRowSSE41(row0, row1, width, thresholds, out);
+        return;
+    }
+#endif
+    edgeMaskRowScalar(row0, row1, width, thresholds, out, 0);
+}
+
+cv::Mat computeEdgeMask(const cv::Mat& depth, const DepthThresholds& thresholds,
+                        SimdLevel level, int numThreads) {
+    cv::Mat depthF;
+    if (depth.type() != CV_32F) {
+        depth.convertTo(depthF, CV_32F);
+    } else {
+        depthF = depth;
+    }
+
+    int H = depthF.rows;
+    int W = depthF.cols;
+    cv::Mat edges(H, W, CV_8U);
+
+    parallelFor(H, numThreads, [&](int v) {
+        const float* row1 = (v + 1 < H) ? depthF.ptr<float>(v + 1) : nullptr;
+        computeEdgeMaskRow(depthF.ptr<float>(v), row1, W, thresholds,
+                           edges.ptr<uint8_t>(v), level);
+    });
+
+    return edges;
+}
+
+} // namespace mesh
+} // namespace rgbd
@@ -1,56 +1,217 @@
 #include "mesh_generator.hpp"
+#include "edge_mask.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <limits>
 #include <iostream>
 
 namespace rgbd {
 namespace mesh {
 
+// Row bands are at least this tall, with a few bands per thread
+static constexpr int kMinRowsPerBand = 16;
+static constexpr int kBandsPerThread = 4;
+
+// Per-pixel flags shared by the counting and fill passes
+static constexpr uint8_t kPixelValid = 1 << 0;     // Pixel has a vertex
+static constexpr uint8_t kUpperTriangle = 1 << 1;  // Quad emits v00, v10, v11
+static constexpr uint8_t kLowerTriangle = 1 << 2;  // Quad emits v00, v11, v01
+
 MeshGenerator::MeshGenerator() : thresholds_() {}
 
 void MeshGenerator::setThresholds(const DepthThresholds& thresholds) {
     thresholds_ = thresholds;
 }
 
-Vertex MeshGenerator::backproject(float u, float v, float z, const Intrinsics& K) {
-    // Back-project pixel center to 3D camera space
-    // The pixel (u, v) covers the area [u, u+1) x [v, v+1)
-    // Its center is at (u + 0.5, v + 0.5)
-    //
-    // Using pixel center for both 3D position and texture coordinates
-    // ensures consistency when rendering back at the same focal length
-    float u_center = u + 0.5f;
-    float v_center = v + 0.5f;
+void MeshGenerator::setNumThreads(int numThreads) {
+    numThreads_ = numThreads;
+}
+
+void MeshGenerator::setVertexLayout(VertexLayout layout) {
+    layout_ = layout;
+}
+
+void MeshGenerator::setIndexMode(IndexMode mode) {
+    indexMode_ = mode;
+}
+
+void MeshGenerator::setAdaptive(const AdaptiveOptions& options) {
+    adaptive_ = options;
+}
+
+bool parseVertexLayout(const std::string& name, VertexLayout& layout) {
+    if (name == "float32") {
+        layout = VertexLayout::Float32;
+    } else if (name == "depth_pixel") {
+        layout = VertexLayout::DepthPixel;
+    } else if (name == "quantized16") {
+        layout = VertexLayout::Quantized16;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* vertexLayoutName(VertexLayout layout) {
+    switch (layout) {
+        case VertexLayout::DepthPixel: return "depth_pixel";
+        case VertexLayout::Quantized16: return "quantized16";
+        default: return "float32";
+    }
+}
+
+bool parseIndexMode(const std::string& name, IndexMode& mode) {
+    if (name == "triangles") {
+        mode = IndexMode::Triangles;
+    } else if (name == "strips") {
+        mode = IndexMode::Strips;
+    } else if (name == "meshlets") {
+        mode = IndexMode::Meshlets;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* indexModeName(IndexMode mode) {
+    switch (mode) {
+        case IndexMode::Strips: return "strips";
+        case IndexMode::Meshlets: return "meshlets";
+        default: return "triangles";
+    }
+}
+
+int meshletRows(int width) {
+    // A meshlet over R quad rows references the vertices of R + 1 pixel rows
+    return std::min(kMeshletTileSize, 65536 / std::max(width, 1) - 1);
+}
+
+bool meshletVisible(const Meshlet& meshlet, const Intrinsics& sourceK, const Intrinsics& targetK) {
+    // The affine bound below only holds between pinhole cameras
+    if (!sourceK.isPinhole() || !targetK.isPinhole()) {
+        return true;
+    }
     
-    // Back-project using pixel center
-    // X = (u_center - cx) * z / fx
-    // Y = (v_center - cy) * z / fy
-    // Z = z
-    float X = (u_center - K.cx) * z / K.fx;
-    float Y = (v_center - K.cy) * z / K.fy;
+    // Vertices sit at pixel centers; u_t = (u_s - cx_s) * fx_t / fx_s + cx_t
+    const float sx = targetK.fx / sourceK.fx;
+    const float sy = targetK.fy / sourceK.fy;
+    float u0 = (meshlet.minU + 0.5f - sourceK.cx) * sx + targetK.cx;
+    float u1 = (meshlet.maxU + 0.5f - sourceK.cx) * sx + targetK.cx;
+    float v0 = (meshlet.minV + 0.5f - sourceK.cy) * sy + targetK.cy;
+    float v1 = (meshlet.maxV + 0.5f - sourceK.cy) * sy + targetK.cy;
     
-    // Compute texture coordinates (normalized) - also using pixel center
-    float tex_u = u_center / static_cast<float>(K.width);
-    float tex_v = v_center / static_cast<float>(K.height);
+    // One pixel of slack for rounding at the image border
+    return std::max(u0, u1) > -1.0f && std::min(u0, u1) < targetK.width + 1.0f &&
+           std::max(v0, v1) > -1.0f && std::min(v0, v1) < targetK.height + 1.0f;
+}
+
+std::vector<Triangle> expandTriangles(const Mesh& mesh) {
+    std::vector<Triangle> triangles;
+    triangles.reserve(mesh.numTriangles());
     
-    return Vertex(X, Y, z, tex_u, tex_v);
+    switch (mesh.indexMode) {
+        case IndexMode::Strips: {
+            // Strip triangle i uses entries i, i+1, i+2 since the last restart
+            size_t start = 0;
+            for (size_t i = 0; i < mesh.stripIndices.size(); ++i) {
+                if (mesh.stripIndices[i] == kStripRestart) {
+                    start = i + 1;
+                } else if (i >= start + 2) {
+                    triangles.emplace_back(mesh.stripIndices[i - 2], mesh.stripIndices[i - 1],
+                                           mesh.stripIndices[i]);
+                }
+            }
+            break;
+        }
+        case IndexMode::Meshlets:
+            for (const Meshlet& m : mesh.meshlets) {
+                const uint16_t* idx = mesh.meshletIndices.data() + m.indexOffset;
+                for (uint32_t i = 0; i + 2 < m.indexCount; i += 3) {
+                    triangles.emplace_back(m.baseVertex + idx[i], m.baseVertex + idx[i + 1],
+                                           m.baseVertex + idx[i + 2]);
+                }
+            }
+            break;
+        default:
+            triangles = mesh.triangles;
+            break;
+    }
+    return triangles;
 }
 
-bool MeshGenerator::shouldBreakEdge(float z1, float z2) const {
-    return thresholds_.isDiscontinuity(z1, z2);
+// Map [0, 1] to the full 16-bit range
+static inline uint16_t quantizeUnit(float x) {
+    return static_cast<uint16_t>(std::lround(clamp(x, 0.0f, 1.0f) * 65535.0f));
 }
 
-bool MeshGenerator::isValidTriangle(float z0, float z1, float z2) const {
-    // Check if all depths are valid
-    if (!isValidDepth(z0) || !isValidDepth(z1) || !isValidDepth(z2)) {
-        return false;
+// Strip indices of one quad row, following the emission order of the fill
+// pass: a strip opens with 3 indices, grows by 1 per triangle and is closed
+// by a restart index
+static size_t countStripIndices(const uint8_t* rowFlags, int W) {
+    size_t count = 0;
+    bool inStrip = false;
+    for (int k = 0; k < 2 * (W - 1); ++k) {
+        uint8_t bit = (k & 1) ? kUpperTriangle : kLowerTriangle;
+        bool valid = (rowFlags[k >> 1] & bit) != 0;
+        if (valid) {
+            count += inStrip ? 1 : 3;
+            inStrip = true;
+        } else if (inStrip) {
+            count += 1;
+            inStrip = false;
+        }
+    }
+    return count + (inStrip ? 1 : 0);
+}
+
+std::array<float, 3> MeshGenerator::setQuantizationRange(Mesh& mesh,
+                                                        const std::array<float, 6>& bounds) {
+    std::array<float, 3> invScale;
+    for (int i = 0; i < 3; ++i) {
+        float extent = bounds[i + 3] - bounds[i];
+        mesh.positionOffset[i] = bounds[i];
+        mesh.positionScale[i] = extent > 0.0f ? extent : 1.0f;
+        invScale[i] = 1.0f / mesh.positionScale[i];
+    }
+    return invScale;
+}
+
+void MeshGenerator::storeVertex(Mesh& mesh, size_t index, int u, int v, float z,
+                                const Intrinsics& K, const std::array<float, 3>& invScale) {
+    if (mesh.layout == VertexLayout::DepthPixel) {
+        mesh.depthVertices[index] = DepthPixelVertex(z, static_cast<uint16_t>(u), static_cast<uint16_t>(v));
+        return;
     }
     
-    // Check all three edges for discontinuities
-    if (shouldBreakEdge(z0, z1)) return false;
-    if (shouldBreakEdge(z1, z2)) return false;
-    if (shouldBreakEdge(z2, z0)) return false;
+    Vertex p = backproject(u, v, z, K);
+    if (mesh.layout == VertexLayout::Quantized16) {
+        QuantizedVertex& q = mesh.quantizedVertices[index];
+        q.x = quantizeUnit((p.x - mesh.positionOffset[0]) * invScale[0]);
+        q.y = quantizeUnit((p.y - mesh.positionOffset[1]) * invScale[1]);
+        q.z = quantizeUnit((p.z - mesh.positionOffset[2]) * invScale[2]);
+        q.u = quantizeUnit(p.u);
+        q.v = quantizeUnit(p.v);
+    } else {
+        mesh.vertices[index] = p;
+    }
+}
+
+Vertex MeshGenerator::backproject(int u, int v, float z, const Intrinsics& K) const {
+    // The pixel (u, v) covers the area [u, u+1) x [v, v+1); its center
+    // (u + 0.5, v + 0.5) is used for both the 3D position and the texture
+    // coordinates, which keeps rendering at the source camera exact.
+    // The ray table holds the (undistorted) normalized coordinates of the
+    // center, X = x z and Y = y z.
+    float X = rays_->rowX(v)[u] * z;
+    float Y = rays_->rowY(v)[u] * z;
     
-    return true;
+    // Compute texture coordinates (normalized) - also using pixel center
+    float tex_u = (u + 0.5f) / static_cast<float>(K.width);
+    float tex_v = (v + 0.5f) / static_cast<float>(K.height);
+    
+    return Vertex(X, Y, z, tex_u, tex_v);
 }
 
 Mesh MeshGenerator::generate(const cv::Mat& depth, const Intrinsics& intrinsics) {
@@ -70,6 +231,20 @@ Mesh MeshGenerator::generate(const cv::Mat& depth, const Intrinsics& intrinsics,
     int H = depth.rows;
     int W = depth.cols;
     
+    // Pixel coordinates are packed into two 16-bit halves
+    if (layout_ == VertexLayout::DepthPixel && (W > 65536 || H > 65536)) {
+        std::cerr << "Error: Depth map too large for the depth_pixel vertex layout" << std::endl;
+        return mesh;
+    }
+    // The shaders rebuild DepthPixel positions with the pinhole model
+    if (layout_ == VertexLayout::DepthPixel && !intrinsics.isPinhole()) {
+        std::cerr << "Error: The depth_pixel vertex layout needs an undistorted source camera"
+                  << std::endl;
+        return mesh;
+    }
+    mesh.layout = layout_;
+    const bool quantize = (layout_ == VertexLayout::Quantized16);
+    
     // Ensure depth is float32
     cv::Mat depthF;
     if (depth.type() != CV_32F) {
@@ -78,84 +253,432 @@ Mesh MeshGenerator::generate(const cv::Mat& depth, const Intrinsics& intrinsics,
         depthF = depth;
     }
     
-    // Create vertex grid (store vertex index for each pixel, -1 if invalid)
-    std::vector<int> vertexGrid(W * H, -1);
+    if (adaptive_.maxErrorPx > 0.0f) {
+        if (indexMode_ != IndexMode::Triangles) {
+            std::cerr << "Warning: Adaptive meshes are triangle lists, ignoring index mode "
+                      << indexModeName(indexMode_) << std::endl;
+        }
+        if (!intrinsics.isPinhole()) {
+            std::cerr << "Error: Adaptive meshing needs an undistorted source camera" << std::endl;
+            return mesh;
+        }
+        rays_ = RayTable::get(intrinsics, W, H);
+        return generateAdaptive(depthF, intrinsics, validMask);
+    }
     
-    // Generate vertices for all valid depth pixels
-    mesh.vertices.reserve(W * H);
+    // Meshlet tiles share the vertices of their row band, which must fit 16-bit local indices
+    const int rowsPerMeshlet = meshletRows(W);
+    if (indexMode_ == IndexMode::Meshlets && rowsPerMeshlet < 1) {
+        std::cerr << "Error: Depth map too wide for 16-bit meshlet indices" << std::endl;
+        return mesh;
+    }
+    mesh.indexMode = indexMode_;
+    rays_ = RayTable::get(intrinsics, W, H);
+    const bool strips = (indexMode_ == IndexMode::Strips);
+    const bool meshlets = (indexMode_ == IndexMode::Meshlets);
+    const int tileColumns = (W - 1 + kMeshletTileSize - 1) / kMeshletTileSize;
     
-    for (int v = 0; v < H; ++v) {
-        const float* depthRow = depthF.ptr<float>(v);
-        const uint8_t* maskRow = validMask.empty() ? nullptr : validMask.ptr<uint8_t>(v);
+    // Split the image into row bands, a few per thread for load balancing
+    int numThreads = resolveThreadCount(numThreads_);
+    int numBands = std::max(1, std::min((H + kMinRowsPerBand - 1) / kMinRowsPerBand,
+                                        numThreads * kBandsPerThread));
+    int rowsPerBand = (H + numBands - 1) / numBands;
+    numBands = (H + rowsPerBand - 1) / rowsPerBand;
+    
+    // Per-pixel flags written by the counting pass and consumed by the fill pass
+    std::vector<uint8_t> flags(static_cast<size_t>(W) * H, 0);
+    
+    // Per-row counts, turned into exclusive offsets below (one extra slot for the total)
+    std::vector<size_t> rowVertexStart(H + 1, 0);
+    std::vector<size_t> rowTriangleStart(H + 1, 0);
+    std::vector<size_t> rowStripStart(strips ? H + 1 : 0, 0);
+    
+    // Per-row triangles of each meshlet tile column, then their offsets
+    std::vector<size_t> rowTileStart(meshlets ? static_cast<size_t>(H) * tileColumns : 0, 0);
+    
+    // Per-band position bounds (min xyz, max xyz), only for Quantized16
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<std::array<float, 6>> bandBounds(quantize ? numBands : 0,
+                                                 std::array<float, 6>{{inf, inf, inf, -inf, -inf, -inf}});
+    
+    auto pixelValid = [&](const float* depthRow, const uint8_t* maskRow, int u) {
+        return isValidDepth(depthRow[u]) && (!maskRow || maskRow[u] > 0);
+    };
+    
+    // Pass 1: count valid vertices and triangles per row. Triangle validity
+    // comes from the vectorized edge mask, two mask rows live per band.
+    parallelFor(numBands, numThreads, [&](int band) {
+        int vBegin = band * rowsPerBand;
+        int vEnd = std::min(H, vBegin + rowsPerBand);
+        
+        std::vector<uint8_t> edgeRow0(W), edgeRow1(W);
+        computeEdgeMaskRow(depthF.ptr<float>(vBegin),
+                           vBegin + 1 < H ? depthF.ptr<float>(vBegin + 1) : nullptr,
+                           W, thresholds_, edgeRow0.data());
         
-        for (int u = 0; u < W; ++u) {
-            float z = depthRow[u];
+        for (int v = vBegin; v < vEnd; ++v) {
+            const float* d0 = depthF.ptr<float>(v);
+            const uint8_t* m0 = validMask.empty() ? nullptr : validMask.ptr<uint8_t>(v);
+            uint8_t* f = &flags[static_cast<size_t>(v) * W];
             
-            // Check validity
-            bool valid = isValidDepth(z);
-            if (maskRow) {
-                valid = valid && (maskRow[u] > 0);
+            size_t numVerts = 0;
+            for (int u = 0; u < W; ++u) {
+                if (pixelValid(d0, m0, u)) {
+                    f[u] = kPixelValid;
+                    ++numVerts;
+                    
+                    if (quantize) {
+                        Vertex p = backproject(u, v, d0[u], intrinsics);
+                        std::array<float, 6>& b = bandBounds[band];
+                        b[0] = std::min(b[0], p.x);
+                        b[1] = std::min(b[1], p.y);
+                        b[2] = std::min(b[2], p.z);
+                        b[3] = std::max(b[3], p.x);
+                        b[4] = std::max(b[4], p.y);
+                        b[5] = std::max(b[5], p.z);
+                    }
+                }
             }
+            rowVertexStart[v] = numVerts;
+            
+            if (v == H - 1) continue;
             
-            if (valid) {
-                vertexGrid[v * W + u] = static_cast<int>(mesh.vertices.size());
-                mesh.vertices.push_back(backproject(static_cast<float>(u), 
-                                                    static_cast<float>(v), 
-                                                    z, intrinsics));
+            const uint8_t* m1 = validMask.empty() ? nullptr : validMask.ptr<uint8_t>(v + 1);
+            computeEdgeMaskRow(depthF.ptr<float>(v + 1),
+                               v + 2 < H ? depthF.ptr<float>(v + 2) : nullptr,
+                               W, thresholds_, edgeRow1.data());
+            const uint8_t* e0 = edgeRow0.data();
+            const uint8_t* e1 = edgeRow1.data();
+            
+            // For each quad (u,v), (u+1,v), (u,v+1), (u+1,v+1) create
+            // triangle 1 (v00, v10, v11) and triangle 2 (v00, v11, v01)
+            // if all of their edges are unbroken
+            size_t numTris = 0;
+            for (int u = 0; u < W - 1; ++u) {
+                uint8_t tri = 0;
+                if (upperTriangleUnbroken(e0, u)) tri |= kUpperTriangle;
+                if (lowerTriangleUnbroken(e0, e1, u)) tri |= kLowerTriangle;
+                if (!tri) continue;
+                
+                // Edges only see depth, the optional mask can still drop corners
+                if (m0) {
+                    if (!(m0[u] > 0 && m1[u + 1] > 0)) continue;
+                    if (!(m0[u + 1] > 0)) tri &= ~kUpperTriangle;
+                    if (!(m1[u] > 0)) tri &= ~kLowerTriangle;
+                }
+                
+                f[u] |= tri;
+                size_t quadTris = ((tri & kUpperTriangle) ? 1 : 0) + ((tri & kLowerTriangle) ? 1 : 0);
+                numTris += quadTris;
+                if (meshlets) {
+                    rowTileStart[static_cast<size_t>(v) * tileColumns + u / kMeshletTileSize] += quadTris;
+                }
+            }
+            rowTriangleStart[v] = numTris;
+            
+            if (strips) {
+                rowStripStart[v] = countStripIndices(f, W);
             }
+            
+            std::swap(edgeRow0, edgeRow1);
+        }
+    });
+    
+    // Exclusive prefix sums give every row its global output offsets
+    size_t numVertices = 0;
+    size_t numTriangles = 0;
+    size_t numStripIndices = 0;
+    for (int v = 0; v <= H; ++v) {
+        size_t vc = rowVertexStart[v];
+        size_t tc = rowTriangleStart[v];
+        rowVertexStart[v] = numVertices;
+        rowTriangleStart[v] = numTriangles;
+        numVertices += vc;
+        numTriangles += tc;
+        if (strips) {
+            size_t sc = rowStripStart[v];
+            rowStripStart[v] = numStripIndices;
+            numStripIndices += sc;
         }
     }
     
-    // Generate triangles from quad grid
-    // For each quad (u,v), (u+1,v), (u,v+1), (u+1,v+1)
-    // Create two triangles if all vertices exist and edges are valid
-    mesh.triangles.reserve((W - 1) * (H - 1) * 2);
+    switch (layout_) {
+        case VertexLayout::DepthPixel: mesh.depthVertices.resize(numVertices); break;
+        case VertexLayout::Quantized16: mesh.quantizedVertices.resize(numVertices); break;
+        default: mesh.vertices.resize(numVertices); break;
+    }
+    switch (indexMode_) {
+        case IndexMode::Strips:
+            mesh.stripIndices.resize(numStripIndices);
+            mesh.stripTriangles = numTriangles;
+            break;
+        case IndexMode::Meshlets: {
+            // Tiles are stored band by band, each tile's rows contiguous;
+            // the prefix sum in that order places every row segment
+            mesh.meshletIndices.resize(numTriangles * 3);
+            size_t offset = 0;
+            for (int v0 = 0; v0 < H - 1; v0 += rowsPerMeshlet) {
+                int v1 = std::min(H - 1, v0 + rowsPerMeshlet);
+                for (int c = 0; c < tileColumns; ++c) {
+                    size_t first = offset;
+                    for (int v = v0; v < v1; ++v) {
+                        size_t& start = rowTileStart[static_cast<size_t>(v) * tileColumns + c];
+                        size_t count = start;
+                        start = offset;
+                        offset += count;
+                    }
+                    if (offset == first) {
+                        continue;  // Empty tiles are skipped
+                    }
+                    Meshlet meshlet(static_cast<uint32_t>(first * 3),
+                                    static_cast<uint32_t>((offset - first) * 3),
+                                    static_cast<uint32_t>(rowVertexStart[v0]));
+                    meshlet.minU = static_cast<uint16_t>(c * kMeshletTileSize);
+                    meshlet.maxU = static_cast<uint16_t>(std::min(W - 1, (c + 1) * kMeshletTileSize));
+                    meshlet.minV = static_cast<uint16_t>(v0);
+                    meshlet.maxV = static_cast<uint16_t>(v1);
+                    mesh.meshlets.push_back(meshlet);
+                }
+            }
+            break;
+        }
+        default:
+            mesh.triangles.resize(numTriangles);
+            break;
+    }
+    
+    // Quantization range: the union of the band bounds
+    std::array<float, 3> invScale = {{0.0f, 0.0f, 0.0f}};
+    if (quantize && numVertices > 0) {
+        std::array<float, 6> bounds = bandBounds[0];
+        for (const std::array<float, 6>& b : bandBounds) {
+            for (int i = 0; i < 3; ++i) {
+                bounds[i] = std::min(bounds[i], b[i]);
+                bounds[i + 3] = std::max(bounds[i + 3], b[i + 3]);
+            }
+        }
+        invScale = setQuantizationRange(mesh, bounds);
+    }
     
-    for (int v = 0; v < H - 1; ++v) {
-        for (int u = 0; u < W - 1; ++u) {
-            // Get vertex indices for quad corners
-            int idx00 = vertexGrid[v * W + u];           // Top-left
-            int idx10 = vertexGrid[v * W + (u + 1)];     // Top-right
-            int idx01 = vertexGrid[(v + 1) * W + u];     // Bottom-left
-            int idx11 = vertexGrid[(v + 1) * W + (u + 1)]; // Bottom-right
+    // Pass 2: fill vertices and triangles in place at their final offsets.
+    // Vertex indices of the row below are derived from its start offset and
+    // a running count, so bands never wait on each other.
+    parallelFor(numBands, numThreads, [&](int band) {
+        int vBegin = band * rowsPerBand;
+        int vEnd = std::min(H, vBegin + rowsPerBand);
+        
+        for (int v = vBegin; v < vEnd; ++v) {
+            const float* d0 = depthF.ptr<float>(v);
+            const uint8_t* f0 = &flags[static_cast<size_t>(v) * W];
+            
+            size_t vertexIndex = rowVertexStart[v];
+            for (int u = 0; u < W; ++u) {
+                if (f0[u] & kPixelValid) {
+                    storeVertex(mesh, vertexIndex++, u, v, d0[u], intrinsics, invScale);
+                }
+            }
+            
+            if (v == H - 1) continue;
             
-            // Get depth values
-            float z00 = depthF.at<float>(v, u);
-            float z10 = depthF.at<float>(v, u + 1);
-            float z01 = depthF.at<float>(v + 1, u);
-            float z11 = depthF.at<float>(v + 1, u + 1);
+            const uint8_t* f1 = f0 + W;
+            uint32_t top = static_cast<uint32_t>(rowVertexStart[v]);
+            uint32_t bottom = static_cast<uint32_t>(rowVertexStart[v + 1]);
             
-            // Triangle 1: v00, v10, v11
-            if (idx00 >= 0 && idx10 >= 0 && idx11 >= 0) {
-                if (isValidTriangle(z00, z10, z11)) {
-                    mesh.triangles.emplace_back(
-                        static_cast<uint32_t>(idx00),
-                        static_cast<uint32_t>(idx10),
-                        static_cast<uint32_t>(idx11)
-                    );
+            if (strips) {
+                // Strip order b0, t0, b1, t1, ...: triangle 2u is the lower
+                // triangle of quad u, 2u + 1 its upper one
+                uint32_t* out = mesh.stripIndices.data() + rowStripStart[v];
+                bool inStrip = false;
+                auto emit = [&](bool valid, uint32_t a, uint32_t b, uint32_t c) {
+                    if (valid) {
+                        if (!inStrip) {
+                            *out++ = a;
+                            *out++ = b;
+                            inStrip = true;
+                        }
+                        *out++ = c;
+                    } else if (inStrip) {
+                        *out++ = kStripRestart;
+                        inStrip = false;
+                    }
+                };
+                
+                for (int u = 0; u < W - 1; ++u) {
+                    uint32_t idx00 = top;
+                    uint32_t idx10 = top + ((f0[u] & kPixelValid) ? 1 : 0);
+                    uint32_t idx01 = bottom;
+                    uint32_t idx11 = bottom + ((f1[u] & kPixelValid) ? 1 : 0);
+                    
+                    emit((f0[u] & kLowerTriangle) != 0, idx01, idx00, idx11);
+                    emit((f0[u] & kUpperTriangle) != 0, idx00, idx11, idx10);
+                    
+                    top = idx10;
+                    bottom = idx11;
                 }
+                if (inStrip) {
+                    *out++ = kStripRestart;
+                }
+                continue;
+            }
+            
+            // Meshlet indices are local to the first vertex of the meshlet
+            uint32_t base = 0;
+            uint16_t* localOut = nullptr;
+            Triangle* triangleOut = nullptr;
+            const size_t* tileStart = nullptr;
+            if (meshlets) {
+                base = static_cast<uint32_t>(rowVertexStart[(v / rowsPerMeshlet) * rowsPerMeshlet]);
+                tileStart = &rowTileStart[static_cast<size_t>(v) * tileColumns];
+            } else {
+                triangleOut = mesh.triangles.data() + rowTriangleStart[v];
             }
+            auto emit = [&](uint32_t a, uint32_t b, uint32_t c) {
+                if (meshlets) {
+                    *localOut++ = static_cast<uint16_t>(a - base);
+                    *localOut++ = static_cast<uint16_t>(b - base);
+                    *localOut++ = static_cast<uint16_t>(c - base);
+                } else {
+                    *triangleOut++ = Triangle(a, b, c);
+                }
+            };
             
-            // Triangle 2: v00, v11, v01
-            if (idx00 >= 0 && idx11 >= 0 && idx01 >= 0) {
-                if (isValidTriangle(z00, z11, z01)) {
-                    mesh.triangles.emplace_back(
-                        static_cast<uint32_t>(idx00),
-                        static_cast<uint32_t>(idx11),
-                        static_cast<uint32_t>(idx01)
-                    );
+            for (int u = 0; u < W - 1; ++u) {
+                // Each tile column has its own segment of the row
+                if (meshlets && u % kMeshletTileSize == 0) {
+                    localOut = mesh.meshletIndices.data() + tileStart[u / kMeshletTileSize] * 3;
+                }
+                
+                // Indices of the quad corners, valid only where the pixel is
+                uint32_t idx00 = top;
+                uint32_t idx10 = top + ((f0[u] & kPixelValid) ? 1 : 0);
+                uint32_t idx01 = bottom;
+                uint32_t idx11 = bottom + ((f1[u] & kPixelValid) ? 1 : 0);
+                
+                if (f0[u] & kUpperTriangle) {
+                    emit(idx00, idx10, idx11);
                 }
+                if (f0[u] & kLowerTriangle) {
+                    emit(idx00, idx11, idx01);
+                }
+                
+                top = idx10;
+                bottom = idx11;
             }
         }
+    });
+    
+    std::cout << "Generated mesh: " << mesh.numVertices() << " vertices, "
+              << mesh.numTriangles() << " triangles";
+    if (layout_ != VertexLayout::Float32) {
+        std::cout << " (" << vertexLayoutName(layout_) << ", "
+                  << mesh.numVertices() * mesh.vertexStride() / 1024 << " KiB vertices)";
     }
+    if (indexMode_ != IndexMode::Triangles) {
+        std::cout << " (" << indexModeName(indexMode_) << ", "
+                  << mesh.indexBytes() / 1024 << " KiB indices";
+        if (indexMode_ == IndexMode::Meshlets) {
+            std::cout << ", " << mesh.meshlets.size() << " meshlets";
+        }
+        std::cout << ")";
+    }
+    std::cout << std::endl;
     
-    mesh.vertices.shrink_to_fit();
-    mesh.triangles.shrink_to_fit();
+    return mesh;
+}
+
+bool MeshGenerator::initTiledMesh(Mesh& mesh, int width, int height) const {
+    mesh.clear();
+    if (layout_ == VertexLayout::Quantized16) {
+        std::cerr << "Error: Tiled meshes need the float32 or depth_pixel vertex layout" << std::endl;
+        return false;
+    }
+    // Tile bounds and DepthPixel coordinates are 16-bit
+    if (width < 2 || height < 2 || width > 65536 || height > 65536) {
+        std::cerr << "Error: Unsupported depth map size for a tiled mesh: "
+                  << width << "x" << height << std::endl;
+        return false;
+    }
+    mesh.layout = layout_;
+    mesh.indexMode = IndexMode::Meshlets;
     
-    std::cout << "Generated mesh: " << mesh.vertices.size() << " vertices, "
-              << mesh.triangles.size() << " triangles" << std::endl;
+    const int tilesX = (width - 1 + kMeshletTileSize - 1) / kMeshletTileSize;
+    const int tilesY = (height - 1 + kMeshletTileSize - 1) / kMeshletTileSize;
+    const size_t numTiles = static_cast<size_t>(tilesX) * tilesY;
+    mesh.meshlets.reserve(numTiles);
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            uint32_t tile = static_cast<uint32_t>(mesh.meshlets.size());
+            Meshlet meshlet(tile * kTileIndexSlots, 0, tile * kTileVertexSlots);
+            meshlet.minU = static_cast<uint16_t>(tx * kMeshletTileSize);
+            meshlet.maxU = static_cast<uint16_t>(std::min(width - 1, (tx + 1) * kMeshletTileSize));
+            meshlet.minV = static_cast<uint16_t>(ty * kMeshletTileSize);
+            meshlet.maxV = static_cast<uint16_t>(std::min(height - 1, (ty + 1) * kMeshletTileSize));
+            mesh.meshlets.push_back(meshlet);
+        }
+    }
     
-    return mesh;
+    if (layout_ == VertexLayout::DepthPixel) {
+        mesh.depthVertices.resize(numTiles * kTileVertexSlots);
+    } else {
+        mesh.vertices.resize(numTiles * kTileVertexSlots);
+    }
+    mesh.meshletIndices.assign(numTiles * kTileIndexSlots, 0);
+    return true;
+}
+
+void MeshGenerator::generateTiles(const cv::Mat& depth, const Intrinsics& intrinsics,
+                                  const std::vector<uint32_t>& tiles, Mesh& mesh) {
+    const std::array<float, 3> invScale = {{1.0f, 1.0f, 1.0f}};  // Unused without Quantized16
+    rays_ = RayTable::get(intrinsics, depth.cols, depth.rows);
+    
+    parallelFor(static_cast<int>(tiles.size()), numThreads_, [&](int i) {
+        Meshlet& tile = mesh.meshlets[tiles[i]];
+        const int u0 = tile.minU;
+        const int v0 = tile.minV;
+        const int tileWidth = tile.maxU - u0 + 1;
+        
+        // Local index of pixel (u, v) is (v - v0) * tileWidth + (u - u0)
+        size_t slot = tile.baseVertex;
+        for (int v = v0; v <= tile.maxV; ++v) {
+            const float* d = depth.ptr<float>(v);
+            for (int u = u0; u <= tile.maxU; ++u) {
+                storeVertex(mesh, slot++, u, v, isValidDepth(d[u]) ? d[u] : 0.0f, intrinsics, invScale);
+            }
+        }
+        
+        // Same edge tests as generate(), on the tile's row segments
+        std::array<uint8_t, kMeshletTileSize + 1> edgeRows[2];
+        auto edgeRow = [&](int v, uint8_t* out) {
+            computeEdgeMaskRow(depth.ptr<float>(v) + u0,
+                               v < tile.maxV ? depth.ptr<float>(v + 1) + u0 : nullptr,
+                               tileWidth, thresholds_, out);
+        };
+        edgeRow(v0, edgeRows[0].data());
+        
+        uint16_t* out = mesh.meshletIndices.data() + tile.indexOffset;
+        uint32_t count = 0;
+        for (int v = v0; v < tile.maxV; ++v) {
+            const uint8_t* e0 = edgeRows[(v - v0) & 1].data();
+            uint8_t* e1 = edgeRows[(v - v0 + 1) & 1].data();
+            edgeRow(v + 1, e1);
+            
+            uint16_t row0 = static_cast<uint16_t>((v - v0) * tileWidth);
+            uint16_t row1 = static_cast<uint16_t>(row0 + tileWidth);
+            for (int x = 0; x + 1 < tileWidth; ++x) {
+                if (upperTriangleUnbroken(e0, x)) {
+                    out[count++] = row0 + x;
+                    out[count++] = row0 + x + 1;
+                    out[count++] = row1 + x + 1;
+                }
+                if (lowerTriangleUnbroken(e0, e1, x)) {
+                    out[count++] = row0 + x;
+                    out[count++] = row1 + x + 1;
+                    out[count++] = row1 + x;
+                }
+            }
+        }
+        tile.indexCount = count;
+    });
 }
 
 } // namespace mesh
@@ -0,0 +1,177 @@
+#include "sequence_mesh.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace rgbd {
+namespace mesh {
+
+namespace {
+
+/**
+ * Check whether a pixel differs from its reference depth beyond the tolerance
+ * Invalid depths only differ from valid ones, whatever their value.
+ */
+inline bool depthChanged(float reference, float z, float tolerance) {
+    bool validReference = isValidDepth(reference);
+    if (validReference != isValidDepth(z)) {
+        return true;
+    }
+    return validReference && std::fabs(z - reference) > tolerance;
+}
+
+bool sameIntrinsics(const Intrinsics& a, const Intrinsics& b) {
+    return a.fx == b.fx && a.fy == b.fy && a.cx == b.cx && a.cy == b.cy &&
+           a.width == b.width && a.height == b.height && a.distortion == b.distortion;
+}
+
+/**
+ * Append [offset, offset + count) to ranges, merging it with an adjacent last range
+ */
+void appendRange(std::vector<BufferRange>& ranges, size_t offset, size_t count) {
+    if (!ranges.empty() && ranges.back().offset + ranges.back().count == offset) {
+        ranges.back().count += count;
+    } else {
+        ranges.emplace_back(offset, count);
+    }
+}
+
+} // namespace
+
+SequenceMesh::SequenceMesh() {}
+
+void SequenceMesh::setThresholds(const DepthThresholds& thresholds) {
+    generator_.setThresholds(thresholds);
+    reset();
+}
+
+void SequenceMesh::setVertexLayout(VertexLayout layout) {
+    generator_.setVertexLayout(layout);
+    reset();
+}
+
+void SequenceMesh::setNumThreads(int numThreads) {
+    generator_.setNumThreads(numThreads);
+    numThreads_ = numThreads;
+}
+
+void SequenceMesh::reset() {
+    reference_.release();
+}
+
+bool SequenceMesh::update(const cv::Mat& depth, const Intrinsics& intrinsics, MeshUpdate& update) {
+    RGBD_TRACE_SCOPE("SequenceMesh::update");
+    if (depth.empty()) {
+        std::cerr << "Error: Empty depth map" << std::endl;
+        return false;
+    }
+
+    cv::Mat depthF;
+    if (depth.type() != CV_32F) {
+        depth.convertTo(depthF, CV_32F);
+    } else {
+        depthF = depth;
+    }
+    const int W = depthF.cols;
+    const int H = depthF.rows;
+
+    // A consumer still holds the last snapshot: write to a copy
+    if (mesh_ && mesh_.use_count() > 1) {
+        mesh_ = std::make_shared<Mesh>(*mesh_);
+    }
+
+    bool rebuild = reference_.empty() || reference_.cols != W || reference_.rows != H ||
+                   !sameIntrinsics(intrinsics, intrinsics_);
+    if (rebuild) {
+        std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+        if (!generator_.initTiledMesh(*mesh, W, H)) {
+            reference_.release();
+            return false;
+        }
+        if (mesh->layout == VertexLayout::DepthPixel && !intrinsics.isPinhole()) {
+            std::cerr << "Error: The depth_pixel vertex layout needs an undistorted source camera"
+                      << std::endl;
+            reference_.release();
+            return false;
+        }
+        mesh_ = mesh;
+        intrinsics_ = intrinsics;
+    }
+    const size_t numTiles = mesh_->meshlets.size();
+    const float tolerance = std::max(0.0f, options_.depthTolerance);
+
+    // A tile changes with any pixel of its vertices, borders included
+    std::vector<uint32_t> tiles;
+    if (!rebuild) {
+        std::vector<uint8_t> changed(numTiles, 0);
+        parallelFor(static_cast<int>(numTiles), numThreads_, [&](int t) {
+            const Meshlet& tile = mesh_->meshlets[t];
+            for (int v = tile.minV; v <= tile.maxV && !changed[t]; ++v) {
+                const float* z = depthF.ptr<float>(v);
+                const float* reference = reference_.ptr<float>(v);
+                for (int u = tile.minU; u <= tile.maxU; ++u) {
+                    if (depthChanged(reference[u], z[u], tolerance)) {
+                        changed[t] = 1;
+                        break;
+                    }
+                }
+            }
+        });
+        for (size_t t = 0; t < numTiles; ++t) {
+            if (changed[t]) {
+                tiles.push_back(static_cast<uint32_t>(t));
+            }
+        }
+        rebuild = tiles.size() > options_.maxChangedFraction * numTiles;
+    }
+
+    if (rebuild) {
+        depthF.copyTo(reference_);
+        tiles.resize(numTiles);
+        for (size_t t = 0; t < numTiles; ++t) {
+            tiles[t] = static_cast<uint32_t>(t);
+        }
+    } else {
+        // Take over the changed pixels. Each tile writes the pixels it owns
+        // (its border pixels belong to the next tile, except at the image
+        // edge); the owner of a changed pixel is among the changed tiles.
+        parallelFor(static_cast<int>(tiles.size()), numThreads_, [&](int i) {
+            const Meshlet& tile = mesh_->meshlets[tiles[i]];
+            int uEnd = (tile.maxU == W - 1) ? W : tile.maxU;
+            int vEnd = (tile.maxV == H - 1) ? H : tile.maxV;
+            for (int v = tile.minV; v < vEnd; ++v) {
+                const float* z = depthF.ptr<float>(v);
+                float* reference = reference_.ptr<float>(v);
+                for (int u = tile.minU; u < uEnd; ++u) {
+                    if (depthChanged(reference[u], z[u], tolerance)) {
+                        reference[u] = z[u];
+                    }
+                }
+            }
+        });
+    }
+
+    // Tiles are built from the reference, so unchanged pixels keep their depth
+    generator_.generateTiles(reference_, intrinsics_, tiles, *mesh_);
+
+    update = MeshUpdate();
+    update.version = ++version_;
+    update.full = rebuild;
+    if (!rebuild) {
+        for (uint32_t t : tiles) {
+            const Meshlet& tile = mesh_->meshlets[t];
+            appendRange(update.vertexRanges, tile.baseVertex, kTileVertexSlots);
+            appendRange(update.indexRanges, tile.indexOffset, kTileIndexSlots);
+        }
+    }
+
+    report_.tiles = numTiles;
+    report_.changedTiles = tiles.size();
+    report_.rebuilt = rebuild;
+    return true;
+}
+
+} // namespace mesh
+} // namespace rgbd
@@ -0,0 +1,580 @@
+#include "cpu_renderer.hpp"
+#include "mesh_generator.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+#if RGBD_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rgbd {
+namespace render {
+
+namespace {
+
+// Vertex positions are snapped to 1/256 pixel like common GL rasterizers
+constexpr int kSubpixelBits = 8;
+constexpr int kSubpixelOne = 1 << kSubpixelBits;
+constexpr int kHalfPixel = kSubpixelOne / 2;
+
+// Triangles whose unclamped bounding box is below this size (in pixels)
+// keep every edge function value of the box, including the 8-wide overshoot
+// past its right end, in int32
+constexpr int kMaxInt32Extent = 112;
+
+// Larger window coordinates do not fit the fixed-point format; such
+// triangles only occur when a vertex grazes the near plane far off-axis
+constexpr float kMaxWindowCoord = 1048576.0f;
+
+// Mesh triangles per setup / binning task
+constexpr size_t kChunkTriangles = 4096;
+
+/**
+ * Same coefficients as GLRenderer::createProjectionMatrix (x and y rows)
+ * plus the viewport transform
+ */
+struct Projection {
+    float m0, m5, m8, m9;
+    float halfW, halfH;
+
+    Projection(const Intrinsics& K) {
+        float W = static_cast<float>(K.width);
+        float H = static_cast<float>(K.height);
+        m0 = 2.0f * K.fx / W;
+        m5 = -2.0f * K.fy / H;
+        m8 = 2.0f * K.cx / W - 1.0f;
+        m9 = 1.0f - 2.0f * K.cy / H;
+        halfW = 0.5f * W;
+        halfH = 0.5f * H;
+    }
+};
+
+struct ClipVertex {
+    float x, y, z;  // Camera space (z is the clip-space w)
+    float u, v;     // Texture coordinates
+};
+
+/**
+ * Triangle ready for rasterization, in window coordinates (y up, like GL)
+ */
+struct SetupTriangle {
+    int32_t x[3], y[3];          // 24.8 fixed point, counter-clockwise
+    float invW[3];               // 1 / camera Z
+    float uOverW[3], vOverW[3];  // Texture coordinates / camera Z
+    int64_t area;                // Twice the area in fixed^2 (> 0)
+    int minX, minY, maxX, maxY;  // Candidate pixel range (inclusive)
+    int32_t extentX, extentY;    // Fixed-point bounding box size, before clamping to the frame
+};
+
+/**
+ * Per-frame render targets shared by all tiles (tiles own disjoint pixels)
+ */
+struct Target {
+    int width;
+    int height;
+    float* invW;     // Depth buffer: largest 1/Z wins
+    uint8_t* rgb;    // Null when RGB is not selected (no texturing)
+    float* depth;
+    uint8_t* mask;
+    const cv::Mat* texture;
+};
+
+/**
+ * Top-left fill rule in image orientation, as GL drivers apply it: for a
+ * counter-clockwise triangle in y-up window coordinates, a pixel center
+ * exactly on an edge belongs to the triangle only if the edge is a left
+ * edge (going down) or a horizontal edge with the interior above it
+ * (going right), i.e. the top edge of the flipped output image.
+ */
+inline bool isTopLeft(int32_t dx, int32_t dy) {
+    return dy < 0 || (dy == 0 && dx > 0);
+}
+
+/**
+ * Clip a polygon against z >= plane (keepAbove) or z <= plane
+ */
+int clipPolygon(const ClipVertex* in, int count, float plane, bool keepAbove, ClipVertex* out) {
+    int n = 0;
+    for (int i = 0; i < count; ++i) {
+        const ClipVertex& a = in[i];
+        const ClipVertex& b = in[(i + 1) % count];
+        bool aInside = keepAbove ? (a.z >= plane) : (a.z <= plane);
+        bool bInside = keepAbove ? (b.z >= plane) : (b.z <= plane);
+        if (aInside) {
+            out[n++] = a;
+        }
+        if (aInside != bInside) {
+            float t = (plane - a.z) / (b.z - a.z);
+            ClipVertex c;
+            c.x = a.x + t * (b.x - a.x);
+            c.y = a.y + t * (b.y - a.y);
+            c.z = plane;
+            c.u = a.u + t * (b.u - a.u);
+            c.v = a.v + t * (b.v - a.v);
+            out[n++] = c;
+        }
+    }
+    return n;
+}
+
+/**
+ * Project, snap and orient one triangle
+ * @return false if it covers no pixel center of the frame
+ */
+bool setupTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2,
+                   const Projection& proj, int width, int height, SetupTriangle& t) {
+    const ClipVertex* v[3] = { &v0, &v1, &v2 };
+    for (int i = 0; i < 3; ++i) {
+        float w = v[i]->z;
+        float winX = (proj.m0 * v[i]->x + proj.m8 * w) / w * proj.halfW + proj.halfW;
+        float winY = (proj.m5 * v[i]->y + proj.m9 * w) / w * proj.halfH + proj.halfH;
+        if (!(std::abs(winX) < kMaxWindowCoord) || !(std::abs(winY) < kMaxWindowCoord)) {
+            return false;
+        }
+        t.x[i] = static_cast<int32_t>(std::lrint(winX * kSubpixelOne));
+        t.y[i] = static_cast<int32_t>(std::lrint(winY * kSubpixelOne));
+        t.invW[i] = 1.0f / w;
+        t.uOverW[i] = v[i]->u * t.invW[i];
+        t.vOverW[i] = v[i]->v * t.invW[i];
+    }
+
+    t.area = static_cast<int64_t>(t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) -
+             static_cast<int64_t>(t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+    if (t.area == 0) {
+        return false;
+    }
+    if (t.area < 0) {
+        std::swap(t.x[1], t.x[2]);
+        std::swap(t.y[1], t.y[2]);
+        std::swap(t.invW[1], t.invW[2]);
+        std::swap(t.uOverW[1], t.uOverW[2]);
+        std::swap(t.vOverW[1], t.vOverW[2]);
+        t.area = -t.area;
+    }
+
+    // Pixels whose center (j + 0.5) lies inside the fixed-point bounding box
+    int32_t minFx = std::min({t.x[0], t.x[1], t.x[2]});
+    int32_t maxFx = std::max({t.x[0], t.x[1], t.x[2]});
+    int32_t minFy = std::min({t.y[0], t.y[1], t.y[2]});
+    int32_t maxFy = std::max({t.y[0], t.y[1], t.y[2]});
+    t.extentX = maxFx - minFx;
+    t.extentY = maxFy - minFy;
+    t.minX = std::max(0, ((minFx - kHalfPixel - 1) >> kSubpixelBits) + 1);
+    t.maxX = std::min(width - 1, (maxFx - kHalfPixel) >> kSubpixelBits);
+    t.minY = std::max(0, ((minFy - kHalfPixel - 1) >> kSubpixelBits) + 1);
+    t.maxY = std::min(height - 1, (maxFy - kHalfPixel) >> kSubpixelBits);
+    return t.minX <= t.maxX && t.minY <= t.maxY;
+}
+
+/**
+ * GL_LINEAR + GL_CLAMP_TO_EDGE sample of an RGB8 texture
+ */
+inline void sampleBilinear(const cv::Mat& texture, float u, float v, uint8_t* rgb) {
+    float x = u * texture.cols - 0.5f;
+    float y = v * texture.rows - 0.5f;
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    float ax = x - fx;
+    float ay = y - fy;
+
+    int x0 = std::min(std::max(static_cast<int>(fx), 0), texture.cols - 1);
+    int y0 = std::min(std::max(static_cast<int>(fy), 0), texture.rows - 1);
+    int x1 = std::min(std::max(static_cast<int>(fx) + 1, 0), texture.cols - 1);
+    int y1 = std::min(std::max(static_cast<int>(fy) + 1, 0), texture.rows - 1);
+
+    const uint8_t* r0 = texture.ptr<uint8_t>(y0);
+    const uint8_t* r1 = texture.ptr<uint8_t>(y1);
+    for (int c = 0; c < 3; ++c) {
+        float top = r0[x0 * 3 + c] + ax * (r0[x1 * 3 + c] - r0[x0 * 3 + c]);
+        float bottom = r1[x0 * 3 + c] + ax * (r1[x1 * 3 + c] - r1[x0 * 3 + c]);
+        rgb[c] = static_cast<uint8_t>(top + ay * (bottom - top) + 0.5f);
+    }
+}
+
+/**
+ * Depth test and shade one covered pixel from its edge function values
+ */
+inline void shadePixel(const SetupTriangle& t, float invArea, int64_t e0, int64_t e1, int64_t e2,
+                       int x, int y, const Target& target) {
+    // Screen-space barycentrics; 1/Z and attribute/Z are linear in screen space
+    float l0 = static_cast<float>(e0) * invArea;
+    float l1 = static_cast<float>(e1) * invArea;
+    float l2 = static_cast<float>(e2) * invArea;
+    float invW = l0 * t.invW[0] + l1 * t.invW[1] + l2 * t.invW[2];
+
+    // Window row y counts from the bottom, output rows from the top
+    size_t idx = static_cast<size_t>(target.height - 1 - y) * target.width + x;
+    if (!(invW > target.invW[idx])) {
+        return;
+    }
+    target.invW[idx] = invW;
+
+    float z = 1.0f / invW;
+    float u = (l0 * t.uOverW[0] + l1 * t.uOverW[1] + l2 * t.uOverW[2]) * z;
+    float v = (l0 * t.vOverW[0] + l1 * t.vOverW[1] + l2 * t.vOverW[2]) * z;
+
+    if (target.rgb) {
+        sampleBilinear(*target.texture, u, v, target.rgb + idx * 3);
+    }
+    target.depth[idx] = z;
+    target.mask[idx] = 255;
+}
+
+/**
+ * Edge function setup for pixel (px, py): E_i is the edge opposite vertex i
+ */
+struct EdgeSetup {
+    int64_t e[3];      // Values at the first pixel center
+    int64_t stepX[3];  // Change per pixel to the right
+    int64_t stepY[3];  // Change per pixel up
+    int64_t bias[3];   // 0 for top-left edges, -1 otherwise
+
+    EdgeSetup(const SetupTriangle& t, int px, int py) {
+        int64_t cx = static_cast<int64_t>(px) * kSubpixelOne + kHalfPixel;
+        int64_t cy = static_cast<int64_t>(py) * kSubpixelOne + kHalfPixel;
+        for (int i = 0; i < 3; ++i) {
+            int a = (i + 1) % 3;
+            int b = (i + 2) % 3;
+            int32_t dx = t.x[b] - t.x[a];
+            int32_t dy = t.y[b] - t.y[a];
+            e[i] = static_cast<int64_t>(dx) * (cy - t.y[a]) - static_cast<int64_t>(dy) * (cx - t.x[a]);
+            stepX[i] = -static_cast<int64_t>(dy) * kSubpixelOne;
+            stepY[i] = static_cast<int64_t>(dx) * kSubpixelOne;
+            bias[i] = isTopLeft(dx, dy) ? 0 : -1;
+        }
+    }
+};
+
+/**
+ * Reference kernel: one pixel at a time in int64
+ */
+void rasterScalar(const SetupTriangle& t, int x0, int y0, int x1, int y1, const Target& target) {
+    EdgeSetup s(t, x0, y0);
+    float invArea = static_cast<float>(1.0 / static_cast<double>(t.area));
+    for (int y = y0; y <= y1; ++y) {
+        int64_t e0 = s.e[0], e1 = s.e[1], e2 = s.e[2];
+        for (int x = x0; x <= x1; ++x) {
+            if (e0 + s.bias[0] >= 0 && e1 + s.bias[1] >= 0 && e2 + s.bias[2] >= 0) {
+                shadePixel(t, invArea, e0, e1, e2, x, y, target);
+            }
+            e0 += s.stepX[0];
+            e1 += s.stepX[1];
+            e2 += s.stepX[2];
+        }
+        for (int i = 0; i < 3; ++i) {
+            s.e[i] += s.stepY[i];
+        }
+    }
+}
+
+#if RGBD_X86_SIMD
+
+/**
+ * AVX2 kernel: coverage of 8 pixels per step with int32 edge functions.
+ * Only used for triangles whose unclamped extent is below kMaxInt32Extent.
+ */
+RGBD_TARGET_AVX2
+void rasterAVX2(const SetupTriangle& t, int x0, int y0, int x1, int y1, const Target& target) {
+    EdgeSetup s(t, x0, y0);
+    float invArea = static_cast<float>(1.0 / static_cast<double>(t.area));
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    __m256i laneOffset[3];
+    __m256i step8[3];
+    for (int i = 0; i < 3; ++i) {
+        laneOffset[i] = _mm256_mullo_epi32(lane, _mm256_set1_epi32(static_cast<int32_t>(s.stepX[i])));
+        step8[i] = _mm256_set1_epi32(static_cast<int32_t>(8 * s.stepX[i]));
+    }
+
+    for (int y = y0; y <= y1; ++y) {
+        // Biased so that "covered" is a plain sign test
+        __m256i e[3];
+        for (int i = 0; i < 3; ++i) {
+            e[i] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int32_t>(s.e[i] + s.bias[i])),
+                                    laneOffset[i]);
+        }
+
+        for (int x = x0; x <= x1; x += 8) {
+            __m256i any = _mm256_or_si256(_mm256_or_si256(e[0], e[1]), e[2]);
+            int outside = _mm256_movemask_ps(_mm256_castsi256_ps(any));
+            int lanes = std::min(8, x1 - x + 1);
+            int covered = ~outside & ((1 << lanes) - 1);
+
+            while (covered) {
+                int k = __builtin_ctz(covered);
+                covered &= covered - 1;
+                shadePixel(t, invArea,
+                           s.e[0] + (x - x0 + k) * s.stepX[0],
+                           s.e[1] + (x - x0 + k) * s.stepX[1],
+                           s.e[2] + (x - x0 + k) * s.stepX[2],
+                           x + k, y, target);
+            }
+
+            for (int i = 0; i < 3; ++i) {
+                e[i] = _mm256_add_epi32(e[i], step8[i]);
+            }
+        }
+        for (int i = 0; i < 3; ++i) {
+            s.e[i] += s.stepY[i];
+        }
+    }
+}
+
+#endif // RGBD_X86_SIMD
+
+/**
+ * Rasterize the part of a triangle inside one tile
+ */
+void rasterTriangle(const SetupTriangle& t, int tileX0, int tileY0, int tileX1, int tileY1,
+                    SimdLevel level, const Target& target) {
+    int x0 = std::max(t.minX, tileX0);
+    int y0 = std::max(t.minY, tileY0);
+    int x1 = std::min(t.maxX, tileX1);
+    int y1 = std::min(t.maxY, tileY1);
+    if (x0 > x1 || y0 > y1) {
+        return;
+    }
+
+#if RGBD_X86_SIMD
+    // Edge functions grow with the whole triangle, not with the clamped
+    // pixel range: a large triangle mostly off-screen stays on int64
+    if (level >= SimdLevel::AVX2 && t.extentX < kMaxInt32Extent * kSubpixelOne &&
+        t.extentY < kMaxInt32Extent * kSubpixelOne) {
+        rasterAVX2(t, x0, y0, x1, y1, target);
+        return;
+    }
+#endif
+    (void)level;
+    rasterScalar(t, x0, y0, x1, y1, target);
+}
+
+/**
+ * Triangles of one chunk of the mesh and the tiles they touch
+ */
+struct Chunk {
+    std::vector<SetupTriangle> triangles;
+    std::vector<std::vector<uint32_t>> bins;  // Per tile: indices into triangles
+};
+
+} // namespace
+
+CpuRenderer::CpuRenderer() {}
+
+CpuRenderer::~CpuRenderer() {
+    cleanup();
+}
+
+bool CpuRenderer::initialize(int gpuDevice) {
+    (void)gpuDevice;
+    if (simdLevel_ > activeSimdLevel()) {
+        simdLevel_ = activeSimdLevel();
+    }
+    initialized_ = true;
+    return true;
+}
+
+bool CpuRenderer::uploadMesh(const Mesh& mesh) {
+    RGBD_TRACE_SCOPE("uploadMesh");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+
+    if (mesh.empty()) {
+        std::cerr << "Error: Empty mesh" << std::endl;
+        return false;
+    }
+
+    mesh_ = mesh;
+
+    // Rasterization walks a plain triangle list
+    if (mesh_.indexMode != IndexMode::Triangles) {
+        mesh_.triangles = mesh::expandTriangles(mesh);
+        mesh_.indexMode = IndexMode::Triangles;
+        mesh_.stripIndices.clear();
+        mesh_.meshletIndices.clear();
+        mesh_.meshlets.clear();
+    }
+    std::cout << "Uploaded mesh: " << mesh_.numVertices() << " vertices, "
+              << mesh_.numTriangles() << " triangles" << std::endl;
+    return true;
+}
+
+bool CpuRenderer::uploadTexture(const cv::Mat& texture) {
+    RGBD_TRACE_SCOPE("uploadTexture");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+
+    if (texture.empty() || texture.depth() != CV_8U) {
+        std::cerr << "Error: Texture must be a non-empty 8-bit image" << std::endl;
+        return false;
+    }
+
+    // Same channel mapping as the GL upload: BGR / BGRA to RGB, gray to red
+    int channels = texture.channels();
+    texture_.create(texture.rows, texture.cols, CV_8UC3);
+    for (int y = 0; y < texture.rows; ++y) {
+        const uint8_t* src = texture.ptr<uint8_t>(y);
+        uint8_t* dst = texture_.ptr<uint8_t>(y);
+        for (int x = 0; x < texture.cols; ++x) {
+            const uint8_t* p = src + x * channels;
+            if (channels >= 3) {
+                dst[x * 3 + 0] = p[2];
+                dst[x * 3 + 1] = p[1];
+                dst[x * 3 + 2] = p[0];
+            } else {
+                dst[x * 3 + 0] = p[0];
+                dst[x * 3 + 1] = 0;
+                dst[x * 3 + 2] = 0;
+            }
+        }
+    }
+
+    std::cout << "Uploaded texture: " << texture.cols << "x" << texture.rows << std::endl;
+    return true;
+}
+
+bool CpuRenderer::render(const Intrinsics& sourceK, const Intrinsics& targetK,
+                         float nearPlane, float farPlane, RenderOutput& output) {
+    RGBD_TRACE_SCOPE("render");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+
+    if (mesh_.empty()) {
+        std::cerr << "Error: No mesh uploaded" << std::endl;
+        return false;
+    }
+
+    if (texture_.empty() && outputs_.rgb) {
+        std::cerr << "Error: No texture uploaded" << std::endl;
+        return false;
+    }
+
+    // DepthPixel vertices are decoded with the pinhole model
+    if (mesh_.layout == VertexLayout::DepthPixel && !sourceK.isPinhole()) {
+        std::cerr << "Error: Lens distortion of the source camera needs the float32 or "
+                  << "quantized16 mesh layout" << std::endl;
+        return false;
+    }
+
+    const int width = targetK.width;
+    const int height = targetK.height;
+    const int tilesX = (width + kTileSize - 1) / kTileSize;
+    const int tilesY = (height + kTileSize - 1) / kTileSize;
+    const int numTiles = tilesX * tilesY;
+    const Projection proj(targetK);
+    const bool distortTarget = !targetK.isPinhole();
+
+    // Depth and mask are a by-product of the depth test, RGB costs texturing
+    output.allocate(width, height);
+    output.clear();
+    if (!outputs_.rgb) {
+        output.rgb.clear();
+    }
+    std::vector<float> invW(static_cast<size_t>(width) * height, 1.0f / farPlane);
+
+    // Pass 1: clip, set up and bin triangles, one task per chunk
+    const size_t numTriangles = mesh_.numTriangles();
+    const int numChunks = static_cast<int>((numTriangles + kChunkTriangles - 1) / kChunkTriangles);
+    std::vector<Chunk> chunks(numChunks);
+
+    parallelFor(numChunks, numThreads_, [&](int c) {
+        Chunk& chunk = chunks[c];
+        chunk.bins.resize(numTiles);
+
+        size_t begin = static_cast<size_t>(c) * kChunkTriangles;
+        size_t end = std::min(begin + kChunkTriangles, numTriangles);
+        for (size_t i = begin; i < end; ++i) {
+            const Triangle& tri = mesh_.triangles[i];
+            ClipVertex polygon[3];
+            const uint32_t ids[3] = { tri.v0, tri.v1, tri.v2 };
+            bool inside = true;
+            for (int k = 0; k < 3; ++k) {
+                Vertex vert = mesh_.vertex(ids[k], sourceK);
+                if (distortTarget && vert.z > 0.0f) {
+                    // Per vertex, like the GL vertex shader
+                    float x = vert.x / vert.z;
+                    float y = vert.y / vert.z;
+                    targetK.distortion.apply(x, y);
+                    vert.x = x * vert.z;
+                    vert.y = y * vert.z;
+                }
+                polygon[k] = { vert.x, vert.y, vert.z, vert.u, vert.v };
+                inside = inside && vert.z >= nearPlane && vert.z <= farPlane;
+            }
+
+            // Clip against the near and far planes like GL does (z in [-w, w])
+            ClipVertex clippedNear[4];
+            ClipVertex clipped[5];
+            const ClipVertex* poly = polygon;
+            int count = 3;
+            if (!inside) {
+                count = clipPolygon(polygon, 3, nearPlane, true, clippedNear);
+                count = clipPolygon(clippedNear, count, farPlane, false, clipped);
+                poly = clipped;
+            }
+
+            for (int k = 1; k + 1 < count; ++k) {
+                SetupTriangle setup;
+                if (!setupTriangle(poly[0], poly[k], poly[k + 1], proj, width, height, setup)) {
+                    continue;
+                }
+
+                uint32_t index = static_cast<uint32_t>(chunk.triangles.size());
+                chunk.triangles.push_back(setup);
+                for (int ty = setup.minY / kTileSize; ty <= setup.maxY / kTileSize; ++ty) {
+                    for (int tx = setup.minX / kTileSize; tx <= setup.maxX / kTileSize; ++tx) {
+                        chunk.bins[ty * tilesX + tx].push_back(index);
+                    }
+                }
+            }
+        }
+    });
+
+    // Pass 2: rasterize tiles; chunks in order keep the draw order per pixel
+    Target target = { width, height, invW.data(), outputs_.rgb ? output.rgb.data() : nullptr,
+                      output.depth.data(), output.mask.data(), &texture_ };
+
+    parallelFor(numTiles, numThreads_, [&](int tile) {
+        int tileX0 = (tile % tilesX) * kTileSize;
+        int tileY0 = (tile / tilesX) * kTileSize;
+        int tileX1 = std::min(tileX0 + kTileSize, width) - 1;
+        int tileY1 = std::min(tileY0 + kTileSize, height) - 1;
+
+        for (const Chunk& chunk : chunks) {
+            for (uint32_t index : chunk.bins[tile]) {
+                rasterTriangle(chunk.triangles[index], tileX0, tileY0, tileX1, tileY1,
+                               simdLevel_, target);
+            }
+        }
+    });
+
+    output.select(outputs_);
+    reportValidPixels(output);
+    return true;
+}
+
+std::string CpuRenderer::getInfo() const {
+    std::ostringstream info;
+    info << "CPU rasterizer: " << resolveThreadCount(numThreads_) << " threads, "
+         << kTileSize << "x" << kTileSize << " tiles, " << simdLevelName(simdLevel_)
+         << " edge functions";
+    return info.str();
+}
+
+void CpuRenderer::cleanup() {
+    mesh_.clear();
+    texture_.release();
+    initialized_ = false;
+}
+
+} // namespace render
+} // namespace rgbd
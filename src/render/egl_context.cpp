@@ -33,6 +33,8 @@ typedef EGLDisplay (*PFNEGLGETPLATFORMDISPLAYEXTPROC_LOCAL)(EGLenum, void*, cons
 
 #include <iostream>
 #include <cstring>
+#include <map>
+#include <mutex>
 
 namespace rgbd {
 namespace render {
@@ -45,12 +47,18 @@ GLContext::~GLContext() {
 
 GLContext::GLContext(GLContext&& other) noexcept 
     : display_(other.display_)
+    , config_(other.config_)
     , context_(other.context_)
     , surface_(other.surface_)
+    , shareGroup_(other.shareGroup_)
+    , device_(other.device_)
     , initialized_(other.initialized_) {
     other.display_ = nullptr;
+    other.config_ = nullptr;
     other.context_ = nullptr;
     other.surface_ = nullptr;
+    other.shareGroup_ = nullptr;
+    other.device_ = -1;
     other.initialized_ = false;
 }
 
@@ -58,53 +66,136 @@ GLContext& GLContext::operator=(GLContext&& other) noexcept {
     if (this != &other) {
         destroy();
         display_ = other.display_;
+        config_ = other.config_;
         context_ = other.context_;
         surface_ = other.surface_;
+        shareGroup_ = other.shareGroup_;
+        device_ = other.device_;
         initialized_ = other.initialized_;
         other.display_ = nullptr;
+        other.config_ = nullptr;
         other.context_ = nullptr;
         other.surface_ = nullptr;
+        other.shareGroup_ = nullptr;
+        other.device_ = -1;
         other.initialized_ = false;
     }
     return *this;
 }
 
-bool GLContext::initialize(int deviceIndex) {
+namespace {
+
+const int kMaxDevices = 16;
+
+/**
+ * Enumerate EGL devices
+ * @return Number of devices written to devices (0 without EGL_EXT_device_enumeration)
+ */
+int queryDevices(void** devices) {
+    auto eglQueryDevicesEXT = (PFNEGLQUERYDEVICESEXTPROC_LOCAL)
+        eglGetProcAddress("eglQueryDevicesEXT");
+    EGLint numDevices = 0;
+    if (!eglQueryDevicesEXT || !eglQueryDevicesEXT(kMaxDevices, devices, &numDevices)) {
+        return 0;
+    }
+    return numDevices;
+}
+
+// A device has one EGLDisplay per process and eglTerminate destroys every
+// context on it, so displays are reference counted across GLContexts
+std::mutex displayMutex;
+std::map<EGLDisplay, int> displayRefs;
+
+bool acquireDisplay(EGLDisplay display) {
+    std::lock_guard<std::mutex> lock(displayMutex);
+    int& refs = displayRefs[display];
+    if (refs == 0) {
+        EGLint major, minor;
+        if (!eglInitialize(display, &major, &minor)) {
+            std::cerr << "Error: Failed to initialize EGL" << std::endl;
+            displayRefs.erase(display);
+            return false;
+        }
+        std::cout << "EGL version: " << major << "." << minor << std::endl;
+    }
+    refs++;
+    return true;
+}
+
+void releaseDisplay(EGLDisplay display) {
+    std::lock_guard<std::mutex> lock(displayMutex);
+    auto it = displayRefs.find(display);
+    if (it != displayRefs.end() && --it->second == 0) {
+        eglTerminate(display);
+        displayRefs.erase(it);
+    }
+}
+
+// glad's entry points dispatch on the current context, loading them once
+// keeps threads from rewriting the pointers other threads are calling
+std::mutex gladMutex;
+bool gladLoaded = false;
+
+bool loadGLFunctions() {
+    std::lock_guard<std::mutex> lock(gladMutex);
+    if (!gladLoaded) {
+        gladLoaded = gladLoadGL() != 0;
+    }
+    return gladLoaded;
+}
+
+} // namespace
+
+int GLContext::queryDeviceCount() {
+    void* devices[kMaxDevices];
+    return queryDevices(devices);
+}
+
+bool GLContext::initialize(int deviceIndex, const GLContext* shareWith) {
     if (initialized_) {
         std::cerr << "EGL context already initialized" << std::endl;
         return true;
     }
+    if (shareWith && !shareWith->initialized_) {
+        std::cerr << "Error: Share context not initialized" << std::endl;
+        return false;
+    }
 
-    // Get EGL display using platform device extension for headless rendering
     EGLDisplay display = EGL_NO_DISPLAY;
+    EGLConfig config = nullptr;
+    EGLContext shareContext = EGL_NO_CONTEXT;
     
-    // Try to get display using platform device extension
-    auto eglQueryDevicesEXT = (PFNEGLQUERYDEVICESEXTPROC_LOCAL)
-        eglGetProcAddress("eglQueryDevicesEXT");
-    auto eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC_LOCAL)
-        eglGetProcAddress("eglGetPlatformDisplayEXT");
-    
-    if (eglQueryDevicesEXT && eglGetPlatformDisplayEXT) {
-        const int maxDevices = 16;
-        void* devices[maxDevices];
-        EGLint numDevices = 0;
+    if (shareWith) {
+        // Same display and config as the share group
+        display = static_cast<EGLDisplay>(shareWith->display_);
+        config = static_cast<EGLConfig>(shareWith->config_);
+        shareContext = static_cast<EGLContext>(shareWith->context_);
+        device_ = shareWith->device_;
+    } else {
+        // Get EGL display using platform device extension for headless rendering
+        auto eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC_LOCAL)
+            eglGetProcAddress("eglGetPlatformDisplayEXT");
         
-        if (eglQueryDevicesEXT(maxDevices, devices, &numDevices) && numDevices > 0) {
+        void* devices[kMaxDevices];
+        int numDevices = queryDevices(devices);
+        if (eglGetPlatformDisplayEXT && numDevices > 0) {
             int targetDevice = (deviceIndex >= 0 && deviceIndex < numDevices) 
                                ? deviceIndex : 0;
             display = eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, 
                                                devices[targetDevice], nullptr);
             
             if (display != EGL_NO_DISPLAY) {
+                device_ = targetDevice;
                 std::cout << "Using EGL device " << targetDevice 
                           << " of " << numDevices << " available" << std::endl;
             }
         }
-    }
-    
-    // Fallback to default display
-    if (display == EGL_NO_DISPLAY) {
-        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        
+        // Fallback to default display
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+            device_ = -1;
+        }
     }
     
     if (display == EGL_NO_DISPLAY) {
@@ -112,44 +203,38 @@ bool GLContext::initialize(int deviceIndex) {
         return false;
     }
     
-    display_ = display;
-    
     // Initialize EGL
-    EGLint major, minor;
-    if (!eglInitialize(display, &major, &minor)) {
-        std::cerr << "Error: Failed to initialize EGL" << std::endl;
-        display_ = nullptr;
+    if (!acquireDisplay(display)) {
         return false;
     }
-    
-    std::cout << "EGL version: " << major << "." << minor << std::endl;
+    display_ = display;
     
     // Choose config
-    const EGLint configAttribs[] = {
-        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
-        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
-        EGL_RED_SIZE, 8,
-        EGL_GREEN_SIZE, 8,
-        EGL_BLUE_SIZE, 8,
-        EGL_ALPHA_SIZE, 8,
-        EGL_DEPTH_SIZE, 24,
-        EGL_NONE
-    };
-    
-    EGLConfig config;
-    EGLint numConfigs;
-    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
-        std::cerr << "Error: Failed to choose EGL config" << std::endl;
-        eglTerminate(display);
-        display_ = nullptr;
-        return false;
+    if (!shareWith) {
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_DEPTH_SIZE, 24,
+            EGL_NONE
+        };
+        
+        EGLint numConfigs;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+            std::cerr << "Error: Failed to choose EGL config" << std::endl;
+            destroy();
+            return false;
+        }
     }
+    config_ = config;
     
     // Bind OpenGL API
     if (!eglBindAPI(EGL_OPENGL_API)) {
         std::cerr << "Error: Failed to bind OpenGL API" << std::endl;
-        eglTerminate(display);
-        display_ = nullptr;
+        destroy();
         return false;
     }
     
@@ -161,7 +246,7 @@ bool GLContext::initialize(int deviceIndex) {
         EGL_NONE
     };
     
-    EGLContext eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    EGLContext eglContext = eglCreateContext(display, config, shareContext, contextAttribs);
     
     // Fallback to OpenGL 4.5
     if (eglContext == EGL_NO_CONTEXT) {
@@ -171,7 +256,7 @@ bool GLContext::initialize(int deviceIndex) {
             EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
             EGL_NONE
         };
-        eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs45);
+        eglContext = eglCreateContext(display, config, shareContext, contextAttribs45);
     }
     
     // Fallback to OpenGL 4.3
@@ -182,17 +267,17 @@ bool GLContext::initialize(int deviceIndex) {
             EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
             EGL_NONE
         };
-        eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs43);
+        eglContext = eglCreateContext(display, config, shareContext, contextAttribs43);
     }
     
     if (eglContext == EGL_NO_CONTEXT) {
         std::cerr << "Error: Failed to create EGL context" << std::endl;
-        eglTerminate(display);
-        display_ = nullptr;
+        destroy();
         return false;
     }
     
     context_ = eglContext;
+    shareGroup_ = shareWith ? shareWith->shareGroup_ : context_;
     
     // Create pbuffer surface (1x1, we'll use FBO for actual rendering)
     const EGLint pbufferAttribs[] = {
@@ -217,7 +302,7 @@ bool GLContext::initialize(int deviceIndex) {
     }
     
     // Load OpenGL functions
-    if (!gladLoadGL()) {
+    if (!loadGLFunctions()) {
         std::cerr << "Error: Failed to load OpenGL functions" << std::endl;
         destroy();
         return false;
@@ -259,6 +344,10 @@ void GLContext::destroy() {
     EGLDisplay display = static_cast<EGLDisplay>(display_);
     
     if (context_) {
+        // A context current on this thread would only be destroyed once released
+        if (eglGetCurrentContext() == static_cast<EGLContext>(context_)) {
+            releaseCurrent();
+        }
         eglDestroyContext(display, static_cast<EGLContext>(context_));
         context_ = nullptr;
     }
@@ -269,10 +358,13 @@ void GLContext::destroy() {
     }
     
     if (display_) {
-        eglTerminate(display);
+        releaseDisplay(display);
         display_ = nullptr;
     }
     
+    config_ = nullptr;
+    shareGroup_ = nullptr;
+    device_ = -1;
     initialized_ = false;
 }
 
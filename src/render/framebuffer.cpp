@@ -1,11 +1,59 @@
 #include "framebuffer.hpp"
+#include "pixel_kernels.hpp"
+#include "trace.hpp"
 #include <glad/glad.h>
 #include <iostream>
-#include <cmath>
 
 namespace rgbd {
 namespace render {
 
+namespace {
+
+// Readback conversions split larger images over all hardware threads
+constexpr int kReadbackThreads = 0;
+
+/**
+ * Texture and pixel transfer formats of color attachment i (RGB, depth, mask)
+ */
+struct TargetFormat {
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+    int bytes;  // Per pixel
+};
+
+TargetFormat targetFormat(int attachment, DepthFormat depthFormat) {
+    switch (attachment) {
+        case 0:
+            return { GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4 };
+        case 1:
+            switch (depthFormat) {
+                case DepthFormat::Float16:
+                    return { GL_R16F, GL_RED, GL_HALF_FLOAT, 2 };
+                case DepthFormat::Millimeters:
+                    // Integer targets transfer with the _INTEGER format
+                    return { GL_R16UI, GL_RED_INTEGER, GL_UNSIGNED_SHORT, 2 };
+                default:
+                    return { GL_R32F, GL_RED, GL_FLOAT, 4 };
+            }
+        default:
+            return { GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1 };
+    }
+}
+
+/**
+ * Check whether the selection renders color attachment i
+ */
+bool hasTarget(const OutputSelection& outputs, int attachment) {
+    switch (attachment) {
+        case 0: return outputs.rgb;
+        case 1: return outputs.rendersDepth();
+        default: return outputs.rendersMask();
+    }
+}
+
+} // namespace
+
 Framebuffer::Framebuffer() {}
 
 Framebuffer::~Framebuffer() {
@@ -15,14 +63,22 @@ Framebuffer::~Framebuffer() {
 Framebuffer::Framebuffer(Framebuffer&& other) noexcept
     : fboId_(other.fboId_)
     , depthRbo_(other.depthRbo_)
+    , depthArrayTexture_(other.depthArrayTexture_)
+    , outputs_(other.outputs_)
+    , fence_(other.fence_)
     , width_(other.width_)
-    , height_(other.height_) {
+    , height_(other.height_)
+    , layers_(other.layers_) {
     for (int i = 0; i < 3; ++i) {
         colorTextures_[i] = other.colorTextures_[i];
+        packBuffers_[i] = other.packBuffers_[i];
         other.colorTextures_[i] = 0;
+        other.packBuffers_[i] = 0;
     }
     other.fboId_ = 0;
     other.depthRbo_ = 0;
+    other.depthArrayTexture_ = 0;
+    other.fence_ = nullptr;
 }
 
 Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept {
@@ -30,66 +86,108 @@ Framebuffer& Framebuffer::operator=(Framebuffer&& other) noexcept {
         destroy();
         fboId_ = other.fboId_;
         depthRbo_ = other.depthRbo_;
+        depthArrayTexture_ = other.depthArrayTexture_;
+        outputs_ = other.outputs_;
+        fence_ = other.fence_;
         width_ = other.width_;
         height_ = other.height_;
+        layers_ = other.layers_;
         for (int i = 0; i < 3; ++i) {
             colorTextures_[i] = other.colorTextures_[i];
+            packBuffers_[i] = other.packBuffers_[i];
             other.colorTextures_[i] = 0;
+            other.packBuffers_[i] = 0;
         }
         other.fboId_ = 0;
         other.depthRbo_ = 0;
+        other.depthArrayTexture_ = 0;
+        other.fence_ = nullptr;
     }
     return *this;
 }
 
-bool Framebuffer::create(int width, int height) {
+bool Framebuffer::create(int width, int height, const OutputSelection& outputs) {
+    return createAttachments(width, height, 0, outputs);
+}
+
+bool Framebuffer::createLayered(int width, int height, int layers, const OutputSelection& outputs) {
+    if (layers < 1) {
+        std::cerr << "Error: Layered framebuffer needs at least one layer" << std::endl;
+        return false;
+    }
+    return createAttachments(width, height, layers, outputs);
+}
+
+bool Framebuffer::createAttachments(int width, int height, int layers, const OutputSelection& outputs) {
     destroy();
     
     width_ = width;
     height_ = height;
+    layers_ = layers;
+    outputs_ = outputs;
+    
+    const bool layered = layers > 0;
+    const GLenum target = layered ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    
+    // Allocate one attachment texture, either 2D or a layers-deep array
+    auto createTexture = [&](GLenum internalFormat, GLenum format, GLenum type) {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        glBindTexture(target, texture);
+        if (layered) {
+            glTexImage3D(target, 0, internalFormat, width, height, layers, 0, format, type, nullptr);
+        } else {
+            glTexImage2D(target, 0, internalFormat, width, height, 0, format, type, nullptr);
+        }
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    };
+    
+    // Attach a texture; layered attachments expose every layer to gl_Layer
+    auto attach = [&](GLenum attachment, GLuint texture) {
+        if (layered) {
+            glFramebufferTexture(GL_FRAMEBUFFER, attachment, texture, 0);
+        } else {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+        }
+    };
     
     // Create framebuffer
     glGenFramebuffers(1, &fboId_);
     glBindFramebuffer(GL_FRAMEBUFFER, fboId_);
     
-    // Create color texture 0: RGB output (RGBA8)
-    glGenTextures(1, &colorTextures_[0]);
-    glBindTexture(GL_TEXTURE_2D, colorTextures_[0]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTextures_[0], 0);
-    
-    // Create color texture 1: Metric depth (R32F)
-    glGenTextures(1, &colorTextures_[1]);
-    glBindTexture(GL_TEXTURE_2D, colorTextures_[1]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, height, 0, GL_RED, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, colorTextures_[1], 0);
-    
-    // Create color texture 2: Mask (R8)
-    glGenTextures(1, &colorTextures_[2]);
-    glBindTexture(GL_TEXTURE_2D, colorTextures_[2]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, colorTextures_[2], 0);
-    
-    // Create depth renderbuffer for z-test
-    glGenRenderbuffers(1, &depthRbo_);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRbo_);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRbo_);
+    // Color textures of the selected outputs: RGB (RGBA8), metric depth
+    // (R32F / R16F / R16UI) and mask (R8). Unselected slots get a GL_NONE
+    // draw buffer, so the fragment locations stay fixed
+    GLenum drawBuffers[3];
+    for (int i = 0; i < 3; ++i) {
+        drawBuffers[i] = GL_NONE;
+        if (!hasTarget(outputs, i)) {
+            continue;
+        }
+        TargetFormat target = targetFormat(i, outputs.depthFormat);
+        colorTextures_[i] = createTexture(target.internalFormat, target.format, target.type);
+        attach(GL_COLOR_ATTACHMENT0 + i, colorTextures_[i]);
+        drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+    }
+    
+    // Depth buffer for z-test. Renderbuffers cannot be layered, so layered
+    // framebuffers use a depth texture array instead
+    if (layered) {
+        depthArrayTexture_ = createTexture(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT);
+        attach(GL_DEPTH_ATTACHMENT, depthArrayTexture_);
+    } else {
+        glGenRenderbuffers(1, &depthRbo_);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRbo_);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRbo_);
+    }
+    glBindTexture(target, 0);
     
     // Set draw buffers
-    GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
     glDrawBuffers(3, drawBuffers);
     
     // Check framebuffer completeness
@@ -98,6 +196,19 @@ bool Framebuffer::create(int width, int height) {
         return false;
     }
     
+    // Pixel-pack buffers for asynchronous readback, one per color texture
+    const GLsizeiptr pixels = static_cast<GLsizeiptr>(width) * height * getLayerCount();
+    for (int i = 0; i < 3; ++i) {
+        if (colorTextures_[i] == 0) {
+            continue;
+        }
+        glGenBuffers(1, &packBuffers_[i]);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers_[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, pixels * targetFormat(i, outputs.depthFormat).bytes,
+                     nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     return true;
 }
@@ -114,20 +225,35 @@ void Framebuffer::unbind() {
 void Framebuffer::clear(float clearDepthValue) const {
     bind();
     
-    // Clear color buffer to black
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    
-    // Clear depth buffer
-    glClearDepthf(1.0f);
-    
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Draw buffer i is color attachment i (or GL_NONE)
+    const GLfloat black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    if (colorTextures_[0] != 0) {
+        glClearBufferfv(GL_COLOR, 0, black);
+    }
+    if (colorTextures_[1] != 0) {
+        if (outputs_.depthFormat == DepthFormat::Millimeters) {
+            const GLuint millimeters[4] = { static_cast<GLuint>(std::lround(clearDepthValue * 1000.0f)), 0, 0, 0 };
+            glClearBufferuiv(GL_COLOR, 1, millimeters);
+        } else {
+            const GLfloat meters[4] = { clearDepthValue, 0.0f, 0.0f, 0.0f };
+            glClearBufferfv(GL_COLOR, 1, meters);
+        }
+    }
+    if (colorTextures_[2] != 0) {
+        glClearBufferfv(GL_COLOR, 2, black);
+    }
     
-    // Clear metric depth texture to clearDepthValue
-    // We'll write the clear value via a simple fullscreen quad or just let the rendering handle it
-    // For now, we rely on the fragment shader to write proper values
+    // Z-buffer to the far plane
+    const GLfloat farDepth = 1.0f;
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
 }
 
 void Framebuffer::readRGB(std::vector<uint8_t>& data) const {
+    RGBD_TRACE_SCOPE("glReadPixels rgb");
+    if (colorTextures_[0] == 0) {
+        data.clear();
+        return;
+    }
     data.resize(width_ * height_ * 3);
     
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId_);
@@ -138,39 +264,35 @@ void Framebuffer::readRGB(std::vector<uint8_t>& data) const {
     std::vector<uint8_t> rgba(width_ * height_ * 4);
     glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
     
-    // Convert RGBA to RGB and flip vertically (OpenGL has origin at bottom-left)
-    for (int y = 0; y < height_; ++y) {
-        int srcY = height_ - 1 - y;  // Flip Y
-        for (int x = 0; x < width_; ++x) {
-            int srcIdx = (srcY * width_ + x) * 4;
-            int dstIdx = (y * width_ + x) * 3;
-            data[dstIdx + 0] = rgba[srcIdx + 0];  // R
-            data[dstIdx + 1] = rgba[srcIdx + 1];  // G
-            data[dstIdx + 2] = rgba[srcIdx + 2];  // B
-        }
-    }
+    kernels::rgbaToRgb(rgba.data(), data.data(), width_, height_, true, false, kReadbackThreads);
 }
 
 void Framebuffer::readDepth(std::vector<float>& data) const {
+    RGBD_TRACE_SCOPE("glReadPixels depth");
+    if (colorTextures_[1] == 0) {
+        data.clear();
+        return;
+    }
     data.resize(width_ * height_);
     
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId_);
     glReadBuffer(GL_COLOR_ATTACHMENT1);
-    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
     
-    std::vector<float> raw(width_ * height_);
-    glReadPixels(0, 0, width_, height_, GL_RED, GL_FLOAT, raw.data());
+    TargetFormat target = targetFormat(1, outputs_.depthFormat);
+    std::vector<uint8_t> raw(static_cast<size_t>(width_) * height_ * target.bytes);
+    glReadPixels(0, 0, width_, height_, target.format, target.type, raw.data());
     
-    // Flip vertically
-    for (int y = 0; y < height_; ++y) {
-        int srcY = height_ - 1 - y;
-        for (int x = 0; x < width_; ++x) {
-            data[y * width_ + x] = raw[srcY * width_ + x];
-        }
-    }
+    kernels::depthToFloat(raw.data(), outputs_.depthFormat, data.data(), width_, height_, true,
+                          kReadbackThreads);
 }
 
 void Framebuffer::readMask(std::vector<uint8_t>& data) const {
+    RGBD_TRACE_SCOPE("glReadPixels mask");
+    if (colorTextures_[2] == 0) {
+        data.clear();
+        return;
+    }
     data.resize(width_ * height_);
     
     glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId_);
@@ -180,16 +302,166 @@ void Framebuffer::readMask(std::vector<uint8_t>& data) const {
     std::vector<uint8_t> raw(width_ * height_);
     glReadPixels(0, 0, width_, height_, GL_RED, GL_UNSIGNED_BYTE, raw.data());
     
-    // Flip vertically
-    for (int y = 0; y < height_; ++y) {
-        int srcY = height_ - 1 - y;
-        for (int x = 0; x < width_; ++x) {
-            data[y * width_ + x] = raw[srcY * width_ + x];
+    kernels::copyRows(raw.data(), data.data(), width_, height_, true, kReadbackThreads);
+}
+
+void Framebuffer::beginReadback() {
+    RGBD_TRACE_SCOPE("glReadPixels async");
+    if (fence_ != nullptr) {
+        glDeleteSync(static_cast<GLsync>(fence_));
+        fence_ = nullptr;
+    }
+    
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    
+    if (layers_ > 0) {
+        // One glGetTexImage per attachment copies every layer at once
+        for (int i = 0; i < 3; ++i) {
+            if (colorTextures_[i] == 0) {
+                continue;
+            }
+            TargetFormat target = targetFormat(i, outputs_.depthFormat);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers_[i]);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, colorTextures_[i]);
+            glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, target.format, target.type, nullptr);
         }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        
+        fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        return;
     }
+    
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId_);
+    
+    // With a pack buffer bound, glReadPixels only queues the copy and the
+    // pointer argument is an offset into the buffer
+    for (int i = 0; i < 3; ++i) {
+        if (colorTextures_[i] == 0) {
+            continue;
+        }
+        TargetFormat target = targetFormat(i, outputs_.depthFormat);
+        glReadBuffer(GL_COLOR_ATTACHMENT0 + i);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers_[i]);
+        glReadPixels(0, 0, width_, height_, target.format, target.type, nullptr);
+    }
+    
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    fence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    
+    // Make sure the queued commands actually reach the GPU
+    glFlush();
+}
+
+bool Framebuffer::isReadbackComplete() const {
+    if (fence_ == nullptr) {
+        return false;
+    }
+    
+    GLint status = GL_UNSIGNALED;
+    glGetSynciv(static_cast<GLsync>(fence_), GL_SYNC_STATUS, 1, nullptr, &status);
+    return status == GL_SIGNALED;
+}
+
+bool Framebuffer::finishReadback(RenderOutput& output) {
+    if (getLayerCount() != 1) {
+        std::cerr << "Error: Layered readback needs one output per layer" << std::endl;
+        return false;
+    }
+    return finishReadbackInto(&output);
+}
+
+bool Framebuffer::finishReadback(std::vector<RenderOutput>& outputs) {
+    outputs.resize(getLayerCount());
+    return finishReadbackInto(outputs.data());
+}
+
+bool Framebuffer::finishReadbackInto(RenderOutput* outputs) {
+    RGBD_TRACE_SCOPE("finishReadback");
+    if (fence_ == nullptr) {
+        std::cerr << "Error: No readback pending" << std::endl;
+        return false;
+    }
+    
+    // Wait in one-second slices until the transfer is done
+    GLsync sync = static_cast<GLsync>(fence_);
+    GLenum result;
+    do {
+        result = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    } while (result == GL_TIMEOUT_EXPIRED);
+    glDeleteSync(sync);
+    fence_ = nullptr;
+    
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "Error: Waiting for readback fence failed" << std::endl;
+        return false;
+    }
+    
+    const int layers = getLayerCount();
+    const size_t layerPixels = static_cast<size_t>(width_) * height_;
+    for (int layer = 0; layer < layers; ++layer) {
+        outputs[layer].allocate(width_, height_, outputs_);
+    }
+    
+    bool ok = true;
+    for (int i = 0; i < 3; ++i) {
+        if (packBuffers_[i] == 0) {
+            continue;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, packBuffers_[i]);
+        const void* mapped = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (mapped == nullptr) {
+            std::cerr << "Error: Failed to map readback buffer" << std::endl;
+            ok = false;
+            break;
+        }
+        
+        // Layers are stored back to back, each bottom-up
+        for (int layer = 0; layer < layers; ++layer) {
+            RenderOutput& output = outputs[layer];
+            switch (i) {
+                case 0:
+                    kernels::rgbaToRgb(static_cast<const uint8_t*>(mapped) + layer * layerPixels * 4,
+                                       output.rgb.data(), width_, height_, true, false, kReadbackThreads);
+                    break;
+                case 1:
+                    kernels::depthToFloat(static_cast<const uint8_t*>(mapped) +
+                                              layer * layerPixels * targetFormat(1, outputs_.depthFormat).bytes,
+                                          outputs_.depthFormat, output.depth.data(), width_, height_, true,
+                                          kReadbackThreads);
+                    break;
+                default:
+                    kernels::copyRows(static_cast<const uint8_t*>(mapped) + layer * layerPixels,
+                                      output.mask.data(), width_, height_, true, kReadbackThreads);
+                    break;
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    
+    // Derive a depth-based mask, drop depth rendered only for it
+    for (int layer = 0; ok && layer < layers; ++layer) {
+        outputs[layer].select(outputs_);
+    }
+    return ok;
 }
 
 void Framebuffer::destroy() {
+    if (fence_ != nullptr) {
+        glDeleteSync(static_cast<GLsync>(fence_));
+        fence_ = nullptr;
+    }
+    
+    for (int i = 0; i < 3; ++i) {
+        if (packBuffers_[i] != 0) {
+            glDeleteBuffers(1, &packBuffers_[i]);
+            packBuffers_[i] = 0;
+        }
+    }
+    
     if (fboId_ != 0) {
         glDeleteFramebuffers(1, &fboId_);
         fboId_ = 0;
@@ -207,8 +479,14 @@ void Framebuffer::destroy() {
         depthRbo_ = 0;
     }
     
+    if (depthArrayTexture_ != 0) {
+        glDeleteTextures(1, &depthArrayTexture_);
+        depthArrayTexture_ = 0;
+    }
+    
     width_ = 0;
     height_ = 0;
+    layers_ = 0;
 }
 
 bool Framebuffer::checkStatus() const {
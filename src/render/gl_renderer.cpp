@@ -1,8 +1,13 @@
 #include "gl_renderer.hpp"
+#include "mesh_generator.hpp"
+#include "trace.hpp"
 #include <glad/glad.h>
 #include <iostream>
+#include <cstddef>
 #include <cstring>
 #include <cmath>
+#include <algorithm>
+#include <atomic>
 
 namespace rgbd {
 namespace render {
@@ -11,24 +16,226 @@ namespace render {
 static const char* vertexShaderSource = R"(
 #version 330 core
 
+#if defined(DEPTH_PIXEL_VERTEX)
+// DepthPixelVertex: position and UV rebuilt from the source pixel
+layout(location = 0) in float aDepth;    // Metric depth
+layout(location = 1) in vec2 aPixel;     // Source pixel (u, v)
+uniform vec4 uSourceK;                   // Source fx, fy, cx, cy
+uniform vec2 uSourceSize;                // Source width, height
+#elif defined(QUANTIZED_VERTEX)
+// QuantizedVertex: 16-bit normalized position and UV
+layout(location = 0) in vec3 aPosition;  // Position in [0, 1] of the mesh bounds
+layout(location = 1) in vec2 aTexCoord;  // Texture coordinates
+uniform vec3 uPositionOffset;
+uniform vec3 uPositionScale;
+#else
 layout(location = 0) in vec3 aPosition;  // Camera-space position (X, Y, Z)
 layout(location = 1) in vec2 aTexCoord;  // Texture coordinates
+#endif
 
 uniform mat4 uProjection;
 
+// Target lens distortion (plumb_bob, see Distortion in types.hpp), applied
+// to the normalized coordinates of each vertex before the projection
+uniform bool uDistort;
+uniform vec4 uDistortion;    // k1, k2, p1, p2
+uniform float uDistortionK3;
+
+vec3 distortTarget(vec3 p) {
+    if (!uDistort || p.z <= 0.0) return p;
+    vec2 n = p.xy / p.z;
+    float r2 = dot(n, n);
+    float radial = 1.0 + r2 * (uDistortion.x + r2 * (uDistortion.y + r2 * uDistortionK3));
+    vec2 d = n * radial +
+             vec2(2.0 * uDistortion.z * n.x * n.y + uDistortion.w * (r2 + 2.0 * n.x * n.x),
+                  uDistortion.z * (r2 + 2.0 * n.y * n.y) + 2.0 * uDistortion.w * n.x * n.y);
+    return vec3(d * p.z, p.z);
+}
+
+#ifdef LAYERED
+// Batch variant: one instance per target view, projections from a UBO.
+// Outputs are renamed for the geometry shader that routes them to gl_Layer.
+layout(std140) uniform LayerProjections {
+    mat4 uLayerProjections[MAX_LAYERS];
+};
+flat out int gLayer;
+#define vTexCoord gTexCoord
+#define vDepth gDepth
+#endif
+
 out vec2 vTexCoord;
 out float vDepth;
 
 void main() {
+#if defined(DEPTH_PIXEL_VERTEX)
+    // Back-project the pixel center exactly like MeshGenerator::backproject
+    vec2 center = aPixel + 0.5;
+    vec3 position = vec3((center.x - uSourceK.z) / uSourceK.x * aDepth,
+                         (center.y - uSourceK.w) / uSourceK.y * aDepth,
+                         aDepth);
+    vec2 texCoord = center / uSourceSize;
+#elif defined(QUANTIZED_VERTEX)
+    vec3 position = uPositionOffset + aPosition * uPositionScale;
+    vec2 texCoord = aTexCoord;
+#else
+    vec3 position = aPosition;
+    vec2 texCoord = aTexCoord;
+#endif
+    
+    vec3 projected = distortTarget(position);
+#ifdef LAYERED
+    gLayer = gl_InstanceID;
+    gl_Position = uLayerProjections[gl_InstanceID] * vec4(projected, 1.0);
+#else
     // Transform to clip space using projection matrix
-    gl_Position = uProjection * vec4(aPosition, 1.0);
+    gl_Position = uProjection * vec4(projected, 1.0);
+#endif
     
     // Pass through texture coordinates and metric depth
-    vTexCoord = aTexCoord;
-    vDepth = aPosition.z;  // Camera-space Z is the metric depth
+    vTexCoord = texCoord;
+    vDepth = position.z;  // Camera-space Z is the metric depth
+}
+)";
+
+// Implicit grid: one instance per quad row, six vertices per quad.
+// Rebuilds the mesh triangles from the depth texture and applies the same
+// DepthThresholds rule as MeshGenerator; broken triangles are moved outside
+// the clip volume so they produce no fragments.
+static const char* gridVertexShaderSource = R"(
+#version 330 core
+
+uniform mat4 uProjection;
+uniform sampler2D uDepthTexture;  // R32F metric depth
+uniform vec4 uSourceK;            // Source fx, fy, cx, cy
+uniform ivec2 uGridSize;          // Depth map width, height
+uniform float uTauRel;
+uniform float uTauAbs;
+
+// Target lens distortion (plumb_bob, see Distortion in types.hpp), applied
+// to the normalized coordinates of each vertex before the projection
+uniform bool uDistort;
+uniform vec4 uDistortion;    // k1, k2, p1, p2
+uniform float uDistortionK3;
+
+vec3 distortTarget(vec3 p) {
+    if (!uDistort || p.z <= 0.0) return p;
+    vec2 n = p.xy / p.z;
+    float r2 = dot(n, n);
+    float radial = 1.0 + r2 * (uDistortion.x + r2 * (uDistortion.y + r2 * uDistortionK3));
+    vec2 d = n * radial +
+             vec2(2.0 * uDistortion.z * n.x * n.y + uDistortion.w * (r2 + 2.0 * n.x * n.x),
+                  uDistortion.z * (r2 + 2.0 * n.y * n.y) + 2.0 * uDistortion.w * n.x * n.y);
+    return vec3(d * p.z, p.z);
+}
+
+#ifdef LAYERED
+layout(std140) uniform LayerProjections {
+    mat4 uLayerProjections[MAX_LAYERS];
+};
+flat out int gLayer;
+#define vTexCoord gTexCoord
+#define vDepth gDepth
+#endif
+
+out vec2 vTexCoord;
+out float vDepth;
+
+// Triangle 1: v00, v10, v11 / Triangle 2: v00, v11, v01
+const ivec2 kCorners[6] = ivec2[6](
+    ivec2(0, 0), ivec2(1, 0), ivec2(1, 1),
+    ivec2(0, 0), ivec2(1, 1), ivec2(0, 1)
+);
+
+bool isDiscontinuity(float z1, float z2) {
+    if (isnan(z1) || isinf(z1) || isnan(z2) || isinf(z2)) return true;
+    if (z1 <= 0.0 || z2 <= 0.0) return true;
+    
+    float diff = abs(z1 - z2);
+    float min_z = min(z1, z2);
+    float max_z = max(z1, z2);
+    
+    if (diff / min_z > uTauRel) return true;
+    
+    float adaptive_abs = uTauAbs * max(1.0, max_z / 2.0);
+    return diff > adaptive_abs;
+}
+
+bool isValidTriangle(float z0, float z1, float z2) {
+    return !isDiscontinuity(z0, z1) && !isDiscontinuity(z1, z2) && !isDiscontinuity(z2, z0);
+}
+
+void main() {
+    int corner = gl_VertexID % 6;
+#ifdef LAYERED
+    // Instances are grouped per view, H-1 quad rows each
+    int rows = uGridSize.y - 1;
+    int layer = gl_InstanceID / rows;
+    int row = gl_InstanceID - layer * rows;
+    gLayer = layer;
+    mat4 projection = uLayerProjections[layer];
+#else
+    int row = gl_InstanceID;
+    mat4 projection = uProjection;
+#endif
+    ivec2 quad = ivec2(gl_VertexID / 6, row);
+    
+    float z00 = texelFetch(uDepthTexture, quad, 0).r;
+    float z10 = texelFetch(uDepthTexture, quad + ivec2(1, 0), 0).r;
+    float z01 = texelFetch(uDepthTexture, quad + ivec2(0, 1), 0).r;
+    float z11 = texelFetch(uDepthTexture, quad + ivec2(1, 1), 0).r;
+    
+    bool valid = (corner < 3) ? isValidTriangle(z00, z10, z11)
+                              : isValidTriangle(z00, z11, z01);
+    if (!valid) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        vTexCoord = vec2(0.0);
+        vDepth = 0.0;
+        return;
+    }
+    
+    // Back-project the pixel center exactly like MeshGenerator::backproject
+    ivec2 pixel = quad + kCorners[corner];
+    float z = texelFetch(uDepthTexture, pixel, 0).r;
+    vec2 center = vec2(pixel) + 0.5;
+    vec3 position = vec3((center.x - uSourceK.z) / uSourceK.x * z,
+                         (center.y - uSourceK.w) / uSourceK.y * z,
+                         z);
+    
+    gl_Position = projection * vec4(distortTarget(position), 1.0);
+    vTexCoord = center / vec2(uGridSize);
+    vDepth = z;
 }
 )";
 
+// Layered batch: forwards each triangle unchanged to the texture array
+// layer of its view
+static const char* layerGeometryShaderSource = R"(
+#version 330 core
+
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 3) out;
+
+flat in int gLayer[];
+in vec2 gTexCoord[];
+in float gDepth[];
+
+out vec2 vTexCoord;
+out float vDepth;
+
+void main() {
+    for (int i = 0; i < 3; ++i) {
+        gl_Layer = gLayer[i];
+        gl_Position = gl_in[i].gl_Position;
+        vTexCoord = gTexCoord[i];
+        vDepth = gDepth[i];
+        EmitVertex();
+    }
+    EndPrimitive();
+}
+)";
+
+// Variants declare only the selected render targets (OUT_RGB, OUT_DEPTH,
+// OUT_MASK); locations match the framebuffer's color attachments
 static const char* fragmentShaderSource = R"(
 #version 330 core
 
@@ -37,25 +244,51 @@ in float vDepth;
 
 uniform sampler2D uRGBTexture;
 
+#ifdef OUT_RGB
 layout(location = 0) out vec4 outColor;     // RGB output
-layout(location = 1) out float outDepth;    // Metric depth output
+#endif
+#if defined(OUT_DEPTH) && defined(DEPTH_MILLIMETERS)
+layout(location = 1) out uint outDepth;     // Depth output in millimeters (R16UI)
+#elif defined(OUT_DEPTH)
+layout(location = 1) out float outDepth;    // Metric depth output (R32F / R16F)
+#endif
+#ifdef OUT_MASK
 layout(location = 2) out float outMask;     // Validity mask output
+#endif
 
 void main() {
+#ifdef OUT_RGB
     // Sample RGB texture
-    vec4 color = texture(uRGBTexture, vTexCoord);
-    
-    // Output RGB
-    outColor = color;
+    outColor = texture(uRGBTexture, vTexCoord);
+#endif
     
+#if defined(OUT_DEPTH) && defined(DEPTH_MILLIMETERS)
+    // Rounded to millimeters, clamped to the 16-bit range
+    outDepth = uint(min(vDepth * 1000.0 + 0.5, 65535.0));
+#elif defined(OUT_DEPTH)
     // Output metric depth (camera Z in meters)
     outDepth = vDepth;
+#endif
     
+#ifdef OUT_MASK
     // Output mask (1.0 = valid rendered pixel)
     outMask = 1.0;
+#endif
 }
 )";
 
+// Uniform buffer binding point of the LayerProjections block
+static const uint32_t kLayerProjectionBinding = 0;
+
+// Command layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
 GLRenderer::GLRenderer() {}
 
 GLRenderer::~GLRenderer() {
@@ -63,12 +296,24 @@ GLRenderer::~GLRenderer() {
 }
 
 bool GLRenderer::initialize(int gpuDevice) {
+    return initializeContext(gpuDevice, nullptr);
+}
+
+bool GLRenderer::initializeShared(const GLRenderer& owner) {
+    if (!owner.initialized_) {
+        std::cerr << "Error: Share group owner not initialized" << std::endl;
+        return false;
+    }
+    return initializeContext(-1, &owner.eglContext_);
+}
+
+bool GLRenderer::initializeContext(int gpuDevice, const GLContext* shareWith) {
     if (initialized_) {
         return true;
     }
     
     // Initialize EGL context
-    if (!eglContext_.initialize(gpuDevice)) {
+    if (!eglContext_.initialize(gpuDevice, shareWith)) {
         std::cerr << "Error: Failed to initialize EGL context" << std::endl;
         return false;
     }
@@ -85,22 +330,198 @@ bool GLRenderer::initialize(int gpuDevice) {
         return false;
     }
     
+    // Framebuffers are created lazily at the first render of each slot
+    ring_.resize(pipelineDepth_);
+    
+    static std::atomic<int> contexts(0);
+    gpuTimer_.setTrackName("GPU context " + std::to_string(contexts++));
+    
     initialized_ = true;
     return true;
 }
 
+void GLRenderer::ProgramUniforms::resolve(const Shader& shader) {
+    projection = shader.uniform("uProjection");
+    rgbTexture = shader.uniform("uRGBTexture");
+    depthTexture = shader.uniform("uDepthTexture");
+    sourceK = shader.uniform("uSourceK");
+    sourceSize = shader.uniform("uSourceSize");
+    gridSize = shader.uniform("uGridSize");
+    tauRel = shader.uniform("uTauRel");
+    tauAbs = shader.uniform("uTauAbs");
+    positionOffset = shader.uniform("uPositionOffset");
+    positionScale = shader.uniform("uPositionScale");
+    distort = shader.uniform("uDistort");
+    distortion = shader.uniform("uDistortion");
+    distortionK3 = shader.uniform("uDistortionK3");
+}
+
+const Shader& GLRenderer::ProgramSet::shader(bool grid, bool layered, VertexLayout layout) const {
+    if (grid) {
+        return layered ? layeredGridShader : gridShader;
+    }
+    const int index = static_cast<int>(layout);
+    return layered ? layeredMeshShaders[index] : meshShaders[index];
+}
+
+const GLRenderer::ProgramUniforms& GLRenderer::ProgramSet::uniforms(bool grid, bool layered,
+                                                                    VertexLayout layout) const {
+    if (grid) {
+        return layered ? layeredGridUniforms : gridUniforms;
+    }
+    const int index = static_cast<int>(layout);
+    return layered ? layeredMeshUniforms[index] : meshUniforms[index];
+}
+
+void GLRenderer::ProgramSet::destroy() {
+    for (int i = 0; i < kNumVertexLayouts; ++i) {
+        meshShaders[i].destroy();
+        layeredMeshShaders[i].destroy();
+    }
+    gridShader.destroy();
+    layeredGridShader.destroy();
+}
+
 bool GLRenderer::initShaders() {
-    return shader_.loadFromSource(vertexShaderSource, fragmentShaderSource);
+    return getPrograms() != nullptr;
+}
+
+const GLRenderer::ProgramSet* GLRenderer::getPrograms() {
+    auto it = programSets_.find(outputs_.key());
+    if (it != programSets_.end()) {
+        return it->second.get();
+    }
+    
+    std::unique_ptr<ProgramSet> programs(new ProgramSet());
+    if (!buildPrograms(outputs_, *programs)) {
+        programs->destroy();
+        std::cerr << "Error: Failed to build shaders for the selected outputs" << std::endl;
+        return nullptr;
+    }
+    const ProgramSet* built = programs.get();
+    programSets_[outputs_.key()] = std::move(programs);
+    return built;
+}
+
+bool GLRenderer::buildPrograms(const OutputSelection& outputs, ProgramSet& programs) const {
+    programs.gridShader.setBinaryCacheDir(shaderCacheDir_);
+    programs.layeredGridShader.setBinaryCacheDir(shaderCacheDir_);
+    for (int i = 0; i < kNumVertexLayouts; ++i) {
+        programs.meshShaders[i].setBinaryCacheDir(shaderCacheDir_);
+        programs.layeredMeshShaders[i].setBinaryCacheDir(shaderCacheDir_);
+    }
+    
+    // Fragment shader variant of the selected render targets
+    std::vector<std::string> targets;
+    if (outputs.rgb) targets.push_back("OUT_RGB");
+    if (outputs.rendersDepth()) targets.push_back("OUT_DEPTH");
+    if (outputs.rendersMask()) targets.push_back("OUT_MASK");
+    if (outputs.depthFormat == DepthFormat::Millimeters) targets.push_back("DEPTH_MILLIMETERS");
+    const std::string fragmentSource = Shader::injectDefines(fragmentShaderSource, targets);
+    
+    if (!programs.gridShader.loadFromSource(gridVertexShaderSource, fragmentSource)) {
+        return false;
+    }
+    
+    // Layered variants for renderBatch
+    const std::vector<std::string> layered = {
+        "LAYERED", "MAX_LAYERS " + std::to_string(kMaxBatchLayers)
+    };
+    if (!programs.layeredGridShader.loadFromSource(Shader::injectDefines(gridVertexShaderSource, layered),
+                                                   layerGeometryShaderSource, fragmentSource)) {
+        return false;
+    }
+    programs.layeredGridShader.bindUniformBlock("LayerProjections", kLayerProjectionBinding);
+    
+    // One mesh program per vertex layout, indexed by VertexLayout
+    const char* layoutDefines[kNumVertexLayouts] = {
+        nullptr, "DEPTH_PIXEL_VERTEX", "QUANTIZED_VERTEX"
+    };
+    for (int i = 0; i < kNumVertexLayouts; ++i) {
+        std::vector<std::string> defines;
+        if (layoutDefines[i]) {
+            defines.push_back(layoutDefines[i]);
+        }
+        std::vector<std::string> layeredDefines = defines;
+        layeredDefines.insert(layeredDefines.end(), layered.begin(), layered.end());
+        
+        if (!programs.meshShaders[i].loadFromSource(Shader::injectDefines(vertexShaderSource, defines),
+                                                    fragmentSource) ||
+            !programs.layeredMeshShaders[i].loadFromSource(
+                Shader::injectDefines(vertexShaderSource, layeredDefines),
+                layerGeometryShaderSource, fragmentSource)) {
+            return false;
+        }
+        programs.layeredMeshShaders[i].bindUniformBlock("LayerProjections", kLayerProjectionBinding);
+    }
+    
+    programs.gridUniforms.resolve(programs.gridShader);
+    programs.layeredGridUniforms.resolve(programs.layeredGridShader);
+    int cached = (programs.gridShader.isFromCache() ? 1 : 0) +
+                 (programs.layeredGridShader.isFromCache() ? 1 : 0);
+    for (int i = 0; i < kNumVertexLayouts; ++i) {
+        programs.meshUniforms[i].resolve(programs.meshShaders[i]);
+        programs.layeredMeshUniforms[i].resolve(programs.layeredMeshShaders[i]);
+        cached += (programs.meshShaders[i].isFromCache() ? 1 : 0) +
+                  (programs.layeredMeshShaders[i].isFromCache() ? 1 : 0);
+    }
+    if (!shaderCacheDir_.empty()) {
+        std::cout << "Shader cache: " << cached << "/" << 2 + 2 * kNumVertexLayouts
+                  << " programs loaded from " << shaderCacheDir_ << std::endl;
+    }
+    return true;
 }
 
 bool GLRenderer::createBuffers() {
     glGenVertexArrays(1, &vao_);
     glGenBuffers(1, &vbo_);
     glGenBuffers(1, &ebo_);
+    
+    // The implicit grid has no vertex attributes, but core profile
+    // still requires a bound VAO to draw
+    glGenVertexArrays(1, &gridVao_);
+    
+    // Visible meshlet commands, per renderer since culling depends on the view
+    glGenBuffers(1, &indirectBuffer_);
+    
+    // Per-layer projection matrices (std140 mat4 array, no padding)
+    glGenBuffers(1, &layerUbo_);
+    glBindBuffer(GL_UNIFORM_BUFFER, layerUbo_);
+    glBufferData(GL_UNIFORM_BUFFER, kMaxBatchLayers * 16 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
     return true;
 }
 
 void GLRenderer::deleteBuffers() {
+    if (layerUbo_ != 0) {
+        glDeleteBuffers(1, &layerUbo_);
+        layerUbo_ = 0;
+    }
+    
+    if (indirectBuffer_ != 0) {
+        glDeleteBuffers(1, &indirectBuffer_);
+        indirectBuffer_ = 0;
+    }
+    
+    // Shared geometry is deleted by its owner
+    if (!ownsGeometry_) {
+        vbo_ = 0;
+        ebo_ = 0;
+        rgbTexture_ = 0;
+        depthTexture_ = 0;
+        ownsGeometry_ = true;
+    }
+    
+    if (depthTexture_ != 0) {
+        glDeleteTextures(1, &depthTexture_);
+        depthTexture_ = 0;
+    }
+    
+    if (gridVao_ != 0) {
+        glDeleteVertexArrays(1, &gridVao_);
+        gridVao_ = 0;
+    }
+    
     if (rgbTexture_ != 0) {
         glDeleteTextures(1, &rgbTexture_);
         rgbTexture_ = 0;
@@ -122,7 +543,111 @@ void GLRenderer::deleteBuffers() {
     }
 }
 
+void GLRenderer::setVertexAttributes(VertexLayout layout) {
+    switch (layout) {
+        case VertexLayout::DepthPixel:
+            // Depth (float) + pixel coordinate (two uint16, converted to float)
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, sizeof(DepthPixelVertex),
+                                  reinterpret_cast<void*>(offsetof(DepthPixelVertex, z)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(DepthPixelVertex),
+                                  reinterpret_cast<void*>(offsetof(DepthPixelVertex, px)));
+            break;
+        case VertexLayout::Quantized16:
+            // Position and UV as normalized uint16
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex),
+                                  reinterpret_cast<void*>(offsetof(QuantizedVertex, x)));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(QuantizedVertex),
+                                  reinterpret_cast<void*>(offsetof(QuantizedVertex, u)));
+            break;
+        default:
+            // Each vertex: 3 floats position + 2 floats UV = 5 floats
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                  reinterpret_cast<void*>(0));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                                  reinterpret_cast<void*>(3 * sizeof(float)));
+            break;
+    }
+}
+
+void GLRenderer::ownGeometry() {
+    if (ownsGeometry_) {
+        return;
+    }
+    // Forget the owner's objects; textures are created again on upload
+    rgbTexture_ = 0;
+    depthTexture_ = 0;
+    numIndices_ = 0;
+    numTriangles_ = 0;
+    vertexBufferBytes_ = 0;
+    indexBufferBytes_ = 0;
+    gridWidth_ = 0;
+    gridHeight_ = 0;
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+    ownsGeometry_ = true;
+}
+
+bool GLRenderer::shareGeometry(const GLRenderer& owner) {
+    if (&owner == this) {
+        return true;
+    }
+    if (!initialized_ || !eglContext_.sharesObjectsWith(owner.eglContext_)) {
+        std::cerr << "Error: Renderers are not in one share group" << std::endl;
+        return false;
+    }
+    
+    // Drop our own objects, then reference the owner's
+    if (ownsGeometry_) {
+        glDeleteBuffers(1, &vbo_);
+        glDeleteBuffers(1, &ebo_);
+        if (rgbTexture_ != 0) glDeleteTextures(1, &rgbTexture_);
+        if (depthTexture_ != 0) glDeleteTextures(1, &depthTexture_);
+    }
+    vbo_ = owner.vbo_;
+    ebo_ = owner.ebo_;
+    rgbTexture_ = owner.rgbTexture_;
+    depthTexture_ = owner.depthTexture_;
+    ownsGeometry_ = false;
+    
+    numIndices_ = owner.numIndices_;
+    numTriangles_ = owner.numTriangles_;
+    indexMode_ = owner.indexMode_;
+    meshlets_ = owner.meshlets_;
+    meshLayout_ = owner.meshLayout_;
+    positionOffset_ = owner.positionOffset_;
+    positionScale_ = owner.positionScale_;
+    gridWidth_ = owner.gridWidth_;
+    gridHeight_ = owner.gridHeight_;
+    gridThresholds_ = owner.gridThresholds_;
+    mode_ = owner.mode_;
+    
+    // Vertex arrays are per context: describe the shared buffers in ours
+    if (numIndices_ > 0) {
+        glBindVertexArray(vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        setVertexAttributes(meshLayout_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        glBindVertexArray(0);
+    }
+    return true;
+}
+
+void GLRenderer::finishUploads() {
+    glFinish();
+}
+
 bool GLRenderer::uploadMesh(const Mesh& mesh) {
+    return uploadMeshBuffers(mesh, GL_STATIC_DRAW);
+}
+
+bool GLRenderer::uploadMeshBuffers(const Mesh& mesh, uint32_t usage) {
+    RGBD_TRACE_SCOPE("uploadMesh");
     if (!initialized_) {
         std::cerr << "Error: Renderer not initialized" << std::endl;
         return false;
@@ -133,44 +658,223 @@ bool GLRenderer::uploadMesh(const Mesh& mesh) {
         return false;
     }
     
+    ownGeometry();
+    gpuTimer_.begin("uploadMesh");
     glBindVertexArray(vao_);
-    
-    // Upload vertex data
-    // Each vertex: 3 floats position + 2 floats UV = 5 floats
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-    glBufferData(GL_ARRAY_BUFFER, 
-                 mesh.vertices.size() * sizeof(Vertex),
-                 mesh.vertices.data(), 
-                 GL_STATIC_DRAW);
     
-    // Position attribute (location 0)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 
-                          reinterpret_cast<void*>(0));
+    // Upload the vertex stream and describe its layout
+    switch (mesh.layout) {
+        case VertexLayout::DepthPixel:
+            glBufferData(GL_ARRAY_BUFFER,
+                         mesh.depthVertices.size() * sizeof(DepthPixelVertex),
+                         mesh.depthVertices.data(),
+                         usage);
+            break;
+        case VertexLayout::Quantized16:
+            glBufferData(GL_ARRAY_BUFFER,
+                         mesh.quantizedVertices.size() * sizeof(QuantizedVertex),
+                         mesh.quantizedVertices.data(),
+                         usage);
+            break;
+        default:
+            glBufferData(GL_ARRAY_BUFFER,
+                         mesh.vertices.size() * sizeof(Vertex),
+                         mesh.vertices.data(),
+                         usage);
+            break;
+    }
+    setVertexAttributes(mesh.layout);
     
-    // Texture coordinate attribute (location 1)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), 
-                          reinterpret_cast<void*>(3 * sizeof(float)));
+    vertexBufferBytes_ = mesh.numVertices() * mesh.vertexStride();
+    indexBufferBytes_ = mesh.indexBytes();
+    meshLayout_ = mesh.layout;
+    positionOffset_ = mesh.positionOffset;
+    positionScale_ = mesh.positionScale;
     
     // Upload index data
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                 mesh.triangles.size() * sizeof(Triangle),
-                 mesh.triangles.data(),
-                 GL_STATIC_DRAW);
-    
-    numIndices_ = mesh.triangles.size() * 3;
+    meshlets_.clear();
+    switch (mesh.indexMode) {
+        case IndexMode::Strips:
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                         mesh.stripIndices.size() * sizeof(uint32_t),
+                         mesh.stripIndices.data(),
+                         usage);
+            numIndices_ = mesh.stripIndices.size();
+            break;
+        case IndexMode::Meshlets:
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                         mesh.meshletIndices.size() * sizeof(uint16_t),
+                         mesh.meshletIndices.data(),
+                         usage);
+            numIndices_ = mesh.meshletIndices.size();
+            
+            // Ranges and bounds, culled against every target view
+            meshlets_ = mesh.meshlets;
+            break;
+        default:
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                         mesh.triangles.size() * sizeof(Triangle),
+                         mesh.triangles.data(),
+                         usage);
+            numIndices_ = mesh.triangles.size() * 3;
+            break;
+    }
+    indexMode_ = mesh.indexMode;
+    numTriangles_ = mesh.numTriangles();
     
     glBindVertexArray(0);
+    gpuTimer_.end();
+    
+    std::cout << "Uploaded mesh: " << mesh.numVertices() << " vertices ("
+              << mesh::vertexLayoutName(mesh.layout) << ", "
+              << mesh.numVertices() * mesh.vertexStride() / 1024 << " KiB), "
+              << mesh.numTriangles() << " triangles ("
+              << mesh::indexModeName(mesh.indexMode) << ", "
+              << mesh.indexBytes() / 1024 << " KiB)" << std::endl;
+    
+    return true;
+}
+
+bool GLRenderer::updateMesh(const Mesh& mesh, const MeshUpdate& update) {
+    RGBD_TRACE_SCOPE("updateMesh");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+    
+    // Ranges only apply to our own buffers holding the previous version
+    const size_t stride = mesh.vertexStride();
+    bool inPlace = !update.full && ownsGeometry_ && numIndices_ > 0 &&
+                   meshLayout_ == mesh.layout && indexMode_ == mesh.indexMode &&
+                   vertexBufferBytes_ == mesh.numVertices() * stride &&
+                   indexBufferBytes_ == mesh.indexBytes();
+    if (!inPlace) {
+        // Sequences rewrite parts of the buffers every frame
+        return uploadMeshBuffers(mesh, GL_DYNAMIC_DRAW);
+    }
+    if (mesh.empty()) {
+        std::cerr << "Error: Empty mesh" << std::endl;
+        return false;
+    }
+    
+    const uint8_t* vertices;
+    switch (mesh.layout) {
+        case VertexLayout::DepthPixel:
+            vertices = reinterpret_cast<const uint8_t*>(mesh.depthVertices.data());
+            break;
+        case VertexLayout::Quantized16:
+            vertices = reinterpret_cast<const uint8_t*>(mesh.quantizedVertices.data());
+            break;
+        default:
+            vertices = reinterpret_cast<const uint8_t*>(mesh.vertices.data());
+            break;
+    }
+    const uint8_t* indices;
+    size_t indexStride;
+    switch (mesh.indexMode) {
+        case IndexMode::Strips:
+            indices = reinterpret_cast<const uint8_t*>(mesh.stripIndices.data());
+            indexStride = sizeof(uint32_t);
+            break;
+        case IndexMode::Meshlets:
+            indices = reinterpret_cast<const uint8_t*>(mesh.meshletIndices.data());
+            indexStride = sizeof(uint16_t);
+            break;
+        default:
+            indices = reinterpret_cast<const uint8_t*>(mesh.triangles.data());
+            indexStride = sizeof(Triangle);
+            break;
+    }
+    
+    size_t written = 0;
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    for (const BufferRange& range : update.vertexRanges) {
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(range.offset * stride),
+                        static_cast<GLsizeiptr>(range.count * stride), vertices + range.offset * stride);
+        written += range.count * stride;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    // The element binding is vertex array state, write through another target
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ebo_);
+    for (const BufferRange& range : update.indexRanges) {
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.offset * indexStride),
+                        static_cast<GLsizeiptr>(range.count * indexStride),
+                        indices + range.offset * indexStride);
+        written += range.count * indexStride;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    
+    if (mesh.indexMode == IndexMode::Meshlets) {
+        meshlets_ = mesh.meshlets;
+    }
+    numTriangles_ = mesh.numTriangles();
+    
+    std::cout << "Updated mesh: " << update.vertexRanges.size() + update.indexRanges.size()
+              << " ranges, " << written / 1024 << " of "
+              << (vertexBufferBytes_ + indexBufferBytes_) / 1024 << " KiB, "
+              << numTriangles_ << " triangles" << std::endl;
+    return true;
+}
+
+bool GLRenderer::uploadDepth(const cv::Mat& depth, const DepthThresholds& thresholds) {
+    RGBD_TRACE_SCOPE("uploadDepth");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+    
+    if (depth.empty() || depth.cols < 2 || depth.rows < 2) {
+        std::cerr << "Error: Depth map too small for implicit grid" << std::endl;
+        return false;
+    }
+    
+    ownGeometry();
+    
+    cv::Mat depthF;
+    if (depth.type() != CV_32F) {
+        depth.convertTo(depthF, CV_32F);
+    } else {
+        depthF = depth;
+    }
+    
+    if (depthTexture_ == 0) {
+        glGenTextures(1, &depthTexture_);
+    }
     
-    std::cout << "Uploaded mesh: " << mesh.vertices.size() << " vertices, "
-              << mesh.triangles.size() << " triangles" << std::endl;
+    glBindTexture(GL_TEXTURE_2D, depthTexture_);
+    
+    // Only read with texelFetch, NEAREST keeps the texture complete without mipmaps
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, static_cast<GLint>(depthF.step / sizeof(float)));
+    gpuTimer_.begin("uploadDepth");
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F,
+                 depthF.cols, depthF.rows, 0,
+                 GL_RED, GL_FLOAT, depthF.data);
+    gpuTimer_.end();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    gridWidth_ = depthF.cols;
+    gridHeight_ = depthF.rows;
+    gridThresholds_ = thresholds;
+    
+    std::cout << "Uploaded depth grid: " << gridWidth_ << "x" << gridHeight_
+              << " (" << (gridWidth_ * gridHeight_ * sizeof(float)) / 1024 << " KiB)" << std::endl;
     
     return true;
 }
 
 bool GLRenderer::uploadTexture(const cv::Mat& texture) {
+    RGBD_TRACE_SCOPE("uploadTexture");
     if (!initialized_) {
         std::cerr << "Error: Renderer not initialized" << std::endl;
         return false;
@@ -181,6 +885,8 @@ bool GLRenderer::uploadTexture(const cv::Mat& texture) {
         return false;
     }
     
+    ownGeometry();
+    
     // Create texture if needed
     if (rgbTexture_ == 0) {
         glGenTextures(1, &rgbTexture_);
@@ -204,9 +910,11 @@ bool GLRenderer::uploadTexture(const cv::Mat& texture) {
     }
     
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gpuTimer_.begin("uploadTexture");
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 
                  texture.cols, texture.rows, 0,
                  format, GL_UNSIGNED_BYTE, texture.data);
+    gpuTimer_.end();
     
     glBindTexture(GL_TEXTURE_2D, 0);
     
@@ -262,85 +970,361 @@ void GLRenderer::createProjectionMatrix(const Intrinsics& K,
 
 bool GLRenderer::render(const Intrinsics& sourceK, const Intrinsics& targetK,
                         float nearPlane, float farPlane, RenderOutput& output) {
-    if (!initialized_) {
-        std::cerr << "Error: Renderer not initialized" << std::endl;
+    // A blocking render is a submit immediately followed by its retrieve,
+    // which would hand back the wrong result if older renders were queued
+    if (!pending_.empty()) {
+        std::cerr << "Error: Cannot render while " << pending_.size()
+                  << " submitted renders are pending" << std::endl;
         return false;
     }
     
-    if (numIndices_ == 0) {
-        std::cerr << "Error: No mesh uploaded" << std::endl;
+    return submit(sourceK, targetK, nearPlane, farPlane) && retrieve(output);
+}
+
+bool GLRenderer::submit(const Intrinsics& sourceK, const Intrinsics& targetK,
+                        float nearPlane, float farPlane) {
+    RGBD_TRACE_SCOPE("submit");
+    if (!checkReady(sourceK)) {
+        return false;
+    }
+    const ProgramSet* programs = getPrograms();
+    if (!programs) {
         return false;
     }
     
-    if (rgbTexture_ == 0) {
-        std::cerr << "Error: No texture uploaded" << std::endl;
+    if (pending_.size() >= ring_.size()) {
+        std::cerr << "Error: Readback ring full (" << ring_.size()
+                  << " renders pending)" << std::endl;
         return false;
     }
     
     int outWidth = targetK.width;
     int outHeight = targetK.height;
     
-    // Create or resize framebuffer
-    if (!framebuffer_.isValid() || 
-        framebuffer_.getWidth() != outWidth || 
-        framebuffer_.getHeight() != outHeight) {
-        if (!framebuffer_.create(outWidth, outHeight)) {
+    // Slots are handed out round-robin and retrieved in order, so the next
+    // slot is never one with a readback still in flight
+    int slot = nextSlot_;
+    Framebuffer& framebuffer = ring_[slot];
+    
+    // Create or resize framebuffer (or change its render targets)
+    if (!framebuffer.isValid() || 
+        framebuffer.getWidth() != outWidth || 
+        framebuffer.getHeight() != outHeight ||
+        framebuffer.getOutputs() != outputs_) {
+        if (!framebuffer.create(outWidth, outHeight, outputs_)) {
             std::cerr << "Error: Failed to create framebuffer" << std::endl;
             return false;
         }
     }
     
-    // Bind framebuffer
-    framebuffer_.bind();
+    draw(*programs, sourceK, targetK, nearPlane, farPlane, framebuffer);
     
-    // Clear
-    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-    glClearDepthf(1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Queue the readback behind the draw; returns without stalling
+    gpuTimer_.begin("readback");
+    framebuffer.beginReadback();
+    gpuTimer_.end();
+    Framebuffer::unbind();
     
-    // Enable depth testing
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+    pending_.push_back(slot);
+    nextSlot_ = (nextSlot_ + 1) % static_cast<int>(ring_.size());
+    return true;
+}
+
+bool GLRenderer::retrieve(RenderOutput& output) {
+    RGBD_TRACE_SCOPE("retrieve");
+    if (pending_.empty()) {
+        std::cerr << "Error: No render pending" << std::endl;
+        return false;
+    }
     
-    // Disable face culling (we want to see both sides)
-    glDisable(GL_CULL_FACE);
+    int slot = pending_.front();
+    pending_.pop_front();
+    gpuTimer_.poll();
+    
+    if (!ring_[slot].finishReadback(output)) {
+        return false;
+    }
+    
+    reportValidPixels(output);
+    return true;
+}
+
+bool GLRenderer::renderBatch(const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs,
+                             float nearPlane, float farPlane, std::vector<RenderOutput>& outputs) {
+    RGBD_TRACE_SCOPE("renderBatch");
+    outputs.clear();
+    if (!checkReady(sourceK)) {
+        return false;
+    }
+    if (targetKs.empty()) {
+        return true;
+    }
+    
+    // All views share the texture array, hence one output size
+    int outWidth = targetKs[0].width;
+    int outHeight = targetKs[0].height;
+    for (const Intrinsics& targetK : targetKs) {
+        if (targetK.width != outWidth || targetK.height != outHeight) {
+            std::cerr << "Error: Batch targets must share one output size" << std::endl;
+            return false;
+        }
+        if (targetK.distortion != targetKs[0].distortion) {
+            std::cerr << "Error: Batch targets must share one lens distortion" << std::endl;
+            return false;
+        }
+    }
+    
+    const ProgramSet* programs = getPrograms();
+    if (!programs) {
+        return false;
+    }
+    const bool grid = (mode_ == RenderMode::ImplicitGrid);
+    const Shader& shader = programs->shader(grid, true, meshLayout_);
+    const ProgramUniforms& uniforms = programs->uniforms(grid, true, meshLayout_);
+    const int numViews = static_cast<int>(targetKs.size());
+    outputs.reserve(numViews);
+    
+    // One pass per kMaxBatchLayers views
+    for (int first = 0; first < numViews; first += kMaxBatchLayers) {
+        int layers = std::min(kMaxBatchLayers, numViews - first);
+        
+        if (!layeredFramebuffer_.isValid() ||
+            layeredFramebuffer_.getWidth() != outWidth ||
+            layeredFramebuffer_.getHeight() != outHeight ||
+            layeredFramebuffer_.getLayerCount() != layers ||
+            layeredFramebuffer_.getOutputs() != outputs_) {
+            if (!layeredFramebuffer_.createLayered(outWidth, outHeight, layers, outputs_)) {
+                std::cerr << "Error: Failed to create layered framebuffer" << std::endl;
+                return false;
+            }
+        }
+        
+        // Upload per-layer projections
+        float projections[kMaxBatchLayers * 16];
+        for (int layer = 0; layer < layers; ++layer) {
+            createProjectionMatrix(targetKs[first + layer], nearPlane, farPlane,
+                                   projections + layer * 16);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, layerUbo_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, layers * 16 * sizeof(float), projections);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, kLayerProjectionBinding, layerUbo_);
+        
+        // Draw every view in one instanced submission, then read all layers back
+        gpuTimer_.begin("drawLayers");
+        beginPass(layeredFramebuffer_);
+        shader.use();
+        std::vector<Intrinsics> layerKs(targetKs.begin() + first, targetKs.begin() + first + layers);
+        drawGeometry(shader, uniforms, sourceK, layerKs);
+        gpuTimer_.end();
+        
+        gpuTimer_.begin("readback");
+        layeredFramebuffer_.beginReadback();
+        gpuTimer_.end();
+        Framebuffer::unbind();
+        
+        std::vector<RenderOutput> layerOutputs;
+        bool read = layeredFramebuffer_.finishReadback(layerOutputs);
+        gpuTimer_.poll();
+        if (!read) {
+            outputs.clear();
+            return false;
+        }
+        for (RenderOutput& output : layerOutputs) {
+            reportValidPixels(output);
+            outputs.push_back(std::move(output));
+        }
+    }
+    
+    return true;
+}
+
+void GLRenderer::setPipelineDepth(int depth) {
+    if (!pending_.empty()) {
+        std::cerr << "Warning: Cannot resize readback ring while renders are pending"
+                  << std::endl;
+        return;
+    }
+    
+    pipelineDepth_ = std::max(1, depth);
+    if (initialized_) {
+        ring_.resize(pipelineDepth_);
+        nextSlot_ = 0;
+    }
+}
+
+bool GLRenderer::checkReady(const Intrinsics& sourceK) const {
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+    
+    if (mode_ == RenderMode::Mesh && numIndices_ == 0) {
+        std::cerr << "Error: No mesh uploaded" << std::endl;
+        return false;
+    }
+    
+    if (mode_ == RenderMode::ImplicitGrid && depthTexture_ == 0) {
+        std::cerr << "Error: No depth grid uploaded" << std::endl;
+        return false;
+    }
+    
+    // The grid and DepthPixel shaders back-project with the pinhole model;
+    // distorted sources need a mesh built from MeshGenerator's ray table
+    if (!sourceK.isPinhole() &&
+        (mode_ == RenderMode::ImplicitGrid || meshLayout_ == VertexLayout::DepthPixel)) {
+        std::cerr << "Error: Lens distortion of the source camera needs the float32 or "
+                  << "quantized16 mesh layout" << std::endl;
+        return false;
+    }
+    
+    // Texture is only sampled for the RGB output
+    if (rgbTexture_ == 0 && outputs_.rgb) {
+        std::cerr << "Error: No texture uploaded" << std::endl;
+        return false;
+    }
+    
+    if (outputs_.empty()) {
+        std::cerr << "Error: No outputs selected" << std::endl;
+        return false;
+    }
+    
+    return true;
+}
+
+void GLRenderer::draw(const ProgramSet& programs, const Intrinsics& sourceK, const Intrinsics& targetK,
+                      float nearPlane, float farPlane, Framebuffer& framebuffer) {
+    RGBD_TRACE_SCOPE("draw");
+    gpuTimer_.begin("draw");
+    beginPass(framebuffer);
     
     // Use shader
-    shader_.use();
+    const bool grid = (mode_ == RenderMode::ImplicitGrid);
+    const Shader& shader = programs.shader(grid, false, meshLayout_);
+    const ProgramUniforms& uniforms = programs.uniforms(grid, false, meshLayout_);
+    shader.use();
     
     // Set projection matrix
     float projMatrix[16];
     createProjectionMatrix(targetK, nearPlane, farPlane, projMatrix);
-    shader_.setUniformMatrix4("uProjection", projMatrix);
+    shader.setUniformMatrix4(uniforms.projection, projMatrix);
+    
+    drawGeometry(shader, uniforms, sourceK, { targetK });
+    gpuTimer_.end();
+}
+
+void GLRenderer::beginPass(const Framebuffer& framebuffer) {
+    // Bind and clear (all layers of a layered framebuffer)
+    framebuffer.clear();
+    
+    // Enable depth testing
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    
+    // Disable face culling (we want to see both sides)
+    glDisable(GL_CULL_FACE);
+}
+
+void GLRenderer::drawGeometry(const Shader& shader, const ProgramUniforms& uniforms,
+                              const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs) {
+    const int views = static_cast<int>(targetKs.size());
     
     // Bind texture
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, rgbTexture_);
-    shader_.setUniform("uRGBTexture", 0);
+    shader.setUniform(uniforms.rgbTexture, 0);
     
-    // Draw mesh
-    glBindVertexArray(vao_);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(numIndices_), GL_UNSIGNED_INT, nullptr);
-    glBindVertexArray(0);
+    // Target lens distortion, shared by every view (checked by renderBatch)
+    const Distortion& distortion = targetKs[0].distortion;
+    shader.setUniform(uniforms.distort, distortion.isZero() ? 0 : 1);
+    shader.setUniform(uniforms.distortion, distortion.k1, distortion.k2, distortion.p1, distortion.p2);
+    shader.setUniform(uniforms.distortionK3, distortion.k3);
     
-    // Read back results
-    output.allocate(outWidth, outHeight);
-    framebuffer_.readRGB(output.rgb);
-    framebuffer_.readDepth(output.depth);
-    framebuffer_.readMask(output.mask);
-    
-    // Unbind
-    Framebuffer::unbind();
-    
-    // Count valid pixels
-    int validCount = 0;
-    for (uint8_t m : output.mask) {
-        if (m > 0) validCount++;
+    if (mode_ == RenderMode::ImplicitGrid) {
+        // Bind depth grid and source camera for in-shader back-projection
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, depthTexture_);
+        shader.setUniform(uniforms.depthTexture, 1);
+        shader.setUniform(uniforms.sourceK, sourceK.fx, sourceK.fy, sourceK.cx, sourceK.cy);
+        shader.setUniform(uniforms.gridSize, gridWidth_, gridHeight_);
+        shader.setUniform(uniforms.tauRel, gridThresholds_.tau_rel);
+        shader.setUniform(uniforms.tauAbs, gridThresholds_.tau_abs);
+        
+        // Draw (W-1) quads per instance, one instance per quad row and view
+        glBindVertexArray(gridVao_);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, 6 * (gridWidth_ - 1), (gridHeight_ - 1) * views);
+        drawnTriangles_ = static_cast<size_t>(gridWidth_ - 1) * (gridHeight_ - 1) * 2;
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    } else {
+        // Compact layouts are decoded in the vertex shader
+        if (meshLayout_ == VertexLayout::DepthPixel) {
+            shader.setUniform(uniforms.sourceK, sourceK.fx, sourceK.fy, sourceK.cx, sourceK.cy);
+            shader.setUniform(uniforms.sourceSize, static_cast<float>(sourceK.width),
+                          static_cast<float>(sourceK.height));
+        } else if (meshLayout_ == VertexLayout::Quantized16) {
+            shader.setUniform(uniforms.positionOffset, positionOffset_[0], positionOffset_[1], positionOffset_[2]);
+            shader.setUniform(uniforms.positionScale, positionScale_[0], positionScale_[1], positionScale_[2]);
+        }
+        
+        // Draw mesh, once per view when layered
+        glBindVertexArray(vao_);
+        if (indexMode_ == IndexMode::Meshlets) {
+            drawMeshlets(sourceK, targetKs, views);
+        } else {
+            GLenum primitive = GL_TRIANGLES;
+            if (indexMode_ == IndexMode::Strips) {
+                primitive = GL_TRIANGLE_STRIP;
+                glEnable(GL_PRIMITIVE_RESTART);
+                glPrimitiveRestartIndex(kStripRestart);
+            }
+            if (views > 1) {
+                glDrawElementsInstanced(primitive, static_cast<GLsizei>(numIndices_),
+                                        GL_UNSIGNED_INT, nullptr, views);
+            } else {
+                glDrawElements(primitive, static_cast<GLsizei>(numIndices_), GL_UNSIGNED_INT, nullptr);
+            }
+            glDisable(GL_PRIMITIVE_RESTART);
+            drawnTriangles_ = numTriangles_;
+        }
+        glBindVertexArray(0);
+    }
+}
+
+void GLRenderer::drawMeshlets(const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs,
+                              int views) {
+    // One command per visible meshlet, instanced once per layered view
+    std::vector<DrawElementsIndirectCommand> commands;
+    commands.reserve(meshlets_.size());
+    drawnTriangles_ = 0;
+    for (const Meshlet& meshlet : meshlets_) {
+        bool visible = !meshletCulling_;
+        for (size_t i = 0; i < targetKs.size() && !visible; ++i) {
+            visible = mesh::meshletVisible(meshlet, sourceK, targetKs[i]);
+        }
+        if (!visible || meshlet.indexCount == 0) {
+            continue;
+        }
+        DrawElementsIndirectCommand command;
+        command.count = meshlet.indexCount;
+        command.instanceCount = static_cast<GLuint>(views);
+        command.firstIndex = meshlet.indexOffset;
+        command.baseVertex = static_cast<GLint>(meshlet.baseVertex);
+        command.baseInstance = 0;
+        commands.push_back(command);
+        drawnTriangles_ += meshlet.indexCount / 3;
+    }
+    if (commands.empty()) {
+        return;
     }
-    std::cout << "Rendered " << validCount << " valid pixels ("
-              << (100.0f * validCount / (outWidth * outHeight)) << "%)" << std::endl;
     
-    return true;
+    // Orphaned on every draw, earlier draws may still read the old commands
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer_);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand),
+                 commands.data(), GL_STREAM_DRAW);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr,
+                                static_cast<GLsizei>(commands.size()), 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 }
 
 std::string GLRenderer::getGLInfo() const {
@@ -350,8 +1334,17 @@ std::string GLRenderer::getGLInfo() const {
 }
 
 void GLRenderer::cleanup() {
-    framebuffer_.destroy();
-    shader_.destroy();
+    if (initialized_) {
+        gpuTimer_.destroy();
+    }
+    pending_.clear();
+    ring_.clear();
+    nextSlot_ = 0;
+    layeredFramebuffer_.destroy();
+    for (auto& programs : programSets_) {
+        programs.second->destroy();
+    }
+    programSets_.clear();
     deleteBuffers();
     eglContext_.destroy();
     initialized_ = false;
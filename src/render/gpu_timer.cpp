@@ -0,0 +1,88 @@
+#include "gpu_timer.hpp"
+#include "trace.hpp"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace rgbd {
+namespace render {
+
+namespace {
+
+// Ended queries kept in flight before begin() waits for the oldest one
+constexpr size_t kMaxQueriesInFlight = 64;
+
+} // namespace
+
+void GpuTimer::begin(const char* name) {
+    if (!trace::enabled() || open_) {
+        return;
+    }
+    collect(inFlight_.size() >= kMaxQueriesInFlight);
+
+    if (free_.empty()) {
+        GLuint id = 0;
+        glGenQueries(1, &id);
+        free_.push_back(id);
+    }
+    active_ = { free_.back(), name, trace::now() };
+    free_.pop_back();
+    glBeginQuery(GL_TIME_ELAPSED, active_.id);
+    open_ = true;
+}
+
+void GpuTimer::end() {
+    if (!open_) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    inFlight_.push_back(active_);
+    open_ = false;
+}
+
+void GpuTimer::poll() {
+    if (!inFlight_.empty()) {
+        collect(false);
+    }
+}
+
+void GpuTimer::collect(bool wait) {
+    // Results become available in submission order
+    while (!inFlight_.empty()) {
+        Query& query = inFlight_.front();
+        if (!wait) {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                break;
+            }
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &elapsed);
+
+        if (trace::enabled()) {
+            if (track_ == 0) {
+                track_ = trace::addTrack(trackName_);
+            }
+            int64_t start = std::max(query.submitted, gpuEnd_);
+            trace::record(track_, query.name, start, static_cast<int64_t>(elapsed));
+            gpuEnd_ = start + static_cast<int64_t>(elapsed);
+        }
+        free_.push_back(query.id);
+        inFlight_.pop_front();
+        wait = false;
+    }
+}
+
+void GpuTimer::destroy() {
+    end();
+    while (!inFlight_.empty()) {
+        collect(true);
+    }
+    if (!free_.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(free_.size()), free_.data());
+        free_.clear();
+    }
+}
+
+} // namespace render
+} // namespace rgbd
@@ -0,0 +1,301 @@
+#include "render_pool.hpp"
+#include "egl_context.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <sstream>
+
+namespace rgbd {
+namespace render {
+
+RenderPool::RenderPool() {}
+
+RenderPool::~RenderPool() {
+    shutdown();
+}
+
+bool RenderPool::initialize(const RenderPoolOptions& options) {
+    if (!workers_.empty()) {
+        return true;
+    }
+
+    std::vector<int> eglDevices = options.devices;
+    if (eglDevices.empty()) {
+        // Every device, or the default display without device enumeration
+        int count = GLContext::queryDeviceCount();
+        for (int i = 0; i < count; ++i) {
+            eglDevices.push_back(i);
+        }
+        if (eglDevices.empty()) {
+            eglDevices.push_back(-1);
+        }
+    }
+    const int perDevice = std::max(1, options.contextsPerDevice);
+
+    bool ok = true;
+    for (int eglDevice : eglDevices) {
+        Device device;
+        device.eglDevice = eglDevice;
+        device.frameMutex.reset(new std::mutex());
+
+        // The first context starts the share group, the others join it
+        std::vector<std::unique_ptr<Worker>> created;
+        std::vector<std::future<bool>> ready;
+        std::vector<bool> up;
+        for (int c = 0; c < perDevice; ++c) {
+            std::unique_ptr<Worker> worker(new Worker());
+            worker->device = static_cast<int>(devices_.size());
+            std::promise<bool> promise;
+            ready.push_back(promise.get_future());
+            const GLRenderer* shareWith = (c == 0) ? nullptr : &created[0]->renderer;
+            worker->thread = std::thread(&RenderPool::workerLoop, this, std::ref(*worker), eglDevice,
+                                         std::cref(options), shareWith, std::move(promise));
+            created.push_back(std::move(worker));
+
+            // Shared contexts need the first one
+            if (c == 0) {
+                up.push_back(ready[0].get());
+                if (!up[0]) {
+                    break;
+                }
+            }
+        }
+
+        // Keep the contexts that came up
+        for (size_t c = 0; c < created.size(); ++c) {
+            if (c > 0) {
+                up.push_back(ready[c].get());
+            }
+            if (!up[c]) {
+                created[c]->thread.join();
+                continue;
+            }
+            device.workers.push_back(workers_.size());
+            workers_.push_back(std::move(created[c]));
+        }
+        if (device.workers.empty()) {
+            std::cerr << "Error: No context on EGL device " << eglDevice << std::endl;
+            ok = false;
+            continue;
+        }
+        devices_.push_back(std::move(device));
+    }
+
+    if (workers_.empty()) {
+        return false;
+    }
+    std::cout << "Render pool: " << workers_.size() << " contexts on "
+              << devices_.size() << " device(s)" << std::endl;
+    return ok;
+}
+
+void RenderPool::workerLoop(Worker& worker, int eglDevice, const RenderPoolOptions& options,
+                            const GLRenderer* shareWith, std::promise<bool> ready) {
+    // The context is created and used on this thread only
+    trace::setThreadName("render pool (device " + std::to_string(worker.device) + ")");
+    worker.renderer.setShaderCacheDir(options.shaderCacheDir);
+    worker.renderer.setPipelineDepth(options.pipelineDepth);
+    worker.renderer.setOutputs(options.outputs);
+    bool initialized = shareWith ? worker.renderer.initializeShared(*shareWith)
+                                 : worker.renderer.initialize(eglDevice);
+    if (!initialized) {
+        worker.renderer.cleanup();
+        ready.set_value(false);
+        return;
+    }
+    worker.info = worker.renderer.getGLInfo();
+    ready.set_value(true);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        taskReady_.wait(lock, [&]() { return stopping_ || !worker.tasks.empty(); });
+        if (worker.tasks.empty()) {
+            break;  // Stopping and drained
+        }
+        Job job = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+
+        lock.unlock();
+        bool result = false;
+        std::exception_ptr error;
+        try {
+            result = job.task(worker.renderer);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        // Counted before the caller sees the result
+        worker.load--;
+        worker.completed++;
+        if (error) {
+            job.result.set_exception(error);
+        } else {
+            job.result.set_value(result);
+        }
+    }
+    lock.unlock();
+
+    worker.renderer.cleanup();
+}
+
+size_t RenderPool::leastLoaded(const std::vector<size_t>& candidates) const {
+    size_t best = candidates[0];
+    for (size_t index : candidates) {
+        // Ties go to the context that did less so far
+        const Worker& worker = *workers_[index];
+        const Worker& current = *workers_[best];
+        if (worker.load < current.load ||
+            (worker.load == current.load && worker.completed < current.completed)) {
+            best = index;
+        }
+    }
+    return best;
+}
+
+std::future<bool> RenderPool::enqueue(size_t index, Task task) {
+    Job job;
+    job.task = std::move(task);
+    std::future<bool> result = job.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            std::promise<bool> rejected;
+            rejected.set_value(false);
+            return rejected.get_future();
+        }
+        workers_[index]->tasks.push_back(std::move(job));
+        workers_[index]->load++;
+    }
+    taskReady_.notify_all();
+    return result;
+}
+
+std::future<bool> RenderPool::submit(Task task) {
+    if (workers_.empty()) {
+        std::promise<bool> rejected;
+        rejected.set_value(false);
+        return rejected.get_future();
+    }
+    std::vector<size_t> all(workers_.size());
+    for (size_t i = 0; i < all.size(); ++i) {
+        all[i] = i;
+    }
+    size_t index;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        index = leastLoaded(all);
+    }
+    return enqueue(index, std::move(task));
+}
+
+bool RenderPool::renderViews(const Upload& upload, const Intrinsics& sourceK,
+                             const std::vector<Intrinsics>& targetKs, float nearPlane, float farPlane,
+                             const Consume& consume) {
+    if (devices_.empty()) {
+        std::cerr << "Error: Render pool not initialized" << std::endl;
+        return false;
+    }
+
+    // Least-loaded device (views of frames in flight count as load)
+    size_t deviceIndex = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t bestLoad = SIZE_MAX;
+        for (size_t d = 0; d < devices_.size(); ++d) {
+            size_t load = 0;
+            for (size_t w : devices_[d].workers) {
+                load += workers_[w]->load;
+            }
+            if (load < bestLoad) {
+                bestLoad = load;
+                deviceIndex = d;
+            }
+        }
+    }
+    Device& device = devices_[deviceIndex];
+    std::lock_guard<std::mutex> frame(*device.frameMutex);
+
+    // Upload once on the device's first context
+    const size_t ownerIndex = device.workers[0];
+    const GLRenderer& owner = workers_[ownerIndex]->renderer;
+    bool uploaded = enqueue(ownerIndex, [&](GLRenderer& renderer) {
+        if (!upload(renderer)) {
+            return false;
+        }
+        renderer.finishUploads();
+        return true;
+    }).get();
+    if (!uploaded) {
+        std::cerr << "Error: Upload failed on EGL device " << device.eglDevice << std::endl;
+        return false;
+    }
+
+    // Every context of the device draws the shared geometry
+    std::mutex consumeMutex;
+    std::vector<std::future<bool>> views;
+    for (size_t i = 0; i < targetKs.size(); ++i) {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            index = leastLoaded(device.workers);
+        }
+        views.push_back(enqueue(index, [&, i](GLRenderer& renderer) {
+            RenderOutput output;
+            if (!renderer.shareGeometry(owner) ||
+                !renderer.render(sourceK, targetKs[i], nearPlane, farPlane, output)) {
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(consumeMutex);
+            consume(i, std::move(output));
+            return true;
+        }));
+    }
+
+    bool ok = true;
+    for (auto& view : views) {
+        ok = view.get() && ok;
+    }
+    return ok;
+}
+
+std::vector<size_t> RenderPool::getCompletedCounts() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<size_t> counts;
+    for (const auto& worker : workers_) {
+        counts.push_back(worker->completed);
+    }
+    return counts;
+}
+
+void RenderPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    taskReady_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    workers_.clear();
+    devices_.clear();
+}
+
+std::string RenderPool::getInfo() const {
+    std::ostringstream info;
+    info << "Render pool: " << workers_.size() << " contexts";
+    for (const Device& device : devices_) {
+        info << "\n  EGL device " << device.eglDevice << ": " << device.workers.size() << " contexts";
+        if (!device.workers.empty()) {
+            info << "\n" << workers_[device.workers[0]]->info;
+        }
+    }
+    return info.str();
+}
+
+} // namespace render
+} // namespace rgbd
@@ -0,0 +1,91 @@
+#include "renderer.hpp"
+#include "gl_renderer.hpp"
+#include "cpu_renderer.hpp"
+#include "resample_renderer.hpp"
+#include <iostream>
+
+namespace rgbd {
+namespace render {
+
+bool Renderer::updateMesh(const Mesh& mesh, const MeshUpdate& update) {
+    (void)update;
+    return uploadMesh(mesh);
+}
+
+bool Renderer::uploadDepth(const cv::Mat& depth, const DepthThresholds& thresholds) {
+    (void)depth;
+    (void)thresholds;
+    std::cerr << "Error: " << getInfo() << " does not render depth grids" << std::endl;
+    return false;
+}
+
+bool Renderer::renderBatch(const Intrinsics& sourceK, const std::vector<Intrinsics>& targetKs,
+                           float nearPlane, float farPlane, std::vector<RenderOutput>& outputs) {
+    outputs.clear();
+    outputs.resize(targetKs.size());
+    for (size_t i = 0; i < targetKs.size(); ++i) {
+        if (!render(sourceK, targetKs[i], nearPlane, farPlane, outputs[i])) {
+            outputs.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Renderer::submit(const Intrinsics& sourceK, const Intrinsics& targetK,
+                      float nearPlane, float farPlane) {
+    RenderOutput output;
+    if (!render(sourceK, targetK, nearPlane, farPlane, output)) {
+        return false;
+    }
+    completed_.push_back(std::move(output));
+    return true;
+}
+
+bool Renderer::retrieve(RenderOutput& output) {
+    if (completed_.empty()) {
+        std::cerr << "Error: No render pending" << std::endl;
+        return false;
+    }
+    output = std::move(completed_.front());
+    completed_.pop_front();
+    return true;
+}
+
+void Renderer::reportValidPixels(const RenderOutput& output) {
+    int validCount = 0;
+    if (!output.mask.empty()) {
+        for (uint8_t m : output.mask) {
+            if (m > 0) validCount++;
+        }
+    } else if (!output.depth.empty()) {
+        for (float z : output.depth) {
+            if (z > 0.0f) validCount++;
+        }
+    } else {
+        return;
+    }
+    std::cout << "Rendered " << validCount << " valid pixels ("
+              << (100.0f * validCount / (output.width * output.height)) << "%)" << std::endl;
+}
+
+std::unique_ptr<Renderer> createRenderer(const std::string& backend, int numThreads) {
+    if (backend == "gl") {
+        return std::unique_ptr<Renderer>(new GLRenderer());
+    }
+    if (backend == "cpu") {
+        auto renderer = std::unique_ptr<CpuRenderer>(new CpuRenderer());
+        renderer->setNumThreads(numThreads);
+        return std::unique_ptr<Renderer>(std::move(renderer));
+    }
+    if (backend == "resample") {
+        auto renderer = std::unique_ptr<ResampleRenderer>(new ResampleRenderer());
+        renderer->setNumThreads(numThreads);
+        return std::unique_ptr<Renderer>(std::move(renderer));
+    }
+    std::cerr << "Error: Unknown render backend: " << backend << std::endl;
+    return nullptr;
+}
+
+} // namespace render
+} // namespace rgbd
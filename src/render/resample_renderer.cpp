@@ -0,0 +1,459 @@
+#include "resample_renderer.hpp"
+#include "edge_mask.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#if RGBD_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace rgbd {
+namespace render {
+
+namespace {
+
+// Target rows per parallel task
+constexpr int kRowsPerTask = 16;
+
+// quadBits_ is gathered 32 bits at a time from byte offsets
+constexpr size_t kQuadBitsPadding = 3;
+
+constexpr uint8_t kUpperTriangle = 1 << 0;  // (v00, v10, v11)
+constexpr uint8_t kLowerTriangle = 1 << 1;  // (v00, v11, v01)
+
+/**
+ * Inverse mapping of one target axis into the source grid
+ *
+ * Target pixel centre i + 0.5 sees the source image coordinate
+ * c_s + f_s * (i + 0.5 - c_t) / f_t; grid vertex k sits at k + 0.5.
+ * A centre exactly on a grid line belongs to the cell the GL fill rule
+ * gives it: the one to its right (columns) or above it (rows), so the
+ * grid's right and top borders are not covered.
+ */
+struct AxisMap {
+    std::vector<int32_t> index;  // First grid vertex of the cell (0 where invalid)
+    std::vector<float> frac;     // Position inside the cell, [0, 1]
+    std::vector<int32_t> valid;  // All ones inside the grid, else 0
+
+    void build(int count, float sourceFocal, float sourceCenter,
+               float targetFocal, float targetCenter, int gridSize, bool linesToCellAbove) {
+        index.assign(count, 0);
+        frac.assign(count, 0.0f);
+        valid.assign(count, 0);
+        const float scale = sourceFocal / targetFocal;
+        const float last = static_cast<float>(gridSize - 1);
+        for (int i = 0; i < count; ++i) {
+            float g = sourceCenter + scale * (static_cast<float>(i) + 0.5f - targetCenter) - 0.5f;
+            int cell;
+            if (linesToCellAbove) {
+                if (!(g > 0.0f && g <= last)) continue;
+                cell = static_cast<int>(std::ceil(g)) - 1;
+            } else {
+                if (!(g >= 0.0f && g < last)) continue;
+                cell = static_cast<int>(g);
+            }
+            index[i] = cell;
+            frac[i] = g - static_cast<float>(cell);
+            valid[i] = -1;
+        }
+    }
+};
+
+/**
+ * Inputs and outputs of one render, shared by all row tasks
+ */
+struct Frame {
+    int gridWidth;
+    const float* invDepth;
+    const uint8_t* quadBits;
+    const uint32_t* texels;     // Null when RGB is not selected
+    AxisMap cols, rows;
+    float nearPlane, farPlane;
+    int width;
+    uint8_t* rgb;               // Null when RGB is not selected
+    float* depth;               // Null when no depth target is rendered
+    uint8_t* mask;              // Null when no mask target is rendered
+};
+
+/**
+ * Bilinear blend of one 8-bit channel like GL_LINEAR (and CpuRenderer)
+ */
+inline uint8_t blendChannel(uint32_t t00, uint32_t t10, uint32_t t01, uint32_t t11,
+                            int shift, float tx, float ty) {
+    float c00 = static_cast<float>((t00 >> shift) & 0xff);
+    float c10 = static_cast<float>((t10 >> shift) & 0xff);
+    float c01 = static_cast<float>((t01 >> shift) & 0xff);
+    float c11 = static_cast<float>((t11 >> shift) & 0xff);
+    float top = c00 + tx * (c10 - c00);
+    float bottom = c01 + tx * (c11 - c01);
+    return static_cast<uint8_t>(top + ty * (bottom - top) + 0.5f);
+}
+
+/**
+ * Shade pixels [begin, end) of target row y (cell row v0, fraction fy)
+ *
+ * The upper triangle covers fx >= fy. With screen-space barycentrics b
+ * and w_i = b_i / Z_i, depth is 1 / sum(w) and the texture position
+ * inside the cell is sum(w_i * corner_i) / sum(w), i.e. perspective-correct
+ * interpolation of the vertex attributes.
+ */
+void shadeRowScalar(const Frame& f, int y, int v0, float fy, int begin, int end) {
+    const int W = f.gridWidth;
+    const size_t rowOffset = static_cast<size_t>(y) * f.width;
+    for (int x = begin; x < end; ++x) {
+        const size_t p = rowOffset + x;
+        const size_t q = static_cast<size_t>(v0) * W + f.cols.index[x];
+        const float fx = f.cols.frac[x];
+        const bool upper = fx >= fy;
+
+        float z = 0.0f, tx = 0.0f, ty = 0.0f;
+        bool valid = false;
+        if (f.cols.valid[x] && (f.quadBits[q] & (upper ? kUpperTriangle : kLowerTriangle))) {
+            float w00 = (upper ? 1.0f - fx : 1.0f - fy) * f.invDepth[q];
+            float w11 = (upper ? fy : fx) * f.invDepth[q + W + 1];
+            float wSide = upper ? (fx - fy) * f.invDepth[q + 1] : (fy - fx) * f.invDepth[q + W];
+            float sum = w00 + w11 + wSide;
+            float invSum = 1.0f / sum;
+            z = invSum;
+            tx = (w11 + (upper ? wSide : 0.0f)) * invSum;
+            ty = (w11 + (upper ? 0.0f : wSide)) * invSum;
+            valid = z >= f.nearPlane && z <= f.farPlane;
+        }
+
+        if (f.depth) f.depth[p] = valid ? z : 0.0f;
+        if (f.mask) f.mask[p] = valid ? 255 : 0;
+        if (f.rgb) {
+            uint8_t* rgb = f.rgb + p * 3;
+            if (!valid) {
+                rgb[0] = rgb[1] = rgb[2] = 0;
+                continue;
+            }
+            uint32_t t00 = f.texels[q], t10 = f.texels[q + 1];
+            uint32_t t01 = f.texels[q + W], t11 = f.texels[q + W + 1];
+            for (int c = 0; c < 3; ++c) {
+                rgb[c] = blendChannel(t00, t10, t01, t11, c * 8, tx, ty);
+            }
+        }
+    }
+}
+
+#if RGBD_X86_SIMD
+
+RGBD_TARGET_AVX2
+inline __m256 channel8(__m256i texels, int shift) {
+    return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, shift), _mm256_set1_epi32(0xff)));
+}
+
+/**
+ * shadeRowScalar for 8 pixels at a time, with the same operations in the
+ * same order so both kernels produce identical results
+ */
+RGBD_TARGET_AVX2
+void shadeRowAVX2(const Frame& f, int y, int v0, float fy, int begin, int end) {
+    const int W = f.gridWidth;
+    const size_t rowOffset = static_cast<size_t>(y) * f.width;
+    const __m256i rowBase = _mm256_set1_epi32(v0 * W);
+    const __m256 fyv = _mm256_set1_ps(fy);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 nearv = _mm256_set1_ps(f.nearPlane);
+    const __m256 farv = _mm256_set1_ps(f.farPlane);
+    const __m256i upperBit = _mm256_set1_epi32(kUpperTriangle);
+    const __m256i lowerBit = _mm256_set1_epi32(kLowerTriangle);
+    const float* iz00p = f.invDepth;
+    const float* iz10p = f.invDepth + 1;
+    const float* iz01p = f.invDepth + W;
+    const float* iz11p = f.invDepth + W + 1;
+
+    int x = begin;
+    for (; x + 8 <= end; x += 8) {
+        const size_t p = rowOffset + x;
+        const __m256i q = _mm256_add_epi32(rowBase, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&f.cols.index[x])));
+        const __m256 fx = _mm256_loadu_ps(&f.cols.frac[x]);
+        const __m256i inside = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&f.cols.valid[x]));
+        const __m256 upper = _mm256_cmp_ps(fx, fyv, _CMP_GE_OQ);
+
+        __m256i bits = _mm256_i32gather_epi32(reinterpret_cast<const int*>(f.quadBits), q, 1);
+        __m256i triangle = _mm256_castps_si256(_mm256_blendv_ps(
+            _mm256_castsi256_ps(lowerBit), _mm256_castsi256_ps(upperBit), upper));
+        __m256i unbroken = _mm256_andnot_si256(
+            _mm256_cmpeq_epi32(_mm256_and_si256(bits, triangle), _mm256_setzero_si256()), inside);
+
+        __m256 valid = zero;
+        __m256 z = zero, tx = zero, ty = zero;
+        if (!_mm256_testz_si256(unbroken, unbroken)) {
+            __m256 iz00 = _mm256_i32gather_ps(iz00p, q, 4);
+            __m256 iz10 = _mm256_i32gather_ps(iz10p, q, 4);
+            __m256 iz01 = _mm256_i32gather_ps(iz01p, q, 4);
+            __m256 iz11 = _mm256_i32gather_ps(iz11p, q, 4);
+
+            __m256 w00 = _mm256_mul_ps(_mm256_blendv_ps(_mm256_sub_ps(one, fyv), _mm256_sub_ps(one, fx), upper), iz00);
+            __m256 w11 = _mm256_mul_ps(_mm256_blendv_ps(fx, fyv, upper), iz11);
+            __m256 wSide = _mm256_blendv_ps(_mm256_mul_ps(_mm256_sub_ps(fyv, fx), iz01),
+                                            _mm256_mul_ps(_mm256_sub_ps(fx, fyv), iz10), upper);
+            __m256 sum = _mm256_add_ps(_mm256_add_ps(w00, w11), wSide);
+            __m256 invSum = _mm256_div_ps(one, sum);
+            z = invSum;
+            tx = _mm256_mul_ps(_mm256_add_ps(w11, _mm256_and_ps(wSide, upper)), invSum);
+            ty = _mm256_mul_ps(_mm256_add_ps(w11, _mm256_andnot_ps(upper, wSide)), invSum);
+            valid = _mm256_and_ps(_mm256_castsi256_ps(unbroken),
+                                  _mm256_and_ps(_mm256_cmp_ps(z, nearv, _CMP_GE_OQ),
+                                                _mm256_cmp_ps(z, farv, _CMP_LE_OQ)));
+        }
+        const int lanes = _mm256_movemask_ps(valid);
+
+        if (f.depth) {
+            _mm256_storeu_ps(f.depth + p, _mm256_and_ps(z, valid));
+        }
+        if (f.mask) {
+            for (int i = 0; i < 8; ++i) {
+                f.mask[p + i] = (lanes >> i) & 1 ? 255 : 0;
+            }
+        }
+        if (f.rgb) {
+            uint8_t* rgb = f.rgb + p * 3;
+            if (lanes == 0) {
+                std::memset(rgb, 0, 24);
+                continue;
+            }
+            const int* texels = reinterpret_cast<const int*>(f.texels);
+            __m256i t00 = _mm256_i32gather_epi32(texels, q, 4);
+            __m256i t10 = _mm256_i32gather_epi32(texels + 1, q, 4);
+            __m256i t01 = _mm256_i32gather_epi32(texels + W, q, 4);
+            __m256i t11 = _mm256_i32gather_epi32(texels + W + 1, q, 4);
+            __m256i packed = _mm256_setzero_si256();
+            for (int c = 0; c < 3; ++c) {
+                __m256 c00 = channel8(t00, c * 8), c10 = channel8(t10, c * 8);
+                __m256 c01 = channel8(t01, c * 8), c11 = channel8(t11, c * 8);
+                __m256 top = _mm256_add_ps(c00, _mm256_mul_ps(tx, _mm256_sub_ps(c10, c00)));
+                __m256 bottom = _mm256_add_ps(c01, _mm256_mul_ps(tx, _mm256_sub_ps(c11, c01)));
+                __m256 value = _mm256_add_ps(_mm256_add_ps(top, _mm256_mul_ps(ty, _mm256_sub_ps(bottom, top))), half);
+                packed = _mm256_or_si256(packed, _mm256_slli_epi32(_mm256_cvttps_epi32(value), c * 8));
+            }
+            packed = _mm256_and_si256(packed, _mm256_castps_si256(valid));
+            alignas(32) uint32_t colors[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(colors), packed);
+            for (int i = 0; i < 8; ++i) {
+                rgb[i * 3 + 0] = static_cast<uint8_t>(colors[i]);
+                rgb[i * 3 + 1] = static_cast<uint8_t>(colors[i] >> 8);
+                rgb[i * 3 + 2] = static_cast<uint8_t>(colors[i] >> 16);
+            }
+        }
+    }
+
+    shadeRowScalar(f, y, v0, fy, x, end);
+}
+
+#endif
+
+/**
+ * Zero target row y (outside the grid vertically)
+ */
+void clearRow(const Frame& f, int y) {
+    const size_t p = static_cast<size_t>(y) * f.width;
+    if (f.depth) std::fill(f.depth + p, f.depth + p + f.width, 0.0f);
+    if (f.mask) std::memset(f.mask + p, 0, f.width);
+    if (f.rgb) std::memset(f.rgb + p * 3, 0, static_cast<size_t>(f.width) * 3);
+}
+
+} // namespace
+
+ResampleRenderer::ResampleRenderer() {}
+
+ResampleRenderer::~ResampleRenderer() {
+    cleanup();
+}
+
+bool ResampleRenderer::initialize(int gpuDevice) {
+    (void)gpuDevice;
+    if (simdLevel_ > activeSimdLevel()) {
+        simdLevel_ = activeSimdLevel();
+    }
+    initialized_ = true;
+    return true;
+}
+
+bool ResampleRenderer::uploadMesh(const Mesh& mesh) {
+    (void)mesh;
+    std::cerr << "Error: The resample backend renders depth grids only (uploadDepth)" << std::endl;
+    return false;
+}
+
+bool ResampleRenderer::uploadDepth(const cv::Mat& depth, const DepthThresholds& thresholds) {
+    RGBD_TRACE_SCOPE("uploadDepth");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+
+    if (depth.empty() || depth.cols < 2 || depth.rows < 2) {
+        std::cerr << "Error: Depth map too small for implicit grid" << std::endl;
+        return false;
+    }
+
+    cv::Mat depthF;
+    if (depth.type() != CV_32F) {
+        depth.convertTo(depthF, CV_32F);
+    } else {
+        depthF = depth;
+    }
+
+    const int W = depthF.cols;
+    const int H = depthF.rows;
+    cv::Mat edges = mesh::computeEdgeMask(depthF, thresholds, simdLevel_, numThreads_);
+
+    invDepth_.assign(static_cast<size_t>(W) * H, 0.0f);
+    quadBits_.assign(static_cast<size_t>(W) * H + kQuadBitsPadding, 0);
+    parallelFor(H, numThreads_, [&](int v) {
+        const float* z = depthF.ptr<float>(v);
+        float* invDepth = invDepth_.data() + static_cast<size_t>(v) * W;
+        for (int u = 0; u < W; ++u) {
+            invDepth[u] = (z[u] > 0.0f && std::isfinite(z[u])) ? 1.0f / z[u] : 0.0f;
+        }
+        if (v + 1 == H) {
+            return;
+        }
+        const uint8_t* edgeRow0 = edges.ptr<uint8_t>(v);
+        const uint8_t* edgeRow1 = edges.ptr<uint8_t>(v + 1);
+        uint8_t* bits = quadBits_.data() + static_cast<size_t>(v) * W;
+        for (int u = 0; u + 1 < W; ++u) {
+            bits[u] = (mesh::upperTriangleUnbroken(edgeRow0, u) ? kUpperTriangle : 0) |
+                      (mesh::lowerTriangleUnbroken(edgeRow0, edgeRow1, u) ? kLowerTriangle : 0);
+        }
+    });
+
+    gridWidth_ = W;
+    gridHeight_ = H;
+    std::cout << "Uploaded depth grid: " << W << "x" << H << std::endl;
+    return true;
+}
+
+bool ResampleRenderer::uploadTexture(const cv::Mat& texture) {
+    RGBD_TRACE_SCOPE("uploadTexture");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+
+    if (texture.empty() || texture.depth() != CV_8U) {
+        std::cerr << "Error: Texture must be a non-empty 8-bit image" << std::endl;
+        return false;
+    }
+
+    // Same channel mapping as the GL upload: BGR / BGRA to RGB, gray to red
+    int channels = texture.channels();
+    texels_.resize(static_cast<size_t>(texture.cols) * texture.rows);
+    for (int y = 0; y < texture.rows; ++y) {
+        const uint8_t* src = texture.ptr<uint8_t>(y);
+        uint32_t* dst = texels_.data() + static_cast<size_t>(y) * texture.cols;
+        for (int x = 0; x < texture.cols; ++x) {
+            const uint8_t* p = src + x * channels;
+            dst[x] = channels >= 3 ? p[2] | (p[1] << 8) | (p[0] << 16) : p[0];
+        }
+    }
+    textureWidth_ = texture.cols;
+    textureHeight_ = texture.rows;
+
+    std::cout << "Uploaded texture: " << texture.cols << "x" << texture.rows << std::endl;
+    return true;
+}
+
+bool ResampleRenderer::render(const Intrinsics& sourceK, const Intrinsics& targetK,
+                              float nearPlane, float farPlane, RenderOutput& output) {
+    RGBD_TRACE_SCOPE("render");
+    if (!initialized_) {
+        std::cerr << "Error: Renderer not initialized" << std::endl;
+        return false;
+    }
+
+    if (invDepth_.empty()) {
+        std::cerr << "Error: No depth grid uploaded" << std::endl;
+        return false;
+    }
+
+    if (outputs_.rgb) {
+        if (texels_.empty()) {
+            std::cerr << "Error: No texture uploaded" << std::endl;
+            return false;
+        }
+        // Texels are addressed with the grid's quad indices
+        if (textureWidth_ != gridWidth_ || textureHeight_ != gridHeight_) {
+            std::cerr << "Error: Texture size " << textureWidth_ << "x" << textureHeight_
+                      << " does not match the depth grid " << gridWidth_ << "x" << gridHeight_ << std::endl;
+            return false;
+        }
+    }
+
+    // The inverse map is separable only between pinhole cameras
+    if (!sourceK.isPinhole() || !targetK.isPinhole()) {
+        std::cerr << "Error: The resample backend does not support lens distortion" << std::endl;
+        return false;
+    }
+
+    const int width = targetK.width;
+    const int height = targetK.height;
+    output.allocate(width, height, outputs_);
+
+    Frame f;
+    f.gridWidth = gridWidth_;
+    f.invDepth = invDepth_.data();
+    f.quadBits = quadBits_.data();
+    f.texels = outputs_.rgb ? texels_.data() : nullptr;
+    f.cols.build(width, sourceK.fx, sourceK.cx, targetK.fx, targetK.cx, gridWidth_, false);
+    f.rows.build(height, sourceK.fy, sourceK.cy, targetK.fy, targetK.cy, gridHeight_, true);
+    f.nearPlane = nearPlane;
+    f.farPlane = farPlane;
+    f.width = width;
+    f.rgb = output.rgb.empty() ? nullptr : output.rgb.data();
+    f.depth = output.depth.empty() ? nullptr : output.depth.data();
+    f.mask = output.mask.empty() ? nullptr : output.mask.data();
+
+    const bool avx2 = RGBD_X86_SIMD && simdLevel_ >= SimdLevel::AVX2;
+    const int numTasks = (height + kRowsPerTask - 1) / kRowsPerTask;
+    parallelFor(numTasks, numThreads_, [&](int task) {
+        int yEnd = std::min(height, (task + 1) * kRowsPerTask);
+        for (int y = task * kRowsPerTask; y < yEnd; ++y) {
+            if (!f.rows.valid[y]) {
+                clearRow(f, y);
+                continue;
+            }
+#if RGBD_X86_SIMD
+            if (avx2) {
+                shadeRowAVX2(f, y, f.rows.index[y], f.rows.frac[y], 0, width);
+                continue;
+            }
+#endif
+            shadeRowScalar(f, y, f.rows.index[y], f.rows.frac[y], 0, width);
+        }
+    });
+    (void)avx2;
+
+    output.select(outputs_);
+    reportValidPixels(output);
+    return true;
+}
+
+std::string ResampleRenderer::getInfo() const {
+    std::ostringstream info;
+    info << "CPU resampler: " << resolveThreadCount(numThreads_) << " threads, "
+         << (simdLevel_ >= SimdLevel::AVX2 ? "AVX2 gather" : "scalar") << " kernel";
+    return info.str();
+}
+
+void ResampleRenderer::cleanup() {
+    std::vector<float>().swap(invDepth_);
+    std::vector<uint8_t>().swap(quadBits_);
+    std::vector<uint32_t>().swap(texels_);
+    gridWidth_ = gridHeight_ = 0;
+    textureWidth_ = textureHeight_ = 0;
+    initialized_ = false;
+}
+
+} // namespace render
+} // namespace rgbd
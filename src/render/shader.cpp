@@ -1,12 +1,50 @@
 #include "shader.hpp"
 #include <glad/glad.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <sstream>
 #include <iostream>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
 
 namespace rgbd {
 namespace render {
 
+// Program binary cache file: magic, key length, key, binary format,
+// binary length, binary
+static const char kCacheMagic[8] = { 'R', 'G', 'B', 'D', 'P', 'R', 'G', '1' };
+
+// Larger cache files are treated as corrupt
+static constexpr uint32_t kMaxBinaryLength = 64u << 20;
+
+/**
+ * 64-bit FNV-1a hash
+ */
+static uint64_t hashBytes(const std::string& data, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : data) {
+        hash = (hash ^ c) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static std::string hexString(uint64_t value) {
+    std::ostringstream stream;
+    stream << std::hex << std::setw(16) << std::setfill('0') << value;
+    return stream.str();
+}
+
+static std::string glString(GLenum name) {
+    const char* value = reinterpret_cast<const char*>(glGetString(name));
+    return value ? value : "";
+}
+
 Shader::Shader() {}
 
 Shader::~Shader() {
@@ -15,7 +53,10 @@ Shader::~Shader() {
 
 Shader::Shader(Shader&& other) noexcept 
     : programId_(other.programId_)
-    , errorMsg_(std::move(other.errorMsg_)) {
+    , errorMsg_(std::move(other.errorMsg_))
+    , uniformLocations_(std::move(other.uniformLocations_))
+    , cacheDir_(std::move(other.cacheDir_))
+    , fromCache_(other.fromCache_) {
     other.programId_ = 0;
 }
 
@@ -24,6 +65,9 @@ Shader& Shader::operator=(Shader&& other) noexcept {
         destroy();
         programId_ = other.programId_;
         errorMsg_ = std::move(other.errorMsg_);
+        uniformLocations_ = std::move(other.uniformLocations_);
+        cacheDir_ = std::move(other.cacheDir_);
+        fromCache_ = other.fromCache_;
         other.programId_ = 0;
     }
     return *this;
@@ -31,8 +75,24 @@ Shader& Shader::operator=(Shader&& other) noexcept {
 
 bool Shader::loadFromSource(const std::string& vertexSource,
                             const std::string& fragmentSource) {
+    return loadFromSource(vertexSource, std::string(), fragmentSource);
+}
+
+bool Shader::loadFromSource(const std::string& vertexSource,
+                            const std::string& geometrySource,
+                            const std::string& fragmentSource) {
     destroy();
     errorMsg_.clear();
+    fromCache_ = false;
+    
+    // Same sources on the same driver reuse the cached binary
+    std::string cacheKey;
+    std::string cachePath = binaryCachePath({ vertexSource, geometrySource, fragmentSource }, cacheKey);
+    if (!cachePath.empty() && loadBinary(cachePath, cacheKey)) {
+        fromCache_ = true;
+        cacheUniformLocations();
+        return true;
+    }
     
     // Compile vertex shader
     uint32_t vertexShader = compileShader(vertexSource, GL_VERTEX_SHADER);
@@ -40,20 +100,38 @@ bool Shader::loadFromSource(const std::string& vertexSource,
         return false;
     }
     
+    // Compile optional geometry shader
+    uint32_t geometryShader = 0;
+    if (!geometrySource.empty()) {
+        geometryShader = compileShader(geometrySource, GL_GEOMETRY_SHADER);
+        if (geometryShader == 0) {
+            glDeleteShader(vertexShader);
+            return false;
+        }
+    }
+    
     // Compile fragment shader
     uint32_t fragmentShader = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
     if (fragmentShader == 0) {
         glDeleteShader(vertexShader);
+        if (geometryShader != 0) glDeleteShader(geometryShader);
         return false;
     }
     
     // Link program
-    bool success = linkProgram(vertexShader, fragmentShader);
+    bool success = linkProgram(vertexShader, geometryShader, fragmentShader);
     
     // Clean up shaders (they're linked into the program now)
     glDeleteShader(vertexShader);
+    if (geometryShader != 0) glDeleteShader(geometryShader);
     glDeleteShader(fragmentShader);
     
+    if (success) {
+        cacheUniformLocations();
+        if (!cachePath.empty()) {
+            saveBinary(cachePath, cacheKey);
+        }
+    }
     return success;
 }
 
@@ -86,6 +164,25 @@ bool Shader::loadFromFiles(const std::string& vertexPath,
     return loadFromSource(vertexSource, fragmentSource);
 }
 
+std::string Shader::injectDefines(const std::string& source,
+                                  const std::vector<std::string>& defines) {
+    std::string block;
+    for (const auto& define : defines) {
+        block += "#define " + define + "\n";
+    }
+    
+    // #version must stay the first directive, so insert after its line
+    size_t version = source.find("#version");
+    if (version == std::string::npos) {
+        return block + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + block;
+    }
+    return source.substr(0, lineEnd + 1) + block + source.substr(lineEnd + 1);
+}
+
 void Shader::use() const {
     if (programId_ != 0) {
         glUseProgram(programId_);
@@ -94,7 +191,15 @@ void Shader::use() const {
 
 int Shader::getUniformLocation(const std::string& name) const {
     if (programId_ == 0) return -1;
-    return glGetUniformLocation(programId_, name.c_str());
+    auto it = uniformLocations_.find(name);
+    if (it != uniformLocations_.end()) {
+        return it->second;
+    }
+    // Only element 0 of arrays is cached, ask GL for other elements
+    if (name.find('[') != std::string::npos) {
+        return glGetUniformLocation(programId_, name.c_str());
+    }
+    return -1;
 }
 
 void Shader::setUniform(const std::string& name, int value) const {
@@ -111,6 +216,13 @@ void Shader::setUniform(const std::string& name, float value) const {
     }
 }
 
+void Shader::setUniform(const std::string& name, int x, int y) const {
+    int location = getUniformLocation(name);
+    if (location >= 0) {
+        glUniform2i(location, x, y);
+    }
+}
+
 void Shader::setUniform(const std::string& name, float x, float y) const {
     int location = getUniformLocation(name);
     if (location >= 0) {
@@ -139,11 +251,195 @@ void Shader::setUniformMatrix4(const std::string& name, const float* matrix) con
     }
 }
 
+void Shader::setUniform(Uniform uniform, int value) const {
+    if (uniform.isValid()) {
+        glUniform1i(uniform.location, value);
+    }
+}
+
+void Shader::setUniform(Uniform uniform, float value) const {
+    if (uniform.isValid()) {
+        glUniform1f(uniform.location, value);
+    }
+}
+
+void Shader::setUniform(Uniform uniform, int x, int y) const {
+    if (uniform.isValid()) {
+        glUniform2i(uniform.location, x, y);
+    }
+}
+
+void Shader::setUniform(Uniform uniform, float x, float y) const {
+    if (uniform.isValid()) {
+        glUniform2f(uniform.location, x, y);
+    }
+}
+
+void Shader::setUniform(Uniform uniform, float x, float y, float z) const {
+    if (uniform.isValid()) {
+        glUniform3f(uniform.location, x, y, z);
+    }
+}
+
+void Shader::setUniform(Uniform uniform, float x, float y, float z, float w) const {
+    if (uniform.isValid()) {
+        glUniform4f(uniform.location, x, y, z, w);
+    }
+}
+
+void Shader::setUniformMatrix4(Uniform uniform, const float* matrix) const {
+    if (uniform.isValid()) {
+        glUniformMatrix4fv(uniform.location, 1, GL_FALSE, matrix);
+    }
+}
+
+bool Shader::bindUniformBlock(const std::string& name, uint32_t binding) const {
+    if (programId_ == 0) return false;
+    GLuint index = glGetUniformBlockIndex(programId_, name.c_str());
+    if (index == GL_INVALID_INDEX) return false;
+    glUniformBlockBinding(programId_, index, binding);
+    return true;
+}
+
 void Shader::destroy() {
     if (programId_ != 0) {
         glDeleteProgram(programId_);
         programId_ = 0;
     }
+    uniformLocations_.clear();
+}
+
+void Shader::cacheUniformLocations() {
+    uniformLocations_.clear();
+    
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(programId_, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(programId_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    
+    std::vector<char> name(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programId_, static_cast<GLuint>(i), maxLength, &length, &size, &type, name.data());
+        std::string uniformName(name.data(), length);
+        
+        // Uniform block members have no location
+        GLint location = glGetUniformLocation(programId_, uniformName.c_str());
+        if (location < 0) continue;
+        uniformLocations_[uniformName] = location;
+        
+        // Arrays are reported as "name[0]", also accept the plain name
+        size_t bracket = uniformName.find('[');
+        if (bracket != std::string::npos) {
+            uniformLocations_[uniformName.substr(0, bracket)] = location;
+        }
+    }
+}
+
+std::string Shader::binaryCachePath(const std::vector<std::string>& sources, std::string& key) const {
+    if (cacheDir_.empty()) return std::string();
+    
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+    if (numFormats <= 0) return std::string();
+    
+    // Binaries are only valid for the driver build that produced them
+    uint64_t sourceHash = hashBytes(std::string());
+    for (const std::string& source : sources) {
+        sourceHash = hashBytes(source + '\0', sourceHash);
+    }
+    key = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n" +
+          glString(GL_VERSION) + "\n" + hexString(sourceHash);
+    return (fs::path(cacheDir_) / (hexString(hashBytes(key)) + ".bin")).string();
+}
+
+bool Shader::loadBinary(const std::string& path, const std::string& key) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    char magic[sizeof(kCacheMagic)];
+    uint32_t keyLength = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&keyLength), sizeof(keyLength));
+    if (!file || std::memcmp(magic, kCacheMagic, sizeof(magic)) != 0 || keyLength != key.size()) {
+        return false;
+    }
+    
+    std::string storedKey(keyLength, '\0');
+    uint32_t format = 0;
+    uint32_t length = 0;
+    file.read(&storedKey[0], keyLength);
+    file.read(reinterpret_cast<char*>(&format), sizeof(format));
+    file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (!file || storedKey != key || length == 0 || length > kMaxBinaryLength) {
+        return false;
+    }
+    
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+    if (!file) {
+        return false;
+    }
+    
+    // The driver may still reject the binary (e.g. after an update that kept its version string)
+    programId_ = glCreateProgram();
+    glProgramBinary(programId_, format, binary.data(), static_cast<GLsizei>(length));
+    GLint success = GL_FALSE;
+    glGetProgramiv(programId_, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(programId_);
+        programId_ = 0;
+        return false;
+    }
+    return true;
+}
+
+void Shader::saveBinary(const std::string& path, const std::string& key) const {
+    GLint length = 0;
+    glGetProgramiv(programId_, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+    
+    std::vector<char> binary(length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(programId_, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return;
+    }
+    
+    std::error_code ec;
+    fs::create_directories(cacheDir_, ec);
+    
+    // Write a private file and rename it, so concurrent processes never
+    // read a partial binary
+    std::string tmpPath = path + "." + std::to_string(getpid()) + "." +
+        std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary);
+        uint32_t keyLength = static_cast<uint32_t>(key.size());
+        uint32_t binaryFormat = format;
+        uint32_t binaryLength = static_cast<uint32_t>(written);
+        file.write(kCacheMagic, sizeof(kCacheMagic));
+        file.write(reinterpret_cast<const char*>(&keyLength), sizeof(keyLength));
+        file.write(key.data(), key.size());
+        file.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
+        file.write(reinterpret_cast<const char*>(&binaryLength), sizeof(binaryLength));
+        file.write(binary.data(), written);
+        if (!file) {
+            file.close();
+            std::remove(tmpPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+    }
 }
 
 uint32_t Shader::compileShader(const std::string& source, uint32_t type) {
@@ -164,7 +460,8 @@ uint32_t Shader::compileShader(const std::string& source, uint32_t type) {
         std::string log(logLength, '\0');
         glGetShaderInfoLog(shader, logLength, nullptr, &log[0]);
         
-        const char* typeName = (type == GL_VERTEX_SHADER) ? "Vertex" : "Fragment";
+        const char* typeName = (type == GL_VERTEX_SHADER) ? "Vertex" :
+                               (type == GL_GEOMETRY_SHADER) ? "Geometry" : "Fragment";
         errorMsg_ = std::string(typeName) + " shader compilation failed:\n" + log;
         std::cerr << errorMsg_ << std::endl;
         
@@ -175,11 +472,18 @@ uint32_t Shader::compileShader(const std::string& source, uint32_t type) {
     return shader;
 }
 
-bool Shader::linkProgram(uint32_t vertexShader, uint32_t fragmentShader) {
+bool Shader::linkProgram(uint32_t vertexShader, uint32_t geometryShader,
+                         uint32_t fragmentShader) {
     programId_ = glCreateProgram();
     
     glAttachShader(programId_, vertexShader);
+    if (geometryShader != 0) {
+        glAttachShader(programId_, geometryShader);
+    }
     glAttachShader(programId_, fragmentShader);
+    if (!cacheDir_.empty()) {
+        glProgramParameteri(programId_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(programId_);
     
     // Check for errors
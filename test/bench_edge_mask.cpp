@@ -0,0 +1,145 @@
+/**
+ * Depth Discontinuity Microbenchmark
+ *
+ * Compares the per-triangle DepthThresholds::isDiscontinuity evaluation the
+ * mesh generator used to do against the vectorized edge-mask kernel, and
+ * reports the cost per megapixel for every available instruction set.
+ *
+ * Usage: bench_edge_mask [width] [height] [iterations]
+ */
+
+#include "types.hpp"
+#include "edge_mask.hpp"
+
+#include <opencv2/core.hpp>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <string>
+
+/**
+ * Synthetic depth: tilted floor, a sphere and a few holes
+ */
+static cv::Mat makeDepth(int width, int height) {
+    cv::Mat depth(height, width, CV_32F);
+    float radius = std::min(width, height) / 4.0f;
+    for (int v = 0; v < height; ++v) {
+        for (int u = 0; u < width; ++u) {
+            float z = 3.0f + 2.0f * v / height;
+            float dx = u - width / 2.0f;
+            float dy = v - height / 2.0f;
+            float d = std::sqrt(dx * dx + dy * dy);
+            if (d < radius) {
+                z = 1.5f - 0.4f * std::sqrt(radius * radius - d * d) / radius;
+            }
+            if ((u * 7 + v * 13) % 211 == 0) {
+                z = 0.0f;
+            }
+            depth.at<float>(v, u) = z;
+        }
+    }
+    return depth;
+}
+
+/**
+ * Legacy path: two isValidTriangle checks (six edge tests) per quad
+ */
+static size_t countTrianglesLegacy(const cv::Mat& depth, const rgbd::DepthThresholds& t) {
+    size_t count = 0;
+    auto validTriangle = [&](float z0, float z1, float z2) {
+        if (!rgbd::isValidDepth(z0) || !rgbd::isValidDepth(z1) || !rgbd::isValidDepth(z2)) {
+            return false;
+        }
+        return !t.isDiscontinuity(z0, z1) && !t.isDiscontinuity(z1, z2) &&
+               !t.isDiscontinuity(z2, z0);
+    };
+    for (int v = 0; v < depth.rows - 1; ++v) {
+        const float* d0 = depth.ptr<float>(v);
+        const float* d1 = depth.ptr<float>(v + 1);
+        for (int u = 0; u < depth.cols - 1; ++u) {
+            count += validTriangle(d0[u], d0[u + 1], d1[u + 1]) ? 1 : 0;
+            count += validTriangle(d0[u], d1[u + 1], d1[u]) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+/**
+ * Mask path: one kernel pass, then triangle emission only tests bits
+ */
+static size_t countTrianglesMask(const cv::Mat& depth, const rgbd::DepthThresholds& t,
+                                 rgbd::SimdLevel level) {
+    cv::Mat edges = rgbd::mesh::computeEdgeMask(depth, t, level, 1);
+    size_t count = 0;
+    for (int v = 0; v < depth.rows - 1; ++v) {
+        const uint8_t* e0 = edges.ptr<uint8_t>(v);
+        const uint8_t* e1 = edges.ptr<uint8_t>(v + 1);
+        for (int u = 0; u < depth.cols - 1; ++u) {
+            count += rgbd::mesh::upperTriangleUnbroken(e0, u) ? 1 : 0;
+            count += rgbd::mesh::lowerTriangleUnbroken(e0, e1, u) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+template <typename Fn>
+static double timeMs(int iterations, Fn&& fn) {
+    double best = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int width = (argc > 1) ? std::stoi(argv[1]) : 1920;
+    int height = (argc > 2) ? std::stoi(argv[2]) : 1080;
+    int iterations = (argc > 3) ? std::stoi(argv[3]) : 10;
+
+    cv::Mat depth = makeDepth(width, height);
+    rgbd::DepthThresholds thresholds(0.05f, 0.1f);
+    double megapixels = width * static_cast<double>(height) / 1e6;
+
+    std::cout << "Edge mask benchmark: " << width << "x" << height
+              << ", best of " << iterations << " (single thread)" << std::endl;
+    std::cout << "CPU dispatch level: " << rgbd::simdLevelName(rgbd::activeSimdLevel())
+              << "\n" << std::endl;
+
+    size_t expected = 0;
+    double legacyMs = timeMs(iterations, [&]() {
+        expected = countTrianglesLegacy(depth, thresholds);
+    });
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::left << std::setw(32) << "per-triangle isDiscontinuity"
+              << legacyMs / megapixels << " ms/MP" << std::endl;
+
+    const rgbd::SimdLevel levels[] = {
+        rgbd::SimdLevel::Scalar, rgbd::SimdLevel::SSE41, rgbd::SimdLevel::AVX2
+    };
+
+    bool ok = true;
+    for (rgbd::SimdLevel level : levels) {
+        if (level > rgbd::activeSimdLevel()) continue;
+
+        size_t count = 0;
+        double ms = timeMs(iterations, [&]() {
+            count = countTrianglesMask(depth, thresholds, level);
+        });
+
+        std::string name = std::string("edge mask (") + rgbd::simdLevelName(level) + ")";
+        std::cout << std::left << std::setw(32) << name
+                  << ms / megapixels << " ms/MP  (" << legacyMs / ms << "x)";
+        if (count != expected) {
+            std::cout << "  MISMATCH: " << count << " vs " << expected << " triangles";
+            ok = false;
+        }
+        std::cout << std::endl;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+/**
+ * Pixel Conversion Microbenchmark
+ *
+ * Times every readback / output encoding kernel (see pixel_kernels.hpp) at
+ * each available instruction set, single-threaded, plus the best level on
+ * all hardware threads, and checks each result against the scalar one.
+ *
+ * Usage: bench_pixel_kernels [width] [height] [iterations]
+ */
+
+#include "pixel_kernels.hpp"
+#include "parallel.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+template <typename Fn>
+static double timeMs(int iterations, Fn&& fn) {
+    double best = 1e30;
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+/**
+ * One kernel: run(threads, level) converts the image into the output that
+ * output() returns (as bytes, for the comparison)
+ */
+struct Kernel {
+    std::string name;
+    std::function<void(int, rgbd::SimdLevel)> run;
+    std::function<std::vector<uint8_t>()> output;
+};
+
+template <typename T>
+static std::vector<uint8_t> bytesOf(const std::vector<T>& values) {
+    std::vector<uint8_t> bytes(values.size() * sizeof(T));
+    std::memcpy(bytes.data(), values.data(), bytes.size());
+    return bytes;
+}
+
+int main(int argc, char** argv) {
+    using namespace rgbd;
+    int width = (argc > 1) ? std::stoi(argv[1]) : 1920;
+    int height = (argc > 2) ? std::stoi(argv[2]) : 1080;
+    int iterations = (argc > 3) ? std::stoi(argv[3]) : 20;
+    size_t pixels = static_cast<size_t>(width) * height;
+    double megapixels = pixels / 1e6;
+
+    // Synthetic readback: gradients, invalid depths and a sparse mask
+    std::vector<uint8_t> rgba(pixels * 4);
+    std::vector<float> depth(pixels);
+    std::vector<uint16_t> half(pixels), millimeters(pixels);
+    std::vector<uint8_t> mask(pixels);
+    for (size_t i = 0; i < pixels; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            rgba[i * 4 + c] = static_cast<uint8_t>(i * (c + 3));
+        }
+        depth[i] = (i % 97 == 0) ? 0.0f : 0.5f + (i % 5000) * 0.002f;
+        half[i] = static_cast<uint16_t>(0x3800 + i % 0x1000);
+        millimeters[i] = static_cast<uint16_t>(i % 20000);
+        mask[i] = (i % 7 != 0) ? 1 : 0;
+    }
+
+    std::vector<uint8_t> rgb(pixels * 3), masked(pixels);
+    std::vector<float> meters(pixels);
+    std::vector<uint16_t> encoded(pixels);
+
+    std::vector<Kernel> cases = {
+        { "rgba -> rgb (flip)",
+          [&](int threads, SimdLevel level) {
+              kernels::rgbaToRgb(rgba.data(), rgb.data(), width, height, true, false, threads, level);
+          },
+          [&]() { return rgb; } },
+        { "rgba -> bgr (flip)",
+          [&](int threads, SimdLevel level) {
+              kernels::rgbaToRgb(rgba.data(), rgb.data(), width, height, true, true, threads, level);
+          },
+          [&]() { return rgb; } },
+        { "rgb -> bgr",
+          [&](int threads, SimdLevel level) {
+              kernels::swapRedBlue(rgba.data(), rgb.data(), width, height, false, threads, level);
+          },
+          [&]() { return rgb; } },
+        { "float16 -> float (flip)",
+          [&](int threads, SimdLevel level) {
+              kernels::depthToFloat(half.data(), DepthFormat::Float16, meters.data(), width, height,
+                                    true, threads, level);
+          },
+          [&]() { return bytesOf(meters); } },
+        { "mm16 -> float (flip)",
+          [&](int threads, SimdLevel level) {
+              kernels::depthToFloat(millimeters.data(), DepthFormat::Millimeters, meters.data(),
+                                    width, height, true, threads, level);
+          },
+          [&]() { return bytesOf(meters); } },
+        { "float -> png16",
+          [&](int threads, SimdLevel level) {
+              kernels::depthToU16(depth.data(), encoded.data(), width, height, 1000.0f, false,
+                                  threads, level);
+          },
+          [&]() { return bytesOf(encoded); } },
+        { "mask -> 0/255",
+          [&](int threads, SimdLevel level) {
+              kernels::maskToU8(mask.data(), masked.data(), width, height, false, threads, level);
+          },
+          [&]() { return masked; } },
+    };
+
+    std::cout << "Pixel kernel benchmark: " << width << "x" << height
+              << ", best of " << iterations << std::endl;
+    std::cout << "CPU dispatch level: " << simdLevelName(activeSimdLevel())
+              << ", threads: " << resolveThreadCount(0) << "\n" << std::endl;
+
+    const SimdLevel levels[] = {
+        SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512
+    };
+
+    bool ok = true;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const Kernel& kernel : cases) {
+        std::cout << kernel.name << std::endl;
+
+        kernel.run(1, SimdLevel::Scalar);
+        std::vector<uint8_t> expected = kernel.output();
+        double scalarMs = 0.0;
+
+        auto report = [&](const std::string& name, int threads, SimdLevel level) {
+            double ms = timeMs(iterations, [&]() { kernel.run(threads, level); });
+            if (level == SimdLevel::Scalar && threads == 1) {
+                scalarMs = ms;
+            }
+            std::cout << "  " << std::left << std::setw(24) << name
+                      << ms / megapixels << " ms/MP  (" << scalarMs / ms << "x)";
+            if (kernel.output() != expected) {
+                std::cout << "  MISMATCH";
+                ok = false;
+            }
+            std::cout << std::endl;
+        };
+
+        for (SimdLevel level : levels) {
+            if (level > activeSimdLevel()) continue;
+            report(simdLevelName(level), 1, level);
+        }
+        report(std::string(simdLevelName(activeSimdLevel())) + ", all threads", 0, activeSimdLevel());
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,470 @@
+/**
+ * End-to-end Rerendering Benchmark
+ *
+ * Drives the full single-frame pipeline over the synthetic scene of
+ * generate_sample and times every stage separately:
+ *   init      renderer creation and initialization (EGL, shaders)
+ *   load      RGB PNG + depth NPY decoding
+ *   mesh      DepthMesh::build (skipped by the resample backend)
+ *   upload    mesh (resample: depth grid) and texture upload
+ *   draw      render submission, summed over all scales
+ *   readback  waiting for / copying the results, summed over all scales
+ *   encode    writing every output file through OutputSink
+ *   total     all of the above
+ * Each scale is retrieved right after it is submitted so draw and readback
+ * do not overlap. Reports min / median / p95 per stage over the timed
+ * iterations, optionally as JSON / CSV, and compares medians against a
+ * CSV written by an earlier run.
+ *
+ * Usage: bench_rerender [--sizes 640x480,1280x720] [--scales N]
+ *                       [--iterations N] [--warmup N]
+ *                       [--backend gl|cpu|resample]
+ *                       [--threads N] [--vertex_layout NAME]
+ *                       [--index_mode NAME] [--meshlet_cull on|off]
+ *                       [--adaptive_error PX]
+ *                       [--shader_cache DIR] [--outputs LIST]
+ *                       [--depth_format float32|float16|mm16]
+ *                       [--json PATH] [--csv PATH]
+ *                       [--baseline PATH] [--tolerance FRACTION]
+ */
+
+#include "image_io.hpp"
+#include "depth_io.hpp"
+#include "depth_mesh.hpp"
+#include "mesh_generator.hpp"
+#include "renderer.hpp"
+#include "gl_renderer.hpp"
+#include "output_sink.hpp"
+#include "synthetic_scene.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const char* const kStages[] = {
+    "init", "load", "mesh", "upload", "draw", "readback", "encode", "total"
+};
+static const int kNumStages = sizeof(kStages) / sizeof(kStages[0]);
+
+struct BenchOptions {
+    std::vector<std::pair<int, int>> sizes = { {640, 480} };
+    int numScales = 5;
+    int iterations = 10;
+    int warmup = 1;
+    std::string backend = "gl";
+    int numThreads = 0;
+    rgbd::VertexLayout vertexLayout = rgbd::VertexLayout::Float32;
+    rgbd::IndexMode indexMode = rgbd::IndexMode::Triangles;
+    bool meshletCulling = true;  // Cull meshlets outside each view (gl backend, --index_mode meshlets)
+    float adaptiveError = 0.0f;  // Quadtree meshing bound in target pixels (0 = full grid)
+    std::string shaderCacheDir;  // Program binary cache of the gl backend, shortens "init"
+    std::string outputs = "rgb,depth,mask";  // Rendered outputs, shrinks "draw" / "readback"
+    std::string depthFormat = "float32";
+    std::string jsonPath;
+    std::string csvPath;
+    std::string baselinePath;
+    float tolerance = 0.15f;  // Allowed median slowdown before a regression is reported
+};
+
+/**
+ * Timing summary of one stage at one resolution
+ */
+struct StageResult {
+    std::string resolution;  // "WxH"
+    int scales = 0;
+    std::string stage;
+    double minMs = 0.0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+
+    std::string key() const {
+        return resolution + "/" + std::to_string(scales) + "/" + stage;
+    }
+};
+
+static double elapsedMs(std::chrono::high_resolution_clock::time_point start) {
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/**
+ * Nearest-rank percentile of a sorted sample
+ */
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+static bool parseArgs(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [--sizes WxH,...] [--scales N] [--iterations N]"
+                      << " [--warmup N] [--backend gl|cpu|resample] [--threads N] [--vertex_layout NAME] [--index_mode NAME] [--meshlet_cull on|off] [--adaptive_error PX] [--shader_cache DIR] [--outputs LIST] [--depth_format F] [--json PATH]"
+                      << " [--csv PATH] [--baseline CSV] [--tolerance FRACTION]" << std::endl;
+            return false;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string val = argv[++i];
+
+        if (arg == "--sizes") {
+            options.sizes.clear();
+            std::stringstream ss(val);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                int w = 0, h = 0;
+                char x = 0;
+                std::istringstream is(item);
+                if (!(is >> w >> x >> h) || x != 'x' || w < 2 || h < 2) {
+                    std::cerr << "Error: Invalid size: " << item << std::endl;
+                    return false;
+                }
+                options.sizes.push_back({w, h});
+            }
+        } else if (arg == "--scales") {
+            options.numScales = std::max(1, std::stoi(val));
+        } else if (arg == "--iterations") {
+            options.iterations = std::max(1, std::stoi(val));
+        } else if (arg == "--warmup") {
+            options.warmup = std::max(0, std::stoi(val));
+        } else if (arg == "--backend") {
+            options.backend = val;
+        } else if (arg == "--threads") {
+            options.numThreads = std::stoi(val);
+        } else if (arg == "--vertex_layout") {
+            if (!rgbd::mesh::parseVertexLayout(val, options.vertexLayout)) {
+                std::cerr << "Error: Unknown vertex layout: " << val << std::endl;
+                return false;
+            }
+        } else if (arg == "--index_mode") {
+            if (!rgbd::mesh::parseIndexMode(val, options.indexMode)) {
+                std::cerr << "Error: Unknown index mode: " << val << std::endl;
+                return false;
+            }
+        } else if (arg == "--meshlet_cull") {
+            if (val != "on" && val != "off") {
+                std::cerr << "Error: --meshlet_cull must be on or off" << std::endl;
+                return false;
+            }
+            options.meshletCulling = (val == "on");
+        } else if (arg == "--adaptive_error") {
+            options.adaptiveError = std::stof(val);
+        } else if (arg == "--shader_cache") {
+            options.shaderCacheDir = val;
+        } else if (arg == "--outputs") {
+            options.outputs = val;
+        } else if (arg == "--depth_format") {
+            options.depthFormat = val;
+        } else if (arg == "--json") {
+            options.jsonPath = val;
+        } else if (arg == "--csv") {
+            options.csvPath = val;
+        } else if (arg == "--baseline") {
+            options.baselinePath = val;
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::stof(val);
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    rgbd::OutputSelection outputs;
+    if (!rgbd::app::parseOutputSelection(options.outputs, options.depthFormat, outputs)) {
+        std::cerr << "Error: Invalid outputs or depth format: " << options.outputs
+                  << " / " << options.depthFormat << std::endl;
+        return false;
+    }
+    return !options.sizes.empty();
+}
+
+/**
+ * Run one full pipeline pass
+ * @param ms Per-stage times of this pass, indexed like kStages
+ * @return false if any stage failed
+ */
+static bool runPipeline(const BenchOptions& options, const std::string& rgbPath,
+                        const std::string& depthPath, const rgbd::app::Config& config,
+                        double* ms) {
+    auto totalStart = std::chrono::high_resolution_clock::now();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::unique_ptr<rgbd::render::Renderer> renderer =
+        rgbd::render::createRenderer(options.backend, options.numThreads);
+    if (auto* glRenderer = dynamic_cast<rgbd::render::GLRenderer*>(renderer.get())) {
+        glRenderer->setShaderCacheDir(options.shaderCacheDir);
+        glRenderer->setMeshletCulling(options.meshletCulling);
+    }
+    if (!renderer) {
+        return false;
+    }
+    renderer->setOutputs(config.getOutputSelection());
+    if (!renderer->initialize()) {
+        return false;
+    }
+    ms[0] = elapsedMs(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    cv::Mat rgb = rgbd::io::loadRGB(rgbPath);
+    cv::Mat depth = rgbd::io::loadDepth(depthPath);
+    if (rgb.empty() || depth.empty()) {
+        return false;
+    }
+    ms[1] = elapsedMs(start);
+
+    rgbd::Intrinsics K(config.fx, config.fy, rgb.cols / 2.0f, rgb.rows / 2.0f, rgb.cols, rgb.rows);
+
+    start = std::chrono::high_resolution_clock::now();
+    rgbd::mesh::DepthMesh depthMesh;
+    // The resample backend renders the depth map itself
+    const bool depthGrid = (options.backend == "resample");
+    if (!depthGrid) {
+        depthMesh.setNumThreads(options.numThreads);
+        depthMesh.setVertexLayout(options.vertexLayout);
+        depthMesh.setIndexMode(options.indexMode);
+        depthMesh.setAdaptive(config.getAdaptiveOptions());
+        if (!depthMesh.build(rgb, depth, K, config.getThresholds())) {
+            return false;
+        }
+    }
+    ms[2] = elapsedMs(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    bool uploaded = depthGrid
+        ? renderer->uploadDepth(depth, config.getThresholds()) && renderer->uploadTexture(rgb)
+        : renderer->uploadMesh(depthMesh.getMesh()) && renderer->uploadTexture(depthMesh.getTexture());
+    if (!uploaded) {
+        return false;
+    }
+    ms[3] = elapsedMs(start);
+
+    std::vector<rgbd::RenderOutput> outputs(config.focalScales.size());
+    ms[4] = ms[5] = 0.0;
+    for (size_t i = 0; i < config.focalScales.size(); ++i) {
+        start = std::chrono::high_resolution_clock::now();
+        if (!renderer->submit(K, K.scaled(config.focalScales[i]), config.nearPlane, config.farPlane)) {
+            return false;
+        }
+        ms[4] += elapsedMs(start);
+
+        start = std::chrono::high_resolution_clock::now();
+        if (!renderer->retrieve(outputs[i])) {
+            return false;
+        }
+        ms[5] += elapsedMs(start);
+    }
+
+    start = std::chrono::high_resolution_clock::now();
+    rgbd::app::OutputSink sink(config, config.encodeThreads);
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        sink.submit("scale_" + std::to_string(i), std::move(outputs[i]));
+    }
+    bool written = sink.finish();
+    ms[6] = elapsedMs(start);
+
+    renderer->cleanup();
+    ms[7] = elapsedMs(totalStart);
+    return written;
+}
+
+static bool loadBaseline(const std::string& path, std::map<std::string, StageResult>& baseline) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Cannot open baseline: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    std::getline(file, line);  // Header
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        StageResult r;
+        std::string scales, minMs, medianMs, p95Ms;
+        if (!std::getline(ss, r.resolution, ',') || !std::getline(ss, scales, ',') ||
+            !std::getline(ss, r.stage, ',') || !std::getline(ss, minMs, ',') ||
+            !std::getline(ss, medianMs, ',') || !std::getline(ss, p95Ms, ',')) {
+            continue;
+        }
+        r.scales = std::stoi(scales);
+        r.minMs = std::stod(minMs);
+        r.medianMs = std::stod(medianMs);
+        r.p95Ms = std::stod(p95Ms);
+        baseline[r.key()] = r;
+    }
+    return true;
+}
+
+static void writeCSV(const std::string& path, const std::vector<StageResult>& results) {
+    std::ofstream file(path);
+    file << "resolution,scales,stage,min_ms,median_ms,p95_ms\n";
+    file << std::fixed << std::setprecision(4);
+    for (const StageResult& r : results) {
+        file << r.resolution << "," << r.scales << "," << r.stage << ","
+             << r.minMs << "," << r.medianMs << "," << r.p95Ms << "\n";
+    }
+}
+
+static void writeJSON(const std::string& path, const BenchOptions& options,
+                      const std::vector<StageResult>& results) {
+    std::ofstream file(path);
+    file << std::fixed << std::setprecision(4);
+    file << "{\n";
+    file << "  \"backend\": \"" << options.backend << "\",\n";
+    file << "  \"vertex_layout\": \"" << rgbd::mesh::vertexLayoutName(options.vertexLayout) << "\",\n";
+    file << "  \"index_mode\": \"" << rgbd::mesh::indexModeName(options.indexMode) << "\",\n";
+    file << "  \"meshlet_cull\": " << (options.meshletCulling ? "true" : "false") << ",\n";
+    file << "  \"shader_cache\": " << (options.shaderCacheDir.empty() ? "false" : "true") << ",\n";
+    file << "  \"adaptive_error\": " << options.adaptiveError << ",\n";
+    file << "  \"outputs\": \"" << options.outputs << "\",\n";
+    file << "  \"depth_format\": \"" << options.depthFormat << "\",\n";
+    file << "  \"iterations\": " << options.iterations << ",\n";
+    file << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StageResult& r = results[i];
+        file << "    {\"resolution\": \"" << r.resolution << "\", \"scales\": " << r.scales
+             << ", \"stage\": \"" << r.stage << "\", \"min_ms\": " << r.minMs
+             << ", \"median_ms\": " << r.medianMs << ", \"p95_ms\": " << r.p95Ms << "}"
+             << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parseArgs(argc, argv, options)) {
+        return 1;
+    }
+
+    std::map<std::string, StageResult> baseline;
+    if (!options.baselinePath.empty() && !loadBaseline(options.baselinePath, baseline)) {
+        return 1;
+    }
+
+    fs::path workDir = fs::temp_directory_path() / "bench_rerender";
+    fs::create_directories(workDir / "out");
+
+    rgbd::app::Config config;
+    config.outputDir = (workDir / "out").string();
+    config.fx = config.fy = 500.0f;
+    config.focalScales.clear();
+    for (int i = 0; i < options.numScales; ++i) {
+        float t = (options.numScales > 1) ? static_cast<float>(i) / (options.numScales - 1) : 0.5f;
+        config.focalScales.push_back(0.5f + 1.5f * t);
+    }
+    config.adaptiveError = options.adaptiveError;
+    config.outputs = options.outputs;
+    config.depthFormat = options.depthFormat;
+
+    std::cout << "Rerender benchmark: backend " << options.backend << ", " << options.numScales
+              << " scales, " << options.iterations << " iterations (+" << options.warmup
+              << " warmup)" << std::endl;
+
+    // Library progress output would drown the report
+    std::ostringstream discarded;
+    std::streambuf* coutBuffer = std::cout.rdbuf();
+
+    std::vector<StageResult> results;
+    for (const auto& size : options.sizes) {
+        int width = size.first;
+        int height = size.second;
+
+        cv::Mat rgb, depth;
+        generateComplexScene(rgb, depth, width, height);
+        std::string rgbPath = (workDir / "scene_rgb.png").string();
+        std::string depthPath = (workDir / "scene_depth.npy").string();
+        std::vector<float> depthVec(depth.begin<float>(), depth.end<float>());
+        if (!cv::imwrite(rgbPath, rgb) || !rgbd::io::saveDepthNPY(depthPath, depthVec, width, height)) {
+            std::cerr << "Error: Failed to write the synthetic scene" << std::endl;
+            return 1;
+        }
+
+        std::vector<std::vector<double>> samples(kNumStages);
+        for (int it = 0; it < options.warmup + options.iterations; ++it) {
+            double ms[kNumStages] = {};
+            std::cout.rdbuf(discarded.rdbuf());
+            bool ok = runPipeline(options, rgbPath, depthPath, config, ms);
+            std::cout.rdbuf(coutBuffer);
+            discarded.str("");
+            if (!ok) {
+                std::cerr << "Error: Pipeline failed at " << width << "x" << height << std::endl;
+                return 1;
+            }
+            if (it < options.warmup) continue;
+            for (int s = 0; s < kNumStages; ++s) {
+                samples[s].push_back(ms[s]);
+            }
+        }
+
+        for (int s = 0; s < kNumStages; ++s) {
+            std::sort(samples[s].begin(), samples[s].end());
+            StageResult r;
+            r.resolution = std::to_string(width) + "x" + std::to_string(height);
+            r.scales = options.numScales;
+            r.stage = kStages[s];
+            r.minMs = samples[s].front();
+            r.medianMs = percentile(samples[s], 0.5);
+            r.p95Ms = percentile(samples[s], 0.95);
+            results.push_back(r);
+        }
+    }
+    fs::remove_all(workDir);
+
+    // Report, with the change against the baseline if one was given
+    bool regressed = false;
+    std::cout << "\n" << std::left << std::setw(12) << "resolution" << std::setw(10) << "stage"
+              << std::right << std::setw(10) << "min ms" << std::setw(12) << "median ms"
+              << std::setw(10) << "p95 ms";
+    if (!baseline.empty()) std::cout << std::setw(14) << "baseline ms" << std::setw(10) << "change";
+    std::cout << std::endl;
+
+    std::cout << std::fixed << std::setprecision(3);
+    for (const StageResult& r : results) {
+        std::cout << std::left << std::setw(12) << r.resolution << std::setw(10) << r.stage
+                  << std::right << std::setw(10) << r.minMs << std::setw(12) << r.medianMs
+                  << std::setw(10) << r.p95Ms;
+
+        auto it = baseline.find(r.key());
+        if (it != baseline.end()) {
+            double base = it->second.medianMs;
+            double change = (base > 0.0) ? (r.medianMs / base - 1.0) * 100.0 : 0.0;
+            std::cout << std::setw(14) << base << std::setw(9) << std::showpos << change
+                      << std::noshowpos << "%";
+            // Changes below 0.1 ms are timer noise, whatever their percentage
+            if (r.medianMs > base * (1.0 + options.tolerance) && r.medianMs - base > 0.1) {
+                std::cout << "  REGRESSION";
+                regressed = true;
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    if (!options.csvPath.empty()) {
+        writeCSV(options.csvPath, results);
+        std::cout << "\nWrote " << options.csvPath << std::endl;
+    }
+    if (!options.jsonPath.empty()) {
+        writeJSON(options.jsonPath, options, results);
+        std::cout << "Wrote " << options.jsonPath << std::endl;
+    }
+
+    if (regressed) {
+        std::cout << "\nMedian slower than baseline by more than "
+                  << options.tolerance * 100.0f << "%" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * Synthetic RGBD scene shared by generate_sample and bench_rerender
+ *
+ * Ground plane, two spheres and a box in front of a background at 8 m:
+ * smooth surfaces plus sharp depth discontinuities at object borders.
+ */
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * Render the scene into a BGR image and a metric depth map
+ */
+inline void generateComplexScene(cv::Mat& rgb, cv::Mat& depth, int width, int height) {
+    rgb.create(height, width, CV_8UC3);
+    depth.create(height, width, CV_32F);
+    
+    float cx = width / 2.0f;
+    float cy = height / 2.0f;
+    
+    // Background depth
+    float bgDepth = 8.0f;
+    
+    for (int v = 0; v < height; ++v) {
+        for (int u = 0; u < width; ++u) {
+            float x = u - cx;
+            float y = v - cy;
+            
+            // Default: background
+            float z = bgDepth;
+            uint8_t r = 100, g = 100, b = 150;  // Sky blue
+            
+            // Ground plane (bottom half)
+            if (v > height / 2) {
+                z = bgDepth - 2.0f * (v - height / 2.0f) / height;
+                z = std::max(z, 1.5f);
+                r = 80; g = 120; b = 80;  // Green grass
+            }
+            
+            // Sphere 1: Left side
+            float sphere1_cx = -width / 4.0f;
+            float sphere1_cy = 0.0f;
+            float sphere1_r = height / 5.0f;
+            float sphere1_z = 3.0f;
+            
+            float dx1 = x - sphere1_cx;
+            float dy1 = y - sphere1_cy;
+            float d1 = std::sqrt(dx1 * dx1 + dy1 * dy1);
+            
+            if (d1 < sphere1_r) {
+                float zOffset = std::sqrt(sphere1_r * sphere1_r - d1 * d1) / sphere1_r;
+                z = sphere1_z - zOffset * 0.8f;
+                r = 200; g = 50; b = 50;  // Red sphere
+            }
+            
+            // Sphere 2: Right side (closer)
+            float sphere2_cx = width / 4.0f;
+            float sphere2_cy = height / 8.0f;
+            float sphere2_r = height / 6.0f;
+            float sphere2_z = 2.0f;
+            
+            float dx2 = x - sphere2_cx;
+            float dy2 = y - sphere2_cy;
+            float d2 = std::sqrt(dx2 * dx2 + dy2 * dy2);
+            
+            if (d2 < sphere2_r) {
+                float zOffset = std::sqrt(sphere2_r * sphere2_r - d2 * d2) / sphere2_r;
+                float newZ = sphere2_z - zOffset * 0.6f;
+                if (newZ < z) {
+                    z = newZ;
+                    r = 50; g = 50; b = 200;  // Blue sphere
+                }
+            }
+            
+            // Box: Center
+            float box_cx = 0.0f;
+            float box_cy = height / 4.0f;
+            float box_w = width / 8.0f;
+            float box_h = height / 6.0f;
+            float box_z = 4.0f;
+            
+            if (std::abs(x - box_cx) < box_w && std::abs(y - box_cy) < box_h) {
+                if (box_z < z) {
+                    z = box_z;
+                    r = 200; g = 200; b = 50;  // Yellow box
+                }
+            }
+            
+            rgb.at<cv::Vec3b>(v, u) = cv::Vec3b(b, g, r);
+            depth.at<float>(v, u) = z;
+        }
+    }
+}
+
@@ -8,13 +8,36 @@
 #include "image_io.hpp"
 #include "depth_io.hpp"
 #include "mesh_generator.hpp"
+#include "edge_mask.hpp"
+#include "pixel_kernels.hpp"
 #include "depth_mesh.hpp"
+#include "sequence_mesh.hpp"
 #include "gl_renderer.hpp"
+#include "cpu_renderer.hpp"
+#include "resample_renderer.hpp"
+#include "output_sink.hpp"
+#include "tar_writer.hpp"
+#include "trace.hpp"
+#include "camera_info.hpp"
+#include "camera_model.hpp"
+#include "mapped_io.hpp"
+#include "batch_runner.hpp"
+#include "render_server.hpp"
+#include "render_pool.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <cassert>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <future>
+#include <chrono>
+#include <map>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
@@ -107,6 +130,170 @@ bool testDepthThresholds() {
     return true;
 }
 
+/**
+ * Test that every SIMD level of the edge mask kernel matches isDiscontinuity
+ */
+bool testEdgeMask() {
+    std::cout << "\n=== Testing Edge Mask Kernel ===" << std::endl;
+    
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    
+    // Mix of smooth depth, values on either side of both thresholds and invalid depths
+    const int width = 67;
+    std::vector<float> row0(width), row1(width);
+    for (int u = 0; u < width; ++u) {
+        row0[u] = 1.0f + 0.37f * (u % 11);
+        row1[u] = row0[u] * ((u % 3 == 0) ? 1.049f : 1.051f);
+    }
+    row0[5] = 0.0f;
+    row0[9] = std::nanf("");
+    row1[14] = std::numeric_limits<float>::infinity();
+    row1[20] = -2.0f;
+    row0[31] = 10.0f; row0[32] = 10.2f;
+    
+    std::vector<uint8_t> reference(width);
+    rgbd::mesh::computeEdgeMaskRow(row0.data(), row1.data(), width, thresh,
+                                   reference.data(), rgbd::SimdLevel::Scalar);
+    
+    for (int u = 0; u < width; ++u) {
+        bool right = u + 1 < width && !thresh.isDiscontinuity(row0[u], row0[u + 1]);
+        bool down = !thresh.isDiscontinuity(row0[u], row1[u]);
+        bool diag = u + 1 < width && !thresh.isDiscontinuity(row0[u], row1[u + 1]);
+        uint8_t expected = (right ? rgbd::mesh::kEdgeRight : 0) |
+                           (down ? rgbd::mesh::kEdgeDown : 0) |
+                           (diag ? rgbd::mesh::kEdgeDiag : 0);
+        TEST_ASSERT(reference[u] == expected, "Scalar edge bits match isDiscontinuity");
+    }
+    
+    const rgbd::SimdLevel levels[] = { rgbd::SimdLevel::SSE41, rgbd::SimdLevel::AVX2 };
+    for (rgbd::SimdLevel level : levels) {
+        std::vector<uint8_t> bits(width);
+        rgbd::mesh::computeEdgeMaskRow(row0.data(), row1.data(), width, thresh,
+                                       bits.data(), level);
+        TEST_ASSERT(bits == reference, std::string("Edge mask matches scalar at ") +
+                                       rgbd::simdLevelName(level));
+        
+        rgbd::mesh::computeEdgeMaskRow(row0.data(), nullptr, width, thresh,
+                                       bits.data(), level);
+        bool lastRowOk = true;
+        for (int u = 0; u < width; ++u) {
+            lastRowOk = lastRowOk && (bits[u] == (reference[u] & rgbd::mesh::kEdgeRight));
+        }
+        TEST_ASSERT(lastRowOk, "Last row only has horizontal edges");
+    }
+    
+    return true;
+}
+
+/**
+ * Test that every SIMD level of the pixel conversion kernels matches scalar
+ */
+bool testPixelKernels() {
+    std::cout << "\n=== Testing Pixel Kernels ===" << std::endl;
+    
+    // Odd width leaves tails after every vector width, height enough for two bands of threads
+    const int width = 83, height = 1601;
+    const size_t pixels = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> rgba(pixels * 4), mask(pixels);
+    std::vector<uint16_t> half(pixels), millimeters(pixels);
+    std::vector<float> depth(pixels);
+    for (size_t i = 0; i < pixels; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            rgba[i * 4 + c] = static_cast<uint8_t>(i * 7 + c * 61);
+        }
+        mask[i] = static_cast<uint8_t>(i % 3 == 0 ? 0 : i % 5);
+        half[i] = static_cast<uint16_t>(i * 157);  // Subnormals, normals, inf and NaN
+        millimeters[i] = static_cast<uint16_t>(i * 211);
+        depth[i] = 0.01f + 0.731f * (i % 97);
+    }
+    depth[3] = 0.0f;
+    depth[10] = -1.0f;
+    depth[17] = std::nanf("");
+    depth[24] = std::numeric_limits<float>::infinity();
+    depth[31] = 1e9f;
+    depth[38] = 65.535f;
+    
+    // Scalar results against the per-pixel definitions
+    std::vector<uint8_t> rgb(pixels * 3);
+    rgbd::kernels::rgbaToRgb(rgba.data(), rgb.data(), width, height, true, false, 1,
+                             rgbd::SimdLevel::Scalar);
+    size_t last = static_cast<size_t>(height - 1) * width;
+    TEST_ASSERT(rgb[0] == rgba[last * 4] && rgb[2] == rgba[last * 4 + 2],
+                "Flipped readback starts at the last source row");
+    
+    std::vector<uint16_t> encoded(pixels);
+    rgbd::kernels::depthToU16(depth.data(), encoded.data(), width, height, 1000.0f, false, 1,
+                              rgbd::SimdLevel::Scalar);
+    TEST_ASSERT(encoded[3] == 0 && encoded[10] == 0 && encoded[17] == 0 && encoded[24] == 0,
+                "Invalid depths encode to 0");
+    TEST_ASSERT(encoded[31] == 65535, "Far depths clamp to 65535");
+    TEST_ASSERT(encoded[1] == static_cast<uint16_t>(depth[1] * 1000.0f), "Depth encodes truncated");
+    
+    std::vector<float> meters(pixels);
+    rgbd::kernels::depthToFloat(half.data(), rgbd::DepthFormat::Float16, meters.data(),
+                                width, height, false, 1, rgbd::SimdLevel::Scalar);
+    TEST_ASSERT(meters[0] == 0.0f && meters[100] == rgbd::kernels::halfToFloat(half[100]),
+                "Float16 depth converts per value");
+    TEST_ASSERT(rgbd::kernels::halfToFloat(0x3C00) == 1.0f &&
+                rgbd::kernels::halfToFloat(0xC000) == -2.0f &&
+                rgbd::kernels::halfToFloat(0x0001) == std::ldexp(1.0f, -24),
+                "Half-precision reference values");
+    
+    // Every level and thread count must give the scalar bytes
+    auto runAll = [&](rgbd::SimdLevel level, int threads, bool flip) {
+        std::vector<uint8_t> out;
+        auto append = [&out](const void* data, size_t bytes) {
+            const uint8_t* p = static_cast<const uint8_t*>(data);
+            out.insert(out.end(), p, p + bytes);
+        };
+        std::vector<uint8_t> rgbOut(pixels * 3), bgrOut(pixels * 3), swapped(pixels * 3), maskOut(pixels);
+        std::vector<float> halfOut(pixels), mmOut(pixels), floatOut(pixels);
+        std::vector<uint16_t> u16Out(pixels);
+        rgbd::kernels::rgbaToRgb(rgba.data(), rgbOut.data(), width, height, flip, false, threads, level);
+        rgbd::kernels::rgbaToRgb(rgba.data(), bgrOut.data(), width, height, flip, true, threads, level);
+        rgbd::kernels::swapRedBlue(rgba.data(), swapped.data(), width, height, flip, threads, level);
+        rgbd::kernels::depthToFloat(half.data(), rgbd::DepthFormat::Float16, halfOut.data(),
+                                    width, height, flip, threads, level);
+        rgbd::kernels::depthToFloat(millimeters.data(), rgbd::DepthFormat::Millimeters, mmOut.data(),
+                                    width, height, flip, threads, level);
+        rgbd::kernels::depthToFloat(depth.data(), rgbd::DepthFormat::Float32, floatOut.data(),
+                                    width, height, flip, threads, level);
+        rgbd::kernels::depthToU16(depth.data(), u16Out.data(), width, height, 1000.0f, flip, threads, level);
+        rgbd::kernels::maskToU8(mask.data(), maskOut.data(), width, height, flip, threads, level);
+        append(rgbOut.data(), rgbOut.size());
+        append(bgrOut.data(), bgrOut.size());
+        append(swapped.data(), swapped.size());
+        append(halfOut.data(), halfOut.size() * sizeof(float));
+        append(mmOut.data(), mmOut.size() * sizeof(float));
+        append(floatOut.data(), floatOut.size() * sizeof(float));
+        append(u16Out.data(), u16Out.size() * sizeof(uint16_t));
+        append(maskOut.data(), maskOut.size());
+        return out;
+    };
+    
+    const rgbd::SimdLevel levels[] = {
+        rgbd::SimdLevel::SSE41, rgbd::SimdLevel::AVX2, rgbd::SimdLevel::AVX512
+    };
+    for (bool flip : { false, true }) {
+        std::vector<uint8_t> reference = runAll(rgbd::SimdLevel::Scalar, 1, flip);
+        for (rgbd::SimdLevel level : levels) {
+            TEST_ASSERT(runAll(level, 1, flip) == reference,
+                        std::string("Kernels match scalar at ") + rgbd::simdLevelName(level));
+        }
+        TEST_ASSERT(runAll(rgbd::activeSimdLevel(), 4, flip) == reference,
+                    "Threaded kernels match scalar");
+    }
+    
+    // In place swap, as used on decoded images
+    std::vector<uint8_t> inPlace(rgba.begin(), rgba.begin() + pixels * 3);
+    std::vector<uint8_t> swapped(pixels * 3);
+    rgbd::kernels::swapRedBlue(inPlace.data(), swapped.data(), width, height, false);
+    rgbd::kernels::swapRedBlue(inPlace.data(), inPlace.data(), width, height, false);
+    TEST_ASSERT(inPlace == swapped, "In-place channel swap matches");
+    
+    return true;
+}
+
 /**
  * Test mesh generation
  */
@@ -147,6 +334,577 @@ bool testMeshGeneration() {
     return true;
 }
 
+/**
+ * Test that multi-threaded mesh generation matches the serial result
+ */
+bool testParallelMeshGeneration() {
+    std::cout << "\n=== Testing Parallel Mesh Generation ===" << std::endl;
+    
+    // Odd size so row bands do not divide evenly, with some invalid pixels
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 173, 211);
+    for (int v = 0; v < depth.rows; v += 7) {
+        depth.at<float>(v, (v * 13) % depth.cols) = std::nanf("");
+        depth.at<float>(v, (v * 29) % depth.cols) = 0.0f;
+    }
+    
+    rgbd::Intrinsics K(150.0f, 150.0f, 86.5f, 105.5f, 173, 211);
+    rgbd::mesh::MeshGenerator generator;
+    
+    generator.setNumThreads(1);
+    rgbd::Mesh serial = generator.generate(depth, K);
+    
+    generator.setNumThreads(4);
+    rgbd::Mesh parallel = generator.generate(depth, K);
+    
+    TEST_ASSERT(serial.numVertices() == parallel.numVertices(), "Vertex counts match");
+    TEST_ASSERT(serial.numTriangles() == parallel.numTriangles(), "Triangle counts match");
+    TEST_ASSERT(std::memcmp(serial.vertices.data(), parallel.vertices.data(),
+                            serial.numVertices() * sizeof(rgbd::Vertex)) == 0,
+                "Vertices are bit-identical");
+    TEST_ASSERT(std::memcmp(serial.triangles.data(), parallel.triangles.data(),
+                            serial.numTriangles() * sizeof(rgbd::Triangle)) == 0,
+                "Triangles are identical");
+    
+    return true;
+}
+
+/**
+ * Test that compact vertex layouts decode to the float32 vertices and render
+ * the same images
+ */
+bool testVertexLayouts() {
+    std::cout << "\n=== Testing Vertex Layouts ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 128, 96);
+    
+    rgbd::Intrinsics K(100.0f, 100.0f, 64.0f, 48.0f, 128, 96);
+    rgbd::mesh::MeshGenerator generator;
+    rgbd::Mesh reference = generator.generate(depth, K);
+    
+    rgbd::VertexLayout parsed;
+    TEST_ASSERT(rgbd::mesh::parseVertexLayout("depth_pixel", parsed) &&
+                parsed == rgbd::VertexLayout::DepthPixel, "Layout name parsed");
+    TEST_ASSERT(!rgbd::mesh::parseVertexLayout("half", parsed), "Unknown layout rejected");
+    
+    const rgbd::VertexLayout layouts[] = {
+        rgbd::VertexLayout::DepthPixel, rgbd::VertexLayout::Quantized16
+    };
+    for (rgbd::VertexLayout layout : layouts) {
+        generator.setVertexLayout(layout);
+        rgbd::Mesh mesh = generator.generate(depth, K);
+        std::cout << "  " << rgbd::mesh::vertexLayoutName(layout) << ": "
+                  << mesh.vertexStride() << " bytes per vertex" << std::endl;
+        
+        TEST_ASSERT(mesh.layout == layout, "Mesh has the requested layout");
+        TEST_ASSERT(mesh.vertices.empty(), "Float32 stream not filled");
+        TEST_ASSERT(mesh.vertexStride() < sizeof(rgbd::Vertex), "Layout is smaller than Vertex");
+        TEST_ASSERT(mesh.numVertices() == reference.numVertices(), "Vertex counts match");
+        TEST_ASSERT(std::memcmp(mesh.triangles.data(), reference.triangles.data(),
+                                mesh.numTriangles() * sizeof(rgbd::Triangle)) == 0,
+                    "Triangles are identical");
+        
+        // DepthPixel is exact up to float rounding, Quantized16 to 1/65535 of the range
+        float maxError = 0.0f;
+        for (size_t i = 0; i < mesh.numVertices(); ++i) {
+            rgbd::Vertex a = mesh.vertex(i, K);
+            const rgbd::Vertex& b = reference.vertices[i];
+            maxError = std::max({maxError, std::abs(a.x - b.x), std::abs(a.y - b.y),
+                                 std::abs(a.z - b.z), std::abs(a.u - b.u), std::abs(a.v - b.v)});
+        }
+        std::cout << "    Max decode error: " << maxError << std::endl;
+        TEST_ASSERT(maxError < 1e-3f, "Decoded vertices match float32 vertices");
+    }
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    
+    TEST_ASSERT(renderer.uploadTexture(rgb), "Texture uploaded");
+    rgbd::Intrinsics targetK = K.scaled(1.5f);
+    
+    rgbd::RenderOutput expected;
+    TEST_ASSERT(renderer.uploadMesh(reference), "Float32 mesh uploaded");
+    TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, expected), "Float32 render succeeded");
+    
+    for (rgbd::VertexLayout layout : layouts) {
+        generator.setVertexLayout(layout);
+        rgbd::RenderOutput output;
+        TEST_ASSERT(renderer.uploadMesh(generator.generate(depth, K)), "Compact mesh uploaded");
+        TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, output), "Compact render succeeded");
+        
+        size_t maskDiff = 0;
+        float maxDepthDiff = 0.0f;
+        for (size_t i = 0; i < output.mask.size(); ++i) {
+            if ((output.mask[i] > 0) != (expected.mask[i] > 0)) {
+                maskDiff++;
+            } else if (output.mask[i] > 0) {
+                maxDepthDiff = std::max(maxDepthDiff, std::abs(output.depth[i] - expected.depth[i]));
+            }
+        }
+        std::cout << "    " << rgbd::mesh::vertexLayoutName(layout) << ": " << maskDiff
+                  << " mask differences, max depth difference " << maxDepthDiff << " m" << std::endl;
+        TEST_ASSERT(maskDiff <= output.mask.size() / 1000, "Compact mask matches float32 mask");
+        TEST_ASSERT(maxDepthDiff < 1e-3f, "Compact depth matches float32 depth");
+    }
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test that strip and meshlet index modes encode the triangle list with less
+ * index memory and render the same images
+ */
+bool testIndexModes() {
+    std::cout << "\n=== Testing Index Modes ===" << std::endl;
+    
+    // Holes so strips get restarted mid-row
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 160, 120);
+    for (int v = 0; v < depth.rows; v += 5) {
+        depth.at<float>(v, (v * 17) % depth.cols) = 0.0f;
+    }
+    
+    rgbd::Intrinsics K(120.0f, 120.0f, 80.0f, 60.0f, 160, 120);
+    rgbd::mesh::MeshGenerator generator;
+    generator.setNumThreads(3);
+    rgbd::Mesh reference = generator.generate(depth, K);
+    
+    // Triangles compared as vertex sets, strips change the corner order
+    auto normalized = [](std::vector<rgbd::Triangle> triangles) {
+        std::vector<std::array<uint32_t, 3>> sorted;
+        for (const rgbd::Triangle& t : triangles) {
+            std::array<uint32_t, 3> a = {{t.v0, t.v1, t.v2}};
+            std::sort(a.begin(), a.end());
+            sorted.push_back(a);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    };
+    auto expected = normalized(reference.triangles);
+    
+    const rgbd::IndexMode modes[] = { rgbd::IndexMode::Strips, rgbd::IndexMode::Meshlets };
+    std::vector<rgbd::Mesh> meshes;
+    for (rgbd::IndexMode mode : modes) {
+        generator.setIndexMode(mode);
+        meshes.push_back(generator.generate(depth, K));
+        const rgbd::Mesh& mesh = meshes.back();
+        std::cout << "  " << rgbd::mesh::indexModeName(mode) << ": " << mesh.indexBytes()
+                  << " bytes vs " << reference.indexBytes() << std::endl;
+        
+        TEST_ASSERT(mesh.indexMode == mode, "Mesh has the requested index mode");
+        TEST_ASSERT(mesh.triangles.empty(), "Triangle list not filled");
+        TEST_ASSERT(mesh.numTriangles() == reference.numTriangles(), "Triangle counts match");
+        TEST_ASSERT(mesh.indexBytes() * 3 / 2 < reference.indexBytes(), "Index memory reduced");
+        TEST_ASSERT(normalized(rgbd::mesh::expandTriangles(mesh)) == expected,
+                    "Same triangles as the triangle list");
+    }
+    
+    // Meshlet indices stay inside the vertex buffer after adding the base
+    for (const rgbd::Meshlet& m : meshes[1].meshlets) {
+        TEST_ASSERT(m.indexOffset + m.indexCount <= meshes[1].meshletIndices.size(),
+                    "Meshlet range inside index buffer");
+        const uint16_t* idx = meshes[1].meshletIndices.data() + m.indexOffset;
+        uint16_t maxLocal = *std::max_element(idx, idx + m.indexCount);
+        TEST_ASSERT(m.baseVertex + maxLocal < meshes[1].numVertices(), "Meshlet vertex in range");
+    }
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    
+    TEST_ASSERT(renderer.uploadTexture(rgb), "Texture uploaded");
+    std::vector<rgbd::Intrinsics> targets = { K.scaled(0.75f), K.scaled(1.5f) };
+    
+    std::vector<rgbd::RenderOutput> expectedOutputs(targets.size());
+    std::vector<rgbd::RenderOutput> expectedBatch;
+    TEST_ASSERT(renderer.uploadMesh(reference), "Triangle list uploaded");
+    for (size_t i = 0; i < targets.size(); ++i) {
+        TEST_ASSERT(renderer.render(K, targets[i], 0.1f, 100.0f, expectedOutputs[i]),
+                    "Triangle list rendered");
+    }
+    TEST_ASSERT(renderer.renderBatch(K, targets, 0.1f, 100.0f, expectedBatch),
+                "Triangle list batch rendered");
+    
+    // Strips reorder the corners of every other triangle, which may change
+    // varying interpolation in the last bits
+    auto compare = [](const rgbd::RenderOutput& a, const rgbd::RenderOutput& b) {
+        size_t maskDiff = 0;
+        float maxDepthDiff = 0.0f;
+        for (size_t p = 0; p < a.mask.size(); ++p) {
+            if (a.mask[p] != b.mask[p]) {
+                maskDiff++;
+            } else if (a.mask[p] > 0) {
+                maxDepthDiff = std::max(maxDepthDiff, std::abs(a.depth[p] - b.depth[p]));
+            }
+        }
+        return maskDiff == 0 && maxDepthDiff < 1e-5f;
+    };
+    
+    for (const rgbd::Mesh& mesh : meshes) {
+        TEST_ASSERT(renderer.uploadMesh(mesh), "Indexed mesh uploaded");
+        for (size_t i = 0; i < targets.size(); ++i) {
+            rgbd::RenderOutput output;
+            TEST_ASSERT(renderer.render(K, targets[i], 0.1f, 100.0f, output), "Render succeeded");
+            TEST_ASSERT(compare(output, expectedOutputs[i]), "Render matches triangle list");
+        }
+        
+        // Layered path draws the visible meshlets instanced per view
+        std::vector<rgbd::RenderOutput> batch;
+        TEST_ASSERT(renderer.renderBatch(K, targets, 0.1f, 100.0f, batch), "Batch render succeeded");
+        for (size_t i = 0; i < targets.size(); ++i) {
+            TEST_ASSERT(compare(batch[i], expectedBatch[i]), "Batch render matches triangle list");
+        }
+    }
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test that meshlet tiles bound their triangles and that culling them
+ * against zoomed-in views draws fewer triangles with identical results
+ */
+bool testMeshletCulling() {
+    std::cout << "\n=== Testing Meshlet Culling ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 320, 240);
+    rgbd::Intrinsics K(250.0f, 250.0f, 160.0f, 120.0f, 320, 240);
+    
+    // Pixel coordinates of the vertices are stored by the DepthPixel layout
+    rgbd::mesh::MeshGenerator generator;
+    generator.setVertexLayout(rgbd::VertexLayout::DepthPixel);
+    generator.setIndexMode(rgbd::IndexMode::Meshlets);
+    rgbd::Mesh mesh = generator.generate(depth, K);
+    TEST_ASSERT(!mesh.empty(), "Meshlet mesh generated");
+    TEST_ASSERT(mesh.meshlets.size() > 20, "Mesh split into tiles");
+    
+    bool inBounds = true;
+    for (const rgbd::Meshlet& m : mesh.meshlets) {
+        const uint16_t* idx = mesh.meshletIndices.data() + m.indexOffset;
+        for (uint32_t i = 0; i < m.indexCount; ++i) {
+            const rgbd::DepthPixelVertex& v = mesh.depthVertices[m.baseVertex + idx[i]];
+            inBounds = inBounds && v.px >= m.minU && v.px <= m.maxU && v.py >= m.minV && v.py <= m.maxV;
+        }
+        TEST_ASSERT(m.maxU - m.minU <= rgbd::mesh::kMeshletTileSize &&
+                    m.maxV - m.minV <= rgbd::mesh::kMeshletTileSize, "Tile size bounded");
+    }
+    TEST_ASSERT(inBounds, "Meshlet vertices inside their bounds");
+    
+    // Tiles at the border leave a 4x zoom, the central one does not
+    rgbd::Intrinsics zoom = K.scaled(4.0f);
+    size_t visible = 0;
+    for (const rgbd::Meshlet& m : mesh.meshlets) {
+        visible += rgbd::mesh::meshletVisible(m, K, zoom) ? 1 : 0;
+    }
+    std::cout << "  Visible at 4x: " << visible << "/" << mesh.meshlets.size() << " meshlets" << std::endl;
+    TEST_ASSERT(visible > 0 && visible * 4 < mesh.meshlets.size(), "Zoomed view culls tiles");
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    TEST_ASSERT(renderer.uploadMesh(mesh) && renderer.uploadTexture(rgb), "Mesh and texture uploaded");
+    
+    const float scales[] = { 1.0f, 2.0f, 4.0f };
+    const size_t total = mesh.numTriangles();
+    for (float scale : scales) {
+        rgbd::Intrinsics targetK = K.scaled(scale);
+        rgbd::RenderOutput culled, full;
+        renderer.setMeshletCulling(true);
+        TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, culled), "Culled render");
+        size_t drawn = renderer.getDrawnTriangles();
+        renderer.setMeshletCulling(false);
+        TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, full), "Unculled render");
+        TEST_ASSERT(renderer.getDrawnTriangles() == total, "Every triangle drawn without culling");
+        
+        std::cout << "  Scale " << scale << ": " << drawn << "/" << total << " triangles" << std::endl;
+        TEST_ASSERT(culled.rgb == full.rgb && culled.depth == full.depth && culled.mask == full.mask,
+                    "Culling leaves the image unchanged");
+        
+        // The visible 1/s^2 of the source, grown by the partially covered tiles
+        const float tile = static_cast<float>(rgbd::mesh::kMeshletTileSize);
+        float expected = (K.width / scale + 2.0f * tile) * (K.height / scale + 2.0f * tile) /
+                         (static_cast<float>(K.width) * K.height);
+        TEST_ASSERT(drawn <= total * std::min(1.0f, expected), "Triangles shrink with the visible area");
+    }
+    
+    // Layered views draw the union of their visible meshlets
+    std::vector<rgbd::Intrinsics> targets = { K.scaled(2.0f), K.scaled(4.0f) };
+    std::vector<rgbd::RenderOutput> culledBatch, fullBatch;
+    renderer.setMeshletCulling(true);
+    TEST_ASSERT(renderer.renderBatch(K, targets, 0.1f, 100.0f, culledBatch), "Culled batch");
+    size_t batchDrawn = renderer.getDrawnTriangles();
+    renderer.setMeshletCulling(false);
+    TEST_ASSERT(renderer.renderBatch(K, targets, 0.1f, 100.0f, fullBatch), "Unculled batch");
+    TEST_ASSERT(batchDrawn < total, "Batch culls tiles outside every view");
+    for (size_t i = 0; i < targets.size(); ++i) {
+        TEST_ASSERT(culledBatch[i].depth == fullBatch[i].depth && culledBatch[i].mask == fullBatch[i].mask,
+                    "Culled batch matches");
+    }
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test that a sequence mesh regenerates only the tiles around changed
+ * depth, matches a mesh built from scratch and updates GPU buffers in place
+ */
+bool testSequenceMesh() {
+    std::cout << "\n=== Testing Sequence Mesh ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 320, 240);
+    for (int v = 0; v < depth.rows; v += 7) {
+        depth.at<float>(v, (v * 13) % depth.cols) = 0.0f;
+    }
+    rgbd::Intrinsics K(250.0f, 250.0f, 160.0f, 120.0f, 320, 240);
+    
+    // Triangles as sorted pixel index triples, independent of vertex order
+    auto pixelTriangles = [&](const rgbd::Mesh& mesh) {
+        std::vector<std::array<uint32_t, 3>> sorted;
+        for (const rgbd::Triangle& t : rgbd::mesh::expandTriangles(mesh)) {
+            std::array<uint32_t, 3> a;
+            const uint32_t corners[3] = { t.v0, t.v1, t.v2 };
+            for (int c = 0; c < 3; ++c) {
+                const rgbd::DepthPixelVertex& v = mesh.depthVertices[corners[c]];
+                a[c] = static_cast<uint32_t>(v.py) * K.width + v.px;
+            }
+            std::sort(a.begin(), a.end());
+            sorted.push_back(a);
+        }
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    };
+    // Same vertices and the same live indices of every tile
+    auto sameMesh = [](const rgbd::Mesh& a, const rgbd::Mesh& b) {
+        if (a.depthVertices.size() != b.depthVertices.size() ||
+            std::memcmp(a.depthVertices.data(), b.depthVertices.data(),
+                        a.depthVertices.size() * sizeof(rgbd::DepthPixelVertex)) != 0 ||
+            a.meshlets.size() != b.meshlets.size()) {
+            return false;
+        }
+        for (size_t t = 0; t < a.meshlets.size(); ++t) {
+            const rgbd::Meshlet& ma = a.meshlets[t];
+            const rgbd::Meshlet& mb = b.meshlets[t];
+            if (ma.indexCount != mb.indexCount ||
+                !std::equal(a.meshletIndices.begin() + ma.indexOffset,
+                            a.meshletIndices.begin() + ma.indexOffset + ma.indexCount,
+                            b.meshletIndices.begin() + mb.indexOffset)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    rgbd::mesh::MeshGenerator generator;
+    generator.setVertexLayout(rgbd::VertexLayout::DepthPixel);
+    rgbd::Mesh reference = generator.generate(depth, K);
+    
+    rgbd::mesh::SequenceMesh sequence;
+    sequence.setVertexLayout(rgbd::VertexLayout::DepthPixel);
+    sequence.setNumThreads(3);
+    rgbd::MeshUpdate update;
+    TEST_ASSERT(sequence.update(depth, K, update), "First frame meshed");
+    TEST_ASSERT(update.full && update.version == 1 && sequence.getReport().rebuilt,
+                "First frame is a full rebuild");
+    std::shared_ptr<const rgbd::Mesh> first = sequence.getMesh();
+    TEST_ASSERT(first->indexMode == rgbd::IndexMode::Meshlets, "Tiled mesh uses meshlets");
+    TEST_ASSERT(first->numTriangles() == reference.numTriangles(), "Triangle count matches generate()");
+    TEST_ASSERT(pixelTriangles(*first) == pixelTriangles(reference), "Same triangles as generate()");
+    auto firstTriangles = pixelTriangles(*first);
+    
+    // A small patch touches the tiles sharing its pixels only
+    cv::Mat moved = depth.clone();
+    for (int v = 100; v < 106; ++v) {
+        for (int u = 100; u < 106; ++u) {
+            moved.at<float>(v, u) = 1.0f;
+        }
+    }
+    TEST_ASSERT(sequence.update(moved, K, update), "Changed frame meshed");
+    const rgbd::mesh::SequenceReport& report = sequence.getReport();
+    std::cout << "  Patch: " << report.changedTiles << "/" << report.tiles << " tiles, "
+              << update.vertexRanges.size() << " vertex ranges" << std::endl;
+    TEST_ASSERT(!update.full && update.version == 2, "Patch is an incremental update");
+    TEST_ASSERT(report.changedTiles >= 1 && report.changedTiles <= 4, "Only nearby tiles regenerated");
+    std::shared_ptr<const rgbd::Mesh> second = sequence.getMesh();
+    size_t vertexSlots = 0;
+    bool rangesInside = true;
+    for (const rgbd::BufferRange& r : update.vertexRanges) {
+        vertexSlots += r.count;
+        rangesInside = rangesInside && r.offset + r.count <= second->numVertices();
+    }
+    for (const rgbd::BufferRange& r : update.indexRanges) {
+        rangesInside = rangesInside && r.offset + r.count <= second->meshletIndices.size();
+    }
+    TEST_ASSERT(vertexSlots == report.changedTiles * rgbd::mesh::kTileVertexSlots, "Ranges cover the changed tiles");
+    TEST_ASSERT(rangesInside, "Ranges inside the buffers");
+    
+    TEST_ASSERT(first != second && pixelTriangles(*first) == firstTriangles,
+                "Held snapshot left unchanged");
+    
+    rgbd::mesh::SequenceMesh fresh;
+    fresh.setVertexLayout(rgbd::VertexLayout::DepthPixel);
+    rgbd::MeshUpdate freshUpdate;
+    TEST_ASSERT(fresh.update(moved, K, freshUpdate), "Fresh mesh of the changed frame");
+    TEST_ASSERT(sameMesh(*second, *fresh.getMesh()), "Update matches a rebuild");
+    TEST_ASSERT(pixelTriangles(*second) == pixelTriangles(generator.generate(moved, K)),
+                "Update matches generate()");
+    
+    // Changes within the tolerance keep the previous depth
+    rgbd::mesh::SequenceOptions options;
+    options.depthTolerance = 0.05f;
+    sequence.setOptions(options);
+    cv::Mat jitter = moved.clone();
+    for (int v = 50; v < 60; ++v) {
+        for (int u = 200; u < 210; ++u) {
+            jitter.at<float>(v, u) += 0.01f;
+        }
+    }
+    TEST_ASSERT(sequence.update(jitter, K, update), "Jittered frame meshed");
+    TEST_ASSERT(!update.full && update.vertexRanges.empty() && update.indexRanges.empty() &&
+                sequence.getReport().changedTiles == 0, "Changes within the tolerance ignored");
+    TEST_ASSERT(sameMesh(*sequence.getMesh(), *fresh.getMesh()), "Mesh kept");
+    
+    // Most tiles changed: rebuilt as a whole
+    cv::Mat scaled = moved.clone();
+    for (int v = 0; v < scaled.rows; ++v) {
+        for (int u = 0; u < scaled.cols; ++u) {
+            scaled.at<float>(v, u) *= 1.2f;
+        }
+    }
+    TEST_ASSERT(sequence.update(scaled, K, update), "Scaled frame meshed");
+    TEST_ASSERT(update.full && sequence.getReport().rebuilt && update.version == 4,
+                "Rebuilt above the changed fraction");
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    
+    // Frame 1 uploaded in full, frame 2 written into its buffers
+    rgbd::mesh::SequenceMesh gpuSequence;
+    gpuSequence.setVertexLayout(rgbd::VertexLayout::DepthPixel);
+    TEST_ASSERT(renderer.uploadTexture(rgb), "Texture uploaded");
+    TEST_ASSERT(gpuSequence.update(depth, K, update) && renderer.updateMesh(*gpuSequence.getMesh(), update),
+                "First frame uploaded");
+    TEST_ASSERT(gpuSequence.update(moved, K, update) && !update.full &&
+                renderer.updateMesh(*gpuSequence.getMesh(), update), "Second frame updated in place");
+    
+    rgbd::Intrinsics targetK = K.scaled(1.5f);
+    rgbd::RenderOutput updated, rebuilt;
+    TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, updated), "Updated mesh rendered");
+    TEST_ASSERT(renderer.uploadMesh(*fresh.getMesh()), "Rebuilt mesh uploaded");
+    TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, rebuilt), "Rebuilt mesh rendered");
+    TEST_ASSERT(updated.rgb == rebuilt.rgb && updated.depth == rebuilt.depth && updated.mask == rebuilt.mask,
+                "In-place update renders like a full upload");
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test that adaptive meshing merges planar regions within its error bounds
+ * and renders like the full grid
+ */
+bool testAdaptiveMesh() {
+    std::cout << "\n=== Testing Adaptive Mesh ===" << std::endl;
+    
+    // Slanted background so merging depends on the error bound, plus holes
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 160, 120);
+    for (int v = 0; v < depth.rows; ++v) {
+        for (int u = 0; u < depth.cols; ++u) {
+            float& z = depth.at<float>(v, u);
+            if (z > 4.0f) z = 4.0f + 0.01f * u + 0.005f * v;
+        }
+    }
+    for (int v = 0; v < depth.rows; v += 7) {
+        depth.at<float>(v, (v * 13) % depth.cols) = 0.0f;
+    }
+    
+    rgbd::Intrinsics K(120.0f, 120.0f, 80.0f, 60.0f, 160, 120);
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    rgbd::mesh::MeshGenerator generator;
+    generator.setThresholds(thresh);
+    generator.setNumThreads(3);
+    rgbd::Mesh reference = generator.generate(depth, K);
+    
+    rgbd::mesh::AdaptiveOptions options;
+    options.maxErrorPx = 0.5f;
+    options.maxDepthError = 0.005f;
+    options.maxFocalScale = 2.0f;
+    generator.setAdaptive(options);
+    rgbd::Mesh mesh = generator.generate(depth, K);
+    const rgbd::mesh::AdaptiveReport& report = generator.getAdaptiveReport();
+    
+    TEST_ASSERT(mesh.indexMode == rgbd::IndexMode::Triangles, "Adaptive mesh is a triangle list");
+    TEST_ASSERT(report.gridTriangles == reference.numTriangles(), "Grid triangle count reported");
+    TEST_ASSERT(report.triangles == mesh.numTriangles(), "Emitted triangle count reported");
+    TEST_ASSERT(mesh.numTriangles() * 4 < reference.numTriangles(), "Planar regions merged");
+    TEST_ASSERT(report.mergedBlocks > 0 && report.mergedBlocks < report.blocks, "Quadtree has mixed levels");
+    TEST_ASSERT(report.maxErrorPx <= options.maxErrorPx * 1.01f, "Reprojection error within bound");
+    TEST_ASSERT(report.maxDepthError <= options.maxDepthError * 1.01f, "Depth error within bound");
+    
+    // Same result with another thread count and a compact vertex layout
+    generator.setNumThreads(1);
+    generator.setVertexLayout(rgbd::VertexLayout::DepthPixel);
+    rgbd::Mesh serial = generator.generate(depth, K);
+    TEST_ASSERT(serial.numVertices() == mesh.numVertices() &&
+                std::memcmp(serial.triangles.data(), mesh.triangles.data(),
+                            mesh.numTriangles() * sizeof(rgbd::Triangle)) == 0,
+                "Adaptive mesh independent of threads and layout");
+    
+    // A zero bound keeps the full grid
+    options.maxErrorPx = 0.0f;
+    generator.setAdaptive(options);
+    TEST_ASSERT(generator.generate(depth, K).numTriangles() == reference.numTriangles(),
+                "Zero error bound disables adaptive meshing");
+    
+    // Coverage follows the full grid (no cracks between levels), depth stays
+    // within the bound
+    std::unique_ptr<rgbd::render::Renderer> cpu = rgbd::render::createRenderer("cpu", 4);
+    TEST_ASSERT(cpu != nullptr && cpu->initialize(), "CPU renderer initialized");
+    TEST_ASSERT(cpu->uploadTexture(rgb), "Texture uploaded");
+    
+    float scales[] = { 0.75f, 2.0f };
+    for (float scale : scales) {
+        rgbd::Intrinsics target = K.scaled(scale);
+        rgbd::RenderOutput expected, output;
+        TEST_ASSERT(cpu->uploadMesh(reference), "Full mesh uploaded");
+        TEST_ASSERT(cpu->render(K, target, 0.1f, 100.0f, expected), "Full mesh rendered");
+        TEST_ASSERT(cpu->uploadMesh(mesh), "Adaptive mesh uploaded");
+        TEST_ASSERT(cpu->render(K, target, 0.1f, 100.0f, output), "Adaptive mesh rendered");
+        
+        size_t maskDiff = 0;
+        float maxDepthError = 0.0f;
+        for (size_t i = 0; i < output.mask.size(); ++i) {
+            if ((output.mask[i] > 0) != (expected.mask[i] > 0)) {
+                maskDiff++;
+            } else if (output.mask[i] > 0) {
+                maxDepthError = std::max(maxDepthError,
+                                         std::abs(output.depth[i] - expected.depth[i]) / expected.depth[i]);
+            }
+        }
+        std::cout << "    Scale " << scale << ": " << maskDiff << " mask differences, max depth error "
+                  << maxDepthError * 100.0f << "%" << std::endl;
+        TEST_ASSERT(maskDiff <= output.mask.size() / 200, "Adaptive mask matches full mesh");
+        TEST_ASSERT(maxDepthError < 2.0f * options.maxDepthError, "Adaptive depth matches full mesh");
+    }
+    
+    return true;
+}
+
 /**
  * Test depth mesh builder
  */
@@ -254,6 +1012,1756 @@ bool testRenderer() {
     return true;
 }
 
+/**
+ * Test that the implicit grid mode reproduces the mesh path
+ */
+bool testImplicitGridRenderer() {
+    std::cout << "\n=== Testing Implicit Grid Renderer ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 192, 160);
+    depth.at<float>(40, 50) = 0.0f;
+    depth.at<float>(90, 120) = std::nanf("");
+    
+    rgbd::Intrinsics K(150.0f, 150.0f, 96.0f, 80.0f, 192, 160);
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    
+    rgbd::mesh::DepthMesh depthMesh;
+    if (!depthMesh.build(rgb, depth, K, thresh)) {
+        std::cerr << "SKIPPED: Failed to build mesh" << std::endl;
+        return true;
+    }
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    
+    TEST_ASSERT(renderer.uploadMesh(depthMesh.getMesh()), "Mesh uploaded");
+    TEST_ASSERT(renderer.uploadDepth(depth, thresh), "Depth grid uploaded");
+    TEST_ASSERT(renderer.uploadTexture(depthMesh.getTexture()), "Texture uploaded");
+    
+    float scales[] = {0.5f, 1.0f, 2.0f};
+    for (float scale : scales) {
+        rgbd::Intrinsics targetK = K.scaled(scale);
+        rgbd::RenderOutput meshOut, gridOut;
+        
+        renderer.setRenderMode(rgbd::render::RenderMode::Mesh);
+        TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, meshOut), "Mesh render succeeded");
+        renderer.setRenderMode(rgbd::render::RenderMode::ImplicitGrid);
+        TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, gridOut), "Grid render succeeded");
+        
+        // GLSL division is not required to be correctly rounded, so allow a
+        // handful of edge pixels to differ
+        size_t maskDiff = 0;
+        float maxDepthDiff = 0.0f;
+        for (size_t i = 0; i < meshOut.mask.size(); ++i) {
+            if ((meshOut.mask[i] > 0) != (gridOut.mask[i] > 0)) {
+                maskDiff++;
+            } else if (meshOut.mask[i] > 0) {
+                maxDepthDiff = std::max(maxDepthDiff, std::abs(meshOut.depth[i] - gridOut.depth[i]));
+            }
+        }
+        std::cout << "    Scale " << scale << ": " << maskDiff << " mask differences, "
+                  << "max depth difference " << maxDepthDiff << " m" << std::endl;
+        TEST_ASSERT(maskDiff <= meshOut.mask.size() / 1000, "Grid mask matches mesh mask");
+        TEST_ASSERT(maxDepthDiff < 1e-3f, "Grid depth matches mesh depth");
+    }
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test cached uniform locations and the program binary cache
+ */
+bool testShaderCache() {
+    std::cout << "\n=== Testing Shader Cache ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 128, 96);
+    rgbd::Intrinsics K(100.0f, 100.0f, 64.0f, 48.0f, 128, 96);
+    rgbd::mesh::DepthMesh depthMesh;
+    TEST_ASSERT(depthMesh.build(rgb, depth, K), "Mesh built");
+    
+    fs::path cacheDir = fs::temp_directory_path() / "rgbd_test_shader_cache";
+    fs::remove_all(cacheDir);
+    
+    // First renderer compiles and fills the cache
+    rgbd::render::GLRenderer first;
+    first.setShaderCacheDir(cacheDir.string());
+    if (!first.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    size_t numFiles = 0;
+    for (const auto& entry : fs::directory_iterator(cacheDir)) {
+        numFiles += entry.path().extension() == ".bin" ? 1 : 0;
+    }
+    std::cout << "  " << numFiles << " cached programs" << std::endl;
+    if (numFiles == 0) {
+        std::cerr << "SKIPPED: Driver exposes no program binary formats" << std::endl;
+        first.cleanup();
+        return true;
+    }
+    
+    const std::string vertexSource =
+        "#version 430 core\n"
+        "layout(location = 0) in vec3 aPosition;\n"
+        "uniform mat4 uProjection;\n"
+        "uniform vec4 uOffsets[4];\n"
+        "void main() { gl_Position = uProjection * vec4(aPosition, 1.0) + uOffsets[2]; }\n";
+    const std::string fragmentSource =
+        "#version 430 core\n"
+        "uniform float uGain;\n"
+        "out vec4 fragColor;\n"
+        "void main() { fragColor = vec4(uGain); }\n";
+    
+    rgbd::render::Shader compiled;
+    compiled.setBinaryCacheDir(cacheDir.string());
+    TEST_ASSERT(compiled.loadFromSource(vertexSource, fragmentSource), "Shader compiled");
+    TEST_ASSERT(!compiled.isFromCache(), "New sources are compiled");
+    TEST_ASSERT(compiled.uniform("uGain").isValid(), "Uniform location cached");
+    TEST_ASSERT(compiled.getUniformLocation("uOffsets") == compiled.getUniformLocation("uOffsets[0]"),
+                "Array uniform found by plain name");
+    TEST_ASSERT(compiled.getUniformLocation("uOffsets[2]") >= 0, "Array element found");
+    TEST_ASSERT(!compiled.uniform("uMissing").isValid(), "Unknown uniform is invalid");
+    
+    rgbd::render::Shader cached;
+    cached.setBinaryCacheDir(cacheDir.string());
+    TEST_ASSERT(cached.loadFromSource(vertexSource, fragmentSource), "Shader loaded");
+    TEST_ASSERT(cached.isFromCache(), "Same sources loaded from the cache");
+    TEST_ASSERT(cached.getUniformLocation("uProjection") == compiled.getUniformLocation("uProjection") &&
+                cached.getUniformLocation("uGain") == compiled.getUniformLocation("uGain"),
+                "Cached program has the same uniforms");
+    
+    // A corrupt binary falls back to compiling and is replaced
+    for (const auto& entry : fs::directory_iterator(cacheDir)) {
+        std::fstream file(entry.path(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(fs::file_size(entry.path()) / 2));
+        file.write("corrupt", 7);
+    }
+    rgbd::render::Shader recompiled;
+    recompiled.setBinaryCacheDir(cacheDir.string());
+    TEST_ASSERT(recompiled.loadFromSource(vertexSource, fragmentSource), "Corrupt cache falls back");
+    TEST_ASSERT(recompiled.uniform("uGain").isValid(), "Fallback program has its uniforms");
+    compiled.destroy();
+    cached.destroy();
+    recompiled.destroy();
+    first.cleanup();
+    fs::remove_all(cacheDir);
+    
+    // Renderers with and without a warm cache produce the same images
+    rgbd::render::GLRenderer plain;
+    TEST_ASSERT(plain.initialize(), "Uncached renderer initialized");
+    rgbd::RenderOutput expected;
+    TEST_ASSERT(plain.uploadMesh(depthMesh.getMesh()) && plain.uploadTexture(depthMesh.getTexture()),
+                "Uncached renderer uploaded");
+    TEST_ASSERT(plain.render(K, K.scaled(1.5f), 0.1f, 100.0f, expected), "Uncached render succeeded");
+    plain.cleanup();
+    
+    for (int run = 0; run < 2; ++run) {
+        rgbd::render::GLRenderer renderer;
+        renderer.setShaderCacheDir(cacheDir.string());
+        TEST_ASSERT(renderer.initialize(), "Cached renderer initialized");
+        TEST_ASSERT(renderer.uploadMesh(depthMesh.getMesh()) && renderer.uploadTexture(depthMesh.getTexture()),
+                    "Cached renderer uploaded");
+        rgbd::RenderOutput output;
+        TEST_ASSERT(renderer.render(K, K.scaled(1.5f), 0.1f, 100.0f, output), "Cached render succeeded");
+        TEST_ASSERT(output.mask == expected.mask && output.rgb == expected.rgb &&
+                    std::memcmp(output.depth.data(), expected.depth.data(),
+                                output.depth.size() * sizeof(float)) == 0,
+                    (run == 0 ? "Render with cold cache matches" : "Render with warm cache matches"));
+        renderer.cleanup();
+    }
+    
+    fs::remove_all(cacheDir);
+    return true;
+}
+
+/**
+ * Test pipelined rendering through the PBO readback ring
+ */
+bool testPipelinedReadback() {
+    std::cout << "\n=== Testing Pipelined Readback ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 128, 96);
+    
+    rgbd::Intrinsics K(100.0f, 100.0f, 64.0f, 48.0f, 128, 96);
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    
+    rgbd::mesh::DepthMesh depthMesh;
+    if (!depthMesh.build(rgb, depth, K, thresh)) {
+        std::cerr << "SKIPPED: Failed to build mesh" << std::endl;
+        return true;
+    }
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    
+    TEST_ASSERT(renderer.uploadMesh(depthMesh.getMesh()), "Mesh uploaded");
+    TEST_ASSERT(renderer.uploadTexture(depthMesh.getTexture()), "Texture uploaded");
+    
+    // Different output sizes so ring slots also get resized
+    std::vector<rgbd::Intrinsics> targets = {
+        K.scaled(0.5f), K.scaled(1.0f), K.scaled(1.5f), K.scaled(2.0f), K.scaled(0.75f)
+    };
+    targets[2].width = 160;
+    targets[2].height = 120;
+    
+    std::vector<rgbd::RenderOutput> expected(targets.size());
+    for (size_t i = 0; i < targets.size(); ++i) {
+        TEST_ASSERT(renderer.render(K, targets[i], 0.1f, 100.0f, expected[i]),
+                    "Blocking render succeeded");
+    }
+    
+    renderer.setPipelineDepth(2);
+    TEST_ASSERT(renderer.getPipelineDepth() == 2, "Pipeline depth set");
+    
+    std::vector<rgbd::RenderOutput> results;
+    size_t next = 0;
+    while (results.size() < targets.size()) {
+        if (next < targets.size() &&
+            renderer.pendingCount() < static_cast<size_t>(renderer.getPipelineDepth())) {
+            TEST_ASSERT(renderer.submit(K, targets[next++], 0.1f, 100.0f), "Submit succeeded");
+            continue;
+        }
+        
+        if (renderer.pendingCount() == 2) {
+            TEST_ASSERT(!renderer.submit(K, targets[0], 0.1f, 100.0f), "Full ring rejects submit");
+            rgbd::RenderOutput unused;
+            TEST_ASSERT(!renderer.render(K, targets[0], 0.1f, 100.0f, unused),
+                        "Blocking render rejected while renders are pending");
+        }
+        
+        results.emplace_back();
+        TEST_ASSERT(renderer.retrieve(results.back()), "Retrieve succeeded");
+    }
+    TEST_ASSERT(renderer.pendingCount() == 0, "Ring drained");
+    
+    rgbd::RenderOutput unused;
+    TEST_ASSERT(!renderer.retrieve(unused), "Retrieve with nothing pending fails");
+    
+    // Results come back in submission order and match the blocking path
+    for (size_t i = 0; i < targets.size(); ++i) {
+        TEST_ASSERT(results[i].width == targets[i].width &&
+                    results[i].height == targets[i].height, "Result size matches target");
+        TEST_ASSERT(results[i].rgb == expected[i].rgb, "Pipelined RGB matches");
+        TEST_ASSERT(results[i].depth == expected[i].depth, "Pipelined depth matches");
+        TEST_ASSERT(results[i].mask == expected[i].mask, "Pipelined mask matches");
+    }
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test layered batch rendering against one render per view
+ */
+bool testBatchRenderer() {
+    std::cout << "\n=== Testing Batch Renderer ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 96, 80);
+    
+    rgbd::Intrinsics K(80.0f, 80.0f, 48.0f, 40.0f, 96, 80);
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    
+    rgbd::mesh::DepthMesh depthMesh;
+    if (!depthMesh.build(rgb, depth, K, thresh)) {
+        std::cerr << "SKIPPED: Failed to build mesh" << std::endl;
+        return true;
+    }
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    
+    TEST_ASSERT(renderer.uploadMesh(depthMesh.getMesh()), "Mesh uploaded");
+    TEST_ASSERT(renderer.uploadDepth(depth, thresh), "Depth grid uploaded");
+    TEST_ASSERT(renderer.uploadTexture(depthMesh.getTexture()), "Texture uploaded");
+    
+    // More views than one layered pass holds
+    std::vector<rgbd::Intrinsics> targets;
+    int numViews = rgbd::render::GLRenderer::kMaxBatchLayers + 3;
+    for (int i = 0; i < numViews; ++i) {
+        targets.push_back(K.scaled(0.5f + 0.1f * i));
+    }
+    
+    rgbd::render::RenderMode modes[] = {
+        rgbd::render::RenderMode::Mesh, rgbd::render::RenderMode::ImplicitGrid
+    };
+    for (rgbd::render::RenderMode mode : modes) {
+        renderer.setRenderMode(mode);
+        
+        std::vector<rgbd::RenderOutput> batch;
+        TEST_ASSERT(renderer.renderBatch(K, targets, 0.1f, 100.0f, batch), "Batch render succeeded");
+        TEST_ASSERT(batch.size() == targets.size(), "One output per view");
+        
+        // Same triangles and coverage; the extra geometry stage may change
+        // varying interpolation in the last bits
+        size_t maskDiff = 0;
+        int maxRgbDiff = 0;
+        float maxDepthDiff = 0.0f;
+        for (size_t i = 0; i < targets.size(); ++i) {
+            rgbd::RenderOutput single;
+            TEST_ASSERT(renderer.render(K, targets[i], 0.1f, 100.0f, single), "Single render succeeded");
+            TEST_ASSERT(batch[i].width == single.width && batch[i].height == single.height,
+                        "Batch output size matches");
+            for (size_t p = 0; p < single.mask.size(); ++p) {
+                if (single.mask[p] != batch[i].mask[p]) {
+                    maskDiff++;
+                } else if (single.mask[p] > 0) {
+                    maxDepthDiff = std::max(maxDepthDiff, std::abs(single.depth[p] - batch[i].depth[p]));
+                }
+            }
+            for (size_t p = 0; p < single.rgb.size(); ++p) {
+                maxRgbDiff = std::max(maxRgbDiff, std::abs(single.rgb[p] - batch[i].rgb[p]));
+            }
+        }
+        std::cout << "    " << maskDiff << " mask differences, max depth difference "
+                  << maxDepthDiff << " m, max RGB difference " << maxRgbDiff << std::endl;
+        TEST_ASSERT(maskDiff == 0, "Batch masks match single renders");
+        TEST_ASSERT(maxDepthDiff < 1e-4f, "Batch depth matches single renders");
+        TEST_ASSERT(maxRgbDiff <= 1, "Batch RGB matches single renders");
+    }
+    
+    // Texture array layers share one size
+    std::vector<rgbd::Intrinsics> mixed = { K, K.scaled(2.0f) };
+    mixed[1].width = 48;
+    std::vector<rgbd::RenderOutput> unused;
+    TEST_ASSERT(!renderer.renderBatch(K, mixed, 0.1f, 100.0f, unused), "Mixed sizes rejected");
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test selectable outputs and reduced-precision depth targets
+ */
+bool testRenderOutputs() {
+    std::cout << "\n=== Testing Render Outputs ===" << std::endl;
+    
+    // Names accepted by --outputs / --depth_format
+    rgbd::OutputSelection parsed;
+    TEST_ASSERT(rgbd::app::parseOutputSelection("depth,mask", "mm16", parsed) &&
+                !parsed.rgb && parsed.depth && parsed.mask &&
+                parsed.depthFormat == rgbd::DepthFormat::Millimeters, "Output list parsed");
+    TEST_ASSERT(!rgbd::app::parseOutputSelection("rgb,normals", "float32", parsed), "Unknown output rejected");
+    TEST_ASSERT(!rgbd::app::parseOutputSelection("", "float32", parsed), "Empty output list rejected");
+    TEST_ASSERT(!rgbd::app::parseOutputSelection("depth", "float64", parsed), "Unknown depth format rejected");
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 96, 80);
+    rgbd::Intrinsics K(80.0f, 80.0f, 48.0f, 40.0f, 96, 80);
+    rgbd::mesh::DepthMesh depthMesh;
+    TEST_ASSERT(depthMesh.build(rgb, depth, K), "Mesh built");
+    rgbd::Intrinsics targetK = K.scaled(1.5f);
+    
+    // The CPU backend drops unselected outputs and skips texturing
+    rgbd::render::CpuRenderer cpu;
+    TEST_ASSERT(cpu.initialize() && cpu.uploadMesh(depthMesh.getMesh()) &&
+                cpu.uploadTexture(depthMesh.getTexture()), "CPU renderer ready");
+    rgbd::RenderOutput cpuFull, cpuDepth;
+    TEST_ASSERT(cpu.render(K, targetK, 0.1f, 100.0f, cpuFull), "CPU full render");
+    rgbd::OutputSelection depthOnly;
+    depthOnly.rgb = depthOnly.mask = false;
+    cpu.setOutputs(depthOnly);
+    TEST_ASSERT(cpu.render(K, targetK, 0.1f, 100.0f, cpuDepth), "CPU depth render");
+    TEST_ASSERT(cpuDepth.rgb.empty() && cpuDepth.mask.empty() && cpuDepth.depth == cpuFull.depth,
+                "CPU depth-only output");
+    cpu.cleanup();
+    
+    rgbd::render::GLRenderer renderer;
+    if (!renderer.initialize()) {
+        std::cerr << "SKIPPED: Failed to initialize renderer (no GPU?)" << std::endl;
+        return true;
+    }
+    TEST_ASSERT(renderer.uploadMesh(depthMesh.getMesh()) && renderer.uploadTexture(depthMesh.getTexture()),
+                "Mesh and texture uploaded");
+    
+    rgbd::RenderOutput full;
+    TEST_ASSERT(renderer.render(K, targetK, 0.1f, 100.0f, full), "Full render");
+    
+    auto renderWith = [&](const rgbd::OutputSelection& outputs, rgbd::RenderOutput& output) {
+        renderer.setOutputs(outputs);
+        return renderer.render(K, targetK, 0.1f, 100.0f, output);
+    };
+    
+    rgbd::OutputSelection rgbOnly;
+    rgbOnly.depth = rgbOnly.mask = false;
+    rgbd::RenderOutput out;
+    TEST_ASSERT(renderWith(rgbOnly, out), "RGB-only render");
+    TEST_ASSERT(out.rgb == full.rgb && out.depth.empty() && out.mask.empty(), "RGB-only output");
+    
+    TEST_ASSERT(renderWith(depthOnly, out), "Depth-only render");
+    TEST_ASSERT(out.rgb.empty() && out.depth == full.depth && out.mask.empty(), "Depth-only output");
+    
+    // Reduced precision: half float is within one ulp (drivers may truncate), R16UI millimeters
+    float maxHalfError = 0.0f;
+    float maxMmError = 0.0f;
+    rgbd::OutputSelection half = depthOnly;
+    half.depthFormat = rgbd::DepthFormat::Float16;
+    TEST_ASSERT(renderWith(half, out) && out.depth.size() == full.depth.size(), "Float16 depth render");
+    for (size_t i = 0; i < full.depth.size(); ++i) {
+        maxHalfError = std::max(maxHalfError, std::abs(out.depth[i] - full.depth[i]) /
+                                              std::max(full.depth[i], 1e-3f));
+    }
+    rgbd::OutputSelection millimeters = depthOnly;
+    millimeters.depthFormat = rgbd::DepthFormat::Millimeters;
+    TEST_ASSERT(renderWith(millimeters, out) && out.depth.size() == full.depth.size(), "Millimeter depth render");
+    for (size_t i = 0; i < full.depth.size(); ++i) {
+        maxMmError = std::max(maxMmError, std::abs(out.depth[i] - full.depth[i]));
+    }
+    std::cout << "    float16 relative error " << maxHalfError << ", mm16 error " << maxMmError << " m" << std::endl;
+    TEST_ASSERT(maxHalfError <= 1.0f / 1024.0f, "Float16 depth within half precision");
+    TEST_ASSERT(maxMmError <= 0.0005f + 1e-6f, "Millimeter depth within rounding");
+    
+    // Mask derived from depth matches the rendered mask
+    rgbd::OutputSelection derived;
+    derived.rgb = derived.depth = false;
+    derived.maskFromDepth = true;
+    derived.depthFormat = rgbd::DepthFormat::Float16;
+    TEST_ASSERT(renderWith(derived, out), "Derived mask render");
+    TEST_ASSERT(out.rgb.empty() && out.depth.empty() && out.mask == full.mask, "Mask from depth matches");
+    
+    // Submitted renders keep the selection they were submitted with
+    renderer.setOutputs(rgbd::OutputSelection());
+    TEST_ASSERT(renderer.submit(K, targetK, 0.1f, 100.0f), "Full render submitted");
+    renderer.setOutputs(millimeters);
+    TEST_ASSERT(renderer.submit(K, targetK, 0.1f, 100.0f), "Millimeter render submitted");
+    rgbd::RenderOutput first, second;
+    TEST_ASSERT(renderer.retrieve(first) && renderer.retrieve(second), "Both retrieved");
+    TEST_ASSERT(first.rgb == full.rgb && first.depth == full.depth && first.mask == full.mask,
+                "First render has every output");
+    TEST_ASSERT(second.rgb.empty() && second.mask.empty() && second.depth.size() == full.depth.size(),
+                "Second render has millimeter depth only");
+    
+    // Layered batches use the same targets
+    rgbd::OutputSelection batchOutputs;
+    batchOutputs.rgb = false;
+    batchOutputs.depthFormat = rgbd::DepthFormat::Millimeters;
+    renderer.setOutputs(batchOutputs);
+    std::vector<rgbd::RenderOutput> batch;
+    TEST_ASSERT(renderer.renderBatch(K, { targetK, K }, 0.1f, 100.0f, batch) && batch.size() == 2,
+                "Batch render");
+    bool batchMatches = batch[0].rgb.empty() && batch[0].mask == full.mask;
+    for (size_t i = 0; batchMatches && i < full.depth.size(); ++i) {
+        batchMatches = std::abs(batch[0].depth[i] - full.depth[i]) <= 0.0005f + 1e-6f;
+    }
+    TEST_ASSERT(batchMatches, "Batch depth and mask match");
+    
+    renderer.cleanup();
+    return true;
+}
+
+/**
+ * Test the GL context pool: shared geometry and least-loaded dispatch
+ */
+bool testRenderPool() {
+    std::cout << "\n=== Testing Render Pool ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 96, 80);
+    
+    rgbd::Intrinsics K(80.0f, 80.0f, 48.0f, 40.0f, 96, 80);
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    
+    rgbd::mesh::DepthMesh depthMesh;
+    if (!depthMesh.build(rgb, depth, K, thresh)) {
+        std::cerr << "SKIPPED: Failed to build mesh" << std::endl;
+        return true;
+    }
+    
+    std::cout << "  EGL devices: " << rgbd::render::GLContext::queryDeviceCount() << std::endl;
+    
+    // Three contexts of the default display, one share group
+    rgbd::render::RenderPool pool;
+    rgbd::render::RenderPoolOptions options;
+    options.devices = {-1};
+    options.contextsPerDevice = 3;
+    if (!pool.initialize(options)) {
+        std::cerr << "SKIPPED: Failed to initialize render pool (no GPU?)" << std::endl;
+        return true;
+    }
+    TEST_ASSERT(pool.size() == 3 && pool.getDeviceCount() == 1, "Three contexts on one device");
+    
+    // Reference views from a renderer of its own
+    rgbd::render::GLRenderer reference;
+    TEST_ASSERT(reference.initialize(), "Reference renderer initialized");
+    
+    std::vector<rgbd::Intrinsics> targets;
+    for (int i = 0; i < 7; ++i) {
+        targets.push_back(K.scaled(0.5f + 0.25f * i));
+    }
+    
+    rgbd::render::RenderMode modes[] = {
+        rgbd::render::RenderMode::Mesh, rgbd::render::RenderMode::ImplicitGrid
+    };
+    for (rgbd::render::RenderMode mode : modes) {
+        auto upload = [&](rgbd::render::GLRenderer& renderer) {
+            renderer.setRenderMode(mode);
+            return renderer.uploadMesh(depthMesh.getMesh()) && renderer.uploadDepth(depth, thresh) &&
+                   renderer.uploadTexture(depthMesh.getTexture());
+        };
+        TEST_ASSERT(upload(reference), "Reference uploaded");
+        
+        std::vector<rgbd::RenderOutput> outputs(targets.size());
+        std::vector<int> consumed(targets.size(), 0);
+        TEST_ASSERT(pool.renderViews(upload, K, targets, 0.1f, 100.0f,
+                                     [&](size_t index, rgbd::RenderOutput&& output) {
+                                         consumed[index]++;
+                                         outputs[index] = std::move(output);
+                                     }), "Pool rendered every view");
+        TEST_ASSERT(std::count(consumed.begin(), consumed.end(), 1) == static_cast<int>(targets.size()),
+                    "Every view consumed once");
+        
+        bool same = true;
+        for (size_t i = 0; i < targets.size(); ++i) {
+            rgbd::RenderOutput expected;
+            TEST_ASSERT(reference.render(K, targets[i], 0.1f, 100.0f, expected), "Reference render succeeded");
+            same = same && outputs[i].rgb == expected.rgb && outputs[i].depth == expected.depth &&
+                   outputs[i].mask == expected.mask;
+        }
+        TEST_ASSERT(same, "Shared contexts match a single renderer");
+    }
+    reference.cleanup();
+    
+    // Equal tasks spread evenly over the contexts
+    std::vector<size_t> before = pool.getCompletedCounts();
+    std::vector<std::future<bool>> tasks;
+    for (int i = 0; i < 9; ++i) {
+        tasks.push_back(pool.submit([](rgbd::render::GLRenderer& renderer) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return renderer.isInitialized();
+        }));
+    }
+    bool tasksOk = true;
+    for (auto& task : tasks) {
+        tasksOk = task.get() && tasksOk;
+    }
+    TEST_ASSERT(tasksOk, "Tasks ran on initialized contexts");
+    std::vector<size_t> after = pool.getCompletedCounts();
+    bool balanced = true;
+    for (size_t i = 0; i < after.size(); ++i) {
+        balanced = balanced && (after[i] - before[i] == 3);
+    }
+    TEST_ASSERT(balanced, "Least-loaded dispatch balances the contexts");
+    
+    pool.shutdown();
+    TEST_ASSERT(pool.size() == 0, "Pool shut down");
+    TEST_ASSERT(!pool.submit([](rgbd::render::GLRenderer&) { return true; }).get(),
+                "Shut down pool rejects tasks");
+    return true;
+}
+
+/**
+ * Test the CPU rasterizer against the GL renderer
+ */
+bool testCpuRenderer() {
+    std::cout << "\n=== Testing CPU Renderer ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 160, 120);
+    
+    rgbd::Intrinsics K(130.0f, 130.0f, 80.0f, 60.0f, 160, 120);
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    
+    rgbd::mesh::DepthMesh depthMesh;
+    if (!depthMesh.build(rgb, depth, K, thresh)) {
+        std::cerr << "SKIPPED: Failed to build mesh" << std::endl;
+        return true;
+    }
+    
+    std::unique_ptr<rgbd::render::Renderer> cpu = rgbd::render::createRenderer("cpu", 4);
+    TEST_ASSERT(cpu != nullptr, "CPU backend created");
+    TEST_ASSERT(rgbd::render::createRenderer("vulkan") == nullptr, "Unknown backend rejected");
+    TEST_ASSERT(cpu->initialize(), "CPU renderer initialized");
+    TEST_ASSERT(cpu->uploadMesh(depthMesh.getMesh()), "Mesh uploaded");
+    TEST_ASSERT(cpu->uploadTexture(depthMesh.getTexture()), "Texture uploaded");
+    
+    // Result must not depend on the thread count or the SIMD kernel
+    rgbd::render::CpuRenderer reference;
+    reference.setNumThreads(1);
+    reference.setSimdLevel(rgbd::SimdLevel::Scalar);
+    TEST_ASSERT(reference.initialize(), "Reference renderer initialized");
+    TEST_ASSERT(reference.uploadMesh(depthMesh.getMesh()), "Reference mesh uploaded");
+    TEST_ASSERT(reference.uploadTexture(depthMesh.getTexture()), "Reference texture uploaded");
+    
+    rgbd::render::GLRenderer gl;
+    bool haveGL = gl.initialize();
+    if (haveGL) {
+        TEST_ASSERT(gl.uploadMesh(depthMesh.getMesh()), "GL mesh uploaded");
+        TEST_ASSERT(gl.uploadTexture(depthMesh.getTexture()), "GL texture uploaded");
+    } else {
+        std::cerr << "  GL comparison skipped (no GPU?)" << std::endl;
+    }
+    
+    float scales[] = { 0.5f, 1.0f, 1.37f, 2.0f };
+    for (float scale : scales) {
+        rgbd::Intrinsics target = K.scaled(scale);
+        rgbd::RenderOutput out, ref;
+        TEST_ASSERT(cpu->render(K, target, 0.1f, 100.0f, out), "CPU render succeeded");
+        TEST_ASSERT(reference.render(K, target, 0.1f, 100.0f, ref), "Reference render succeeded");
+        TEST_ASSERT(out.mask == ref.mask && out.rgb == ref.rgb &&
+                    std::memcmp(out.depth.data(), ref.depth.data(), out.depth.size() * sizeof(float)) == 0,
+                    "CPU render is deterministic");
+        
+        if (!haveGL) continue;
+        rgbd::RenderOutput expected;
+        TEST_ASSERT(gl.render(K, target, 0.1f, 100.0f, expected), "GL render succeeded");
+        TEST_ASSERT(out.width == expected.width && out.height == expected.height, "Output size matches");
+        
+        // Documented tolerance (CpuRenderer): silhouette pixels < 0.5%,
+        // depth within 1e-3 relative, RGB within 2 levels
+        size_t maskDiff = 0;
+        size_t rgbOutliers = 0;
+        float maxDepthDiff = 0.0f;
+        for (size_t p = 0; p < out.mask.size(); ++p) {
+            if (out.mask[p] != expected.mask[p]) {
+                maskDiff++;
+                continue;
+            }
+            if (out.mask[p] == 0) continue;
+            float rel = std::abs(out.depth[p] - expected.depth[p]) / expected.depth[p];
+            maxDepthDiff = std::max(maxDepthDiff, rel);
+            for (int c = 0; c < 3; ++c) {
+                if (std::abs(out.rgb[p * 3 + c] - expected.rgb[p * 3 + c]) > 2) {
+                    rgbOutliers++;
+                    break;
+                }
+            }
+        }
+        std::cout << "    scale " << scale << ": " << maskDiff << " mask differences, max depth difference "
+                  << maxDepthDiff << " (relative), " << rgbOutliers << " RGB outliers" << std::endl;
+        TEST_ASSERT(maskDiff * 200 < out.mask.size(), "Coverage matches GL");
+        TEST_ASSERT(maxDepthDiff < 1e-3f, "Depth matches GL");
+        TEST_ASSERT(rgbOutliers * 200 < out.mask.size(), "RGB matches GL");
+    }
+    
+    // A huge triangle crossing the frame corner: its clamped pixel range is
+    // small, but its edge functions overflow int32
+    rgbd::Mesh large;
+    const float corners[3][2] = { { -20000.0f, -19950.0f }, { 60.0f, 110.0f }, { -20000.0f, 110.0f } };
+    for (const auto& c : corners) {
+        const float z = 2.0f;
+        large.vertices.emplace_back((c[0] + 0.5f - K.cx) / K.fx * z, (c[1] + 0.5f - K.cy) / K.fy * z, z,
+                                    0.5f, 0.5f);
+    }
+    large.triangles.emplace_back(0, 1, 2);
+    if (rgbd::activeSimdLevel() < rgbd::SimdLevel::AVX2) {
+        std::cerr << "  Large triangle check skipped (no AVX2)" << std::endl;
+    } else {
+        rgbd::render::CpuRenderer avx2;
+        avx2.setSimdLevel(rgbd::SimdLevel::AVX2);
+        TEST_ASSERT(avx2.initialize() && reference.initialize(), "Renderers initialized");
+        TEST_ASSERT(avx2.uploadMesh(large) && reference.uploadMesh(large), "Large triangle uploaded");
+        TEST_ASSERT(avx2.uploadTexture(depthMesh.getTexture()), "Texture uploaded");
+        rgbd::RenderOutput out, ref;
+        TEST_ASSERT(avx2.render(K, K, 0.1f, 100.0f, out), "AVX2 render succeeded");
+        TEST_ASSERT(reference.render(K, K, 0.1f, 100.0f, ref), "Scalar render succeeded");
+        size_t covered = std::count(ref.mask.begin(), ref.mask.end(), 255);
+        std::cout << "    large triangle: " << covered << " pixels covered" << std::endl;
+        TEST_ASSERT(covered > 0 && covered < ref.mask.size(), "Large triangle partly covers the frame");
+        TEST_ASSERT(out.mask == ref.mask &&
+                    std::memcmp(out.depth.data(), ref.depth.data(), out.depth.size() * sizeof(float)) == 0,
+                    "AVX2 matches scalar for a large off-screen triangle");
+    }
+    
+    gl.cleanup();
+    cpu->cleanup();
+    return true;
+}
+
+/**
+ * Test the resample backend against the mesh path of the CPU rasterizer
+ */
+bool testResampleRenderer() {
+    std::cout << "\n=== Testing Resample Renderer ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 160, 120);
+    
+    rgbd::Intrinsics K(130.0f, 130.0f, 80.0f, 60.0f, 160, 120);
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    
+    rgbd::mesh::DepthMesh depthMesh;
+    if (!depthMesh.build(rgb, depth, K, thresh)) {
+        std::cerr << "SKIPPED: Failed to build mesh" << std::endl;
+        return true;
+    }
+    
+    std::unique_ptr<rgbd::render::Renderer> resample = rgbd::render::createRenderer("resample", 4);
+    TEST_ASSERT(resample != nullptr, "Resample backend created");
+    TEST_ASSERT(resample->initialize(), "Resample renderer initialized");
+    TEST_ASSERT(!resample->uploadMesh(depthMesh.getMesh()), "Mesh upload rejected");
+    TEST_ASSERT(resample->uploadDepth(depth, thresh), "Depth grid uploaded");
+    TEST_ASSERT(resample->uploadTexture(rgb), "Texture uploaded");
+    
+    rgbd::render::ResampleRenderer scalar;
+    scalar.setNumThreads(1);
+    scalar.setSimdLevel(rgbd::SimdLevel::Scalar);
+    TEST_ASSERT(scalar.initialize(), "Scalar renderer initialized");
+    TEST_ASSERT(scalar.uploadDepth(depth, thresh) && scalar.uploadTexture(rgb), "Scalar inputs uploaded");
+    
+    rgbd::render::CpuRenderer reference;
+    TEST_ASSERT(reference.initialize(), "Reference renderer initialized");
+    TEST_ASSERT(!reference.uploadDepth(depth, thresh), "Mesh-only backend rejects depth grids");
+    TEST_ASSERT(reference.uploadMesh(depthMesh.getMesh()), "Reference mesh uploaded");
+    TEST_ASSERT(reference.uploadTexture(depthMesh.getTexture()), "Reference texture uploaded");
+    
+    float scales[] = { 0.5f, 1.0f, 1.37f, 2.0f };
+    for (float scale : scales) {
+        rgbd::Intrinsics target = K.scaled(scale);
+        target.cx += 3.0f;  // Scale 1 puts pixel centres on grid lines
+        rgbd::RenderOutput out, same, expected;
+        TEST_ASSERT(resample->render(K, target, 0.1f, 100.0f, out), "Resample render succeeded");
+        TEST_ASSERT(scalar.render(K, target, 0.1f, 100.0f, same), "Scalar render succeeded");
+        TEST_ASSERT(out.mask == same.mask && out.rgb == same.rgb &&
+                    std::memcmp(out.depth.data(), same.depth.data(), out.depth.size() * sizeof(float)) == 0,
+                    "Result independent of threads and SIMD kernel");
+        TEST_ASSERT(reference.render(K, target, 0.1f, 100.0f, expected), "Reference render succeeded");
+        
+        // Same tolerance as CpuRenderer against GL
+        size_t maskDiff = 0;
+        size_t rgbOutliers = 0;
+        float maxDepthDiff = 0.0f;
+        bool cleared = true;
+        for (size_t p = 0; p < out.mask.size(); ++p) {
+            if (out.mask[p] != expected.mask[p]) {
+                maskDiff++;
+                continue;
+            }
+            if (out.mask[p] == 0) {
+                cleared = cleared && out.depth[p] == 0.0f && out.rgb[p * 3] == 0;
+                continue;
+            }
+            float rel = std::abs(out.depth[p] - expected.depth[p]) / expected.depth[p];
+            maxDepthDiff = std::max(maxDepthDiff, rel);
+            for (int c = 0; c < 3; ++c) {
+                if (std::abs(out.rgb[p * 3 + c] - expected.rgb[p * 3 + c]) > 2) {
+                    rgbOutliers++;
+                    break;
+                }
+            }
+        }
+        std::cout << "    scale " << scale << ": " << maskDiff << " mask differences, max depth difference "
+                  << maxDepthDiff << " (relative), " << rgbOutliers << " RGB outliers" << std::endl;
+        TEST_ASSERT(cleared, "Invalid pixels are cleared");
+        TEST_ASSERT(maskDiff * 200 < out.mask.size(), "Coverage matches the mesh path");
+        TEST_ASSERT(maxDepthDiff < 1e-3f, "Depth matches the mesh path");
+        TEST_ASSERT(rgbOutliers * 200 < out.mask.size(), "RGB matches the mesh path");
+    }
+    
+    // Pixels of quads across the foreground silhouette are not interpolated
+    rgbd::RenderOutput out;
+    TEST_ASSERT(resample->render(K, K, 0.1f, 100.0f, out), "Identity render succeeded");
+    size_t bridged = 0;
+    for (size_t p = 0; p < out.depth.size(); ++p) {
+        if (out.depth[p] > 2.6f && out.depth[p] < 4.9f) bridged++;
+    }
+    TEST_ASSERT(bridged == 0, "No depth interpolated across discontinuities");
+    
+    // Far plane in between foreground and background
+    TEST_ASSERT(resample->render(K, K, 0.1f, 3.0f, out), "Clipped render succeeded");
+    bool clipped = true;
+    for (float z : out.depth) {
+        clipped = clipped && z <= 3.0f;
+    }
+    TEST_ASSERT(clipped, "Depth beyond the far plane dropped");
+    
+    rgbd::app::Config config;
+    config.rgbPath = "rgb.png";
+    config.depthPath = "depth.exr";
+    config.backend = "resample";
+    TEST_ASSERT(config.validate().empty() && config.usesDepthGrid(), "Resample backend accepted");
+    config.adaptiveError = 0.5f;
+    TEST_ASSERT(!config.validate().empty(), "Adaptive meshing rejected");
+    
+    resample->cleanup();
+    TEST_ASSERT(!resample->render(K, K, 0.1f, 100.0f, out), "Render without inputs fails");
+    return true;
+}
+
+/**
+ * Test ray tables, distorted sources and target distortion
+ */
+bool testCameraModel() {
+    std::cout << "\n=== Testing Camera Model ===" << std::endl;
+    
+    cv::Mat rgb, depth;
+    generateTestData(rgb, depth, 160, 120);
+    rgbd::Intrinsics K(130.0f, 128.0f, 81.0f, 59.5f, 160, 120);
+    rgbd::Intrinsics Kd = K;
+    Kd.distortion.k1 = -0.2f;
+    Kd.distortion.k2 = 0.05f;
+    Kd.distortion.p1 = 0.001f;
+    Kd.distortion.p2 = -0.0005f;
+    TEST_ASSERT(K.isPinhole() && !Kd.isPinhole(), "Distortion detected");
+    TEST_ASSERT(Kd.scaled(2.0f).distortion == Kd.distortion &&
+                Kd.withResolution(320, 240).distortion == Kd.distortion, "Derived intrinsics keep the lens");
+    
+    // Tables are built once per camera and shared
+    size_t builds = rgbd::mesh::RayTable::buildCount();
+    auto pinhole = rgbd::mesh::RayTable::get(K, 160, 120);
+    TEST_ASSERT(rgbd::mesh::RayTable::get(K, 160, 120) == pinhole, "Cached table reused");
+    TEST_ASSERT(rgbd::mesh::RayTable::buildCount() <= builds + 1, "Table built at most once");
+    TEST_ASSERT(rgbd::mesh::RayTable::get(K, 80, 60) != pinhole, "Size is part of the key");
+    
+    bool exact = true;
+    for (int v = 0; v < 120; ++v) {
+        for (int u = 0; u < 160; ++u) {
+            exact = exact && pinhole->rowX(v)[u] == (u + 0.5f - K.cx) / K.fx &&
+                    pinhole->rowY(v)[u] == (v + 0.5f - K.cy) / K.fy;
+        }
+    }
+    TEST_ASSERT(exact, "Pinhole rays in closed form");
+    
+    // Distorting the ray of a pixel lands on its center
+    auto rays = rgbd::mesh::RayTable::get(Kd, 160, 120);
+    TEST_ASSERT(rays->unconvergedCount() == 0, "Undistortion converged everywhere");
+    float maxError = 0.0f;
+    for (int v = 0; v < 120; ++v) {
+        for (int u = 0; u < 160; ++u) {
+            float x = rays->rowX(v)[u];
+            float y = rays->rowY(v)[u];
+            Kd.distortion.apply(x, y);
+            maxError = std::max({ maxError, std::abs(x * Kd.fx + Kd.cx - (u + 0.5f)),
+                                  std::abs(y * Kd.fy + Kd.cy - (v + 0.5f)) });
+        }
+    }
+    std::cout << "    max reprojection error of the rays: " << maxError << " px" << std::endl;
+    TEST_ASSERT(maxError < 1e-3f, "Rays reproject onto the pixel centers");
+    
+    // Float32 back-projection matches the DepthPixel decode bit for bit
+    rgbd::mesh::MeshGenerator generator;
+    rgbd::Mesh floatMesh = generator.generate(depth, K);
+    generator.setVertexLayout(rgbd::VertexLayout::DepthPixel);
+    rgbd::Mesh pixelMesh = generator.generate(depth, K);
+    bool same = floatMesh.numVertices() == pixelMesh.numVertices();
+    for (size_t i = 0; same && i < floatMesh.numVertices(); ++i) {
+        rgbd::Vertex a = floatMesh.vertex(i, K);
+        rgbd::Vertex b = pixelMesh.vertex(i, K);
+        same = a.x == b.x && a.y == b.y && a.z == b.z && a.u == b.u && a.v == b.v;
+    }
+    TEST_ASSERT(same, "Ray table matches the DepthPixel decode");
+    TEST_ASSERT(generator.generate(depth, Kd).empty(), "DepthPixel rejects a distorted source");
+    
+    // Rendering a distorted source with its own lens reproduces the input
+    rgbd::DepthThresholds thresh(0.05f, 0.1f);
+    rgbd::mesh::DepthMesh depthMesh;
+    TEST_ASSERT(depthMesh.build(rgb, depth, Kd, thresh), "Distorted mesh built");
+    rgbd::render::CpuRenderer cpu;
+    TEST_ASSERT(cpu.initialize(), "CPU renderer initialized");
+    TEST_ASSERT(cpu.uploadMesh(depthMesh.getMesh()), "Mesh uploaded");
+    TEST_ASSERT(cpu.uploadTexture(depthMesh.getTexture()), "Texture uploaded");
+    rgbd::RenderOutput out;
+    TEST_ASSERT(cpu.render(Kd, Kd, 0.1f, 100.0f, out), "Distorted render succeeded");
+    size_t covered = 0, depthOutliers = 0, rgbOutliers = 0;
+    for (int v = 0; v < 120; ++v) {
+        for (int u = 0; u < 160; ++u) {
+            size_t p = static_cast<size_t>(v) * 160 + u;
+            if (!out.mask[p]) continue;
+            covered++;
+            if (std::abs(out.depth[p] - depth.at<float>(v, u)) > 1e-3f * depth.at<float>(v, u)) {
+                depthOutliers++;
+            }
+            const cv::Vec3b& c = rgb.at<cv::Vec3b>(v, u);
+            if (std::abs(out.rgb[p * 3] - c[2]) > 2 || std::abs(out.rgb[p * 3 + 2] - c[0]) > 2) {
+                rgbOutliers++;
+            }
+        }
+    }
+    std::cout << "    distorted round trip: " << covered << " pixels covered, " << depthOutliers
+              << " depth and " << rgbOutliers << " RGB outliers" << std::endl;
+    TEST_ASSERT(covered * 100 > 160 * 120 * 95, "Round trip covers the frame");
+    TEST_ASSERT(depthOutliers * 200 < covered && rgbOutliers * 200 < covered, "Round trip reproduces the input");
+    
+    // A pinhole render of the distorted source is a different image
+    rgbd::RenderOutput rectified;
+    TEST_ASSERT(cpu.render(Kd, K, 0.1f, 100.0f, rectified), "Undistorted render succeeded");
+    TEST_ASSERT(rectified.depth != out.depth, "Target distortion changes the image");
+    
+    // Target distortion on GL matches the CPU rasterizer
+    rgbd::render::GLRenderer gl;
+    if (!gl.initialize()) {
+        std::cerr << "  GL comparison skipped (no GPU?)" << std::endl;
+        return true;
+    }
+    TEST_ASSERT(gl.uploadMesh(depthMesh.getMesh()), "GL mesh uploaded");
+    TEST_ASSERT(gl.uploadTexture(depthMesh.getTexture()), "GL texture uploaded");
+    float scales[] = { 0.75f, 1.0f, 1.5f };
+    for (float scale : scales) {
+        rgbd::Intrinsics target = Kd.scaled(scale);
+        rgbd::RenderOutput expected, actual;
+        TEST_ASSERT(gl.render(Kd, target, 0.1f, 100.0f, expected), "GL render succeeded");
+        TEST_ASSERT(cpu.render(Kd, target, 0.1f, 100.0f, actual), "CPU render succeeded");
+        size_t maskDiff = 0;
+        float maxDepthDiff = 0.0f;
+        for (size_t p = 0; p < actual.mask.size(); ++p) {
+            if (actual.mask[p] != expected.mask[p]) {
+                maskDiff++;
+            } else if (actual.mask[p]) {
+                maxDepthDiff = std::max(maxDepthDiff,
+                                        std::abs(actual.depth[p] - expected.depth[p]) / expected.depth[p]);
+            }
+        }
+        std::cout << "    scale " << scale << ": " << maskDiff << " mask differences, max depth difference "
+                  << maxDepthDiff << " (relative)" << std::endl;
+        TEST_ASSERT(maskDiff * 200 < actual.mask.size(), "Coverage matches GL");
+        TEST_ASSERT(maxDepthDiff < 1e-3f, "Depth matches GL");
+    }
+    
+    // Batch targets share one lens
+    std::vector<rgbd::RenderOutput> outputs;
+    TEST_ASSERT(!gl.renderBatch(Kd, { Kd, K }, 0.1f, 100.0f, outputs), "Mixed lenses rejected");
+    
+    // The implicit grid rebuilds pinhole rays only
+    gl.setRenderMode(rgbd::render::RenderMode::ImplicitGrid);
+    TEST_ASSERT(gl.uploadDepth(depth, thresh), "Depth grid uploaded");
+    rgbd::RenderOutput grid;
+    TEST_ASSERT(!gl.render(Kd, Kd, 0.1f, 100.0f, grid), "Grid rejects a distorted source");
+    gl.cleanup();
+    return true;
+}
+
+/**
+ * Test camera info parsing
+ */
+bool testCameraInfo() {
+    std::cout << "\n=== Testing Camera Info ===" << std::endl;
+    
+    fs::create_directories("test_output/camera_info");
+    const std::string path = "test_output/camera_info/frame_depth_camera_info.json";
+    {
+        std::ofstream file(path);
+        file << "{\n  \"header\": {\"frame_id\": \"cam\"},\n  \"height\": 480,\n  \"width\": 640,\n"
+             << "  \"K\": [392.5, 0.0, 320.25, 0.0, 391.0, 243.75, 0.0, 0.0, 1.0],\n"
+             << "  \"roi\": {\"height\": 0, \"width\": 0}\n}\n";
+    }
+    
+    rgbd::Intrinsics K;
+    TEST_ASSERT(rgbd::io::loadCameraInfo(path, K), "Camera info loaded");
+    TEST_ASSERT(K.fx == 392.5f && K.fy == 391.0f && K.cx == 320.25f && K.cy == 243.75f,
+                "K array parsed");
+    TEST_ASSERT(K.width == 640 && K.height == 480, "Top-level size used, not the ROI");
+    
+    {
+        std::ofstream file("test_output/camera_info/bad.json");
+        file << "{\"K\": [1.0, 2.0]}";
+    }
+    TEST_ASSERT(K.isPinhole(), "No D array: pinhole");
+    
+    // plumb_bob distortion and the rectified projection
+    const std::string distorted = "test_output/camera_info/distorted.json";
+    {
+        std::ofstream file(distorted);
+        file << "{\"height\": 480, \"width\": 640, \"distortion_model\": \"plumb_bob\",\n"
+             << " \"D\": [-0.25, 0.0625, 0.001, -0.002, 0.0078125],\n"
+             << " \"K\": [392.5, 0.0, 320.25, 0.0, 391.0, 243.75, 0.0, 0.0, 1.0],\n"
+             << " \"P\": [350.0, 0.0, 318.5, 0.0, 0.0, 351.0, 240.5, 0.0, 0.0, 0.0, 1.0, 0.0]}\n";
+    }
+    rgbd::Intrinsics rectified;
+    TEST_ASSERT(rgbd::io::loadCameraInfo(distorted, K, &rectified), "Distorted camera info loaded");
+    TEST_ASSERT(K.distortion.k1 == -0.25f && K.distortion.k2 == 0.0625f && K.distortion.p1 == 0.001f &&
+                K.distortion.p2 == -0.002f && K.distortion.k3 == 0.0078125f, "D array parsed");
+    TEST_ASSERT(rectified.fx == 350.0f && rectified.fy == 351.0f && rectified.cx == 318.5f &&
+                rectified.cy == 240.5f && rectified.width == 640 && rectified.isPinhole(),
+                "P array parsed");
+    
+    // Other models only without distortion
+    {
+        std::ofstream file("test_output/camera_info/equidistant.json");
+        file << "{\"distortion_model\": \"equidistant\", \"D\": [0.1, 0.0, 0.0, 0.0],\n"
+             << " \"K\": [392.5, 0.0, 320.25, 0.0, 391.0, 243.75, 0.0, 0.0, 1.0]}\n";
+        std::ofstream zero("test_output/camera_info/rational.json");
+        zero << "{\"distortion_model\": \"rational_polynomial\", \"D\": [0, 0, 0, 0, 0, 0, 0, 0],\n"
+             << " \"K\": [392.5, 0.0, 320.25, 0.0, 391.0, 243.75, 0.0, 0.0, 1.0]}\n";
+    }
+    TEST_ASSERT(!rgbd::io::loadCameraInfo("test_output/camera_info/equidistant.json", K),
+                "Unsupported distortion model rejected");
+    TEST_ASSERT(rgbd::io::loadCameraInfo("test_output/camera_info/rational.json", K) && K.isPinhole(),
+                "Zero coefficients of any model accepted");
+    
+    TEST_ASSERT(!rgbd::io::loadCameraInfo("test_output/camera_info/bad.json", K), "Short K rejected");
+    TEST_ASSERT(!rgbd::io::loadCameraInfo("test_output/camera_info/missing.json", K), "Missing file rejected");
+    
+    return true;
+}
+
+/**
+ * Test the multi-frame pipeline (CPU backend, no GPU needed)
+ */
+bool testBatchRunner() {
+    std::cout << "\n=== Testing Batch Runner ===" << std::endl;
+    
+    const std::string dir = "test_output/frames";
+    fs::remove_all(dir);
+    fs::create_directories(dir + "/out");
+    
+    // Three frames; the second has its own camera info
+    const int numFrames = 3;
+    for (int i = 0; i < numFrames; ++i) {
+        cv::Mat rgb, depth;
+        generateTestData(rgb, depth, 64 + 16 * i, 48);
+        std::string base = dir + "/f" + std::to_string(i);
+        TEST_ASSERT(rgbd::io::saveRGB(base + "_rgb.png", rgb), "Frame RGB written");
+        std::vector<float> values(depth.begin<float>(), depth.end<float>());
+        TEST_ASSERT(rgbd::io::saveDepthNPY(base + "_depth.npy", values, depth.cols, depth.rows),
+                    "Frame depth written");
+    }
+    {
+        std::ofstream file(dir + "/f1_depth_camera_info.json");
+        file << "{\"width\": 80, \"height\": 48, \"K\": [60, 0, 40, 0, 60, 24, 0, 0, 1]}";
+    }
+    
+    std::vector<rgbd::app::FrameSpec> frames;
+    TEST_ASSERT(rgbd::app::scanFrames(dir, frames), "Directory scanned");
+    TEST_ASSERT(frames.size() == numFrames, "All frames found");
+    TEST_ASSERT(frames[0].name == "f0" && frames[2].name == "f2", "Frames sorted by name");
+    TEST_ASSERT(frames[0].cameraInfoPath.empty() && !frames[1].cameraInfoPath.empty(),
+                "Camera info paired");
+    
+    std::vector<rgbd::app::FrameSpec> globbed;
+    TEST_ASSERT(rgbd::app::scanFrames(dir + "/f1_*.png", globbed) && globbed.size() == 1,
+                "Glob selects matching frames");
+    
+    {
+        std::ofstream file(dir + "/manifest.txt");
+        file << "# rgb depth [camera_info]\n\n"
+             << "f2_rgb.png f2_depth.npy\n"
+             << "f1_rgb.png f1_depth.npy f1_depth_camera_info.json\n"
+             << "missing_rgb.png missing_depth.npy\n";
+    }
+    std::vector<rgbd::app::FrameSpec> listed;
+    TEST_ASSERT(rgbd::app::loadManifest(dir + "/manifest.txt", listed), "Manifest loaded");
+    TEST_ASSERT(listed.size() == 3 && listed[0].name == "f2", "Manifest order kept");
+    TEST_ASSERT(fs::exists(listed[1].cameraInfoPath), "Manifest paths resolved against its directory");
+    
+    rgbd::app::Config config;
+    config.outputDir = dir + "/out";
+    config.backend = "cpu";
+    config.focalScales = {0.5f, 1.0f};
+    config.saveExr = false;
+    config.savePng = false;
+    config.frameQueue = 1;
+    
+    std::unique_ptr<rgbd::render::Renderer> renderer = rgbd::render::createRenderer("cpu", 2);
+    TEST_ASSERT(renderer->initialize(), "Renderer initialized");
+    
+    rgbd::app::OutputSink sink(config, 2);
+    rgbd::app::BatchRunner runner(config);
+    TEST_ASSERT(!runner.run(*renderer, listed, sink), "Missing frame reported");
+    TEST_ASSERT(runner.getProcessedCount() == 2 && runner.getFailedCount() == 1,
+                "Valid frames processed, missing frame skipped");
+    
+    TEST_ASSERT(runner.run(*renderer, frames, sink), "Directory frames processed");
+    TEST_ASSERT(runner.getProcessedCount() == numFrames, "Every frame rendered");
+    TEST_ASSERT(sink.finish(), "Outputs written");
+    
+    for (int i = 0; i < numFrames; ++i) {
+        std::string base = config.outputDir + "/f" + std::to_string(i) + "_scale_";
+        TEST_ASSERT(fs::exists(base + "0.50_rgb.png") && fs::exists(base + "1.00_mask.png"),
+                    "Per-frame outputs exist");
+    }
+    
+    renderer->cleanup();
+    return true;
+}
+
+/**
+ * Test the render server over a Unix domain socket
+ */
+bool testRenderServer() {
+    std::cout << "\n=== Testing Render Server ===" << std::endl;
+    
+    const std::string dir = "test_output/server";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const std::string socketPath = dir + "/rgbd.sock";
+    
+    // Inline sizes are checked against the payload before allocating
+    int pair[2];
+    TEST_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == 0, "Socket pair created");
+    {
+        const std::string header = "id 7\nrgb_data 60000 60000\n";
+        const uint32_t magic = 0x52424752, headerBytes = static_cast<uint32_t>(header.size());
+        const uint64_t payloadBytes = 16;
+        char frame[16 + 64] = {};
+        std::memcpy(frame, &magic, 4);
+        std::memcpy(frame + 4, &headerBytes, 4);
+        std::memcpy(frame + 8, &payloadBytes, 8);
+        std::memcpy(frame + 16, header.data(), header.size());
+        size_t frameBytes = 16 + header.size() + payloadBytes;
+        TEST_ASSERT(write(pair[0], frame, frameBytes) == static_cast<ssize_t>(frameBytes), "Oversized frame sent");
+        rgbd::app::RenderRequest request;
+        std::string error;
+        TEST_ASSERT(!rgbd::app::receiveRequest(pair[1], request, error) &&
+                    error.find("Payload too short") != std::string::npos && request.rgb.empty(),
+                    "Oversized inline image rejected");
+    }
+    close(pair[0]);
+    close(pair[1]);
+    
+    rgbd::app::Config config;
+    config.backend = "cpu";
+    config.fx = 60.0f;
+    config.fy = 60.0f;
+    config.focalScales = {0.5f, 1.0f};
+    config.saveExr = false;
+    config.savePng = false;
+    config.frameQueue = 1;
+    config.serveSocket = socketPath;
+    
+    std::unique_ptr<rgbd::render::Renderer> renderer = rgbd::render::createRenderer("cpu", 2);
+    TEST_ASSERT(renderer->initialize(), "Renderer initialized");
+    
+    rgbd::app::RenderServer server(config);
+    bool served = false;
+    std::thread serverThread([&]() { served = server.run(*renderer, socketPath); });
+    
+    int fd = -1;
+    for (int attempt = 0; attempt < 100 && fd < 0; ++attempt) {
+        if (fs::exists(socketPath)) {
+            fd = rgbd::app::connectUnixSocket(socketPath);
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+    TEST_ASSERT(fd >= 0, "Client connected");
+    
+    // Pipelined inline requests, then two that must fail
+    std::vector<cv::Mat> rgbs(3), depths(3);
+    for (int i = 0; i < 3; ++i) {
+        generateTestData(rgbs[i], depths[i], 48 + 16 * i, 40);
+        rgbd::app::RenderRequest request;
+        request.id = i + 1;
+        request.rgb = rgbs[i];
+        request.depth = depths[i];
+        if (i == 1) {
+            request.focalScales = {1.5f};
+        }
+        TEST_ASSERT(rgbd::app::sendRequest(fd, request), "Request sent");
+    }
+    rgbd::app::RenderRequest missing;
+    missing.id = 4;
+    missing.rgbPath = dir + "/missing_rgb.png";
+    missing.depthPath = dir + "/missing_depth.npy";
+    TEST_ASSERT(rgbd::app::sendRequest(fd, missing), "Request with missing files sent");
+    rgbd::app::RenderRequest invalid;
+    invalid.id = 5;
+    invalid.rgb = rgbs[0];
+    invalid.depth = depths[0];
+    invalid.nearPlane = 10.0f;
+    invalid.farPlane = 1.0f;
+    TEST_ASSERT(rgbd::app::sendRequest(fd, invalid), "Invalid request sent");
+    
+    std::map<uint64_t, rgbd::app::RenderResponse> responses;
+    for (int i = 0; i < 5; ++i) {
+        rgbd::app::RenderResponse response;
+        TEST_ASSERT(rgbd::app::receiveResponse(fd, response), "Response received");
+        responses[response.id] = std::move(response);
+    }
+    TEST_ASSERT(responses.size() == 5, "One response per request id");
+    TEST_ASSERT(!responses[4].ok && !responses[4].error.empty(), "Missing inputs reported");
+    TEST_ASSERT(!responses[5].ok && responses[5].error.find("near/far") != std::string::npos,
+                "Request fields validated");
+    
+    // Inline outputs match rendering the same frame directly
+    for (int i = 0; i < 3; ++i) {
+        const rgbd::app::RenderResponse& response = responses[i + 1];
+        rgbd::app::Config frameConfig = config;
+        if (i == 1) {
+            frameConfig.focalScales = {1.5f};
+        }
+        TEST_ASSERT(response.ok && response.outputs.size() == frameConfig.focalScales.size() &&
+                    response.scales == frameConfig.focalScales, "Every scale returned in order");
+        
+        rgbd::Intrinsics K(config.fx, config.fy, rgbs[i].cols / 2.0f, rgbs[i].rows / 2.0f,
+                           rgbs[i].cols, rgbs[i].rows);
+        rgbd::mesh::DepthMesh mesh;
+        TEST_ASSERT(mesh.build(rgbs[i], depths[i], K, config.getThresholds()), "Reference mesh built");
+        std::unique_ptr<rgbd::render::Renderer> reference = rgbd::render::createRenderer("cpu", 2);
+        reference->initialize();
+        reference->uploadMesh(mesh.getMesh());
+        reference->uploadTexture(mesh.getTexture());
+        bool same = true;
+        rgbd::app::renderFocalScales(*reference, K, frameConfig,
+            [&](size_t index, rgbd::RenderOutput&& output) {
+                const rgbd::RenderOutput& served = response.outputs[index];
+                same = same && served.width == output.width && served.height == output.height &&
+                       served.rgb == output.rgb && served.depth == output.depth &&
+                       served.mask == output.mask;
+            });
+        TEST_ASSERT(same, "Inline outputs match a direct render");
+        reference->cleanup();
+    }
+    
+    // Files: the response comes once they are written
+    rgbd::app::RenderRequest toFiles;
+    toFiles.id = 6;
+    toFiles.rgb = rgbs[0];
+    toFiles.depth = depths[0];
+    toFiles.outputDir = dir + "/out";
+    toFiles.name = "frame";
+    TEST_ASSERT(rgbd::app::sendRequest(fd, toFiles), "File request sent");
+    rgbd::app::RenderResponse written;
+    TEST_ASSERT(rgbd::app::receiveResponse(fd, written) && written.id == 6, "File response received");
+    TEST_ASSERT(written.outputs.empty() && written.files.size() == 4, "RGB and mask file per scale");
+    
+    // Stopping drains and removes the socket
+    server.stop();
+    serverThread.join();
+    ::close(fd);
+    TEST_ASSERT(served && server.getProcessedCount() == 4 && server.getFailedCount() == 2,
+                "Server counted rendered and failed requests");
+    TEST_ASSERT(!fs::exists(socketPath), "Socket removed on stop");
+    
+    bool filesExist = true;
+    for (const std::string& path : written.files) {
+        filesExist = filesExist && fs::exists(path);
+    }
+    TEST_ASSERT(written.ok && filesExist, "Files written before the response");
+    
+    renderer->cleanup();
+    return true;
+}
+
+/**
+ * Write a .npy file with an arbitrary header (version 1 or 2+)
+ */
+static void writeNpy(const std::string& path, int version, const std::string& dict,
+                     const void* data, size_t bytes) {
+    size_t prefix = (version == 1) ? 10 : 12;
+    std::string header = dict;
+    while ((prefix + header.size() + 1) % 64 != 0) header += ' ';
+    header += '\n';
+    
+    std::ofstream file(path, std::ios::binary);
+    file.write("\x93NUMPY", 6);
+    char ver[2] = { static_cast<char>(version), 0 };
+    file.write(ver, 2);
+    uint32_t len = static_cast<uint32_t>(header.size());
+    file.write(reinterpret_cast<const char*>(&len), (version == 1) ? 2 : 4);
+    file.write(header.data(), header.size());
+    file.write(static_cast<const char*>(data), bytes);
+}
+
+/**
+ * Test the memory-mapped NPY / PNM loaders
+ */
+bool testMappedIO() {
+    std::cout << "\n=== Testing Mapped IO ===" << std::endl;
+    
+    const std::string dir = "test_output/mapped";
+    fs::create_directories(dir);
+    const int H = 5, W = 19;  // Odd sizes exercise the SIMD tails
+    auto expected = [&](int r, int c) { return static_cast<float>(r * 100 + c); };
+    std::string shape = "'shape': (" + std::to_string(H) + ", " + std::to_string(W) + "), }";
+    
+    // float32, C order: wrapped without a copy
+    std::vector<float> f32(H * W);
+    for (int i = 0; i < H * W; ++i) f32[i] = expected(i / W, i % W);
+    writeNpy(dir + "/f4.npy", 1, "{'descr': '<f4', 'fortran_order': False, " + shape,
+             f32.data(), f32.size() * 4);
+    rgbd::io::MappedMat m = rgbd::io::mapNPY(dir + "/f4.npy");
+    TEST_ASSERT(!m.empty() && m.isZeroCopy(), "float32 NPY mapped without copy");
+    TEST_ASSERT(m.mat.rows == H && m.mat.cols == W && m.mat.at<float>(3, 17) == expected(3, 17),
+                "float32 values");
+    
+    // Other dtypes, version 2 header
+    std::vector<uint16_t> u16(H * W), f16(H * W);
+    std::vector<int32_t> i32(H * W);
+    std::vector<double> f64(H * W);
+    for (int i = 0; i < H * W; ++i) {
+        u16[i] = static_cast<uint16_t>(expected(i / W, i % W));
+        i32[i] = static_cast<int32_t>(expected(i / W, i % W)) - 1000;
+        f64[i] = expected(i / W, i % W) + 0.5;
+        f16[i] = static_cast<uint16_t>(0x3C00 + (i % 4) * 0x400);  // 1, 2, 4, 8
+    }
+    struct Case { const char* descr; const void* data; size_t bytes; };
+    Case cases[] = {
+        { "<u2", u16.data(), u16.size() * 2 }, { "<i4", i32.data(), i32.size() * 4 },
+        { "<f8", f64.data(), f64.size() * 8 }, { "<f2", f16.data(), f16.size() * 2 },
+    };
+    for (const Case& c : cases) {
+        std::string path = dir + "/" + std::string(c.descr + 1) + ".npy";
+        writeNpy(path, 2, std::string("{'descr': '") + c.descr + "', 'fortran_order': False, " + shape,
+                 c.data, c.bytes);
+        m = rgbd::io::mapNPY(path);
+        TEST_ASSERT(!m.empty() && !m.isZeroCopy() && m.mat.type() == CV_32F, "dtype converted to float32");
+        bool ok = true;
+        for (int i = 0; i < H * W; ++i) {
+            float v = m.mat.at<float>(i / W, i % W);
+            float want = (c.descr[1] == 'u') ? expected(i / W, i % W)
+                       : (c.descr[1] == 'i') ? expected(i / W, i % W) - 1000
+                       : (c.descr[2] == '8') ? expected(i / W, i % W) + 0.5f
+                       : static_cast<float>(1 << (i % 4));
+            ok = ok && v == want;
+        }
+        TEST_ASSERT(ok, std::string(c.descr) + " values match");
+    }
+    
+    // Fortran order stores columns contiguously
+    std::vector<float> columns(H * W);
+    for (int c = 0; c < W; ++c)
+        for (int r = 0; r < H; ++r) columns[c * H + r] = expected(r, c);
+    writeNpy(dir + "/fortran.npy", 3, "{'descr': '<f4', 'fortran_order': True, " + shape,
+             columns.data(), columns.size() * 4);
+    cv::Mat fortran = rgbd::io::loadDepthNPY(dir + "/fortran.npy");
+    TEST_ASSERT(!fortran.empty() && fortran.at<float>(4, 2) == expected(4, 2) &&
+                fortran.at<float>(1, 18) == expected(1, 18), "Fortran order transposed");
+    
+    // Scale is applied to the mapping's private pages, the file stays intact
+    m = rgbd::io::mapDepth(dir + "/f4.npy", 0.5f);
+    TEST_ASSERT(m.mat.at<float>(2, 3) == 0.5f * expected(2, 3), "Depth scale applied");
+    TEST_ASSERT(rgbd::io::mapNPY(dir + "/f4.npy").mat.at<float>(2, 3) == expected(2, 3),
+                "Mapped file unchanged");
+    
+    writeNpy(dir + "/big.npy", 1, "{'descr': '>f4', 'fortran_order': False, " + shape,
+             f32.data(), f32.size() * 4);
+    TEST_ASSERT(rgbd::io::mapNPY(dir + "/big.npy").empty(), "Big-endian rejected");
+    writeNpy(dir + "/short.npy", 1, "{'descr': '<f4', 'fortran_order': False, " + shape,
+             f32.data(), 8);
+    TEST_ASSERT(rgbd::io::mapNPY(dir + "/short.npy").empty(), "Truncated data rejected");
+    
+    // PGM / PPM
+    {
+        std::ofstream file(dir + "/gray.pgm", std::ios::binary);
+        file << "P5\n# comment\n3 2\n255\n";
+        const uint8_t px[6] = { 1, 2, 3, 4, 5, 6 };
+        file.write(reinterpret_cast<const char*>(px), 6);
+    }
+    m = rgbd::io::mapPNM(dir + "/gray.pgm");
+    TEST_ASSERT(m.isZeroCopy() && m.mat.type() == CV_8UC1 && m.mat.at<uint8_t>(1, 2) == 6,
+                "8-bit PGM mapped");
+    {
+        std::ofstream file(dir + "/depth.pgm", std::ios::binary);
+        file << "P5 2 1 65535\n";
+        const uint8_t px[4] = { 0x03, 0xE8, 0x07, 0xD0 };  // 1000, 2000 big-endian
+        file.write(reinterpret_cast<const char*>(px), 4);
+    }
+    m = rgbd::io::mapDepth(dir + "/depth.pgm", 0.001f);
+    TEST_ASSERT(!m.empty() && std::abs(m.mat.at<float>(0, 1) - 2.0f) < 1e-6f, "16-bit PGM depth");
+    {
+        std::ofstream file(dir + "/color.ppm", std::ios::binary);
+        file << "P6\n1 1\n255\n";
+        file.write("\x0a\x14\x1e", 3);
+    }
+    m = rgbd::io::mapPNM(dir + "/color.ppm");
+    TEST_ASSERT(m.mat.type() == CV_8UC3 && m.mat.at<cv::Vec3b>(0, 0)[2] == 30, "PPM mapped in RGB order");
+    
+    return true;
+}
+
+/**
+ * Test the background output sink
+ */
+bool testOutputSink() {
+    std::cout << "\n=== Testing Output Sink ===" << std::endl;
+    
+    fs::create_directories("test_output/sink");
+    
+    rgbd::app::Config config;
+    config.outputDir = "test_output/sink";
+    config.saveExr = false;
+    config.savePng = true;
+    config.saveNpy = true;
+    
+    const int numOutputs = 6;
+    {
+        rgbd::app::OutputSink sink(config, 3);
+        TEST_ASSERT(sink.getThreadCount() == 3, "Encoder threads started");
+        
+        for (int i = 0; i < numOutputs; ++i) {
+            rgbd::RenderOutput output;
+            output.allocate(48, 32);
+            for (size_t p = 0; p < output.depth.size(); ++p) {
+                output.depth[p] = 1.0f + 0.25f * i;
+                output.mask[p] = 255;
+            }
+            TEST_ASSERT(sink.submit("out_" + std::to_string(i), std::move(output)), "Output queued");
+            TEST_ASSERT(output.depth.empty(), "Sink took ownership of the buffers");
+        }
+        
+        TEST_ASSERT(sink.finish(), "All files written");
+        TEST_ASSERT(sink.getWrittenCount() == numOutputs * 4, "RGB, depth PNG, NPY and mask per output");
+        TEST_ASSERT(sink.getFailedCount() == 0, "No failures");
+        
+        rgbd::RenderOutput late;
+        late.allocate(4, 4);
+        TEST_ASSERT(!sink.submit("late", std::move(late)), "Submit after finish rejected");
+    }
+    
+    for (int i = 0; i < numOutputs; ++i) {
+        std::string base = "test_output/sink/out_" + std::to_string(i);
+        TEST_ASSERT(fs::exists(base + "_rgb.png") && fs::exists(base + "_mask.png") &&
+                    fs::exists(base + "_depth.png"), "Image files exist");
+        cv::Mat depth = rgbd::io::loadDepthNPY(base + "_depth.npy");
+        TEST_ASSERT(!depth.empty() && std::abs(depth.at<float>(5, 7) - (1.0f + 0.25f * i)) < 1e-6f,
+                    "NPY content matches its output");
+    }
+    
+    // Failures are collected rather than aborting the remaining files
+    config.outputDir = "test_output/sink/missing_dir";
+    config.saveNpy = false;
+    rgbd::app::OutputSink failing(config, 2);
+    rgbd::RenderOutput output;
+    output.allocate(8, 8);
+    failing.submit("out", std::move(output));
+    TEST_ASSERT(!failing.finish(), "Failed writes reported");
+    TEST_ASSERT(failing.getFailedCount() == 3, "Every failed file counted");
+    
+    return true;
+}
+
+/**
+ * Test EXR compression, HALF depth and multi-channel / multi-part bundles
+ */
+bool testExrOutput() {
+    std::cout << "\n=== Testing EXR Output ===" << std::endl;
+    
+    const rgbd::io::ExrCompression methods[] = {
+        rgbd::io::ExrCompression::None, rgbd::io::ExrCompression::ZIP, rgbd::io::ExrCompression::ZIPS,
+        rgbd::io::ExrCompression::PIZ, rgbd::io::ExrCompression::DWAA
+    };
+    for (rgbd::io::ExrCompression method : methods) {
+        rgbd::io::ExrCompression parsed;
+        TEST_ASSERT(rgbd::io::parseExrCompression(rgbd::io::exrCompressionName(method), parsed) &&
+                    parsed == method, "Compression name round trip");
+    }
+    rgbd::io::ExrCompression unknown;
+    TEST_ASSERT(!rgbd::io::parseExrCompression("b44", unknown), "Unknown compression rejected");
+    
+    rgbd::app::Config config;
+    config.rgbPath = "rgb.png";
+    config.depthPath = "depth.png";
+    config.exrBundle = "layers";
+    TEST_ASSERT(!config.validate().empty(), "Unknown bundle rejected");
+    config.exrBundle = "scale";
+    TEST_ASSERT(config.validate().empty() == rgbd::io::exrAvailable(), "Bundles need OpenEXR");
+    
+    if (!rgbd::io::exrAvailable()) {
+        std::cerr << "SKIPPED: Built without OpenEXR" << std::endl;
+        return true;
+    }
+    
+    fs::create_directories("test_output/exr");
+    auto makeOutput = [](int width, int height, float offset) {
+        rgbd::RenderOutput output;
+        output.allocate(width, height);
+        for (int p = 0; p < width * height; ++p) {
+            output.depth[p] = (p % 11 == 0) ? 0.0f : offset + 0.001f * p;
+            output.mask[p] = output.depth[p] > 0 ? 1 : 0;
+            for (int c = 0; c < 3; ++c) {
+                output.rgb[p * 3 + c] = static_cast<uint8_t>(p * (c + 1));
+            }
+        }
+        return output;
+    };
+    rgbd::RenderOutput output = makeOutput(64, 48, 1.0f);
+    auto maxDepthError = [&](const cv::Mat& depth, const rgbd::RenderOutput& expected, bool relative) {
+        float error = 0.0f;
+        for (int v = 0; v < depth.rows; ++v) {
+            for (int u = 0; u < depth.cols; ++u) {
+                float z = expected.depth[v * expected.width + u];
+                float diff = std::abs(depth.at<float>(v, u) - z);
+                error = std::max(error, relative && z > 0 ? diff / z : diff);
+            }
+        }
+        return error;
+    };
+    
+    // FLOAT depth stays lossless with every method, DWAA included
+    for (rgbd::io::ExrCompression method : methods) {
+        rgbd::io::ExrOptions options;
+        options.compression = method;
+        std::string path = std::string("test_output/exr/bundle_") + rgbd::io::exrCompressionName(method) + ".exr";
+        TEST_ASSERT(rgbd::io::saveOutputsEXR(path, { { "", &output } }, options), "Bundle written");
+        cv::Mat depth = rgbd::io::loadDepth(path);
+        TEST_ASSERT(depth.cols == 64 && depth.rows == 48 && maxDepthError(depth, output, false) == 0.0f,
+                    "Z channel loaded losslessly");
+        std::cout << "  " << rgbd::io::exrCompressionName(method) << ": " << fs::file_size(path)
+                  << " bytes" << std::endl;
+    }
+    
+    rgbd::io::ExrOptions half;
+    half.halfDepth = true;
+    TEST_ASSERT(rgbd::io::saveDepthEXR("test_output/exr/half.exr", output.depth, 64, 48, half),
+                "HALF depth written");
+    cv::Mat halfDepth = rgbd::io::loadDepth("test_output/exr/half.exr");
+    TEST_ASSERT(!halfDepth.empty() && maxDepthError(halfDepth, output, true) < 1e-3f,
+                "HALF depth within its precision");
+    
+    // Frame bundle: one multi-part file, depth NPY still per scale
+    config.outputDir = "test_output/exr";
+    config.exrBundle = "frame";
+    config.savePng = false;
+    config.saveNpy = true;
+    {
+        rgbd::app::OutputSink sink(config, 2);
+        TEST_ASSERT(sink.bundlesFrames(), "Sink bundles frames");
+        std::vector<rgbd::RenderOutput> outputs;
+        outputs.push_back(makeOutput(64, 48, 2.0f));
+        outputs.push_back(makeOutput(64, 48, 3.0f));
+        std::vector<rgbd::RenderOutput> unnamed(3);
+        TEST_ASSERT(!sink.submitFrame("frame_", { "scale_1.00" }, std::move(unnamed)),
+                    "Part name count must match the outputs");
+        TEST_ASSERT(sink.submitFrame("frame_", { "scale_1.00", "scale_2.00" }, std::move(outputs)),
+                    "Frame queued");
+        TEST_ASSERT(sink.finish() && sink.getWrittenCount() == 3, "Bundle and NPY files written");
+    }
+    TEST_ASSERT(fs::exists("test_output/exr/frame_scales.exr") &&
+                fs::exists("test_output/exr/frame_scale_2.00_depth.npy") &&
+                !fs::exists("test_output/exr/frame_scale_1.00_rgb.png"), "Bundled file set");
+    cv::Mat first = rgbd::io::loadDepth("test_output/exr/frame_scales.exr");
+    TEST_ASSERT(!first.empty() && maxDepthError(first, makeOutput(64, 48, 2.0f), false) == 0.0f,
+                "First part loaded");
+    
+    return true;
+}
+
+/**
+ * Read a whole file (empty if missing)
+ */
+static std::vector<uint8_t> readFileBytes(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Parse the regular members of a tar file (pax 'path' records applied)
+ * @return false on a bad header checksum or a truncated archive
+ */
+static bool parseTar(const std::vector<uint8_t>& tar, std::vector<rgbd::io::TarMember>& members) {
+    size_t offset = 0;
+    std::string longName;
+    while (offset + 512 <= tar.size()) {
+        const char* header = reinterpret_cast<const char*>(tar.data() + offset);
+        if (header[0] == 0) {
+            return true;  // End-of-archive block
+        }
+        unsigned int checksum = 0;
+        for (int i = 0; i < 512; ++i) {
+            checksum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(header[i]);
+        }
+        if (checksum != std::stoul(std::string(header + 148, 6), nullptr, 8)) {
+            return false;
+        }
+        size_t size = std::stoull(std::string(header + 124, 11), nullptr, 8);
+        offset += 512;
+        if (offset + size > tar.size()) {
+            return false;
+        }
+        std::string body(tar.begin() + offset, tar.begin() + offset + size);
+        if (header[156] == 'x') {
+            size_t start = body.find(" path=") + 6;
+            longName = body.substr(start, body.find('\n', start) - start);
+        } else {
+            std::string name = longName.empty() ? std::string(header, strnlen(header, 100)) : longName;
+            members.push_back({name, std::vector<uint8_t>(body.begin(), body.end())});
+            longName.clear();
+        }
+        offset += (size + 511) / 512 * 512;
+    }
+    return false;
+}
+
+/**
+ * Test rolling tar shards and the tar mode of the output sink
+ */
+bool testTarShards() {
+    std::cout << "\n=== Testing Tar Shards ===" << std::endl;
+    
+    fs::remove_all("test_output/tar");
+    fs::create_directories("test_output/tar");
+    
+    // Five samples of 2 KiB in the archive each: two per 4 KiB shard
+    auto makeSample = [](int i) {
+        std::vector<rgbd::io::TarMember> sample(2);
+        sample[0].name = "sample_" + std::to_string(i) + ".rgb.png";
+        sample[1].name = (i == 4 ? std::string(120, 'k') : "sample_" + std::to_string(i)) + ".depth.npy";
+        for (int b = 0; b < 300; ++b) sample[0].data.push_back(static_cast<uint8_t>(b * (i + 1)));
+        for (int b = 0; b < 10; ++b) sample[1].data.push_back(static_cast<uint8_t>(i));
+        return sample;
+    };
+    for (const char* name : { "a", "b" }) {
+        rgbd::io::TarShardWriter writer("test_output/tar", name, 4096, true);
+        for (int i = 0; i < 5; ++i) {
+            TEST_ASSERT(writer.append(makeSample(i)), "Sample appended");
+        }
+        TEST_ASSERT(writer.close(), "Shard closed");
+        TEST_ASSERT(writer.getShardCount() == 3, "Samples rolled over at the size limit");
+        TEST_ASSERT(writer.shardPath(2) == "test_output/tar/" + std::string(name) + "-000002.tar",
+                    "Shard naming");
+    }
+    
+    for (int shard = 0; shard < 3; ++shard) {
+        std::string path = "test_output/tar/a-00000" + std::to_string(shard);
+        std::vector<uint8_t> tar = readFileBytes(path + ".tar");
+        TEST_ASSERT(tar == readFileBytes("test_output/tar/b-00000" + std::to_string(shard) + ".tar"),
+                    "Identical members give identical shards");
+        TEST_ASSERT(tar.size() % 512 == 0 && (shard == 2 || tar.size() <= 4096 + 1024),
+                    "Shard within its size limit");
+        
+        std::vector<rgbd::io::TarMember> members;
+        TEST_ASSERT(parseTar(tar, members), "Valid ustar headers");
+        TEST_ASSERT(members.size() == (shard == 2 ? 2u : 4u), "Whole samples per shard");
+        for (size_t m = 0; m < members.size(); ++m) {
+            std::vector<rgbd::io::TarMember> expected = makeSample(shard * 2 + static_cast<int>(m / 2));
+            TEST_ASSERT(members[m].name == expected[m % 2].name && members[m].data == expected[m % 2].data,
+                        "Members in order with their data");
+        }
+        
+        // Index: data offsets into the shard
+        std::ifstream index(path + ".idx");
+        std::string name;
+        size_t offset = 0, size = 0, entries = 0;
+        while (index >> name >> offset >> size) {
+            TEST_ASSERT(name == members[entries].name && size == members[entries].data.size() &&
+                        std::equal(members[entries].data.begin(), members[entries].data.end(),
+                                   tar.begin() + offset), "Index points at the member data");
+            entries++;
+        }
+        TEST_ASSERT(entries == members.size(), "Every member indexed");
+    }
+    
+    rgbd::app::Config config;
+    config.rgbPath = "rgb.png";
+    config.depthPath = "depth.png";
+    config.tarShardMB = -1;
+    TEST_ASSERT(!config.validate().empty(), "Negative shard size rejected");
+    
+    // Sink: one sample per output, appended in submission order
+    config.outputDir = "test_output/tar";
+    config.tarShardMB = 1;
+    config.saveExr = false;
+    config.savePng = false;
+    config.saveNpy = true;
+    const int numOutputs = 8;
+    {
+        rgbd::app::OutputSink sink(config, 3);
+        TEST_ASSERT(sink.writesTar(), "Sink writes tar shards");
+        for (int i = 0; i < numOutputs; ++i) {
+            rgbd::RenderOutput output;
+            output.allocate(32, 24);
+            output.rgb.clear();
+            output.mask.clear();
+            for (size_t p = 0; p < output.depth.size(); ++p) {
+                output.depth[p] = 1.0f + i;
+            }
+            TEST_ASSERT(sink.submit("frame_scale_" + std::to_string(i) + ".50", std::move(output)),
+                        "Output queued");
+        }
+        TEST_ASSERT(sink.finish() && sink.getWrittenCount() == numOutputs, "Members written");
+    }
+    std::vector<rgbd::io::TarMember> members;
+    TEST_ASSERT(parseTar(readFileBytes("test_output/tar/shard-000000.tar"), members) &&
+                members.size() == numOutputs, "Sink shard readable");
+    for (int i = 0; i < numOutputs; ++i) {
+        TEST_ASSERT(members[i].name == "frame_scale_" + std::to_string(i) + "_50.depth.npy",
+                    "WebDataset member names in submission order");
+        std::vector<uint8_t> npy;
+        TEST_ASSERT(rgbd::io::encodeDepthNPY(std::vector<float>(32 * 24, 1.0f + i), 32, 24, npy) &&
+                    members[i].data == npy, "Member holds the encoded file");
+    }
+    
+    return true;
+}
+
+/**
+ * Test trace recording, GPU timer spans and the trace-event JSON
+ */
+bool testTrace() {
+    std::cout << "\n=== Testing Trace ===" << std::endl;
+    
+    if (!rgbd::trace::compiledIn()) {
+        std::cerr << "SKIPPED: Built without tracing" << std::endl;
+        return true;
+    }
+    
+    TEST_ASSERT(!rgbd::trace::enabled(), "Not recording by default");
+    { RGBD_TRACE_SCOPE("before start"); }
+    TEST_ASSERT(rgbd::trace::start() && rgbd::trace::enabled(), "Recording started");
+    TEST_ASSERT(rgbd::trace::eventCount() == 0, "Nothing recorded before start");
+    
+    {
+        RGBD_TRACE_SCOPE("outer");
+        RGBD_TRACE_SCOPE("inner");
+    }
+    std::thread worker([]() {
+        rgbd::trace::setThreadName("test \"worker\"");
+        RGBD_TRACE_SCOPE("worker span");
+    });
+    worker.join();
+    TEST_ASSERT(rgbd::trace::eventCount() == 3, "Spans of both threads recorded");
+    
+    // GPU spans of a render, collected at the latest by cleanup()
+    bool gpu = false;
+    {
+        cv::Mat rgb, depth;
+        generateTestData(rgb, depth, 64, 64);
+        rgbd::Intrinsics K(50.0f, 50.0f, 32.0f, 32.0f, 64, 64);
+        rgbd::mesh::DepthMesh depthMesh;
+        rgbd::render::GLRenderer renderer;
+        if (depthMesh.build(rgb, depth, K) && renderer.initialize()) {
+            rgbd::RenderOutput output;
+            TEST_ASSERT(renderer.uploadMesh(depthMesh.getMesh()) &&
+                        renderer.uploadTexture(depthMesh.getTexture()) &&
+                        renderer.render(K, K.scaled(1.5f), 0.1f, 100.0f, output), "Traced render");
+            renderer.cleanup();
+            gpu = true;
+        }
+    }
+    
+    rgbd::trace::stop();
+    { RGBD_TRACE_SCOPE("after stop"); }
+    
+    fs::create_directories("test_output");
+    TEST_ASSERT(rgbd::trace::writeJson("test_output/trace.json"), "Trace written");
+    std::ifstream file("test_output/trace.json");
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    TEST_ASSERT(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0 &&
+                json.find("\n]}") != std::string::npos, "Trace-event JSON object");
+    TEST_ASSERT(json.find("\"name\":\"outer\"") != std::string::npos &&
+                json.find("\"name\":\"inner\"") != std::string::npos &&
+                json.find("\"name\":\"worker span\"") != std::string::npos, "CPU spans written");
+    TEST_ASSERT(json.find("\"name\":\"test \\\"worker\\\"\"") != std::string::npos, "Escaped thread name");
+    TEST_ASSERT(json.find("before start") == std::string::npos &&
+                json.find("after stop") == std::string::npos, "Only spans while recording");
+    
+    // Per-connection threads must not grow the registry
+    size_t logs = rgbd::trace::logCount();
+    for (int i = 0; i < 8; ++i) {
+        std::thread([]() { rgbd::trace::setThreadName("connection"); }).join();
+    }
+    TEST_ASSERT(rgbd::trace::logCount() == logs, "Naming threads while stopped takes no log");
+    TEST_ASSERT(rgbd::trace::start(), "Recording restarted");
+    std::thread([]() { RGBD_TRACE_SCOPE("reused"); }).join();
+    rgbd::trace::stop();
+    TEST_ASSERT(rgbd::trace::logCount() == logs && rgbd::trace::eventCount() == 1,
+                "Empty log of an exited thread reused");
+    
+    if (!gpu) {
+        std::cerr << "SKIPPED: GPU spans (no GPU?)" << std::endl;
+        return true;
+    }
+    TEST_ASSERT(json.find("\"name\":\"glReadPixels async\"") != std::string::npos &&
+                json.find("\"name\":\"DepthMesh::build\"") != std::string::npos, "Pipeline stages traced");
+    TEST_ASSERT(json.find("\"cat\":\"gpu\",\"name\":\"draw\"") != std::string::npos &&
+                json.find("\"cat\":\"gpu\",\"name\":\"readback\"") != std::string::npos &&
+                json.find("GPU context") != std::string::npos, "GPU timer spans on the context track");
+    
+    return true;
+}
+
 /**
  * Test IO functions
  */
@@ -323,10 +2831,35 @@ int main() {
     };
     
     runTest(testDepthThresholds, "Depth Thresholds");
+    runTest(testEdgeMask, "Edge Mask Kernel");
+    runTest(testPixelKernels, "Pixel Kernels");
     runTest(testMeshGeneration, "Mesh Generation");
+    runTest(testParallelMeshGeneration, "Parallel Mesh Generation");
+    runTest(testVertexLayouts, "Vertex Layouts");
+    runTest(testIndexModes, "Index Modes");
+    runTest(testMeshletCulling, "Meshlet Culling");
+    runTest(testSequenceMesh, "Sequence Mesh");
+    runTest(testAdaptiveMesh, "Adaptive Mesh");
     runTest(testDepthMesh, "Depth Mesh");
     runTest(testIO, "IO Functions");
+    runTest(testMappedIO, "Mapped IO");
+    runTest(testOutputSink, "Output Sink");
+    runTest(testExrOutput, "EXR Output");
+    runTest(testTarShards, "Tar Shards");
+    runTest(testCameraInfo, "Camera Info");
+    runTest(testCameraModel, "Camera Model");
+    runTest(testBatchRunner, "Batch Runner");
+    runTest(testRenderServer, "Render Server");
     runTest(testRenderer, "OpenGL Renderer");
+    runTest(testImplicitGridRenderer, "Implicit Grid Renderer");
+    runTest(testShaderCache, "Shader Cache");
+    runTest(testPipelinedReadback, "Pipelined Readback");
+    runTest(testBatchRenderer, "Batch Renderer");
+    runTest(testRenderOutputs, "Render Outputs");
+    runTest(testRenderPool, "Render Pool");
+    runTest(testCpuRenderer, "CPU Renderer");
+    runTest(testResampleRenderer, "Resample Renderer");
+    runTest(testTrace, "Trace");
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "  Results: " << passed << "/" << total << " tests passed" << std::endl;